@@ -0,0 +1,185 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.Compression
+{
+    /// <summary>
+    /// Class defining methods for decompressing the byte-oriented LZ77 block compression stream of the firmware
+    /// (blockcompress.c). Each token is either a literal run (0xxxxxxx, followed by x + 1 literal bytes) or a match
+    /// (1xxxxxxx, followed by an optional length extension and then the distance - 1). A match copies x + 3 bytes
+    /// from up to 1024 bytes back in the output. The distance is a variable-length integer, and when x is 127, another
+    /// one follows the token and the match length is 130 plus its value.
+    /// </summary>
+    public class BlockDecompressor : IDecompressor
+    {
+        private const int HistorySize = 1024;
+        private const int MinMatch = 3;
+        private const int ShortMatch = 127;
+
+        private enum States
+        {
+            Token,
+            Literal,
+            Extension,
+            Distance
+        }
+
+        private byte[] history;
+        private int historyPos;
+        private States state;
+        private int literalCount;
+        private UInt32 matchLength;
+        private UInt32 varint;
+        private int varintShift;
+
+        // Definition for callback function for each output byte.
+        public delegate void OutputByte(byte b);
+        private OutputByte Callback;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates a BlockDecompressor object for use in decompressing data dynamically.
+        /// </summary>
+        /// <param name="Callback">A function that will be called for each decompressed
+        /// output byte.</param>
+        public BlockDecompressor(OutputByte Callback)
+        {
+            if (Callback == null)
+                throw new Exception("A Callback function must be specified");
+
+            this.Callback = Callback;
+
+            history = new byte[HistorySize];
+            historyPos = 0;
+            state = States.Token;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Decodes (decompresses) a sequence of bytes.
+        /// </summary>
+        /// <param name="Data">An array of bytes to be decoded (decompressed)</param>
+        public void Decode(byte[] Data)
+        {
+            foreach (byte b in Data)
+                this.Decode(b);
+        }
+
+        /// <summary>
+        /// Decodes (decompresses) a byte of data.
+        /// </summary>
+        /// <param name="Data">A byte to be decoded (decompressed)</param>
+        public void Decode(byte Data)
+        {
+            switch (state)
+            {
+                case States.Token:
+                    if ((Data & 0x80) == 0)
+                    {
+                        literalCount = Data + 1;
+                        state = States.Literal;
+                    }
+                    else
+                    {
+                        matchLength = (UInt32)(Data & 0x7f) + MinMatch;
+                        state = (Data & 0x7f) == ShortMatch ? States.Extension : States.Distance;
+                    }
+                    varint = 0;
+                    varintShift = 0;
+                    break;
+
+                case States.Literal:
+                    output(Data);
+                    if (--literalCount == 0)
+                        state = States.Token;
+                    break;
+
+                case States.Extension:
+                    if (!readVarint(Data))
+                        break;
+
+                    matchLength += varint;
+                    varint = 0;
+                    varintShift = 0;
+                    state = States.Distance;
+                    break;
+
+                case States.Distance:
+                    if (!readVarint(Data))
+                        break;
+
+                    if (varint >= HistorySize)
+                        throw new Exception("BlockDecompressor.Decode: Invalid Match Distance");
+
+                    int from = (historyPos - ((int)varint + 1)) & (HistorySize - 1);
+
+                    // The match may overlap the bytes it produces (e.g. a run), so copy byte by byte.
+                    for (UInt32 i = 0; i < matchLength; i++)
+                    {
+                        output(history[from]);
+                        from = (from + 1) & (HistorySize - 1);
+                    }
+                    state = States.Token;
+                    break;
+            }
+        }
+
+        /// <summary>
+        /// Flushes any remaining data.
+        /// </summary>
+        public void Flush()
+        {
+        }
+
+        /// <summary>
+        /// Add a byte to the variable-length integer being received.
+        /// </summary>
+        /// <param name="Data">The next byte of the integer</param>
+        /// <returns>'true' if this was the last byte of the integer</returns>
+        private bool readVarint(byte Data)
+        {
+            if (varintShift > 28)
+                throw new Exception("BlockDecompressor.Decode: Invalid Variable-Length Integer");
+
+            varint |= (UInt32)(Data & 0x7f) << varintShift;
+            varintShift += 7;
+            return (Data & 0x80) == 0;
+        }
+
+        /// <summary>
+        /// Send a decompressed byte to the output and add it to the history.
+        /// </summary>
+        /// <param name="Value">The decompressed byte</param>
+        private void output(byte Value)
+        {
+            history[historyPos] = Value;
+            historyPos = (historyPos + 1) & (HistorySize - 1);
+            Callback(Value);
+        }
+
+        #endregion
+    }
+}
@@ -25,24 +25,14 @@ namespace LogicAnalyzer.Compression
     /// <summary>
     /// Class definining methods for LZW-style data decompression. It was experimentally
     /// determined that 13-bit codes provide the best compression for logic analyzer
-    /// data.
+    /// data. The decoding is done a block at a time by an LzwDecoder; this class hands
+    /// the output on a byte at a time.
     /// </summary>
-    public class Decompressor
+    public class Decompressor : IDecompressor
     {
-        private ushort freeEntry;
-        private Stack<byte> stack;
-        private ushort[] prefix;
-        private byte[] suffix;
-        private Queue<byte> inQueue;
-        private ushort outBits;
-        private int crc;
-        private ushort prevEnt;
-        private byte outByte;
-        private short inBits;
-        private bool firstEntry = true; // NOTE: these could be the reason for compression not working 2 in a row (need initialize method).
-        private int curCode = 0; // NOTE: ""    ""
-        private ushort ent = 0; // NOTE: ""    ""
-
+        private LzwDecoder decoder;
+        private byte[] inByte;
+        private byte[] outBuffer;
 
         // Definition for callback function for each output byte. An interface is not used
         // here to keep compatibility with the C version of the code running on the Micro.
@@ -63,23 +53,9 @@ namespace LogicAnalyzer.Compression
 
             this.Callback = Callback;
 
-            stack = new Stack<byte>(8192);
-            prefix = new ushort[Compressor.MaxCode];
-            suffix = new byte[Compressor.MaxCode];
-
-            // Just a small buffer to hold input bytes between calls to Decode().
-            inQueue = new Queue<byte>();
-
-            outBits = 0;
-            inBits = Compressor.nBits;
-            crc = 0;
-            freeEntry = Compressor.FirstCode;
-
-            for (short i = 255; i >= 0; i--)
-            {
-                prefix[i] = 0;
-                suffix[i] = (byte)i;
-            }
+            decoder = new LzwDecoder();
+            inByte = new byte[1];
+            outBuffer = new byte[LzwDecoder.MaxStringLength];
         }
 
         #endregion
@@ -92,11 +68,7 @@ namespace LogicAnalyzer.Compression
         /// <param name="Data">An array of bytes to be decoded (decompressed)</param>
         public void Decode(byte[] Data)
         {
-            foreach (byte b in Data)
-            {
-                this.Decode(b);
-                curCode++;
-            }
+            Decode(Data, 0, Data.Length);
         }
 
         /// <summary>
@@ -105,66 +77,28 @@ namespace LogicAnalyzer.Compression
         /// <param name="Data">A byte to be decoded (decompressed)</param>
         public void Decode(byte Data)
         {
-            inQueue.Enqueue(Data);
+            inByte[0] = Data;
+            Decode(inByte, 0, 1);
+        }
+
+        /// <summary>
+        /// Decodes (decompresses) part of an array of bytes.
+        /// </summary>
+        /// <param name="Data">An array holding the bytes to be decoded (decompressed)</param>
+        /// <param name="Offset">The first byte to decode</param>
+        /// <param name="Count">The number of bytes to decode</param>
+        private void Decode(byte[] Data, int Offset, int Count)
+        {
+            int end = Offset + Count;
+            int length;
 
-            if (getEntry())
+            do
             {
-                if (ent > Compressor.MaxCode)
-                    throw new Exception("Invalid code 1");
-
-                if (firstEntry)
-                {
-                    outByte = (byte)(ent & 0xff);
-                    prevEnt = ent;
-                    crc += outByte;
-                    Callback(outByte);
-                    firstEntry = false;
-                }
-                else
-                {
-                    ushort code = ent;
-
-                    if (code == Compressor.ClearCode)
-                    {
-                        for (short i = 255; i >= 0; i--)
-                            prefix[i] = 0;
-                        freeEntry = Compressor.FirstCode - 1;
-                        return;
-                    }
-
-                    if (code >= freeEntry)
-                    {
-                        stack.Push(outByte);
-                        code = prevEnt;
-                    }
-
-                    while (code > 0xff)
-                    {
-                        if (code >= Compressor.MaxCode)
-                            throw new Exception("Invalid code 2");
-                        stack.Push(suffix[code]);
-                        code = prefix[code];
-                    }
-
-                    outByte = suffix[code];
-                    stack.Push(outByte);
-
-                    while (stack.Count > 0)
-                    {
-                        byte ch = stack.Pop();
-                        Callback(ch);
-                        crc += ch;
-                    }
-
-                    if (freeEntry < Compressor.MaxCode)
-                    {
-                        code = freeEntry++;
-                        prefix[code] = prevEnt;
-                        suffix[code] = outByte;
-                    }
-                    prevEnt = ent;
-                }
+                length = decoder.Decode(Data, ref Offset, end, outBuffer, 0, outBuffer.Length);
+                for (int i = 0; i < length; i++)
+                    Callback(outBuffer[i]);
             }
+            while (length > 0);
         }
 
         /// <summary>
@@ -175,45 +109,11 @@ namespace LogicAnalyzer.Compression
         }
 
         /// <summary>
-        /// Get the next entry to decode.
+        /// Ready the decompressor for a new stream.
         /// </summary>
-        /// <returns>Return 'true' if we've read a full entry</returns>
-        private bool getEntry()
+        public void Reset()
         {
-            byte inByte;
-
-            if (inBits == Compressor.nBits)
-                ent = 0;
-
-            while (inQueue.Count > 0)
-            {
-                inByte = inQueue.Dequeue();
-                if (inBits <= (8 - outBits))
-                {
-                    ent = (ushort)((ent << inBits) | (inByte >> (8 - inBits)));
-                    outBits += (ushort)inBits;
-
-                    // If we have bits left over, put the (masked) input byte back in the queue.
-                    if (outBits == 8)
-                        outBits = 0;
-                    else
-                    {
-                        // If we have bits left over, put the (masked) input byte back in the queue.
-                        inQueue.Enqueue((byte)(inByte & Compressor.mask[8 - inBits]));
-                    }
-
-                    inBits = Compressor.nBits;
-                    return true;
-                }
-                else
-                {
-                    ent = (ushort)((ent << (8 - outBits)) | inByte);
-                    inBits -= (short)(8 - outBits);
-                    outBits = 0;
-                }
-            }
-
-            return false;
+            decoder.Reset();
         }
 
         #endregion
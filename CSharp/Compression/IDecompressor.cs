@@ -0,0 +1,56 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.Compression
+{
+    /// <summary>
+    /// The compression methods supported by the firmware.
+    /// </summary>
+    public enum CompressionMethods
+    {
+        Lzw,  // 13-bit LZW codes (compress.c)
+        Block // Byte-oriented LZ77 tokens (blockcompress.c)
+    }
+
+    /// <summary>
+    /// Interface defining methods for a streaming decompressor.
+    /// </summary>
+    public interface IDecompressor
+    {
+        /// <summary>
+        /// Decodes (decompresses) a sequence of bytes.
+        /// </summary>
+        /// <param name="Data">An array of bytes to be decoded (decompressed)</param>
+        void Decode(byte[] Data);
+
+        /// <summary>
+        /// Decodes (decompresses) a byte of data.
+        /// </summary>
+        /// <param name="Data">A byte to be decoded (decompressed)</param>
+        void Decode(byte Data);
+
+        /// <summary>
+        /// Flushes any remaining data.
+        /// </summary>
+        void Flush();
+    }
+}
@@ -0,0 +1,194 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.Compression
+{
+    /// <summary>
+    /// Class defining methods for decoding the LZW stream of the firmware (compress.c, see Compressor) a block at a
+    /// time. Input bits are gathered in a 32-bit buffer rather than a byte at a time, and each code's string is
+    /// written straight into the caller's output array, back to front from the string table (which keeps the length
+    /// of each string, so its end is known up front). The stream ends with the code MaxCode, and Reset() readies the
+    /// decoder for the next one.
+    /// </summary>
+    public class LzwDecoder
+    {
+        /// <summary>
+        /// The longest string a code can stand for. Decode() only stops short of the end of its input when the
+        /// output has less room than this.
+        /// </summary>
+        public const int MaxStringLength = Compressor.MaxCode;
+
+        private ushort[] prefix;
+        private byte[] suffix;
+        private ushort[] length;
+        private ushort freeEntry;
+        private ushort prevEnt;
+        private byte firstChar;
+        private bool firstEntry;
+        private UInt32 bitBuffer;
+        private int bitCount;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes an LzwDecoder object.
+        /// </summary>
+        public LzwDecoder()
+        {
+            prefix = new ushort[Compressor.MaxCode];
+            suffix = new byte[Compressor.MaxCode];
+            length = new ushort[Compressor.MaxCode];
+
+            for (int i = 0; i < 256; i++)
+            {
+                suffix[i] = (byte)i;
+                length[i] = 1;
+            }
+
+            Reset();
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// 'true' once the code that ends the stream has been decoded (the rest of the input is ignored).
+        /// </summary>
+        public bool Ended
+        {
+            get;
+            private set;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Ready the decoder for a new stream. The string table is rebuilt as the stream is decoded, so
+        /// nothing of the previous stream is left over.
+        /// </summary>
+        public void Reset()
+        {
+            freeEntry = Compressor.FirstCode;
+            prevEnt = 0;
+            firstChar = 0;
+            firstEntry = true;
+            bitBuffer = 0;
+            bitCount = 0;
+            this.Ended = false;
+        }
+
+        /// <summary>
+        /// Decode a block of the stream. Decoding stops at the end of the input, at the end of the stream, or
+        /// when the output has no room for the next string; in the last case, call again with more room (the
+        /// rest of the input is picked up from Offset).
+        /// </summary>
+        /// <param name="Input">An array holding the input</param>
+        /// <param name="Offset">Where the input starts; on return, the offset of the input not yet used</param>
+        /// <param name="End">The end of the input in the array</param>
+        /// <param name="Output">An array to write the decoded bytes to</param>
+        /// <param name="OutputOffset">Where to write the decoded bytes</param>
+        /// <param name="OutputCount">The room there is in the output</param>
+        /// <returns>The number of bytes written</returns>
+        public int Decode(byte[] Input, ref int Offset, int End, byte[] Output, int OutputOffset, int OutputCount)
+        {
+            int written = 0;
+
+            while (!this.Ended)
+            {
+                ushort code, c;
+                int count, pos;
+
+                // Top up the bit buffer. It never holds more than nBits + 7 bits, so it doesn't overflow.
+                while (bitCount < Compressor.nBits && Offset < End)
+                {
+                    bitBuffer = (bitBuffer << 8) | Input[Offset++];
+                    bitCount += 8;
+                }
+                if (bitCount < Compressor.nBits)
+                    break;
+
+                code = (ushort)((bitBuffer >> (bitCount - Compressor.nBits)) & Compressor.MaxCode);
+
+                if (code == Compressor.MaxCode)
+                {
+                    this.Ended = true;
+                    break;
+                }
+
+                if (code == Compressor.ClearCode && !firstEntry)
+                {
+                    // The table is full. The next code is a single byte, whose entry lands on the clear
+                    // code (and is never used), so the entries after it line up with the compressor's.
+                    freeEntry = Compressor.FirstCode - 1;
+                    bitCount -= Compressor.nBits;
+                    continue;
+                }
+
+                if (firstEntry ? code > 0xff : code > freeEntry)
+                    throw new Exception("LzwDecoder.Decode: Invalid Code");
+
+                // A code that isn't in the table yet is the previous string followed by its own first byte.
+                count = (code == freeEntry) ? length[prevEnt] + 1 : length[code];
+                if (count > OutputCount - written)
+                    break;
+                bitCount -= Compressor.nBits;
+
+                // Write the string from its last byte back.
+                pos = OutputOffset + written + count - 1;
+                if (code == freeEntry)
+                {
+                    Output[pos--] = firstChar;
+                    c = prevEnt;
+                }
+                else
+                    c = code;
+
+                while (c > 0xff)
+                {
+                    Output[pos--] = suffix[c];
+                    c = prefix[c];
+                }
+                Output[pos] = (byte)c;
+                firstChar = (byte)c;
+                written += count;
+
+                if (firstEntry)
+                    firstEntry = false;
+                else if (freeEntry < Compressor.MaxCode)
+                {
+                    prefix[freeEntry] = prevEnt;
+                    suffix[freeEntry] = firstChar;
+                    length[freeEntry] = (ushort)Math.Min(length[prevEnt] + 1, MaxStringLength);
+                    freeEntry++;
+                }
+                prevEnt = code;
+            }
+
+            return written;
+        }
+
+        #endregion
+    }
+}
@@ -32,8 +32,14 @@ namespace LogicAnalyzer.Controllers
     {
         private AbstractDataFilter<byte> inputFilter;
         private AbstractDataFilter<byte> outputFilter;
-        private Queue<byte> dataReceived;
-        private Queue<byte> dataToSend;
+
+        // The data received and waiting to be read is dataReceived[receivedStart..receivedEnd). It is
+        // written on the receiving thread and read on any other, under a lock per block.
+        private byte[] dataReceived;
+        private int receivedStart;
+        private int receivedEnd;
+        private object receivedLock = new object();
+        private byte[] single = new byte[1];
 
         #region Constructors
 
@@ -62,8 +68,7 @@ namespace LogicAnalyzer.Controllers
         public AbstractController(string Name, int DefaultQueueLength)
         {
             this.Name = Name;
-            this.dataReceived = new Queue<byte>(DefaultQueueLength);
-            this.dataToSend = new Queue<byte>(DefaultQueueLength);
+            this.dataReceived = new byte[Math.Max(DefaultQueueLength, 16)];
         }
 
         #endregion
@@ -78,9 +83,9 @@ namespace LogicAnalyzer.Controllers
         {
             get
             {
-                lock (dataReceived)
+                lock (receivedLock)
                 {
-                    return dataReceived.Count;
+                    return receivedEnd - receivedStart;
                 }
             }
         }
@@ -214,12 +219,14 @@ namespace LogicAnalyzer.Controllers
         {
             byte b;
 
-            if (this.dataReceived.Count == 0)
-                throw new Exception("AbstractController.Read: Read buffer is empty");
-
-            lock (this.dataReceived)
+            lock (receivedLock)
             {
-                b = this.dataReceived.Dequeue();
+                if (receivedStart == receivedEnd)
+                    throw new Exception("AbstractController.Read: Read buffer is empty");
+
+                b = dataReceived[receivedStart++];
+                if (receivedStart == receivedEnd)
+                    receivedStart = receivedEnd = 0;
             }
 
             return b;
@@ -236,19 +243,23 @@ namespace LogicAnalyzer.Controllers
         /// <returns>The number of bytes read</returns>
         public int Read(byte[] Buffer, int MaxLength)
         {
-            int count = 0;
+            int count;
 
-            if (this.dataReceived.Count == 0)
-                throw new Exception("AbstractController.Read: Read buffer is empty");
             if (Buffer == null)
                 throw new Exception("AbstractController.Read: Buffer is null");
             if (Buffer.Length < MaxLength)
                 throw new Exception("AbstractController.Read: Buffer length < MaxLength");
 
-            lock (this.dataReceived)
+            lock (receivedLock)
             {
-                while (count < MaxLength && this.dataReceived.Count > 0)
-                    Buffer[count++] = this.dataReceived.Dequeue();
+                if (receivedStart == receivedEnd)
+                    throw new Exception("AbstractController.Read: Read buffer is empty");
+
+                count = Math.Min(MaxLength, receivedEnd - receivedStart);
+                System.Buffer.BlockCopy(dataReceived, receivedStart, Buffer, 0, count);
+                receivedStart += count;
+                if (receivedStart == receivedEnd)
+                    receivedStart = receivedEnd = 0;
             }
 
             return count;
@@ -261,91 +272,121 @@ namespace LogicAnalyzer.Controllers
         /// <param name="Data">A byte of incoming data to register with the controller</param>
         protected void ReceiveFromDevice(byte Data)
         {
-            this.TotalUnfilteredBytesReceived++;
+            single[0] = Data;
+            ReceiveFromDevice(single, 0, 1);
+        }
 
-            try
+        /// <summary>
+        /// Function that gets called from descendents to register a block of data received
+        /// from a device with the controller.
+        /// </summary>
+        /// <param name="Data">A block of incoming data to register with the controller</param>
+        protected void ReceiveFromDevice(byte[] Data)
+        {
+            ReceiveFromDevice(Data, 0, Data.Length);
+        }
+
+        /// <summary>
+        /// Function that gets called from descendents to register a block of data received
+        /// from a device with the controller. The block is written to the input filters in
+        /// one go, and their output is taken into the receive buffer in one go.
+        /// </summary>
+        /// <param name="Data">An array holding the incoming data</param>
+        /// <param name="Offset">The offset of the data in the array</param>
+        /// <param name="Count">The length of the data</param>
+        protected void ReceiveFromDevice(byte[] Data, int Offset, int Count)
+        {
+            // The filters can be cleared from another thread while the block is going through them,
+            // so the chain is taken once.
+            AbstractDataFilter<byte> filter = inputFilter;
+
+            this.TotalUnfilteredBytesReceived += Count;
+
+            if (filter == null)
             {
-                if (inputFilter != null)
-                {
-                    // Write data to the first filter. The filters are daisy-chained, so this value
-                    // is passed all the way down to the end of the chain and back up again.
-                    inputFilter.Write(Data);
-                    while (inputFilter.DataReady)
-                    {
-                        byte b = inputFilter.Read();
-
-                        this.TotalBytesReceived++;
-
-                        lock (this.dataReceived)
-                        {
-                            this.dataReceived.Enqueue(b);
-                        }
-                    }
-                }
-                else
+                // If there are no input filters, just store the data in the receive buffer.
+                lock (receivedLock)
                 {
-                    // If there are no input filters, just store the value in the receipt queue.
-                    lock (this.dataReceived)
-                    {
-                        this.dataReceived.Enqueue(Data);
-                    }
+                    MakeRoom(Count);
+                    System.Buffer.BlockCopy(Data, Offset, dataReceived, receivedEnd, Count);
+                    receivedEnd += Count;
                 }
+                return;
+            }
+
+            try
+            {
+                // Write data to the first filter. The filters are daisy-chained, so the block is
+                // passed all the way down to the end of the chain.
+                filter.Write(Data, Offset, Count);
             }
             catch (Exception ex)
             {
                 BroadcastError(ex.Message);
             }
+
+            // Whatever came through (even from a block with errors in it) is kept.
+            int length = filter.DataLength;
+
+            if (length > 0)
+            {
+                lock (receivedLock)
+                {
+                    MakeRoom(length);
+                    receivedEnd += filter.Read(dataReceived, receivedEnd, length);
+                }
+                this.TotalBytesReceived += length;
+            }
         }
 
         /// <summary>
-        /// Convert the send queue to an array of bytes.
+        /// Makes room at the end of the receive buffer, by moving the unread data to the start of
+        /// the buffer and growing it if necessary. Call with the receive lock held.
         /// </summary>
-        /// <returns>An array of bytes from the send queue</returns>
-        private byte[] GetSendBuffer()
+        /// <param name="Count">The room needed</param>
+        private void MakeRoom(int Count)
         {
-            byte[] bytes;
+            int length = receivedEnd - receivedStart;
+            byte[] buffer = dataReceived;
+
+            if (receivedEnd + Count <= buffer.Length)
+                return;
 
-            lock (dataToSend)
+            if (length + Count > buffer.Length)
             {
-                bytes = this.dataToSend.ToArray();
-                this.dataToSend.Clear();
+                int size = buffer.Length * 2;
+
+                while (size < length + Count)
+                    size *= 2;
+                buffer = new byte[size];
             }
-            return bytes;
+
+            System.Buffer.BlockCopy(dataReceived, receivedStart, buffer, 0, length);
+            dataReceived = buffer;
+            receivedStart = 0;
+            receivedEnd = length;
         }
 
         /// <summary>
-        /// Write a byte of data to the controller. Note that data may be
-        /// pre-processed through filters before being sent to the output device.
+        /// Pass data to be sent through the output filters, if there are any.
         /// </summary>
-        /// <param name="Data">A byte of data to send through the controller</param>
-        private void WriteByte(byte Data)
+        /// <param name="Data">The data to send</param>
+        /// <returns>The (possibly filtered) data to send to the device</returns>
+        private byte[] FilterSendData(byte[] Data)
         {
-            this.TotalUnfilteredBytesSent++;
+            this.TotalUnfilteredBytesSent += Data.Length;
 
             if (outputFilter != null)
             {
-                // Write data to the first filter. The filters are daisy-chained, so this value
-                // is passed all the way down to the end of the chain and back up again.
+                // Write data to the first filter. The filters are daisy-chained, so the data
+                // is passed all the way down to the end of the chain.
                 outputFilter.Write(Data);
-                while (outputFilter.DataReady)
-                {
-                    byte b = outputFilter.Read();
-
-                    this.TotalBytesSent++;
-                    lock (this.dataToSend)
-                    {
-                        this.dataToSend.Enqueue(b);
-                    }
-                }
-            }
-            else
-            {
-                // If there are no output filters, just store the value in the send queue.
-                lock (this.dataToSend)
-                {
-                    this.dataToSend.Enqueue(Data);
-                }
+                Data = new byte[outputFilter.DataLength];
+                outputFilter.Read(Data, 0, Data.Length);
             }
+
+            this.TotalBytesSent += Data.Length;
+            return Data;
         }
 
         /// <summary>
@@ -354,9 +395,7 @@ namespace LogicAnalyzer.Controllers
         /// <param name="Data">A byte to send to the controller</param>
         public void Write(byte Data)
         {
-            WriteByte(Data);
-
-            this.WriteToDevice(GetSendBuffer());
+            this.Write(new byte[] { Data });
         }
 
         /// <summary>
@@ -365,10 +404,7 @@ namespace LogicAnalyzer.Controllers
         /// <param name="Data">An array of bytes to send to the controller</param>
         public void Write(byte[] Data)
         {
-            foreach (byte b in Data)
-                WriteByte(b);
-
-            this.WriteToDevice(GetSendBuffer());
+            this.WriteToDevice(FilterSendData(Data));
         }
 
         /// <summary>
@@ -377,10 +413,12 @@ namespace LogicAnalyzer.Controllers
         /// <param name="Data">A string of bytes to send to the controller</param>
         public void Write(string Data)
         {
-            foreach (char c in Data)
-                WriteByte(Convert.ToByte(c));
+            byte[] bytes = new byte[Data.Length];
+
+            for (int i = 0; i < Data.Length; i++)
+                bytes[i] = Convert.ToByte(Data[i]);
 
-            this.WriteToDevice(GetSendBuffer());
+            this.Write(bytes);
         }
 
         /// <summary>
@@ -399,8 +437,10 @@ namespace LogicAnalyzer.Controllers
         {
             this.inputFilter = null;
             this.outputFilter = null;
-            this.dataToSend.Clear();
-            this.dataReceived.Clear();
+            lock (receivedLock)
+            {
+                receivedStart = receivedEnd = 0;
+            }
         }
 
         #endregion
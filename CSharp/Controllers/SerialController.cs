@@ -21,17 +21,39 @@ using System.Collections.Generic;
 using System.Text;
 using System.IO;
 using System.IO.Ports;
+using System.Threading;
 using LogicAnalyzer.Filters;
 
 namespace LogicAnalyzer.Controllers
 {
     /// <summary>
-    /// A class defining a serial port controller.
+    /// A class defining a serial port controller. By default a dedicated thread reads the port in large
+    /// blocks into a buffer that is reused, and hands each block straight on to the input filters. The
+    /// alternative is to read whatever has arrived on each DataReceived event of the serial port.
     /// </summary>
     public class SerialController : AbstractController
     {
+        /// <summary>
+        /// The default size of the blocks read from the serial port.
+        /// </summary>
+        public const int DefaultReadBlockSize = 65536;
+
         private SerialPort serialPort;
         private int _timeOut = 3000;
+        private Reader reader;
+        private byte[] readBuffer = new byte[0];
+
+        /// <summary>
+        /// The state of a dedicated reader thread. Each thread has its own, so a reader still finishing off after
+        /// the port was closed can't share a buffer (or a running flag) with the one started when it is reopened.
+        /// </summary>
+        private class Reader
+        {
+            public Thread Thread;
+            public Stream Stream;
+            public byte[] Buffer;
+            public volatile bool Running;
+        }
 
         #region Constructors
 
@@ -50,6 +72,8 @@ namespace LogicAnalyzer.Controllers
             this.Parity = Parity;
             this.DataBits = DataBits;
             this.StopBits = StopBits;
+            this.DedicatedReader = true;
+            this.ReadBlockSize = DefaultReadBlockSize;
         }
 
         #endregion
@@ -92,6 +116,26 @@ namespace LogicAnalyzer.Controllers
             internal set;
         }
 
+        /// <summary>
+        /// Gets/Sets whether a dedicated thread reads the serial port (rather than the DataReceived event of
+        /// the serial port). This takes effect when the port is opened.
+        /// </summary>
+        public bool DedicatedReader
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the largest block read from the serial port at a time. This takes effect when the
+        /// port is opened.
+        /// </summary>
+        public int ReadBlockSize
+        {
+            get;
+            set;
+        }
+
         /// <summary>
         /// Gets/Sets the amount of time (in milliseconds) before a timeout occurs when reading data.
         /// </summary>
@@ -125,9 +169,25 @@ namespace LogicAnalyzer.Controllers
             {
                 serialPort = new SerialPort(this.Name, this.BaudRate, this.Parity, this.DataBits, this.StopBits);
                 serialPort.ReadTimeout = _timeOut;
-                serialPort.DataReceived += new SerialDataReceivedEventHandler(serialPort_DataReceived);
+                serialPort.ReadBufferSize = Math.Max(this.ReadBlockSize, 4096);
+                if (!this.DedicatedReader)
+                    serialPort.DataReceived += new SerialDataReceivedEventHandler(serialPort_DataReceived);
                 serialPort.ErrorReceived += new SerialErrorReceivedEventHandler(serialPort_ErrorReceived);
                 serialPort.Open();
+
+                if (this.DedicatedReader)
+                {
+                    // The reader takes the read buffer over until it has stopped.
+                    reader = new Reader();
+                    reader.Stream = serialPort.BaseStream;
+                    reader.Buffer = (readBuffer.Length == this.ReadBlockSize) ? readBuffer : new byte[this.ReadBlockSize];
+                    reader.Running = true;
+                    readBuffer = new byte[0];
+                    reader.Thread = new Thread(ReadLoop);
+                    reader.Thread.Name = "Serial reader (" + this.Name + ")";
+                    reader.Thread.IsBackground = true;
+                    reader.Thread.Start(reader);
+                }
             }
             catch(IOException iox)
             {
@@ -147,6 +207,13 @@ namespace LogicAnalyzer.Controllers
         /// </summary>
         public override void Close()
         {
+            Reader stopping = reader;
+
+            // Closing the port ends the read the reader thread is waiting in.
+            reader = null;
+            if (stopping != null)
+                stopping.Running = false;
+
             if(serialPort != null)
             {
                 try
@@ -163,6 +230,10 @@ namespace LogicAnalyzer.Controllers
                     BroadcastError(ex.Message);
                 }
             }
+
+            // The read buffer can be used again once the reader is done with it.
+            if (stopping != null && stopping.Thread != Thread.CurrentThread && stopping.Thread.Join(_timeOut))
+                readBuffer = stopping.Buffer;
         }
 
         /// <summary>
@@ -214,21 +285,72 @@ namespace LogicAnalyzer.Controllers
 
         #region Serial Port Event Handlers
 
-#if true
-        private void WriteBytes(byte[] buffer)
+#if false
+        private void WriteBytes(byte[] buffer, int count)
         {
             StringBuilder sb = new StringBuilder();
 
-            foreach (byte b in buffer)
+            for (int i = 0; i < count; i++)
             {
                 if (sb.Length != 0)
                     sb.Append(" ");
-                sb.Append(b.ToString("X2"));
+                sb.Append(buffer[i].ToString("X2"));
             }
             System.Diagnostics.Debug.WriteLine("CNTR: " + sb.ToString());
         }
 #endif
 
+        /// <summary>
+        /// The dedicated reader thread. Each read waits for data and returns as much as has arrived (up to
+        /// the block size), so blocks are large when the data is flowing and small when it trickles in.
+        /// </summary>
+        /// <param name="State">The reader's state</param>
+        private void ReadLoop(object State)
+        {
+            Reader reader = (Reader)State;
+
+            while (reader.Running)
+            {
+                int count;
+
+                try
+                {
+                    count = reader.Stream.Read(reader.Buffer, 0, reader.Buffer.Length);
+                }
+                catch (TimeoutException)
+                {
+                    continue;
+                }
+                catch (Exception ex)
+                {
+                    // The port was closed (or lost).
+                    if (reader.Running)
+                        BroadcastError(ex.Message);
+                    break;
+                }
+
+                if (count > 0 && reader.Running)
+                {
+#if false
+                    WriteBytes(reader.Buffer, count);
+#endif
+                    // Nothing thrown on the way through may end the thread (a listener writing to a port
+                    // that is closing, say), or the rest of the capture would go unread.
+                    try
+                    {
+                        base.ReceiveFromDevice(reader.Buffer, 0, count);
+
+                        // Tell our listeners that data has been received.
+                        BroadcastDataReceived();
+                    }
+                    catch (Exception ex)
+                    {
+                        BroadcastError(ex.Message);
+                    }
+                }
+            }
+        }
+
         /// <summary>
         /// Handler for serial port DataReceived events.
         /// </summary>
@@ -238,19 +360,22 @@ namespace LogicAnalyzer.Controllers
         {
             if(serialPort != null && serialPort.BytesToRead > 0)
             {
-                byte[] bytes = new byte[serialPort.BytesToRead];
+                int count = serialPort.BytesToRead;
+
+                // The read buffer is only grown, never reallocated per event.
+                if (readBuffer.Length < count)
+                    readBuffer = new byte[Math.Max(count, 4096)];
 
-                serialPort.Read(bytes, 0, bytes.Length);
+                count = serialPort.Read(readBuffer, 0, count);
 
-                //System.Diagnostics.Debug.WriteLine("CTRL REC: " + bytes.Length);
+                //System.Diagnostics.Debug.WriteLine("CTRL REC: " + count);
 
-                if(bytes.Length > 0)
+                if(count > 0)
                 {
-#if true
-                    WriteBytes(bytes);
+#if false
+                    WriteBytes(readBuffer, count);
 #endif
-                    foreach(byte b in bytes)
-                        base.ReceiveFromDevice(b);
+                    base.ReceiveFromDevice(readBuffer, 0, count);
 
                     // Tell our listeners that data has been received.
                     BroadcastDataReceived();
@@ -129,8 +129,7 @@ namespace LogicAnalyzer.Controllers
 
             if (e.Data.Length > 0)
             {
-                foreach (byte b in e.Data)
-                    base.ReceiveFromDevice(b);
+                base.ReceiveFromDevice(e.Data);
 
                 // Tell our listeners that data has been received.
                 BroadcastDataReceived();
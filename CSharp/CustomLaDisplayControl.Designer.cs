@@ -17,6 +17,8 @@
             {
                 components.Dispose();
             }
+            if (disposing)
+                tiles.Dispose();
             base.Dispose(disposing);
         }
 
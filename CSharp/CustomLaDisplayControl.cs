@@ -41,11 +41,29 @@ namespace LogicAnalyzer
         private const int PlotHeight = 50;
         private const int HighStateYValue = 5;
         private const int LowStateYValue = 45;
+        private const int MaxZoomShift = 6;
+        private const int DefaultMinZoomShift = -4;
+        private const int MinZoomShift = -30;
 
         /// <summary>
-        /// The list of sample signals to plot.
+        /// The transitions of the signals to plot.
         /// </summary>
-        private List<SampleSignal>[] Signals;
+        private TransitionIndex[] Signals;
+
+        /// <summary>
+        /// The ranges where the state of the signals isn't known (High inside them).
+        /// </summary>
+        private TransitionIndex Unknown;
+
+        /// <summary>
+        /// The points where the device changed its sampling rate.
+        /// </summary>
+        private List<TimelineEvent> RateChanges;
+
+        /// <summary>
+        /// The pin each signal was sampled from (0 is the first).
+        /// </summary>
+        private int[] Pins;
 
         // If 'ShowDashedTransitionLine' is defined, a white dashed-line will be shown whenever
         // the user hovers the cursor over a transition line in the grid. The MouseMove and Paint
@@ -60,13 +78,20 @@ namespace LogicAnalyzer
         private Pen gridPen;
         private Font gridFont;
         private Brush gridBrush;
+        private Pen ratePen;
+
+        /// <summary>
+        /// The signals, drawn a tile at a time off the UI thread.
+        /// </summary>
+        private WaveformTileCache tiles;
+        private volatile bool repaintPending = false;
 
         private int SamplingRate;
         private int TicksPerGridLine;
         private int MicrosPerGridLine;
 
         public int LeftSampleTick = 0;
-        public int PixelsPerSampleTick = 16; // Zoom value (16 is 1:1)
+        public int ZoomShift = 0; // Zoom value, as a power of two (0 is 1:1, positive zooms in)
 
         #region Constructors
 
@@ -82,10 +107,18 @@ namespace LogicAnalyzer
             gridFont = new Font("Calibri", 12);
             gridBrush = new SolidBrush(Color.GreenYellow);
 
+            // Rate changes are marked with a dashed line.
+            ratePen = new Pen(Brushes.Orange, GridLineThickness);
+            ratePen.DashStyle = System.Drawing.Drawing2D.DashStyle.Dash;
+
 #if ShowDashedTransitionLine
             dashedPen = new Pen(Brushes.White, GridLineThickness);
             dashedPen.DashStyle = System.Drawing.Drawing2D.DashStyle.Dash;
 #endif
+            // Repaints are mostly blits of tiles, so draw them off screen rather than flicker.
+            this.DoubleBuffered = true;
+            tiles = new WaveformTileCache(PlotHeight, HighStateYValue, LowStateYValue);
+            tiles.TileRendered += new EventHandler(tiles_TileRendered);
             Clear();
         }
 
@@ -94,7 +127,11 @@ namespace LogicAnalyzer
         /// </summary>
         public void Clear()
         {
-            Signals = new List<SampleSignal>[8];
+            Signals = new TransitionIndex[8];
+            Unknown = null;
+            tiles.SetSignals(null, null);
+            RateChanges = null;
+            Pins = null;
             Invalidate();
         }
 
@@ -108,28 +145,48 @@ namespace LogicAnalyzer
         /// <param name="Samples">The array of samples to plot</param>
         public void Plot(SamplePlot Samples)
         {
-            int i = 0;
-            int sampleTicks = 0;
-
-            Signals = new List<SampleSignal>[Samples.SampleSignals.Length];
+            // A plot that was followed as it grew (see Follow()) keeps the tiles drawn of it, and its place.
+            bool followed = (Samples.Transitions == Signals);
 
-            foreach (List<SampleSignal> sampleList in Samples.SampleSignals)
-            {
-                if (i == 0)
-                {
-                    // Find the duration of the first sample (they are all equal).
-                    foreach (SampleSignal ss in sampleList)
-                        sampleTicks += ss.Duration;
+            if (followed)
+                tiles.SignalsExtended();
+            else
+                tiles.SetSignals(Samples.Transitions, Samples.Unknown);
+            Signals = Samples.Transitions;
+            Unknown = Samples.Unknown;
+            RateChanges = Samples.RateChanges;
+            Pins = Samples.Pins;
+
+            // Set the scrollbar (scrolling stops short of the end of a capture too long for it).
+            totalSampleTicks = (int)Math.Min(Samples.Length, int.MaxValue);
+            hScrollBar1.Maximum = totalSampleTicks;
+            hScrollBar1.Value = followed ? Math.Min(this.LeftSampleTick, totalSampleTicks) : 0;
+            Invalidate();
+        }
 
-                    totalSampleTicks = sampleTicks;
-                }
-                Signals[i++] = sampleList;
-            }
+        /// <summary>
+        /// Plot samples that are still coming in, scrolled to show the latest. Call this again as the plot
+        /// grows; only the tiles at its end are drawn again.
+        /// </summary>
+        /// <param name="Samples">The plot (see SamplePlot.Begin())</param>
+        public void Follow(SamplePlot Samples)
+        {
+            long windowTicks = PixelsToSampleTicks(this.Width - this.vScrollBar1.Width);
 
-            // Set the scrollbar.
-            // NOTE: This could overflow if the ticks are too large.
+            if (Samples.Transitions != Signals)
+                tiles.SetSignals(Samples.Transitions, Samples.Unknown);
+            else
+                tiles.SignalsExtended();
+            Signals = Samples.Transitions;
+            Unknown = Samples.Unknown;
+            RateChanges = Samples.RateChanges;
+            Pins = Samples.Pins;
+
+            // Keep the end of the plot at the right of the window.
+            totalSampleTicks = (int)Math.Min(Samples.Length, int.MaxValue);
             hScrollBar1.Maximum = totalSampleTicks;
-            hScrollBar1.Value = 0;
+            this.LeftSampleTick = (int)Math.Max(totalSampleTicks - windowTicks, 0);
+            hScrollBar1.Value = this.LeftSampleTick;
             Invalidate();
         }
 
@@ -144,7 +201,7 @@ namespace LogicAnalyzer
                 int tpg;
 
                 // Start with an estimate of the ticks per grid line...
-                tpg = PixelsToSampleTicks(this.Width - this.vScrollBar1.Width) / 10;
+                tpg = (int)Math.Min(PixelsToSampleTicks(this.Width - this.vScrollBar1.Width) / 10, int.MaxValue);
 
                 // Get the microseconds per grid line from above.
                 MicrosPerGridLine = (int)(1000000.0 * tpg / this.SamplingRate);
@@ -181,7 +238,7 @@ namespace LogicAnalyzer
         /// </summary>
         public void ResetZoom()
         {
-            this.PixelsPerSampleTick = 16;
+            this.ZoomShift = 0;
             CalculateScale();
         }
 
@@ -190,22 +247,23 @@ namespace LogicAnalyzer
         /// </summary>
         public void ZoomIn()
         {
-            if (this.PixelsPerSampleTick < 1024)
+            if (this.ZoomShift < MaxZoomShift)
             {
-                this.PixelsPerSampleTick *= 2;
+                this.ZoomShift++;
                 CalculateScale();
                 this.Invalidate();
             }
         }
 
         /// <summary>
-        /// Zoom out.
+        /// Zoom out (until the whole capture fits in the window).
         /// </summary>
         public void ZoomOut()
         {
-            if (this.PixelsPerSampleTick > 1)
+            if (this.ZoomShift > DefaultMinZoomShift ||
+                (this.ZoomShift > MinZoomShift && PixelsToSampleTicks(this.Width - this.vScrollBar1.Width) < totalSampleTicks))
             {
-                this.PixelsPerSampleTick /= 2;
+                this.ZoomShift--;
                 CalculateScale();
                 this.Invalidate();
             }
@@ -244,7 +302,7 @@ namespace LogicAnalyzer
         /// </summary>
         /// <param name="SampleTicks">The time in ticks</param>
         /// <returns>The time as text</returns>
-        private string TicksToText(int SampleTicks)
+        private string TicksToText(long SampleTicks)
         {
             return MicrosToText((int)(1000000.0 * SampleTicks / this.SamplingRate));
         }
@@ -254,9 +312,9 @@ namespace LogicAnalyzer
         /// </summary>
         /// <param name="SampleTicks">The time in ticks</param>
         /// <returns>The pixel representing the time</returns>
-        private int SampleTicksToPixels(int SampleTicks)
+        private long SampleTicksToPixels(long SampleTicks)
         {
-            return SampleTicks * PixelsPerSampleTick / 16;
+            return ZoomShift >= 0 ? SampleTicks << ZoomShift : SampleTicks >> -ZoomShift;
         }
 
         /// <summary>
@@ -264,9 +322,9 @@ namespace LogicAnalyzer
         /// </summary>
         /// <param name="Pixels">The display pixel</param>
         /// <returns>The time (in Ticks) represented by the pixel</returns>
-        private int PixelsToSampleTicks(int Pixels)
+        private long PixelsToSampleTicks(int Pixels)
         {
-            return (int)(Pixels / (PixelsPerSampleTick / 16.0));
+            return ZoomShift >= 0 ? Pixels >> ZoomShift : (long)Pixels << -ZoomShift;
         }
 
         /// <summary>
@@ -276,10 +334,9 @@ namespace LogicAnalyzer
         /// <param name="e"></param>
         private void CustomLaDisplayControl_Paint(object sender, PaintEventArgs e)
         {
-            int clipLeftSampleTick = this.LeftSampleTick + PixelsToSampleTicks(e.ClipRectangle.Left);
-            int clipRightSampleTick = this.LeftSampleTick + PixelsToSampleTicks(e.ClipRectangle.Right);
-            int elapsedTime = 0;
-            int micros = 0;
+            long clipLeftSampleTick = this.LeftSampleTick + PixelsToSampleTicks(e.ClipRectangle.Left);
+            long clipRightSampleTick = this.LeftSampleTick + PixelsToSampleTicks(e.ClipRectangle.Right);
+            long elapsedTime;
             int x;
 
 #if ShowDashedTransitionLine
@@ -288,12 +345,13 @@ namespace LogicAnalyzer
 
             if (MicrosPerGridLine > 0 && TicksPerGridLine > 0)
             {
-                // Draw the grid lines in yellow.
+                // Draw the grid lines in yellow, from the first one in the clip region.
+                elapsedTime = Math.Max(clipLeftSampleTick, 0) / this.TicksPerGridLine * this.TicksPerGridLine;
                 while (elapsedTime <= clipRightSampleTick)
                 {
                     if (elapsedTime >= clipLeftSampleTick)
                     {
-                        x = SampleTicksToPixels(elapsedTime - this.LeftSampleTick);
+                        x = (int)SampleTicksToPixels(elapsedTime - this.LeftSampleTick);
 
                         // NOTE: this draws the entire line, but should only draw within the clip region.
                         e.Graphics.DrawLine(gridPen, x, 0, x, this.Height);
@@ -303,51 +361,38 @@ namespace LogicAnalyzer
                             e.Graphics.DrawString(TicksToText(elapsedTime), gridFont, gridBrush, x - 20, 2);
                     }
                     elapsedTime += this.TicksPerGridLine;
-                    micros += MicrosPerGridLine;
                 }
             }
 
             if (Signals != null)
             {
-                // Now, plot each signal within the clip region.
+                // Now, plot each signal within the clip region, from the tiles that cover it.
+                long leftPixel = SampleTicksToPixels(this.LeftSampleTick);
+                long firstTile = (leftPixel + e.ClipRectangle.Left) / WaveformTileCache.TileWidth;
+                long lastTile = (leftPixel + e.ClipRectangle.Right - 1) / WaveformTileCache.TileWidth;
                 int yOffset = PlotOffset;
 
-                foreach (List<SampleSignal> Signal in Signals)
+                for (int channel = 0; channel < Signals.Length; channel++)
                 {
+                    TransitionIndex Signal = Signals[channel];
+
                     if (Signal != null)
                     {
-                        if (e.ClipRectangle.Top <= yOffset && e.ClipRectangle.Bottom >= yOffset)
-                        {
-                            int et, prevX = -1, y = -1;
+                        // Label the signal with the pin it was sampled from.
+                        if (Pins != null && e.ClipRectangle.Left < 60 && e.ClipRectangle.Top <= yOffset + PlotHeight && e.ClipRectangle.Bottom >= yOffset)
+                            e.Graphics.DrawString("CH" + (Pins[channel] + 1), gridFont, gridBrush, 2, yOffset + HighStateYValue + 8);
 
-                            elapsedTime = 0;
+                        if (e.ClipRectangle.Top < yOffset + PlotHeight && e.ClipRectangle.Bottom >= yOffset)
+                        {
+                            long endTile = Math.Min(lastTile, SampleTicksToPixels(Signal.Length) / WaveformTileCache.TileWidth);
 
-                            foreach (SampleSignal ss in Signal)
+                            // Tiles that aren't ready are left out; they are painted when they arrive.
+                            for (long t = firstTile; t <= endTile; t++)
                             {
-                                et = elapsedTime + ss.Duration;
-
-                                // If the current sample time is within the displayable area, plot it.
-                                if (clipLeftSampleTick < et)
-                                {
-                                    if (prevX < 0)
-                                        prevX = SampleTicksToPixels(elapsedTime - this.LeftSampleTick);
-
-                                    // Draw a transition between low and high.
-                                    if (y >= 0)
-                                        e.Graphics.DrawLine(Pens.Red, prevX, yOffset + LowStateYValue, prevX, yOffset + HighStateYValue);
-
-                                    // Draw a line between the previous X and the current X.
-                                    x = SampleTicksToPixels(et - this.LeftSampleTick);
-                                    y = yOffset + (ss.SampleState == SampleSignal.State.High ? HighStateYValue : LowStateYValue);
-                                    e.Graphics.DrawLine(Pens.Red, prevX, y, x, y);
-                                    prevX = x;
-                                }
-
-                                // If we're off the right side of the window, stop.
-                                if (clipRightSampleTick < et)
-                                    break;
-
-                                elapsedTime = et;
+                                Bitmap tile = tiles.GetTile(ZoomShift, t, channel);
+
+                                if (tile != null)
+                                    e.Graphics.DrawImageUnscaled(tile, (int)(t * WaveformTileCache.TileWidth - leftPixel), yOffset);
                             }
                         }
                     }
@@ -356,6 +401,20 @@ namespace LogicAnalyzer
                     yOffset += PlotHeight;
                 }
 
+                if (RateChanges != null)
+                {
+                    // Mark where the device changed its sampling rate.
+                    foreach (TimelineEvent rc in RateChanges)
+                    {
+                        if (rc.Position >= clipLeftSampleTick && rc.Position <= clipRightSampleTick)
+                        {
+                            x = (int)SampleTicksToPixels(rc.Position - this.LeftSampleTick);
+                            e.Graphics.DrawLine(ratePen, x, 0, x, this.Height);
+                            e.Graphics.DrawString(rc.Value > 1 ? "1/" + rc.Value + " rate" : "full rate", gridFont, Brushes.Orange, x + 2, this.Height - 40);
+                        }
+                    }
+                }
+
 #if ShowDashedTransitionLine
                 // If there is a transition line to paint, do it now.
                 if (mx >= 0 && e.ClipRectangle.Left <= mx && e.ClipRectangle.Right >= mx)
@@ -379,6 +438,25 @@ namespace LogicAnalyzer
 
         #region Event Handlers
 
+        /// <summary>
+        /// Tile rendered event handler. Tiles arrive on the rendering thread, so the repaint is passed to
+        /// the UI thread (once for any number of tiles that arrive before it happens).
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        private void tiles_TileRendered(object sender, EventArgs e)
+        {
+            if (!repaintPending && this.IsHandleCreated)
+            {
+                repaintPending = true;
+                this.BeginInvoke((MethodInvoker)delegate
+                {
+                    repaintPending = false;
+                    this.Invalidate();
+                });
+            }
+        }
+
         /// <summary>
         /// Mouse movement event handler. This is used to display the time of the cursor location (an
         /// event is broadcast to anyone listening that the cursor location has changed).
@@ -398,32 +476,32 @@ namespace LogicAnalyzer
 
                 if (channel < Signals.Length && Signals[channel] != null)
                 {
-                    int thisSampleTick = this.LeftSampleTick + PixelsToSampleTicks(e.X);
+                    long thisSampleTick = this.LeftSampleTick + PixelsToSampleTicks(e.X);
+
+                    TransitionIndex Signal = Signals[channel];
+                    SampleSignal.State state;
+
+                    // Find the state under the cursor.
+                    if (thisSampleTick < 0 || thisSampleTick >= Signal.Length || (Unknown != null && Unknown.StateAt(thisSampleTick) == SampleSignal.State.High))
+                        state = SampleSignal.State.Unknown;
+                    else
+                        state = Signal.StateAt(thisSampleTick);
 
                     // Tell anyone who's listening what is under the cursor.
-                    BroadcastOnMouseOver(channel + 1, TicksToText(thisSampleTick));
+                    BroadcastOnMouseOver((Pins != null ? Pins[channel] : channel) + 1, TicksToText(thisSampleTick), state);
 
 #if ShowDashedTransitionLine
-                    int elapsedTime = 0;
-                    List<SampleSignal> Signal = Signals[channel];
-
                     // If the mouse is hovered over transition point for this signal,
                     // we want to show a dashed line.
 
                     // Check if we're on a transition point.
-                    foreach (SampleSignal ss in Signal)
-                    {
-                        if (thisSampleTick == elapsedTime)
-                        {
-                            mouseOverX = e.X;
-                            mouseIsOver = true;
-                            this.Invalidate(new Rectangle(mouseOverX, 0, 1, this.Height));
-                            break;
-                        }
-                        else if (thisSampleTick < elapsedTime)
-                            break;
+                    int edge = Signal.FindEdge(thisSampleTick);
 
-                        elapsedTime += ss.Duration;
+                    if (edge > 0 && Signal[edge - 1] == thisSampleTick)
+                    {
+                        mouseOverX = e.X;
+                        mouseIsOver = true;
+                        this.Invalidate(new Rectangle(mouseOverX, 0, 1, this.Height));
                     }
 #endif
                 }
@@ -466,12 +544,13 @@ namespace LogicAnalyzer
         /// </summary>
         /// <param name="Channel">The channel that the cursor is hovering over</param>
         /// <param name="Time">The time that the cursor is hovering over</param>
-        protected void BroadcastOnMouseOver(int Channel, string Time)
+        /// <param name="State">The state of the channel at that time</param>
+        protected void BroadcastOnMouseOver(int Channel, string Time, SampleSignal.State State)
         {
             EventHandler<LaMouseOverEventArgs> handler = OnMouseOver;
 
             if (handler != null)
-                handler(this, LaMouseOverEventArgs.GetInstance(Channel, Time));
+                handler(this, LaMouseOverEventArgs.GetInstance(Channel, Time, State));
         }
 
         #endregion
@@ -0,0 +1,297 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Text;
+
+namespace LogicAnalyzer.DataAcquisition
+{
+    /// <summary>
+    /// Class defining the performance counters the device keeps for a capture. They arrive in a
+    /// status frame at the end of each capture, or in answer to a STAT command (see stats.h in the
+    /// firmware for the layout).
+    /// </summary>
+    public class CaptureStats
+    {
+        /// <summary>
+        /// The length of the status frame payload this class understands. Later firmware may add
+        /// fields at the end.
+        /// </summary>
+        public const int PayloadLength = 56;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a CaptureStats object from a status frame payload.
+        /// </summary>
+        /// <param name="Payload">The status frame payload</param>
+        private CaptureStats(byte[] Payload)
+        {
+            this.IsrCycles = BitConverter.ToUInt64(Payload, 0);
+            this.DrainCycles = BitConverter.ToUInt64(Payload, 8);
+            this.Samples = BitConverter.ToUInt32(Payload, 16);
+            this.Dropped = BitConverter.ToUInt32(Payload, 20);
+            this.BytesSent = BitConverter.ToUInt32(Payload, 24);
+            this.CompressorIn = BitConverter.ToUInt32(Payload, 28);
+            this.CompressorOut = BitConverter.ToUInt32(Payload, 32);
+            this.IsrCount = BitConverter.ToUInt32(Payload, 36);
+            this.IsrMaxCycles = BitConverter.ToUInt32(Payload, 40);
+            this.DrainCount = BitConverter.ToUInt32(Payload, 44);
+            this.DrainMaxCycles = BitConverter.ToUInt32(Payload, 48);
+            this.QueueHighWater = BitConverter.ToUInt16(Payload, 52);
+            this.QueueSize = BitConverter.ToUInt16(Payload, 54);
+
+            // Gap counters (firmware that sends gap records).
+            if (Payload.Length >= 64)
+            {
+                this.Gaps = BitConverter.ToUInt32(Payload, 56);
+                this.GapSamples = BitConverter.ToUInt32(Payload, 60);
+            }
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the number of bytes handed to the USART, framing included
+        /// </summary>
+        public uint BytesSent
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the compression ratio (input bytes per output byte), or 0 if the compressor wasn't used
+        /// </summary>
+        public double CompressionRatio
+        {
+            get
+            {
+                return this.CompressorOut > 0 ? (double)this.CompressorIn / this.CompressorOut : 0;
+            }
+        }
+
+        /// <summary>
+        /// Gets the number of bytes fed to the compressor
+        /// </summary>
+        public uint CompressorIn
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of bytes the compressor produced
+        /// </summary>
+        public uint CompressorOut
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of sample bytes lost because the queue was full (or the burst window was overrun)
+        /// </summary>
+        public uint Dropped
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of drain loop passes that moved data out of the queue
+        /// </summary>
+        public uint DrainCount
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the total number of core cycles spent in drain loop passes
+        /// </summary>
+        public ulong DrainCycles
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the longest drain loop pass, in core cycles
+        /// </summary>
+        public uint DrainMaxCycles
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of gap records the device sent (runs of samples lost because the queue was full)
+        /// </summary>
+        public uint Gaps
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of samples lost in those gaps
+        /// </summary>
+        public uint GapSamples
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of capture interrupts
+        /// </summary>
+        public uint IsrCount
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the total number of core cycles spent in the capture interrupt
+        /// </summary>
+        public ulong IsrCycles
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the longest capture interrupt, in core cycles
+        /// </summary>
+        public uint IsrMaxCycles
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the most bytes that were waiting in the queue at once
+        /// </summary>
+        public int QueueHighWater
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the size of the device's sample queue
+        /// </summary>
+        public int QueueSize
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of samples taken
+        /// </summary>
+        public uint Samples
+        {
+            get;
+            private set;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Reads the counters from a status frame payload.
+        /// </summary>
+        /// <param name="Payload">The status frame payload (may be null)</param>
+        /// <returns>The counters, or null if the payload is missing or too short</returns>
+        public static CaptureStats Parse(byte[] Payload)
+        {
+            if (Payload == null || Payload.Length < PayloadLength)
+                return null;
+            return new CaptureStats(Payload);
+        }
+
+        /// <summary>
+        /// Gets the column names for the values written by ToCsv().
+        /// </summary>
+        public static string CsvHeader
+        {
+            get
+            {
+                return "Samples,Dropped,BytesSent,CompressorIn,CompressorOut,QueueHighWater,QueueSize," +
+                    "IsrCount,IsrCycles,IsrMaxCycles,DrainCount,DrainCycles,DrainMaxCycles,Gaps,GapSamples";
+            }
+        }
+
+        /// <summary>
+        /// Formats the counters as comma-separated values (see CsvHeader).
+        /// </summary>
+        /// <returns>The counters</returns>
+        public string ToCsv()
+        {
+            return string.Join(",", new string[] {
+                this.Samples.ToString(CultureInfo.InvariantCulture),
+                this.Dropped.ToString(CultureInfo.InvariantCulture),
+                this.BytesSent.ToString(CultureInfo.InvariantCulture),
+                this.CompressorIn.ToString(CultureInfo.InvariantCulture),
+                this.CompressorOut.ToString(CultureInfo.InvariantCulture),
+                this.QueueHighWater.ToString(CultureInfo.InvariantCulture),
+                this.QueueSize.ToString(CultureInfo.InvariantCulture),
+                this.IsrCount.ToString(CultureInfo.InvariantCulture),
+                this.IsrCycles.ToString(CultureInfo.InvariantCulture),
+                this.IsrMaxCycles.ToString(CultureInfo.InvariantCulture),
+                this.DrainCount.ToString(CultureInfo.InvariantCulture),
+                this.DrainCycles.ToString(CultureInfo.InvariantCulture),
+                this.DrainMaxCycles.ToString(CultureInfo.InvariantCulture),
+                this.Gaps.ToString(CultureInfo.InvariantCulture),
+                this.GapSamples.ToString(CultureInfo.InvariantCulture) });
+        }
+
+        /// <summary>
+        /// Formats the counters as a short report for the console.
+        /// </summary>
+        /// <returns>The report</returns>
+        public override string ToString()
+        {
+            StringBuilder sb = new StringBuilder();
+
+            sb.AppendFormat("Samples: {0}, dropped bytes: {1}, bytes sent: {2}\r\n", this.Samples, this.Dropped, this.BytesSent);
+            sb.AppendFormat("Queue high-water mark: {0} of {1} ({2}%)\r\n", this.QueueHighWater, this.QueueSize,
+                this.QueueSize > 0 ? (100 * this.QueueHighWater) / this.QueueSize : 0);
+            if (this.Gaps > 0)
+                sb.AppendFormat("Gaps: {0}, {1} samples lost\r\n", this.Gaps, this.GapSamples);
+            if (this.CompressorOut > 0)
+                sb.AppendFormat("Compression: {0:F2}:1 ({1} -> {2} bytes)\r\n", this.CompressionRatio, this.CompressorIn, this.CompressorOut);
+            if (this.IsrCount > 0)
+                sb.AppendFormat("Capture interrupt: {0} calls, {1} cycles average, {2} max\r\n",
+                    this.IsrCount, this.IsrCycles / this.IsrCount, this.IsrMaxCycles);
+            if (this.DrainCount > 0)
+                sb.AppendFormat("Drain loop: {0} passes, {1} cycles average, {2} max\r\n",
+                    this.DrainCount, this.DrainCycles / this.DrainCount, this.DrainMaxCycles);
+            return sb.ToString();
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,258 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace LogicAnalyzer.DataAcquisition
+{
+    /// <summary>
+    /// Class defining a store for the sample data of a capture. The data is kept in fixed-size segments, so it
+    /// is never copied to grow. Once the segments held in memory reach the memory budget, further segments are
+    /// written to a temporary file instead, so a capture of any length takes no more memory than the budget
+    /// (plus a segment or two). The data is read back a segment at a time through Segments.
+    /// </summary>
+    public class CaptureStore : IDisposable
+    {
+        /// <summary>
+        /// The default segment size (1 MB).
+        /// </summary>
+        public const int DefaultSegmentSize = 1 << 20;
+
+        /// <summary>
+        /// The default memory budget (64 MB).
+        /// </summary>
+        public const long DefaultMemoryBudget = 64L << 20;
+
+        private List<byte[]> memorySegments;
+        private int spilledSegments;
+        private byte[] current;
+        private int currentLength;
+        private FileStream spill;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a CaptureStore object with the default segment size and memory budget.
+        /// </summary>
+        public CaptureStore()
+            : this(DefaultSegmentSize, DefaultMemoryBudget)
+        {
+        }
+
+        /// <summary>
+        /// Creates and initializes a CaptureStore object.
+        /// </summary>
+        /// <param name="SegmentSize">The size of each segment (in bytes)</param>
+        /// <param name="MemoryBudget">The most data to keep in memory before the rest goes to a file (in bytes)</param>
+        public CaptureStore(int SegmentSize, long MemoryBudget)
+        {
+            if (SegmentSize < 1)
+                throw new Exception("CaptureStore: Invalid segment size");
+
+            this.SegmentSize = SegmentSize;
+            this.MemoryBudget = MemoryBudget;
+            memorySegments = new List<byte[]>();
+            current = new byte[SegmentSize];
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the size of each segment (in bytes). Every segment but the last is full.
+        /// </summary>
+        public int SegmentSize
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the most data kept in memory before the rest goes to a file (in bytes).
+        /// </summary>
+        public long MemoryBudget
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the length of the data in the store (in bytes).
+        /// </summary>
+        public long Length
+        {
+            get
+            {
+                return ((long)memorySegments.Count + spilledSegments) * SegmentSize + currentLength;
+            }
+        }
+
+        /// <summary>
+        /// Gets the length of the data that went to the file (in bytes).
+        /// </summary>
+        public long SpilledLength
+        {
+            get
+            {
+                return (long)spilledSegments * SegmentSize;
+            }
+        }
+
+        /// <summary>
+        /// Gets the data in the store, a segment at a time and in order. A segment read back from the file is
+        /// read into the same buffer as the one before it, so each segment is only valid until the next one is
+        /// taken.
+        /// </summary>
+        public IEnumerable<ArraySegment<byte>> Segments
+        {
+            get
+            {
+                // The segments in memory are handed out as they are (they're never written to again).
+                for (int i = 0; i < memorySegments.Count; i++)
+                    yield return new ArraySegment<byte>(memorySegments[i]);
+
+                if (spilledSegments > 0)
+                {
+                    byte[] buffer = new byte[SegmentSize];
+
+                    for (int i = 0; i < spilledSegments; i++)
+                    {
+                        ReadSpilledSegment(i, buffer);
+                        yield return new ArraySegment<byte>(buffer);
+                    }
+                }
+
+                if (currentLength > 0)
+                    yield return new ArraySegment<byte>(current, 0, currentLength);
+            }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Append a block of data to the store.
+        /// </summary>
+        /// <param name="Buffer">An array holding the data</param>
+        /// <param name="Offset">The offset of the data in the array</param>
+        /// <param name="Count">The length of the data</param>
+        public void Append(byte[] Buffer, int Offset, int Count)
+        {
+            while (Count > 0)
+            {
+                int count = Math.Min(Count, SegmentSize - currentLength);
+
+                System.Buffer.BlockCopy(Buffer, Offset, current, currentLength, count);
+                currentLength += count;
+                Offset += count;
+                Count -= count;
+
+                if (currentLength == SegmentSize)
+                    CloseSegment();
+            }
+        }
+
+        /// <summary>
+        /// Empty the store (and delete its file).
+        /// </summary>
+        public void Clear()
+        {
+            memorySegments.Clear();
+            spilledSegments = 0;
+            currentLength = 0;
+            CloseSpill();
+        }
+
+        /// <summary>
+        /// Dispose of the store (and delete its file).
+        /// </summary>
+        public void Dispose()
+        {
+            Clear();
+        }
+
+        /// <summary>
+        /// The current segment is full; keep it in memory if the budget allows, otherwise write it to the
+        /// file (and reuse its buffer).
+        /// </summary>
+        private void CloseSegment()
+        {
+            if (spilledSegments == 0 && (long)(memorySegments.Count + 1) * SegmentSize <= MemoryBudget)
+            {
+                memorySegments.Add(current);
+                current = new byte[SegmentSize];
+            }
+            else
+            {
+                if (spill == null)
+                    spill = new FileStream(Path.GetTempFileName(), FileMode.Create, FileAccess.ReadWrite, FileShare.None,
+                        4096, FileOptions.DeleteOnClose);
+
+                lock (spill)
+                {
+                    spill.Position = (long)spilledSegments * SegmentSize;
+                    spill.Write(current, 0, SegmentSize);
+                }
+                spilledSegments++;
+            }
+            currentLength = 0;
+        }
+
+        /// <summary>
+        /// Read a segment back from the file.
+        /// </summary>
+        /// <param name="Index">The index of the segment in the file</param>
+        /// <param name="Buffer">A buffer of (at least) the segment size</param>
+        private void ReadSpilledSegment(int Index, byte[] Buffer)
+        {
+            lock (spill)
+            {
+                int offset = 0;
+
+                spill.Position = (long)Index * SegmentSize;
+                while (offset < SegmentSize)
+                {
+                    int count = spill.Read(Buffer, offset, SegmentSize - offset);
+
+                    if (count <= 0)
+                        throw new Exception("CaptureStore: Sample data file is truncated");
+                    offset += count;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Close the file (which deletes it).
+        /// </summary>
+        private void CloseSpill()
+        {
+            if (spill != null)
+            {
+                spill.Dispose();
+                spill = null;
+            }
+        }
+
+        #endregion
+    }
+}
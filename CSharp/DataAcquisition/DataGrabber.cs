@@ -18,6 +18,7 @@
 
 using System;
 using System.Collections.Generic;
+using System.Globalization;
 using System.Text;
 using System.Windows;
 using System.Windows.Forms;
@@ -36,11 +37,34 @@ namespace LogicAnalyzer.DataAcquisition
         private Timer sampleTimer;
         private bool samplingInProgress;
         private bool sampleReceived;
+        private bool statsInProgress;
+        private Filters.FrameFilter frameFilter;
+        private long creditedBytes;
+        private FileStream streamFile;
+        private object streamFileLock = new object();  // Held to write to the stream file, or close it
+        private byte[] receiveBuffer = new byte[4096];
+        private TransitionDecoder transitionDecoder = new TransitionDecoder();
+        private const int LivePlotInterval = 100;  // Milliseconds between updates of the plot while sampling
+        private object livePlotLock = new object();
+        private SamplePlot livePlot;
+        private int livePlotEvents;
+        private int livePlotTime;
+        private int burstDeadline;
+        private const int BurstLineRate = 10000;  // Bytes/second a burst is allowed to take to be sent
 
         public enum SamplingModes
         {
-            Continuous,     // One sample per sampling period
-            TransitionsOnly // Only samples that are different than the previous sample
+            Continuous,      // One sample per sampling period
+            TransitionsOnly, // Only samples that are different than the previous sample
+            RunLength        // Runs of identical samples, each sent with a repeat count
+        }
+
+        public enum TriggerModes
+        {
+            None,           // Start sampling straight away
+            Pattern,        // Start when (sample & TriggerMask) == TriggerValue
+            Edge,           // Start on a TriggerRising/TriggerFalling edge
+            PatternThenEdge // Start on an edge, once the pattern has been seen
         }
 
         #region Constructors
@@ -74,7 +98,7 @@ namespace LogicAnalyzer.DataAcquisition
             this.SamplingMode = SamplingMode;
             this.SamplingTime = SamplingTime;
             this.SamplingCompression = SamplingCompression;
-            this.Data = new List<byte>();
+            this.Data = new CaptureStore();
 
             Controller.OnDataReceived += new EventHandler<ControllerEventArgs>(Controller_OnDataReceived);
             Controller.OnError += new EventHandler<ControllerEventArgs>(Controller_OnError);
@@ -94,22 +118,24 @@ namespace LogicAnalyzer.DataAcquisition
         }
 
         /// <summary>
-        /// Gets/Sets sampled data.
+        /// Gets the sampled data.
         /// </summary>
-        internal List<byte> Data
+        internal CaptureStore Data
         {
             get;
-            set;
+            private set;
         }
 
         /// <summary>
-        /// Gets the length of the sampled data.
+        /// Gets the length of the sampled data (in bytes of sample data, the same units as ExpectedDataLength).
         /// </summary>
-        private int DataLength
+        private long DataLength
         {
             get
             {
-                return Data.Count;
+                if (this.SamplingMode == SamplingModes.TransitionsOnly)
+                    return transitionDecoder.Timestamp;
+                return Data.Length;
             }
         }
 
@@ -120,8 +146,14 @@ namespace LogicAnalyzer.DataAcquisition
         {
             get
             {
-                // Guess at the amount of data that we will receive in the next sample.
-                return (int)((this.SamplingRate * (this.SamplingTime / 1000.0)) / this.SamplesPerByte);
+                // Guess at the amount of data that we will receive in the next sample. There is no telling
+                // for a capture that runs until it is stopped.
+                // In Transition mode, it's the length of the timeline in ticks.
+                int samplesPerByte = this.SamplingMode == SamplingModes.TransitionsOnly ? 1 : this.SamplesPerByte;
+
+                if (this.BurstDepth > 0)
+                    return this.BurstDepth / samplesPerByte;
+                return (int)Math.Min((this.SamplingRate * (this.SamplingTime / 1000.0)) / samplesPerByte, int.MaxValue);
             }
         }
 
@@ -132,7 +164,7 @@ namespace LogicAnalyzer.DataAcquisition
         {
             get
             {
-                switch (this.SamplingChannels)
+                switch (this.Pins.Length)
                 {
                     case 1:
                         return 8;
@@ -155,6 +187,35 @@ namespace LogicAnalyzer.DataAcquisition
             set;
         }
 
+        /// <summary>
+        /// Gets/Sets the pins to sample, as a mask (bit 0 is the first pin), when they aren't simply the first
+        /// SamplingChannels pins (0). The device packs the sampled pins together, lowest pin first, so any 3 pins
+        /// take up no more room in the sample data than the first 3.
+        /// </summary>
+        public byte SamplingPins
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets the pin (0 is the first) that each channel of the sample data is taken from.
+        /// </summary>
+        public int[] Pins
+        {
+            get
+            {
+                List<int> pins = new List<int>(8);
+
+                for (int p = 0; p < 8; p++)
+                {
+                    if (this.SamplingPins != 0 ? (this.SamplingPins & (1 << p)) != 0 : p < this.SamplingChannels)
+                        pins.Add(p);
+                }
+                return pins.ToArray();
+            }
+        }
+
         /// <summary>
         /// Gets/Sets if compression is to be used
         /// </summary>
@@ -164,6 +225,109 @@ namespace LogicAnalyzer.DataAcquisition
             set;
         }
 
+        /// <summary>
+        /// Gets/Sets the compression method the device should use (when compression is used)
+        /// </summary>
+        public Compression.CompressionMethods SamplingCompressionMethod
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets if the device should capture with timer-triggered DMA instead of
+        /// an interrupt per sample (needed for the higher sampling rates)
+        /// </summary>
+        public bool SamplingDma
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets if the device may halve its sampling rate while it can't send the samples
+        /// as fast as it takes them (rather than drop them)
+        /// </summary>
+        public bool SamplingDecimate
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the trigger mode. Samples before the trigger are discarded by the device.
+        /// </summary>
+        public TriggerModes TriggerMode
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the channels (bits) compared by a pattern trigger
+        /// </summary>
+        public byte TriggerMask
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the channel states (bits) a pattern trigger looks for
+        /// </summary>
+        public byte TriggerValue
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the channels (bits) whose rising edge fires an edge trigger
+        /// </summary>
+        public byte TriggerRising
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the channels (bits) whose falling edge fires an edge trigger
+        /// </summary>
+        public byte TriggerFalling
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the number of samples to skip after the trigger fires
+        /// </summary>
+        public int TriggerHoldoff
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the number of samples to record in burst mode (0 to stream samples instead). In burst mode,
+        /// the device records at full speed and sends the samples around the trigger afterwards; the sampling
+        /// time is how long to wait for the trigger.
+        /// </summary>
+        public int BurstDepth
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the number of samples from before the trigger to send in burst mode
+        /// </summary>
+        public int BurstPre
+        {
+            get;
+            set;
+        }
+
         /// <summary>
         /// Gets/Sets the sampling mode
         /// </summary>
@@ -183,7 +347,7 @@ namespace LogicAnalyzer.DataAcquisition
         }
 
         /// <summary>
-        /// Gets/Sets the total time to sample (in milliseconds)
+        /// Gets/Sets the total time to sample (in milliseconds), or 0 to sample until StopSampling() is called
         /// </summary>
         public int SamplingTime
         {
@@ -191,6 +355,76 @@ namespace LogicAnalyzer.DataAcquisition
             set;
         }
 
+        /// <summary>
+        /// Gets/Sets the flow control window (in bytes of sample data), or 0 for no flow control. With flow
+        /// control, the device only sends as much sample data as it has been given credit for, and credit is
+        /// given back as the data is taken in. If the host falls behind, the device degrades the capture
+        /// (decimation, then gaps) rather than the data being lost on the way.
+        /// </summary>
+        public int FlowControlWindow
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets the most sample data to keep in memory (in bytes), or 0 for the default. Beyond that, the
+        /// sample data is kept in a temporary file until the next capture (see CaptureStore).
+        /// </summary>
+        public long MemoryBudget
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets/Sets a file the sample data is written to as it arrives, instead of being kept (null to keep
+        /// it). For captures that are to be saved rather than plotted. In Transition mode, the file holds the
+        /// transition records (see TransitionDecoder).
+        /// </summary>
+        public string StreamFile
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// The performance counters the device reported for the last capture (null if none were received).
+        /// </summary>
+        public CaptureStats LastStats
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// File the performance counters of every capture are appended to (null for no log).
+        /// </summary>
+        public string StatsLogFile
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// The gaps and rate changes the device reported for the last capture, in timeline order.
+        /// </summary>
+        public List<TimelineEvent> TimelineEvents
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the plot of the last capture, built as its data came in (null if the data went to a file, or if
+        /// the plot has to be built again from the data, see SamplePlot.EventsLate).
+        /// </summary>
+        public SamplePlot Plot
+        {
+            get;
+            private set;
+        }
+
         #endregion
 
         #region Methods
@@ -203,6 +437,7 @@ namespace LogicAnalyzer.DataAcquisition
             if (this.Controller != null)
                 this.Controller.Close();
             samplingInProgress = false;
+            CloseStreamFile();
         }
 
         /// <summary>
@@ -228,9 +463,10 @@ namespace LogicAnalyzer.DataAcquisition
                     return;
             }
 
-            this.Data = new List<byte>(64);
+            this.Data.Clear();
 
             pingInProgress = false;
+            statsInProgress = false;
             sampleReceived = false;
             samplingInProgress = false;
 
@@ -258,6 +494,13 @@ namespace LogicAnalyzer.DataAcquisition
         /// </summary>
         public void PingController()
         {
+            // While sampling, the device answers in the sample stream (see SendCommand()).
+            if (samplingInProgress)
+            {
+                SendCommand("PING");
+                return;
+            }
+
             // If the controller is not open, attempt to open it.
             if (!Controller.IsOpen())
             {
@@ -295,6 +538,58 @@ namespace LogicAnalyzer.DataAcquisition
             }
         }
 
+        /// <summary>
+        /// Ask the controller/device for the performance counters of its last capture.
+        /// </summary>
+        public void RequestStats()
+        {
+            // While sampling, the counters so far come back in the sample stream (see SendCommand()).
+            if (samplingInProgress)
+            {
+                SendCommand("STAT");
+                return;
+            }
+
+            // If the controller is not open, attempt to open it.
+            if (!Controller.IsOpen())
+            {
+                // If Open() fails, the error was already broadcast through the event handler
+                // so just stop.
+                if (!Controller.Open())
+                    return;
+            }
+
+            pingInProgress = false;
+            samplingInProgress = false;
+
+            Controller.ClearFilters();
+
+            // The counters come back in a status frame.
+            frameFilter = new Filters.FrameFilter();
+            Controller.AddInputFilter(frameFilter);
+
+            Controller.TotalBytesReceived = 0;
+            Controller.TotalUnfilteredBytesReceived = 0;
+
+            try
+            {
+                // Send a command to the controller/micro.
+                Controller.Write("STAT\r\n");
+
+                statsInProgress = true;
+
+                // Wait for 1/2 a second for a response.
+                sampleTimer = new Timer();
+                sampleTimer.Interval = 500;
+                sampleTimer.Tick += sampleTimer_Tick;
+                sampleTimer.Enabled = true;
+            }
+            catch (Exception ex)
+            {
+                BroadcastError(ex.Message);
+            }
+        }
+
         /// <summary>
         /// Start a sampling session.
         /// </summary>
@@ -309,29 +604,45 @@ namespace LogicAnalyzer.DataAcquisition
                     return;
             }
 
-            // Use the expected data length to initialize the data array.
-            this.Data = new List<byte>(this.ExpectedDataLength + 16);
+            // The last capture's data (and its file, if it had one) goes.
+            this.Data.Dispose();
+            this.Data = new CaptureStore(CaptureStore.DefaultSegmentSize,
+                this.MemoryBudget > 0 ? this.MemoryBudget : CaptureStore.DefaultMemoryBudget);
 
             pingInProgress = false;
+            statsInProgress = false;
             sampleReceived = false;
+            this.LastStats = null;
+            this.TimelineEvents = new List<TimelineEvent>();
+            this.Plot = null;
+
+            // The capture is plotted as it comes in, unless it goes to a file.
+            lock (livePlotLock)
+            {
+                livePlot = string.IsNullOrEmpty(this.StreamFile) ? SamplePlot.Begin(this.Pins, this.SamplingMode == SamplingModes.TransitionsOnly) : null;
+                livePlotEvents = 0;
+                livePlotTime = Environment.TickCount;
+            }
 
             Controller.ClearFilters();
 
-            // Attach an error filter to the controller input.
-            Controller.AddInputFilter(new Filters.ErrorFilter());
+            // While sampling, the device sends frames. The frame filter checks them, reports
+            // errors and lost data, and decompresses the sample stream if necessary.
+            frameFilter = new Filters.FrameFilter();
+            frameFilter.OnReply += frameFilter_OnReply;
+            Controller.AddInputFilter(frameFilter);
+            creditedBytes = 0;
 
-            if (this.SamplingMode == SamplingModes.Continuous)
-            {
-                // If we're in Continuous mode and compression is specified, add a decompression filter to the controller input.
-                if (this.SamplingCompression)
-                    Controller.AddInputFilter(new Filters.DecompressionFilter());
-            }
-            else
+            if (this.SamplingMode == SamplingModes.RunLength)
             {
-                // If we're in Transition mode, attach a filter for that.
-                Controller.AddInputFilter(new Filters.TimestampFilter());
+                // If we're in RunLength mode, expand the runs back to a continuous stream.
+                Controller.AddInputFilter(new Filters.RunLengthFilter());
             }
 
+            // In Transition mode, the transition records are kept as they are (see SamplePlot.FromTransitions()).
+            // They are only decoded here to follow the length of the timeline.
+            transitionDecoder = new TransitionDecoder();
+
             Controller.TotalBytesReceived = 0;
             Controller.TotalUnfilteredBytesReceived = 0;
 
@@ -339,30 +650,180 @@ namespace LogicAnalyzer.DataAcquisition
             {
                 // Send commands to the controller to set modes on the micro.
                 Controller.Write("CHAN=" + this.SamplingChannels + "\r\n");
+                if (this.SamplingPins != 0)
+                    Controller.Write("MASK=" + this.SamplingPins + "\r\n");
                 Controller.Write("RATE=" + this.SamplingRate + "\r\n");
-                Controller.Write("COMP=" + (this.SamplingCompression ? "Y" : "N") + "\r\n");
+                Controller.Write("TRIG=" + (this.TriggerMode == TriggerModes.Pattern ? "P" : this.TriggerMode == TriggerModes.Edge ? "E" :
+                    this.TriggerMode == TriggerModes.PatternThenEdge ? "PE" : "N") + "\r\n");
+                Controller.Write("TMSK=" + this.TriggerMask + "\r\n");
+                Controller.Write("TVAL=" + this.TriggerValue + "\r\n");
+                Controller.Write("TRIS=" + this.TriggerRising + "\r\n");
+                Controller.Write("TFAL=" + this.TriggerFalling + "\r\n");
+                Controller.Write("HOLD=" + this.TriggerHoldoff + "\r\n");
+                Controller.Write("COMP=" + (!this.SamplingCompression ? "N" : this.SamplingCompressionMethod == Compression.CompressionMethods.Block ? "B" : "Y") + "\r\n");
                 Controller.Write("TIME=" + this.SamplingTime + "\r\n");
-                Controller.Write("MODE=" + (this.SamplingMode == SamplingModes.TransitionsOnly ? "TRAN" : "CONT") + "\r\n");
+                Controller.Write("MODE=" + (this.SamplingMode == SamplingModes.TransitionsOnly ? "TRAN" : this.SamplingMode == SamplingModes.RunLength ? "RUNL" : "CONT") + "\r\n");
+                Controller.Write("DMAC=" + (this.SamplingDma ? "Y" : "N") + "\r\n");
+                Controller.Write("DECI=" + (this.SamplingDecimate ? "Y" : "N") + "\r\n");
+                Controller.Write("DPTH=" + this.BurstDepth + "\r\n");
+                Controller.Write("PRE=" + this.BurstPre + "\r\n");
+                if (this.FlowControlWindow > 0)
+                    Controller.Write("CRED=" + this.FlowControlWindow + "\r\n");
+
+                CloseStreamFile();
+                if (!string.IsNullOrEmpty(this.StreamFile))
+                {
+                    lock (streamFileLock)
+                    {
+                        streamFile = new FileStream(this.StreamFile, FileMode.Create, FileAccess.Write, FileShare.Read, 1 << 16);
+                    }
+                }
 
                 // Start sampling...
                 Controller.Write("START\r\n");
 
                 samplingInProgress = true;
+                burstDeadline = Environment.TickCount + BurstTimeout;
 
-                // Wait for a response.
+                // Wait for a response. A capture without a time limit is watched until it ends.
                 sampleTimer = new Timer();
-                sampleTimer.Interval = this.SamplingTime + 100;
+                sampleTimer.Interval = this.SamplingTime > 0 ? this.SamplingTime + 100 : 100;
                 sampleTimer.Tick += sampleTimer_Tick;
                 sampleTimer.Enabled = true;
             }
             catch (Exception ex)
             {
                 samplingInProgress = false;
+                CloseStreamFile();
 
                 BroadcastError(ex.Message);
             }
         }
 
+        /// <summary>
+        /// Stop a sampling session early (or one without a time limit). The device still sends the samples it
+        /// has taken, and the session completes as usual once they are in. Stopping again tells the device to
+        /// send them without waiting for flow control credit.
+        /// </summary>
+        public void StopSampling()
+        {
+            if (samplingInProgress)
+                SendCommand("STOP");
+        }
+
+        /// <summary>
+        /// Have the device forget the trigger it has seen and look for the next one. This is only possible
+        /// while sampling, before the samples after the trigger have all been taken.
+        /// </summary>
+        public void RearmTrigger()
+        {
+            if (samplingInProgress)
+            {
+                // The window is recorded again after the next trigger.
+                burstDeadline = Environment.TickCount + BurstTimeout;
+                SendCommand("ARM");
+            }
+        }
+
+        /// <summary>
+        /// Gets how long a burst capture can take to end (in milliseconds): waiting for the trigger, recording
+        /// the window, then sending it. Nothing comes in until the window is recorded, so the capture can't be
+        /// judged finished by the data stopping.
+        /// </summary>
+        private int BurstTimeout
+        {
+            get
+            {
+                long window = this.SamplingRate > 0 ? (long)this.BurstDepth * 1000 / this.SamplingRate : 0;
+                long send = (long)this.ExpectedDataLength * 1000 / BurstLineRate;
+
+                return (int)Math.Min(this.SamplingTime + window + send + 1000, int.MaxValue);
+            }
+        }
+
+        /// <summary>
+        /// Send a command to the device while sampling. The device takes it as soon as it can, and replies
+        /// with a frame in the sample stream (see frameFilter_OnReply()).
+        /// </summary>
+        /// <param name="Command">The command</param>
+        private void SendCommand(string Command)
+        {
+            try
+            {
+                Controller.Write(Command + "\r\n");
+            }
+            catch (Exception ex)
+            {
+                BroadcastError(ex.Message);
+            }
+        }
+
+        /// <summary>
+        /// Add a block of received data to the plot of the capture, and have the plot shown again if it
+        /// hasn't been for LivePlotInterval.
+        /// </summary>
+        /// <param name="Buffer">An array holding the data</param>
+        /// <param name="Count">The length of the data</param>
+        private void AppendLivePlot(byte[] Buffer, int Count)
+        {
+            SamplePlot plot;
+
+            lock (livePlotLock)
+            {
+                plot = livePlot;
+                if (plot == null)
+                    return;
+
+                // The frame filter has taken in the gaps and rate changes sent ahead of the data.
+                while (livePlotEvents < frameFilter.Events.Count)
+                    plot.AddEvent(frameFilter.Events[livePlotEvents++]);
+                plot.Append(Buffer, 0, Count);
+            }
+
+            if (Environment.TickCount - livePlotTime >= LivePlotInterval)
+            {
+                livePlotTime = Environment.TickCount;
+                BroadcastPlotUpdate(plot);
+            }
+        }
+
+        /// <summary>
+        /// Finish the plot of the capture, once the data is all in.
+        /// </summary>
+        private void FinishLivePlot()
+        {
+            lock (livePlotLock)
+            {
+                if (livePlot == null)
+                    return;
+
+                while (livePlotEvents < frameFilter.Events.Count)
+                    livePlot.AddEvent(frameFilter.Events[livePlotEvents++]);
+                livePlot.Finish();
+
+                // Data that comes in late is left out of it.
+                if (!livePlot.EventsLate)
+                    this.Plot = livePlot;
+                livePlot = null;
+            }
+        }
+
+        /// <summary>
+        /// Close the file the sample data is being written to, if there is one.
+        /// </summary>
+        private void CloseStreamFile()
+        {
+            // The reader thread could be writing to it.
+            lock (streamFileLock)
+            {
+                if (streamFile != null)
+                {
+                    streamFile.Close();
+                    streamFile = null;
+                }
+            }
+        }
+
         /// <summary>
         /// Timer tick event handler (used to finish sampling and pinging).
         /// </summary>
@@ -383,7 +844,32 @@ namespace LogicAnalyzer.DataAcquisition
                 return;
             }
 
-            addlTime = (this.SamplingMode == SamplingModes.TransitionsOnly ? 500 : 100);
+            // If we asked the device for its counters, report them.
+            if (statsInProgress)
+            {
+                statsInProgress = false;
+                Controller.ClearFilters();
+
+                CaptureStats stats = CaptureStats.Parse(frameFilter.Status);
+                if (stats == null)
+                    BroadcastError("No status received\r\n");
+                else
+                    BroadcastConsoleMessage(stats.ToString());
+                return;
+            }
+
+            // A capture without a time limit goes on until the device sends its end frame, and so does a burst
+            // capture, unless it takes far longer than it should.
+            if (!frameFilter.Ended && (this.SamplingTime == 0 ||
+                (this.BurstDepth > 0 && unchecked(Environment.TickCount - burstDeadline) < 0)))
+            {
+                sampleReceived = false;
+                sampleTimer.Interval = 100;
+                sampleTimer.Enabled = true;
+                return;
+            }
+
+            addlTime = (this.SamplingMode != SamplingModes.Continuous ? 500 : 100);
 
             // The sample should be complete, but there could be a lag, so
             // check every 100 ms from now on to look for activity.
@@ -396,6 +882,20 @@ namespace LogicAnalyzer.DataAcquisition
 
                 //Controller.Write("STOP\r\n");
 
+                // The device ends every capture with a status frame of its performance counters.
+                this.TimelineEvents = new List<TimelineEvent>(frameFilter.Events);
+                this.TimelineEvents.Sort(TimelineEvent.ComparePositions);
+
+                CloseStreamFile();
+                FinishLivePlot();
+
+                this.LastStats = CaptureStats.Parse(frameFilter.Status);
+                if (this.LastStats != null)
+                {
+                    BroadcastConsoleMessage(this.LastStats.ToString());
+                    LogStats(this.LastStats);
+                }
+
                 Controller.ClearFilters();
 
                 // Tell our listeners that we are finished sampling.
@@ -407,6 +907,46 @@ namespace LogicAnalyzer.DataAcquisition
             sampleTimer.Enabled = true;
         }
 
+        /// <summary>
+        /// Append the performance counters of a capture, with the settings it was made with, to the stats log.
+        /// </summary>
+        /// <param name="Stats">The counters</param>
+        private void LogStats(CaptureStats Stats)
+        {
+            if (string.IsNullOrEmpty(this.StatsLogFile))
+                return;
+
+            try
+            {
+                bool newFile = !File.Exists(this.StatsLogFile);
+
+                using (StreamWriter writer = new StreamWriter(this.StatsLogFile, true))
+                {
+                    if (newFile)
+                        writer.WriteLine("Captured,TimeMs,Rate,Channels,Mode,Compression,Dma,BurstDepth," + CaptureStats.CsvHeader);
+
+                    writer.WriteLine(string.Join(",", new string[] {
+                        DateTime.Now.ToString("s", CultureInfo.InvariantCulture),
+                        this.SamplingTime.ToString(CultureInfo.InvariantCulture),
+                        this.SamplingRate.ToString(CultureInfo.InvariantCulture),
+                        this.Pins.Length.ToString(CultureInfo.InvariantCulture),
+                        this.SamplingMode.ToString(),
+                        !this.SamplingCompression ? "None" : this.SamplingCompressionMethod.ToString(),
+                        this.SamplingDma ? "Y" : "N",
+                        this.BurstDepth.ToString(CultureInfo.InvariantCulture),
+                        Stats.ToCsv() }));
+                }
+            }
+            catch (IOException ex)
+            {
+                BroadcastError("Could not write the stats log: " + ex.Message + "\r\n");
+            }
+            catch (UnauthorizedAccessException ex)
+            {
+                BroadcastError("Could not write the stats log: " + ex.Message + "\r\n");
+            }
+        }
+
         #endregion
 
         #region Events
@@ -478,6 +1018,24 @@ namespace LogicAnalyzer.DataAcquisition
             //handler(this, ProgressEventArgs.GetInstance(this.Name, Message));
         }
 
+        /// <summary>
+        /// Handle this event to follow the plot of a capture while it comes in (raised at most every
+        /// LivePlotInterval, on the thread the data comes in on).
+        /// </summary>
+        public event EventHandler<PlotEventArgs> OnPlotUpdate;
+
+        /// <summary>
+        /// Broadcast an OnPlotUpdate event to anyone who's listening.
+        /// </summary>
+        /// <param name="Samples">The plot so far</param>
+        protected void BroadcastPlotUpdate(SamplePlot Samples)
+        {
+            EventHandler<PlotEventArgs> handler = OnPlotUpdate;
+
+            if (handler != null)
+                handler(this, new PlotEventArgs(Samples));
+        }
+
         /// <summary>
         /// Handle this event to identify when progress is being made when receiving data.
         /// </summary>
@@ -500,6 +1058,29 @@ namespace LogicAnalyzer.DataAcquisition
 
         #region Controller Event Handlers
 
+        /// <summary>
+        /// Handler for the device's replies to commands sent while sampling.
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        void frameFilter_OnReply(object sender, Filters.ReplyEventArgs e)
+        {
+            if (!e.Done)
+                BroadcastError(e.Command + " refused while sampling\r\n");
+            else if (e.Command == "PING")
+                BroadcastConsoleMessage("Ping successful\r\n");
+            else if (e.Command == "STAT")
+            {
+                // The status frame comes just before the reply.
+                CaptureStats stats = CaptureStats.Parse(frameFilter.Status);
+
+                if (stats != null)
+                    BroadcastConsoleMessage(stats.ToString());
+            }
+            else
+                BroadcastConsoleMessage(e.Command + " done\r\n");
+        }
+
         /// <summary>
         /// Handler for controller OnError events.
         /// </summary>
@@ -541,8 +1122,12 @@ namespace LogicAnalyzer.DataAcquisition
 
             if (count > 0)
             {
-                byte[] buffer = new byte[count];
-                Controller.Read(buffer, count);
+                // The receive buffer is only grown, never reallocated per event.
+                if (receiveBuffer.Length < count)
+                    receiveBuffer = new byte[Math.Max(count, 2 * receiveBuffer.Length)];
+
+                byte[] buffer = receiveBuffer;
+                count = Controller.Read(buffer, count);
 
                 if (samplingInProgress)
                 {
@@ -553,19 +1138,47 @@ namespace LogicAnalyzer.DataAcquisition
                     WriteBytes(buffer);
 #endif
 
-                    // NOTE: Not sure if this is any better than looping through the buffer myself...
-                    this.Data.AddRange(buffer);
+                    // Keep the data, or send it straight on to the stream file. The file is closed on the UI
+                    // thread when the capture is over, so it is only written with the lock held.
+                    bool streamed;
+
+                    lock (streamFileLock)
+                    {
+                        FileStream file = streamFile;
+
+                        streamed = file != null;
+                        if (streamed)
+                            file.Write(buffer, 0, count);
+                    }
+                    if (!streamed)
+                    {
+                        this.Data.Append(buffer, 0, count);
+                        AppendLivePlot(buffer, count);
+                    }
+                    if (this.SamplingMode == SamplingModes.TransitionsOnly)
+                        transitionDecoder.Skip(buffer, 0, count);
+
+                    // Give the device its credit back once a quarter of the window has been taken in.
+                    if (this.FlowControlWindow > 0 && frameFilter.SampleBytes - creditedBytes >= this.FlowControlWindow / 4)
+                    {
+                        Controller.Write("CRED=" + (frameFilter.SampleBytes - creditedBytes) + "\r\n");
+                        creditedBytes = frameFilter.SampleBytes;
+                    }
 
                     // Tell our fans that we're making progress.
                     if (this.ExpectedDataLength > 0)
                         BroadcastProgress((int)((100.0 * this.DataLength) / this.ExpectedDataLength));
                 }
+                else if (statsInProgress)
+                {
+                    // The status frame is picked up by the frame filter; nothing else is expected.
+                }
                 else if (pingInProgress)
                 {
                     pingResponseReceived = true;
 
                     // Check for a valid ping response.
-                    if (enc.GetString(buffer).Equals("pOnG\r\n"))
+                    if (enc.GetString(buffer, 0, count).Equals("pOnG\r\n"))
                         BroadcastConsoleMessage("Ping successful\r\n");
                     else
                         BroadcastError("Ping failed\r\n");
@@ -573,7 +1186,7 @@ namespace LogicAnalyzer.DataAcquisition
                 else
                 {
                     // If we're not in 'sample' or 'ping' mode, just send the received data to the console.
-                    BroadcastConsoleMessage(new System.Text.ASCIIEncoding().GetString(buffer).Replace("\0", ""));
+                    BroadcastConsoleMessage(new System.Text.ASCIIEncoding().GetString(buffer, 0, count).Replace("\0", ""));
                 }
             }
 
@@ -19,18 +19,30 @@
 using System;
 using System.Collections.Generic;
 using System.Text;
+using System.Threading;
 
 namespace LogicAnalyzer.DataAcquisition
 {
     /// <summary>
-    /// Class defining methods for turning an array of sampled bytes into separate arrays of SampleSignal objects (one
-    /// for each input channel).
+    /// Class defining methods for turning an array of sampled bytes into a TransitionIndex for each input channel,
+    /// in one pass over the samples. A plot can also be built as a capture comes in (see Begin()), a block of
+    /// samples at a time; each block costs no more than it would in a single pass, and a display can draw the
+    /// plot up to its Length while it grows.
     /// </summary>
     public class SamplePlot
     {
         private int samplesPerByte;
         private int sampleShift;
-        private SampleSignal[] currentChannelSignal;
+        private int channelMask;
+        private byte currentSample;
+        private bool started;
+        private List<TimelineEvent> events;
+        private int nextEvent;
+        private long position;
+        private int divisor;
+        private long unknownUntil;
+        private long length;
+        private TransitionDecoder decoder;
 
         #region Constructors
 
@@ -41,7 +53,58 @@ namespace LogicAnalyzer.DataAcquisition
         /// <param name="Channels">The number of channels being sampled (when 4 or fewer, sample data is 'stacked')</param>
         /// <param name="StackedSamples">'true' if more than one sample is stacked in each byte</param>
         public SamplePlot(byte[] Samples, int Channels, bool StackedSamples)
+            : this(Samples, Channels, StackedSamples, null)
         {
+        }
+
+        /// <summary>
+        /// Creates and initalizes a SamplePlot object for a capture the device reported gaps and rate changes in
+        /// </summary>
+        /// <param name="Samples">Raw sampled data from the input device</param>
+        /// <param name="Channels">The number of channels being sampled (when 4 or fewer, sample data is 'stacked')</param>
+        /// <param name="StackedSamples">'true' if more than one sample is stacked in each byte</param>
+        /// <param name="Events">The gaps and rate changes of the capture (may be null)</param>
+        public SamplePlot(byte[] Samples, int Channels, bool StackedSamples, IList<TimelineEvent> Events)
+            : this(Samples, firstPins(Channels), StackedSamples, Events)
+        {
+        }
+
+        /// <summary>
+        /// Creates and initalizes a SamplePlot object for a capture of any of the device's pins
+        /// </summary>
+        /// <param name="Samples">Raw sampled data from the input device</param>
+        /// <param name="Pins">The pin (0 is the first) each channel was sampled from, in the order the device packs them</param>
+        /// <param name="StackedSamples">'true' if more than one sample is stacked in each byte</param>
+        /// <param name="Events">The gaps and rate changes of the capture (may be null)</param>
+        public SamplePlot(byte[] Samples, int[] Pins, bool StackedSamples, IList<TimelineEvent> Events)
+            : this(new ArraySegment<byte>[] { new ArraySegment<byte>(Samples) }, Pins, StackedSamples, Events)
+        {
+        }
+
+        /// <summary>
+        /// Creates and initalizes a SamplePlot object from sample data held in segments (see CaptureStore)
+        /// </summary>
+        /// <param name="Samples">Raw sampled data from the input device, a segment at a time</param>
+        /// <param name="Pins">The pin (0 is the first) each channel was sampled from, in the order the device packs them</param>
+        /// <param name="StackedSamples">'true' if more than one sample is stacked in each byte</param>
+        /// <param name="Events">The gaps and rate changes of the capture (may be null)</param>
+        public SamplePlot(IEnumerable<ArraySegment<byte>> Samples, int[] Pins, bool StackedSamples, IList<TimelineEvent> Events)
+            : this(Pins, StackedSamples, Events)
+        {
+            // Build the sample arrays...
+            buildSampleSignals(Samples);
+        }
+
+        /// <summary>
+        /// Initializes a SamplePlot object, without any samples.
+        /// </summary>
+        /// <param name="Pins">The pin (0 is the first) each channel was sampled from, in the order the device packs them</param>
+        /// <param name="StackedSamples">'true' if more than one sample is stacked in each byte</param>
+        /// <param name="Events">The gaps and rate changes of the capture (may be null)</param>
+        private SamplePlot(int[] Pins, bool StackedSamples, IList<TimelineEvent> Events)
+        {
+            int Channels = Pins.Length;
+
             if (StackedSamples)
             {
                 // When the number of channels is 4 or fewer, samples are 'stacked'. So here
@@ -77,18 +140,62 @@ namespace LogicAnalyzer.DataAcquisition
             }
 
             this.Channels = Channels;
-            this.SampleSignals = new List<SampleSignal>[Channels];
-            currentChannelSignal = new SampleSignal[Channels];
+            this.Pins = (int[])Pins.Clone();
+            this.StackedSamples = StackedSamples;
+            this.Transitions = new TransitionIndex[Channels];
+            this.Unknown = new TransitionIndex(SampleSignal.State.Low);
+            this.RateChanges = new List<TimelineEvent>();
+            this.Length = 0;
 
+            // Each channel starts low until the first known sample sets its state.
             for (int c = 0; c < Channels; c++)
-            {
-                // Initialize each channel low, 0 duration.
-                currentChannelSignal[c] = new SampleSignal(SampleSignal.State.Low, 0);
-                this.SampleSignals[c] = new List<SampleSignal>(2048);
-            }
+                this.Transitions[c] = new TransitionIndex(SampleSignal.State.Low);
+            channelMask = (1 << Channels) - 1;
+            currentSample = 0;
+            started = false;
 
-            // Build the sample arrays...
-            buildSampleSignals(Samples);
+            // Walk the events in timeline order alongside the samples.
+            events = (Events != null) ? new List<TimelineEvent>(Events) : new List<TimelineEvent>();
+            events.Sort(TimelineEvent.ComparePositions);
+            nextEvent = 0;
+            position = 0;
+            divisor = 1;
+            unknownUntil = 0;
+        }
+
+        /// <summary>
+        /// Creates a SamplePlot object from the transition records of a transitions-only capture (see
+        /// TransitionDecoder). Each record extends the channels by a whole run, so the samples are never
+        /// expanded one per tick.
+        /// </summary>
+        /// <param name="Records">The transition records, a segment at a time</param>
+        /// <param name="Pins">The pin (0 is the first) each channel was sampled from, in the order the device packs them</param>
+        /// <param name="Events">The gaps and rate changes of the capture (may be null)</param>
+        /// <returns>The plot</returns>
+        public static SamplePlot FromTransitions(IEnumerable<ArraySegment<byte>> Records, int[] Pins, IList<TimelineEvent> Events)
+        {
+            SamplePlot plot = new SamplePlot(Pins, false, Events);
+
+            plot.decoder = new TransitionDecoder();
+            plot.buildSampleSignals(Records);
+            return plot;
+        }
+
+        /// <summary>
+        /// Creates a SamplePlot object without any samples, to be built as a capture comes in (see Append(),
+        /// AddEvent() and Finish()).
+        /// </summary>
+        /// <param name="Pins">The pin (0 is the first) each channel was sampled from, in the order the device packs them</param>
+        /// <param name="TransitionRecords">'true' if the samples are transition records (see TransitionDecoder),
+        /// 'false' if they are stacked samples</param>
+        /// <returns>The plot</returns>
+        public static SamplePlot Begin(int[] Pins, bool TransitionRecords)
+        {
+            SamplePlot plot = new SamplePlot(Pins, !TransitionRecords, null);
+
+            if (TransitionRecords)
+                plot.decoder = new TransitionDecoder();
+            return plot;
         }
 
         #endregion
@@ -96,14 +203,34 @@ namespace LogicAnalyzer.DataAcquisition
         #region Properties
 
         /// <summary>
-        /// Gets the resulting signal plots for each channel.
+        /// Gets the resulting transitions of each channel.
         /// </summary>
-        public List<SampleSignal>[] SampleSignals
+        public TransitionIndex[] Transitions
         {
             get;
             internal set;
         }
 
+        /// <summary>
+        /// Gets the ranges where the state of every channel is unknown because the device lost the samples
+        /// (the index is High inside them). The channels keep their last known state through these.
+        /// </summary>
+        public TransitionIndex Unknown
+        {
+            get;
+            internal set;
+        }
+
+        /// <summary>
+        /// Gets the length of the plot in ticks. While the plot is being built, this is how much of it is
+        /// final; it is read and written atomically, so it can be followed from another thread.
+        /// </summary>
+        public long Length
+        {
+            get { return Interlocked.Read(ref length); }
+            internal set { Interlocked.Exchange(ref length, value); }
+        }
+
         /// <summary>
         /// Gets the number of channels being sampled (when 4 or fewer, sample data is 'stacked')
         /// </summary>
@@ -113,6 +240,15 @@ namespace LogicAnalyzer.DataAcquisition
             internal set;
         }
 
+        /// <summary>
+        /// Gets the pin (0 is the first) each channel was sampled from.
+        /// </summary>
+        public int[] Pins
+        {
+            get;
+            internal set;
+        }
+
         /// <summary>
         /// 'true' if more than one sample is stacked in each byte
         /// </summary>
@@ -122,25 +258,124 @@ namespace LogicAnalyzer.DataAcquisition
             internal set;
         }
 
+        /// <summary>
+        /// Gets the points where the device changed its sampling rate (positions are in the same time units
+        /// as the signal durations). The list is replaced rather than added to, so it can be held on to while
+        /// the plot is being built.
+        /// </summary>
+        public List<TimelineEvent> RateChanges
+        {
+            get;
+            internal set;
+        }
+
+        /// <summary>
+        /// 'true' if an event was added after the samples past its position (see AddEvent()), so the plot
+        /// isn't the one the whole capture would give and should be built again from the data.
+        /// </summary>
+        public bool EventsLate
+        {
+            get;
+            private set;
+        }
+
         #endregion
 
         #region Methods
 
         /// <summary>
-        /// Add a signal to the Channel's list.
+        /// Get the pins sampled when only a number of channels is given (the first pins).
         /// </summary>
-        /// <param name="channel"></param>
-        private void addSignal(int channel)
+        /// <param name="Channels"></param>
+        /// <returns></returns>
+        private static int[] firstPins(int Channels)
         {
-            SampleSignal ss = currentChannelSignal[channel];
+            if (Channels < 1 || Channels > 8)
+                throw new Exception("Channels must be in the range 1 - 8");
+
+            int[] pins = new int[Channels];
+
+            for (int c = 0; c < Channels; c++)
+                pins[c] = c;
+            return pins;
+        }
+
+        /// <summary>
+        /// Set the Channels-wide sample from the current position on, adding a transition to each channel
+        /// whose bit changes.
+        /// </summary>
+        /// <param name="sample"></param>
+        private void setSample(byte sample)
+        {
+            int changed;
+
+            sample = (byte)(sample & channelMask);
+
+            // Leave a range of unknown samples.
+            if ((Unknown.EdgeCount & 1) != 0)
+                Unknown.AddEdge(position);
 
-            if (ss.Duration > 0)
+            if (!started)
             {
-                SampleSignals[channel].Add(ss);
+                // The first known sample gives the state the channels start in.
+                for (int c = 0; c < Channels; c++)
+                    Transitions[c].InitialState = (sample & (1 << c)) != 0 ? SampleSignal.State.High : SampleSignal.State.Low;
+                currentSample = sample;
+                started = true;
+                return;
+            }
+
+            changed = sample ^ currentSample;
+            if (changed != 0)
+            {
+                for (int c = 0; c < Channels; c++)
+                {
+                    if ((changed & (1 << c)) != 0)
+                        Transitions[c].AddEdge(position);
+                }
+                currentSample = sample;
+            }
+        }
+
+        /// <summary>
+        /// Mark the samples from the current position on as unknown.
+        /// </summary>
+        private void setUnknown()
+        {
+            if ((Unknown.EdgeCount & 1) == 0)
+                Unknown.AddEdge(position);
+        }
+
+        /// <summary>
+        /// Apply the events that take effect before the sample at the current position.
+        /// </summary>
+        private void processEvents()
+        {
+            while (nextEvent < events.Count && events[nextEvent].Position <= position)
+            {
+                TimelineEvent ev = events[nextEvent++];
 
-                // Create a new current signal on this channel with the opposite flavor.
-                // Duration = 1.
-                currentChannelSignal[channel] = new SampleSignal(ss.SampleState == SampleSignal.State.High ? SampleSignal.State.Low : SampleSignal.State.High, 1);
+                if (ev.Kind == TimelineEvent.Kinds.RateChange)
+                {
+                    List<TimelineEvent> rateChanges = new List<TimelineEvent>(RateChanges);
+
+                    divisor = Math.Max(ev.Value, 1);
+                    rateChanges.Add(new TimelineEvent(ev.Kind, position, divisor));
+                    RateChanges = rateChanges;
+                }
+                else if (StackedSamples)
+                {
+                    // The samples of a gap are missing from the data, so stand in for them.
+                    if (ev.Value > 0)
+                        setUnknown();
+                    position += ev.Value;
+                }
+                else
+                {
+                    // In transition mode the timeline is complete (the last state known is simply
+                    // repeated through a gap), so the gap's samples are marked as unknown instead.
+                    unknownUntil = Math.Max(unknownUntil, ev.Position + ev.Value);
+                }
             }
         }
 
@@ -150,46 +385,179 @@ namespace LogicAnalyzer.DataAcquisition
         /// <param name="sample"></param>
         private void processSample(byte sample)
         {
-            bool stateChanged;
+            if (nextEvent < events.Count)
+                processEvents();
 
-            for (int c = 0; c < Channels; c++)
+            if (position < unknownUntil)
+                setUnknown();
+            else
+                setSample(sample);
+
+            // While the device is decimating, each sample it took stands for 'divisor' ticks
+            // of the full sampling rate. (The timestamps of transition mode already take this into account.)
+            position += StackedSamples ? divisor : 1;
+        }
+
+        /// <summary>
+        /// Process a run of ticks of the same Channels-wide sample (transitions-only mode). The run is split
+        /// where events take effect and where unknown samples end, so the result is the same as processing
+        /// the samples one at a time.
+        /// </summary>
+        /// <param name="sample"></param>
+        /// <param name="ticks"></param>
+        private void processRun(byte sample, long ticks)
+        {
+            while (ticks > 0)
             {
-                // Check if the state for this channel changed.
-                if ((sample & (1 << c)) != 0)
-                    stateChanged = (currentChannelSignal[c].SampleState == SampleSignal.State.Low);
-                else
-                    stateChanged = (currentChannelSignal[c].SampleState == SampleSignal.State.High);
+                long count = ticks;
+
+                if (nextEvent < events.Count)
+                {
+                    processEvents();
+                    if (nextEvent < events.Count)
+                        count = Math.Min(count, events[nextEvent].Position - position);
+                }
 
-                // If the state (high/low) changed from the last sample, then add a new signal.
-                // Otherwise, just increase the duration of the previous signal.
-                if (stateChanged)
-                    addSignal(c);
+                if (position < unknownUntil)
+                {
+                    count = Math.Min(count, unknownUntil - position);
+                    setUnknown();
+                }
                 else
-                    currentChannelSignal[c].Duration++;
+                    setSample(sample);
+
+                position += count;
+                ticks -= count;
             }
         }
 
         /// <summary>
-        /// Build the signale arrays from the raw sample data.
+        /// Add the next block of samples (or transition records) of a plot started with Begin(). Once the
+        /// block is in, Length moves on to cover it.
         /// </summary>
-        /// <param name="Samples">Raw sampled data from the input device</param>
-        private void buildSampleSignals(byte[] Samples)
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        public void Append(byte[] Buffer, int Offset, int Count)
+        {
+            if (decoder != null)
+                appendTransitions(Buffer, Offset, Count);
+            else
+                appendSamples(Buffer, Offset, Count);
+
+            // The transitions go in before the length that covers them.
+            Unknown.Length = position;
+            for (int c = 0; c < Channels; c++)
+                Transitions[c].Length = position;
+            Length = position;
+        }
+
+        /// <summary>
+        /// Add a gap or rate change of a plot started with Begin(). Events are best added as soon as they
+        /// arrive; one added after the samples past its position can only take effect late (see EventsLate).
+        /// </summary>
+        /// <param name="Event">The event</param>
+        public void AddEvent(TimelineEvent Event)
+        {
+            int i = events.Count;
+
+            if (Event.Position < position)
+                EventsLate = true;
+
+            // Keep the events still to come in timeline order (they mostly arrive in it).
+            while (i > nextEvent && events[i - 1].Position > Event.Position)
+                i--;
+            events.Insert(i, Event);
+        }
+
+        /// <summary>
+        /// Finish a plot started with Begin(), once all of the samples and events are in.
+        /// </summary>
+        public void Finish()
+        {
+            finishTransitions();
+        }
+
+        /// <summary>
+        /// Add a block of stacked samples.
+        /// </summary>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        private void appendSamples(byte[] Buffer, int Offset, int Count)
         {
             byte shiftedSampleByte;
+            int end = Offset + Count;
 
-            foreach (byte sampleByte in Samples)
+            for (int i = Offset; i < end; i++)
             {
-                shiftedSampleByte = sampleByte;
+                shiftedSampleByte = Buffer[i];
                 for (int s = 0; s < samplesPerByte; s++)
                 {
                     processSample(shiftedSampleByte);
                     shiftedSampleByte >>= sampleShift;
                 }
             }
+        }
+
+        /// <summary>
+        /// Add a block of transition records. A record split between blocks is picked up in the next.
+        /// </summary>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        private void appendTransitions(byte[] Buffer, int Offset, int Count)
+        {
+            int end = Offset + Count;
+            long ticks;
+            byte sample;
+
+            while (decoder.Next(Buffer, ref Offset, end, out ticks, out sample))
+            {
+                if (ticks > 0)
+                    processRun(sample, ticks);
+            }
+        }
+
+        /// <summary>
+        /// Build the transitions from the raw sample data (or transition records).
+        /// </summary>
+        /// <param name="Samples">Raw sampled data from the input device, a segment at a time</param>
+        private void buildSampleSignals(IEnumerable<ArraySegment<byte>> Samples)
+        {
+            foreach (ArraySegment<byte> segment in Samples)
+            {
+                if (decoder != null)
+                    appendTransitions(segment.Array, segment.Offset, segment.Count);
+                else
+                    appendSamples(segment.Array, segment.Offset, segment.Count);
+            }
+
+            finishTransitions();
+        }
+
+        /// <summary>
+        /// Finish the transitions at the end of the samples.
+        /// </summary>
+        private void finishTransitions()
+        {
+            // A gap may run up to (or past) the end of the capture.
+            processEvents();
+            if (position < unknownUntil)
+            {
+                setUnknown();
+                position = unknownUntil;
+            }
 
             // Finish up.
+            Unknown.Length = position;
+            Unknown.TrimExcess();
             for (int c = 0; c < Channels; c++)
-                addSignal(c);
+            {
+                Transitions[c].Length = position;
+                Transitions[c].TrimExcess();
+            }
+            Length = position;
         }
 
         #endregion
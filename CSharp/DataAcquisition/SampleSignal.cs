@@ -30,7 +30,8 @@ namespace LogicAnalyzer.DataAcquisition
         public enum State
         {
             Low,
-            High
+            High,
+            Unknown // The device lost the samples (see TimelineEvent)
         }
 
         #region Constructors
@@ -38,7 +39,7 @@ namespace LogicAnalyzer.DataAcquisition
         /// <summary>
         /// Creates and initializes a SampleSignal object.
         /// </summary>
-        /// <param name="SampleState">High or Low state of the signale</param>
+        /// <param name="SampleState">High, Low or Unknown state of the signal</param>
         /// <param name="Duration">The duration of the signal (time units are arbitrary)</param>
         public SampleSignal(State SampleState, int Duration)
         {
@@ -51,7 +52,7 @@ namespace LogicAnalyzer.DataAcquisition
         #region Properties
 
         /// <summary>
-        /// Gets/Sets the High or Low state of the signal
+        /// Gets/Sets the High, Low or Unknown state of the signal
         /// </summary>
         public State SampleState
         {
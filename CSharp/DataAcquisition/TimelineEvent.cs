@@ -0,0 +1,106 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.DataAcquisition
+{
+    /// <summary>
+    /// Class defining something that happened at a point on the timeline of a capture, other than the samples
+    /// themselves: a gap (samples the device had to drop because it could not send them fast enough) or a change
+    /// of the rate the device samples at (it halves the rate while it is overloaded, if allowed to). Positions are in
+    /// samples at the full sampling rate since the start of the capture.
+    /// </summary>
+    public class TimelineEvent
+    {
+        /// <summary>
+        /// The kinds of timeline events.
+        /// </summary>
+        public enum Kinds
+        {
+            Gap,
+            RateChange
+        }
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a TimelineEvent object.
+        /// </summary>
+        /// <param name="Kind">The kind of event</param>
+        /// <param name="Position">The position of the event on the timeline</param>
+        /// <param name="Value">The number of samples lost (for a gap) or the new rate divisor (for a rate change)</param>
+        public TimelineEvent(Kinds Kind, long Position, int Value)
+        {
+            this.Kind = Kind;
+            this.Position = Position;
+            this.Value = Value;
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the kind of event
+        /// </summary>
+        public Kinds Kind
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the position of the event on the timeline (in samples since the start of the capture)
+        /// </summary>
+        public long Position
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of samples lost (for a gap), or the rate divisor from here on (for a rate change: 1 is
+        /// the full sampling rate, 2 is half of it)
+        /// </summary>
+        public int Value
+        {
+            get;
+            private set;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Compares two events by position, for sorting.
+        /// </summary>
+        /// <param name="A">An event</param>
+        /// <param name="B">Another event</param>
+        /// <returns>Less than zero if A comes first, zero if they are at the same position, otherwise more than zero</returns>
+        public static int ComparePositions(TimelineEvent A, TimelineEvent B)
+        {
+            return A.Position.CompareTo(B.Position);
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,139 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.DataAcquisition
+{
+    /// <summary>
+    /// Class defining methods to decode the transition records of transitions-only mode without expanding them
+    /// into a sample per tick. Each record in the stream is the number of sample ticks since the previous record
+    /// (a variable-length integer, 7 bits per byte, low bits first, with bit 7 set on all but the last byte)
+    /// followed by a mask of the channels that changed at that tick (see DeltaTimestampFilter, which expands
+    /// them). Each record ends a run of the previous sample value, which is what the decoder hands back. The
+    /// stream can be decoded in blocks of any size; a record split between blocks is picked up in the next.
+    /// </summary>
+    public class TransitionDecoder
+    {
+        // The delta of the record currently being decoded.
+        private UInt32 delta = 0;
+        private int deltaShift = 0;
+        private bool deltaComplete = false;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a TransitionDecoder object.
+        /// </summary>
+        public TransitionDecoder()
+        {
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the tick of the last record decoded (the length of the timeline so far).
+        /// </summary>
+        public long Timestamp
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the sample value from the last record decoded on.
+        /// </summary>
+        public byte Value
+        {
+            get;
+            private set;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Decode the next record in a block.
+        /// </summary>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">Where to start decoding; on return, the offset after the record</param>
+        /// <param name="End">The end of the block in the array</param>
+        /// <param name="Ticks">The length of the run the record ended (may be 0)</param>
+        /// <param name="RunValue">The sample value during the run</param>
+        /// <returns>'true' if a record was decoded, 'false' if the block ran out first</returns>
+        public bool Next(byte[] Buffer, ref int Offset, int End, out long Ticks, out byte RunValue)
+        {
+            while (Offset < End)
+            {
+                byte b = Buffer[Offset++];
+
+                if (!deltaComplete)
+                {
+                    // Accumulate the variable-length delta.
+                    if (deltaShift > 28)
+                        throw new Exception("TransitionDecoder.Next: Invalid Delta");
+
+                    delta |= (UInt32)(b & 0x7f) << deltaShift;
+                    deltaShift += 7;
+                    deltaComplete = ((b & 0x80) == 0);
+                }
+                else
+                {
+                    // The byte is the mask of the channels that changed.
+                    Ticks = delta;
+                    RunValue = this.Value;
+                    this.Timestamp += delta;
+                    this.Value ^= b;
+
+                    delta = 0;
+                    deltaShift = 0;
+                    deltaComplete = false;
+                    return true;
+                }
+            }
+
+            Ticks = 0;
+            RunValue = this.Value;
+            return false;
+        }
+
+        /// <summary>
+        /// Decode a block without taking the runs (to follow the length of the timeline).
+        /// </summary>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        public void Skip(byte[] Buffer, int Offset, int Count)
+        {
+            int end = Offset + Count;
+            long ticks;
+            byte value;
+
+            while (Next(Buffer, ref Offset, end, out ticks, out value))
+            {
+            }
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,203 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+using System.Threading;
+
+namespace LogicAnalyzer.DataAcquisition
+{
+    /// <summary>
+    /// Class defining a compact index of the transitions of one signal: the state it starts in and the ticks
+    /// at which it changes, packed in one array in timeline order. Both the state at any tick and the first
+    /// transition of a window are found with a binary search, so a plot of millions of transitions is drawn
+    /// and probed without walking it from the start. An index can be read while it is still being added to
+    /// (see SamplePlot.Begin()): the transitions before Length are final, and new ones only go in after them.
+    /// </summary>
+    public class TransitionIndex
+    {
+        private const int InitialCapacity = 256;
+
+        private long[] edges;
+        private int count;
+        private long length;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a TransitionIndex object, with no transitions.
+        /// </summary>
+        /// <param name="InitialState">The state of the signal at tick 0 (High or Low)</param>
+        public TransitionIndex(SampleSignal.State InitialState)
+        {
+            this.InitialState = InitialState;
+            edges = new long[InitialCapacity];
+            count = 0;
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the state of the signal at tick 0 (High or Low)
+        /// </summary>
+        public SampleSignal.State InitialState
+        {
+            get;
+            internal set;
+        }
+
+        /// <summary>
+        /// Gets the number of transitions.
+        /// </summary>
+        public int EdgeCount
+        {
+            get { return count; }
+        }
+
+        /// <summary>
+        /// Gets the tick of a transition (the first tick in the new state).
+        /// </summary>
+        /// <param name="Index">The transition (0 is the first)</param>
+        /// <returns>The tick</returns>
+        public long this[int Index]
+        {
+            get
+            {
+                if (Index < 0 || Index >= count)
+                    throw new ArgumentOutOfRangeException("Index");
+                return edges[Index];
+            }
+        }
+
+        /// <summary>
+        /// Gets the length of the signal in ticks (read and written atomically, and only moved on once the
+        /// transitions before it are in).
+        /// </summary>
+        public long Length
+        {
+            get { return Interlocked.Read(ref length); }
+            internal set { Interlocked.Exchange(ref length, value); }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Find the number of transitions at or before a tick. This is also the index of the first transition
+        /// after the tick, so the transitions of a window are the ones from FindEdge(left) up to the first
+        /// one past the right side.
+        /// </summary>
+        /// <param name="Tick">The tick</param>
+        /// <returns>The number of transitions at or before the tick</returns>
+        public int FindEdge(long Tick)
+        {
+            // The count is taken before the array, which holds at least that many (it's only ever replaced
+            // by a larger copy).
+            int n = count;
+            int i = Array.BinarySearch<long>(edges, 0, n, Tick);
+
+            return (i >= 0) ? i + 1 : ~i;
+        }
+
+        /// <summary>
+        /// Find the number of transitions at or before a tick, searching forward from a number of transitions
+        /// known to be at or before it. The search gallops from there, so walking a signal forward through many
+        /// ticks costs little more than the transitions skipped, however long the signal is.
+        /// </summary>
+        /// <param name="Tick">The tick</param>
+        /// <param name="From">A number of transitions at or before the tick (FindEdge() of an earlier tick)</param>
+        /// <returns>The number of transitions at or before the tick</returns>
+        public int FindEdge(long Tick, int From)
+        {
+            int n = count;
+            long[] e = edges;
+            int low = From, high, step = 1, i;
+
+            if (low >= n || e[low] > Tick)
+                return low;
+
+            // Bracket the answer: e[low] is at or before the tick, and e[high] (if any) after it.
+            high = low + 1;
+            while (high < n && e[high] <= Tick)
+            {
+                low = high;
+                step *= 2;
+                high = (int)Math.Min((long)low + step, n);
+            }
+            high = Math.Min(high, n);
+
+            i = Array.BinarySearch<long>(e, low + 1, high - low - 1, Tick);
+            return (i >= 0) ? i + 1 : ~i;
+        }
+
+        /// <summary>
+        /// Get the state of the signal at a tick.
+        /// </summary>
+        /// <param name="Tick">The tick</param>
+        /// <returns>High or Low</returns>
+        public SampleSignal.State StateAt(long Tick)
+        {
+            return StateAfter(FindEdge(Tick));
+        }
+
+        /// <summary>
+        /// Get the state of the signal after a number of transitions.
+        /// </summary>
+        /// <param name="Edges">The number of transitions (see FindEdge())</param>
+        /// <returns>High or Low</returns>
+        public SampleSignal.State StateAfter(int Edges)
+        {
+            if ((Edges & 1) == 0)
+                return InitialState;
+            return (InitialState == SampleSignal.State.High) ? SampleSignal.State.Low : SampleSignal.State.High;
+        }
+
+        /// <summary>
+        /// Add a transition after the others. Two transitions at the same tick cancel out, so the
+        /// second one removes the first.
+        /// </summary>
+        /// <param name="Tick">The tick of the transition (no earlier than the last one)</param>
+        internal void AddEdge(long Tick)
+        {
+            if (count > 0 && edges[count - 1] == Tick)
+            {
+                count--;
+                return;
+            }
+
+            if (count == edges.Length)
+                Array.Resize(ref edges, count * 2);
+            edges[count++] = Tick;
+        }
+
+        /// <summary>
+        /// Release the room left over for more transitions, once the index is complete.
+        /// </summary>
+        internal void TrimExcess()
+        {
+            if (count < edges.Length)
+                Array.Resize(ref edges, Math.Max(count, 1));
+        }
+
+        #endregion
+    }
+}
@@ -25,11 +25,24 @@ namespace LogicAnalyzer.Filters
     /// <summary>
     /// Class defining the base functionality of a generic data filter. Decendents can
     /// define tags that delimit data in some way using the ITagTesterWriter interface.
+    /// Data moves through a chain of filters a block at a time: a block written to a filter is
+    /// processed and written on to the next filter (with WriteOutput()), and only the last filter in
+    /// the chain holds the output. Its output buffer is reused from one block to the next, so a steady
+    /// stream of blocks doesn't allocate. Filters that only override Write(T) still work, a value at a
+    /// time. A filter chain is not thread-safe; it is written and read on one thread (the controller's
+    /// receiving thread).
     /// </summary>
     /// <typeparam name="T">Data type of objects being filtered</typeparam>
     public class AbstractDataFilter<T> : ITagTesterWriter<T>
     {
-        private Queue<T> dataOut;
+        // The largest run of a repeated value (see WriteOutput(T, uint)) that is passed on in one block.
+        private const int RunBlockSize = 4096;
+
+        // The filtered data waiting to be read is outBuffer[outStart..outEnd).
+        private T[] outBuffer;
+        private int outStart;
+        private int outEnd;
+        private T[] runBuffer;
 
         #region Constructors
 
@@ -44,10 +57,10 @@ namespace LogicAnalyzer.Filters
         /// <summary>
         /// Creates and initializes an AbstractDataFilter object.
         /// </summary>
-        /// <param name="InitialQueueSize">Initial size of the filter data queue</param>
+        /// <param name="InitialQueueSize">Initial size of the filter output buffer</param>
         public AbstractDataFilter(int InitialQueueSize)
         {
-            dataOut = new Queue<T>(InitialQueueSize);
+            outBuffer = new T[Math.Max(InitialQueueSize, 16)];
             TagTester = new TagTester<T>(this);
         }
 
@@ -72,13 +85,10 @@ namespace LogicAnalyzer.Filters
         {
             get
             {
-                int count;
-
-                lock (dataOut)
-                {
-                    count = dataOut.Count;
-                }
-                return count;
+                // The output of a chain is the output of its last filter.
+                if (ChildFilter != null)
+                    return ChildFilter.DataLength;
+                return outEnd - outStart;
             }
         }
 
@@ -133,25 +143,7 @@ namespace LogicAnalyzer.Filters
         /// <param name="Data">A data value to be passed through the filter</param>
         public virtual void Write(T Data)
         {
-            if (ChildFilter != null)
-            {
-                ChildFilter.Write(Data);
-                while (ChildFilter.DataReady)
-                {
-                    T data = ChildFilter.Read();
-                    lock (dataOut)
-                    {
-                        dataOut.Enqueue(data);
-                    }
-                }
-            }
-            else
-            {
-                lock (dataOut)
-                {
-                    dataOut.Enqueue(Data);
-                }
-            }
+            WriteOutput(Data);
         }
 
         /// <summary>
@@ -161,8 +153,22 @@ namespace LogicAnalyzer.Filters
         /// <param name="Buffer">A byte array to be passed through the filter.</param>
         public virtual void Write(T[] Buffer)
         {
-            foreach (T b in Buffer)
-                this.Write(b);
+            this.Write(Buffer, 0, Buffer.Length);
+        }
+
+        /// <summary>
+        /// Writes a block of data to the filter. Override this to process whole blocks; by default
+        /// the values are written one at a time.
+        /// </summary>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        public virtual void Write(T[] Buffer, int Offset, int Count)
+        {
+            int end = Offset + Count;
+
+            for (int i = Offset; i < end; i++)
+                this.Write(Buffer[i]);
         }
 
         /// <summary>
@@ -174,13 +180,15 @@ namespace LogicAnalyzer.Filters
         {
             T value;
 
-            if (!this.DataReady)
+            if (ChildFilter != null)
+                return ChildFilter.Read();
+
+            if (outStart == outEnd)
                 throw new Exception("AbstractDataFilter.Read: Filter queue is empty");
 
-            lock (dataOut)
-            {
-                value = dataOut.Dequeue();
-            }
+            value = outBuffer[outStart++];
+            if (outStart == outEnd)
+                outStart = outEnd = 0;
             return value;
         }
 
@@ -193,8 +201,6 @@ namespace LogicAnalyzer.Filters
         /// <returns></returns>
         public virtual int Read(T[] Buffer, int MaxLength)
         {
-            int cnt = 0;
-
             if (!this.DataReady)
                 throw new Exception("AbstractDataFilter.Read: Filter is empty");
             if (Buffer == null)
@@ -202,10 +208,29 @@ namespace LogicAnalyzer.Filters
             if (Buffer.Length < MaxLength)
                 throw new Exception("AbstractDataFilter.Read: Buffer length < MaxLength");
 
-            while (cnt < MaxLength && this.DataLength > 0)
-                Buffer[cnt++] = this.Read();
+            return this.Read(Buffer, 0, MaxLength);
+        }
+
+        /// <summary>
+        /// Reads a block of data from the filter into an array.
+        /// </summary>
+        /// <param name="Buffer">A pre-allocated output array</param>
+        /// <param name="Offset">Where to put the data in the array</param>
+        /// <param name="MaxLength">The maximum length of data to read</param>
+        /// <returns>The length of data read (0 if the filter is empty)</returns>
+        public virtual int Read(T[] Buffer, int Offset, int MaxLength)
+        {
+            int count;
 
-            return cnt;
+            if (ChildFilter != null)
+                return ChildFilter.Read(Buffer, Offset, MaxLength);
+
+            count = Math.Min(MaxLength, outEnd - outStart);
+            Array.Copy(outBuffer, outStart, Buffer, Offset, count);
+            outStart += count;
+            if (outStart == outEnd)
+                outStart = outEnd = 0;
+            return count;
         }
 
         /// <summary>
@@ -214,17 +239,100 @@ namespace LogicAnalyzer.Filters
         public virtual void Flush()
         {
             if (this.ChildFilter != null)
-            {
                 this.ChildFilter.Flush();
-                while (ChildFilter.DataReady)
+        }
+
+        /// <summary>
+        /// Writes a filtered value to the output of the filter (or on to the next filter in the chain).
+        /// </summary>
+        /// <param name="Data">The filtered value</param>
+        protected void WriteOutput(T Data)
+        {
+            if (ChildFilter != null)
+            {
+                ChildFilter.Write(Data);
+                return;
+            }
+
+            if (outEnd == outBuffer.Length)
+                MakeRoom(1);
+            outBuffer[outEnd++] = Data;
+        }
+
+        /// <summary>
+        /// Writes a block of filtered data to the output of the filter (or on to the next filter in the chain).
+        /// </summary>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        protected void WriteOutput(T[] Buffer, int Offset, int Count)
+        {
+            if (ChildFilter != null)
+            {
+                ChildFilter.Write(Buffer, Offset, Count);
+                return;
+            }
+
+            if (outEnd + Count > outBuffer.Length)
+                MakeRoom(Count);
+            Array.Copy(Buffer, Offset, outBuffer, outEnd, Count);
+            outEnd += Count;
+        }
+
+        /// <summary>
+        /// Writes a value to the output of the filter (or on to the next filter in the chain) a number of
+        /// times. Long runs are passed on in blocks.
+        /// </summary>
+        /// <param name="Data">The filtered value</param>
+        /// <param name="Count">The number of times to write it</param>
+        protected void WriteOutput(T Data, uint Count)
+        {
+            while (Count > 0)
+            {
+                int count = (int)Math.Min(Count, RunBlockSize);
+
+                if (ChildFilter != null)
+                {
+                    if (runBuffer == null)
+                        runBuffer = new T[RunBlockSize];
+                    for (int i = 0; i < count; i++)
+                        runBuffer[i] = Data;
+                    ChildFilter.Write(runBuffer, 0, count);
+                }
+                else
                 {
-                    T data = ChildFilter.Read();
-                    lock (dataOut)
-                    {
-                        dataOut.Enqueue(data);
-                    }
+                    if (outEnd + count > outBuffer.Length)
+                        MakeRoom(count);
+                    for (int i = 0; i < count; i++)
+                        outBuffer[outEnd++] = Data;
                 }
+                Count -= (uint)count;
+            }
+        }
+
+        /// <summary>
+        /// Makes room at the end of the output buffer, by moving the unread data to the start of
+        /// the buffer and growing it if necessary.
+        /// </summary>
+        /// <param name="Count">The room needed</param>
+        private void MakeRoom(int Count)
+        {
+            int length = outEnd - outStart;
+            T[] buffer = outBuffer;
+
+            if (length + Count > buffer.Length)
+            {
+                int size = buffer.Length * 2;
+
+                while (size < length + Count)
+                    size *= 2;
+                buffer = new T[size];
             }
+
+            Array.Copy(outBuffer, outStart, buffer, 0, length);
+            outBuffer = buffer;
+            outStart = 0;
+            outEnd = length;
         }
 
         #endregion
@@ -73,7 +73,7 @@ namespace LogicAnalyzer.Filters
             else
             {
                 // If we're not in compression mode, just pass the data through.
-                base.Write(Value);
+                WriteOutput(Value);
             }
         }
 
@@ -118,7 +118,7 @@ namespace LogicAnalyzer.Filters
         /// <param name="Value"></param>
         private void ReceiveCompressedByte(byte value)
         {
-            base.Write(value);
+            WriteOutput(value);
         }
 
         #endregion
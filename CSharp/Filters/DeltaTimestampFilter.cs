@@ -0,0 +1,95 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.Filters
+{
+    /// <summary>
+    /// Class defining methods to filter delta-timestamped transition data. Each record in the stream is the number
+    /// of sample ticks since the previous record (a variable-length integer, 7 bits per byte, low bits first, with
+    /// bit 7 set on all but the last byte) followed by a mask of the channels that changed at that tick. The
+    /// previous sample value is replicated up to the tick of each record, as in the TimestampFilter. A record with
+    /// an empty change mask only extends the duration of the last sample (it is sent at the end of a capture).
+    /// </summary>
+    public class DeltaTimestampFilter : AbstractDataFilter<byte>
+    {
+        // The delta of the record currently being received.
+        private UInt32 delta = 0;
+        private int deltaShift = 0;
+        private bool deltaComplete = false;
+        // Sample ticks since the start of the capture; a streaming capture can run past 32 bits of them.
+        private long currentTimestamp = 0;
+        private long timestamp = 0;
+        private byte prevSample = 0;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a DeltaTimestampFilter object.
+        /// </summary>
+        public DeltaTimestampFilter()
+        {
+
+        }
+
+        #endregion
+
+        #region Overridden Methods
+
+        /// <summary>
+        /// Write a value to the delta timestamp filter.
+        /// </summary>
+        /// <param name="Value">The data value being sent through the filter</param>
+        public override void Write(byte Value)
+        {
+            if (!deltaComplete)
+            {
+                // Accumulate the variable-length delta.
+                if (deltaShift > 28)
+                    throw new Exception("DeltaTimestampFilter.Write: Invalid Delta");
+
+                delta |= (UInt32)(Value & 0x7f) << deltaShift;
+                deltaShift += 7;
+                deltaComplete = ((Value & 0x80) == 0);
+            }
+            else
+            {
+                timestamp += delta;
+
+                // Repeat the previous sample up to the time of this record.
+                if (currentTimestamp < timestamp)
+                {
+                    WriteOutput(prevSample, (uint)(timestamp - currentTimestamp));
+                    currentTimestamp = timestamp;
+                }
+
+                // The value is the mask of the channels that changed.
+                prevSample ^= Value;
+
+                delta = 0;
+                deltaShift = 0;
+                deltaComplete = false;
+            }
+        }
+
+        #endregion
+    }
+}
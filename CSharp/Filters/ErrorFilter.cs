@@ -63,7 +63,7 @@ namespace LogicAnalyzer.Filters
             if (inErrorTag)
                 errorMessage.Add(Data);
             else
-                base.Write(Data);
+                WriteOutput(Data);
         }
 
         /// <summary>
@@ -72,6 +72,68 @@ namespace LogicAnalyzer.Filters
         /// </summary>
         /// <param name="Data">The data value being sent through the filter</param>
         public override void Write(byte Data)
+        {
+            string error = FilterValue(Data);
+
+            if (error != null)
+                throw new Exception(error);
+        }
+
+        /// <summary>
+        /// Write a block of data to the error message filter. Data outside of error messages is
+        /// passed through a span at a time, up to the next byte that could start a tag. Any error
+        /// messages found in the block are thrown as a single exception once the whole block has
+        /// been processed.
+        /// </summary>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        public override void Write(byte[] Buffer, int Offset, int Count)
+        {
+            int end = Offset + Count;
+            StringBuilder errors = null;
+
+            while (Offset < end)
+            {
+                if (!inErrorTag && this.TagTester.Length == 0)
+                {
+                    int tag = Array.IndexOf(Buffer, ErrorTagStart[0], Offset, end - Offset);
+
+                    if (tag < 0)
+                        tag = end;
+                    if (tag > Offset)
+                        WriteOutput(Buffer, Offset, tag - Offset);
+                    Offset = tag;
+                    if (Offset == end)
+                        break;
+                }
+
+                string error = FilterValue(Buffer[Offset++]);
+
+                if (error != null)
+                {
+                    if (errors == null)
+                        errors = new StringBuilder();
+                    else
+                        errors.Append("\r\n");
+                    errors.Append(error);
+                }
+            }
+
+            if (errors != null)
+                throw new Exception(errors.ToString());
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Filter a value, looking for the start and end of error messages.
+        /// </summary>
+        /// <param name="Data">The data value being sent through the filter</param>
+        /// <returns>The error message, if the value completed one (otherwise null)</returns>
+        private string FilterValue(byte Data)
         {
             if (inErrorTag)
             {
@@ -81,7 +143,7 @@ namespace LogicAnalyzer.Filters
                     // If we're inside an error tag, add the data to the error message.
                     errorMessage.Add(Data);
                 }
-                else if (this.TagTester.Length == ErrorTagStart.Length)
+                else if (this.TagTester.Length == ErrorTagStop.Length)
                 {
                     // Found the 'error stop tag'.
 
@@ -89,8 +151,11 @@ namespace LogicAnalyzer.Filters
                     inErrorTag = false;
                     this.TagTester.Clear();
 
-                    // Throw an exception with the error message.
-                    throw new Exception(new System.Text.ASCIIEncoding().GetString(errorMessage.ToArray()));
+                    // Return the error message.
+                    string error = new System.Text.ASCIIEncoding().GetString(errorMessage.ToArray());
+
+                    errorMessage.Clear();
+                    return error;
                 }
             }
             else
@@ -99,7 +164,7 @@ namespace LogicAnalyzer.Filters
                 if (!this.TagTester.ValueInTagCode(ErrorTagStart, Data))
                 {
                     // If we're not in error message mode, just pass the data through.
-                    base.Write(Data);
+                    WriteOutput(Data);
                 }
                 else if (this.TagTester.Length == ErrorTagStart.Length)
                 {
@@ -110,6 +175,7 @@ namespace LogicAnalyzer.Filters
                     inErrorTag = true;
                 }
             }
+            return null;
         }
 
         #endregion
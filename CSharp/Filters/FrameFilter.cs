@@ -0,0 +1,538 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+using LogicAnalyzer.Compression;
+using LogicAnalyzer.DataAcquisition;
+
+namespace LogicAnalyzer.Filters
+{
+    /// <summary>
+    /// Class defining methods for a frame data filter. While sampling, the device wraps everything
+    /// it sends in frames: a sync byte, the frame type, a sequence number, the payload length (2 bytes),
+    /// the payload and a CRC (2 bytes) - see frame.h in the firmware. Each frame is checked as a whole
+    /// and its payload is passed on (decompressed, if necessary). Lost or damaged frames are reported
+    /// as errors instead of being passed on as sample data. A sync byte is only taken for the start of
+    /// a frame if the header after it makes sense and the CRC checks out; if not, the bytes after it
+    /// are searched again for the real start, so a frame is not lost to a stray sync byte.
+    /// </summary>
+    public class FrameFilter : AbstractDataFilter<byte>
+    {
+        internal const byte FrameSync = 0xa5;
+        internal const int HeaderSize = 5;
+        internal const int TrailerSize = 2;
+        internal const int MaxPayloadLength = 512;      // TX_PAYLOAD_SIZE in the firmware's main.c
+        internal const int SmallPayloadLength = 64;     // FRAME_SMALL_PAYLOAD_MAX in frame.h
+        internal const int DecodedBlockSize = 4096;
+
+        /// <summary>
+        /// The frame types sent by the firmware.
+        /// </summary>
+        public enum FrameTypes : byte
+        {
+            Start = 0x01,       // Sampling mode, compression method
+            Samples = 0x02,     // Sample stream bytes
+            Compressed = 0x03,  // Compressed sample stream bytes
+            Error = 0x04,       // Error message text
+            Status = 0x05,      // Device status
+            End = 0x06,         // Sample count (4 bytes)
+            Gap = 0x07,         // Position, number of samples lost (4 bytes each)
+            Rate = 0x08,        // Position, rate divisor from there on (4 bytes each)
+            Reply = 0x09        // Result (0 = done, 1 = refused), command text
+        }
+
+        private static ushort[] crcTable = CreateCrcTable();
+
+        private byte[] frame;
+        private byte[] single;
+        private byte[] decoded;
+        private int decodedLength;
+        private int frameLength;
+        private int frameSize;
+        private byte sequence;
+        private int discarded;
+        private long lastPosition;
+        private IDecompressor decompressor;
+        private LzwDecoder lzw;
+        private bool lzwActive;
+        private StringBuilder errors;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a FrameFilter object.
+        /// </summary>
+        public FrameFilter()
+        {
+            frame = new byte[HeaderSize + MaxPayloadLength + TrailerSize];
+            single = new byte[1];
+            decoded = new byte[DecodedBlockSize + LzwDecoder.MaxStringLength];
+            lzw = new LzwDecoder();
+            errors = new StringBuilder();
+            this.Initialize();
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the gaps and rate changes received so far in this capture, in the order they were received (which
+        /// is not necessarily the order of their positions).
+        /// </summary>
+        public List<TimelineEvent> Events
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of sample data bytes (the payload of sample and compressed frames) received so far in
+        /// this capture. This is what the device counts against the flow control credit.
+        /// </summary>
+        public long SampleBytes
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets whether the end frame of the capture has been received.
+        /// </summary>
+        public bool Ended
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the payload of the last status frame received (or null).
+        /// </summary>
+        public byte[] Status
+        {
+            get;
+            private set;
+        }
+
+        #endregion
+
+        #region Events
+
+        /// <summary>
+        /// Handle this event to receive the device's replies to commands sent while sampling. It is raised on
+        /// the thread writing to the filter.
+        /// </summary>
+        public event EventHandler<ReplyEventArgs> OnReply;
+
+        #endregion
+
+        #region Overridden Methods
+
+        /// <summary>
+        /// Re-initialize the filter for a new capture.
+        /// </summary>
+        public override void Initialize()
+        {
+            frameLength = 0;
+            frameSize = 0;
+            sequence = 0;
+            discarded = 0;
+            lastPosition = 0;
+            decompressor = null;
+            lzwActive = false;
+            decodedLength = 0;
+            errors.Length = 0;
+            this.Events = new List<TimelineEvent>();
+            this.SampleBytes = 0;
+            this.Ended = false;
+            this.Status = null;
+        }
+
+        /// <summary>
+        /// Write a value to the frame filter.
+        /// </summary>
+        /// <param name="Data">The data value being sent through the filter</param>
+        public override void Write(byte Data)
+        {
+            single[0] = Data;
+            this.Write(single, 0, 1);
+        }
+
+        /// <summary>
+        /// Write a block of data to the frame filter. Payloads are copied a span at a time and each
+        /// frame is checked and handled once it is complete. Any errors found in the block are thrown
+        /// as a single exception once the whole block has been processed.
+        /// </summary>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        public override void Write(byte[] Buffer, int Offset, int Count)
+        {
+            int offset = Offset;
+            int end = Offset + Count;
+
+            while (offset < end)
+            {
+                if (frameLength == 0)
+                {
+                    // Look for the start of the next frame. Anything in between is lost data.
+                    int sync = Array.IndexOf(Buffer, FrameSync, offset, end - offset);
+
+                    if (sync < 0)
+                    {
+                        discarded += end - offset;
+                        break;
+                    }
+
+                    discarded += sync - offset;
+                    frame[frameLength++] = FrameSync;
+                    offset = sync + 1;
+                }
+                else
+                {
+                    // Take the rest of the header, or the rest of the frame.
+                    int count = Math.Min((frameSize == 0 ? HeaderSize : frameSize) - frameLength, end - offset);
+
+                    System.Buffer.BlockCopy(Buffer, offset, frame, frameLength, count);
+                    frameLength += count;
+                    offset += count;
+                }
+
+                ParseFrame();
+            }
+
+            if (discarded > 0)
+            {
+                AddError(discarded + " bytes received outside of frames");
+                discarded = 0;
+            }
+
+            if (errors.Length > 0)
+            {
+                string message = errors.ToString();
+
+                errors.Length = 0;
+                throw new Exception(message);
+            }
+        }
+
+        /// <summary>
+        /// Flush the decompressor.
+        /// </summary>
+        public override void Flush()
+        {
+            if (decompressor != null)
+            {
+                decompressor.Flush();
+                decompressor = null;
+                WriteDecoded();
+            }
+            lzwActive = false;
+            base.Flush();
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Calculates the CRC-16/CCITT (polynomial 0x1021) of a block of data, as used by the firmware.
+        /// </summary>
+        /// <param name="Crc">The CRC so far (0xffff to start)</param>
+        /// <param name="Buffer">The data</param>
+        /// <param name="Offset">The offset of the data in the buffer</param>
+        /// <param name="Count">The length of the data</param>
+        /// <returns>The updated CRC</returns>
+        internal static ushort Crc(ushort Crc, byte[] Buffer, int Offset, int Count)
+        {
+            int end = Offset + Count;
+
+            for (int i = Offset; i < end; i++)
+                Crc = (ushort)((Crc << 8) ^ crcTable[(Crc >> 8) ^ Buffer[i]]);
+            return Crc;
+        }
+
+        /// <summary>
+        /// Creates the CRC lookup table.
+        /// </summary>
+        /// <returns>The CRC of every byte value</returns>
+        private static ushort[] CreateCrcTable()
+        {
+            ushort[] table = new ushort[256];
+
+            for (int i = 0; i < 256; i++)
+            {
+                int crc = i << 8;
+
+                for (int bit = 0; bit < 8; bit++)
+                    crc = ((crc & 0x8000) != 0 ? (crc << 1) ^ 0x1021 : crc << 1) & 0xffff;
+                table[i] = (ushort)crc;
+            }
+            return table;
+        }
+
+        /// <summary>
+        /// Gets the longest payload a frame of a type can have, or -1 if the firmware doesn't send the type.
+        /// </summary>
+        /// <param name="Type">The frame type</param>
+        /// <returns>The longest payload</returns>
+        private static int MaxLength(byte Type)
+        {
+            switch ((FrameTypes)Type)
+            {
+                case FrameTypes.Samples:
+                case FrameTypes.Compressed:
+                    return MaxPayloadLength;
+
+                case FrameTypes.Start:
+                case FrameTypes.Error:
+                case FrameTypes.Status:
+                case FrameTypes.End:
+                case FrameTypes.Gap:
+                case FrameTypes.Rate:
+                case FrameTypes.Reply:
+                    return SmallPayloadLength;
+            }
+            return -1;
+        }
+
+        /// <summary>
+        /// Check what has been collected of the frame starting at the last sync byte found. A complete frame
+        /// is processed; if the header or the CRC is wrong, the sync byte wasn't the start of a frame (or the
+        /// frame is damaged) and the search for the start goes on from the byte after it.
+        /// </summary>
+        private void ParseFrame()
+        {
+            while (frameLength > 0)
+            {
+                if (frameSize == 0)
+                {
+                    int length;
+
+                    if (frameLength < HeaderSize)
+                        return;
+
+                    length = frame[3] | (frame[4] << 8);
+                    if (length > MaxLength(frame[1]))
+                    {
+                        discarded++;
+                        Skip(1);
+                        continue;
+                    }
+                    frameSize = HeaderSize + length + TrailerSize;
+                }
+
+                if (frameLength < frameSize)
+                    return;
+
+                if (Crc(0xffff, frame, 1, frameSize - TrailerSize - 1) != (frame[frameSize - 2] | (frame[frameSize - 1] << 8)))
+                {
+                    // A damaged frame is reported as lost by the sequence number of the next one.
+                    discarded++;
+                    Skip(1);
+                    continue;
+                }
+
+                // After a false start, the next frame may have been collected along with this one.
+                ProcessFrame();
+                Skip(frameSize);
+            }
+        }
+
+        /// <summary>
+        /// Drop the start of what has been collected of the frame, and start the frame over from the next sync
+        /// byte in the rest of it (if there is one). Anything before that is lost data.
+        /// </summary>
+        /// <param name="Count">The number of bytes to drop</param>
+        private void Skip(int Count)
+        {
+            int sync = Count < frameLength ? Array.IndexOf(frame, FrameSync, Count, frameLength - Count) : -1;
+
+            if (sync < 0)
+                sync = frameLength;
+            discarded += sync - Count;
+            frameLength -= sync;
+            frameSize = 0;
+            if (frameLength > 0)
+                System.Buffer.BlockCopy(frame, sync, frame, 0, frameLength);
+        }
+
+        /// <summary>
+        /// Pass the contents of a complete, checked frame on.
+        /// </summary>
+        private void ProcessFrame()
+        {
+            int length = frameSize - HeaderSize - TrailerSize;
+
+            if (frame[2] != sequence)
+            {
+                AddError((byte)(frame[2] - sequence) + " frame(s) lost before frame " + frame[2]);
+                LoseFrames();
+            }
+            sequence = (byte)(frame[2] + 1);
+
+            switch ((FrameTypes)frame[1])
+            {
+                case FrameTypes.Start:
+                    // The compression method the device is using (SAMPLING_COMPRESSION_* in the
+                    // firmware: 0 = none, 1 = LZW, 2 = block). The LZW decoder is kept from one
+                    // capture to the next, so it starts over here.
+                    decompressor = null;
+                    lzwActive = false;
+                    if (length >= 2 && frame[HeaderSize + 1] == 2)
+                        decompressor = new BlockDecompressor(ReceiveDecompressedByte);
+                    else if (length >= 2 && frame[HeaderSize + 1] == 1)
+                    {
+                        lzw.Reset();
+                        lzwActive = true;
+                    }
+                    break;
+
+                case FrameTypes.Samples:
+                    this.SampleBytes += length;
+                    WriteOutput(frame, HeaderSize, length);
+                    break;
+
+                case FrameTypes.Compressed:
+                    this.SampleBytes += length;
+                    if (lzwActive)
+                    {
+                        DecodeLzw(HeaderSize, length);
+                        WriteDecoded();
+                    }
+                    else if (decompressor != null)
+                    {
+                        for (int i = HeaderSize; i < HeaderSize + length; i++)
+                            decompressor.Decode(frame[i]);
+                        WriteDecoded();
+                    }
+                    break;
+
+                case FrameTypes.Error:
+                    AddError(Encoding.ASCII.GetString(frame, HeaderSize, length));
+                    break;
+
+                case FrameTypes.Status:
+                    this.Status = new byte[length];
+                    System.Buffer.BlockCopy(frame, HeaderSize, this.Status, 0, length);
+                    break;
+
+                case FrameTypes.Gap:
+                case FrameTypes.Rate:
+                    // The position is on the sample timeline, so unlike the sample data these don't have to be
+                    // passed on in order. It wraps at 32 bits, so it is taken to be the position nearest the
+                    // last one that has the same low 32 bits (events are far less than 2^31 samples apart).
+                    if (length >= 8)
+                    {
+                        lastPosition += (int)(BitConverter.ToUInt32(frame, HeaderSize) - (uint)lastPosition);
+                        this.Events.Add(new TimelineEvent((FrameTypes)frame[1] == FrameTypes.Gap ? TimelineEvent.Kinds.Gap : TimelineEvent.Kinds.RateChange,
+                            lastPosition, BitConverter.ToInt32(frame, HeaderSize + 4)));
+                    }
+                    break;
+
+                case FrameTypes.Reply:
+                    EventHandler<ReplyEventArgs> handler = OnReply;
+
+                    if (length >= 1 && handler != null)
+                        handler(this, new ReplyEventArgs(Encoding.ASCII.GetString(frame, HeaderSize + 1, length - 1), frame[HeaderSize] == 0));
+                    break;
+
+                case FrameTypes.End:
+                    if (decompressor != null)
+                    {
+                        decompressor.Flush();
+                        decompressor = null;
+                        WriteDecoded();
+                    }
+                    lzwActive = false;
+                    this.Ended = true;
+                    break;
+            }
+        }
+
+        /// <summary>
+        /// Frames have been lost. A compressed stream can't be picked up again part-way through, so
+        /// the rest of it is dropped rather than decoded into garbage.
+        /// </summary>
+        private void LoseFrames()
+        {
+            decompressor = null;
+            lzwActive = false;
+        }
+
+        /// <summary>
+        /// Add a message to the errors to be reported at the end of the current block.
+        /// </summary>
+        /// <param name="Message">The error message</param>
+        private void AddError(string Message)
+        {
+            if (errors.Length > 0)
+                errors.Append("\r\n");
+            errors.Append(Message);
+        }
+
+        /// <summary>
+        /// Callback function for the decompressor to send output bytes to the output of the filter. They
+        /// are collected and passed on in blocks.
+        /// </summary>
+        /// <param name="Value"></param>
+        private void ReceiveDecompressedByte(byte Value)
+        {
+            if (decodedLength == decoded.Length)
+                WriteDecoded();
+            decoded[decodedLength++] = Value;
+        }
+
+        /// <summary>
+        /// Decode the LZW stream in a compressed frame straight into the decompressed bytes, passing them
+        /// on whenever there may not be room for the next string.
+        /// </summary>
+        /// <param name="Offset">The start of the compressed bytes in the frame</param>
+        /// <param name="Count">The number of compressed bytes</param>
+        private void DecodeLzw(int Offset, int Count)
+        {
+            int end = Offset + Count;
+
+            while (true)
+            {
+                decodedLength += lzw.Decode(frame, ref Offset, end, decoded, decodedLength, decoded.Length - decodedLength);
+
+                // With room for any string left, the frame is used up (or the stream has ended).
+                if (decoded.Length - decodedLength >= LzwDecoder.MaxStringLength)
+                    break;
+                WriteDecoded();
+            }
+        }
+
+        /// <summary>
+        /// Pass the decompressed bytes collected so far on to the output of the filter.
+        /// </summary>
+        private void WriteDecoded()
+        {
+            if (decodedLength > 0)
+            {
+                WriteOutput(decoded, 0, decodedLength);
+                decodedLength = 0;
+            }
+        }
+
+        #endregion
+    }
+}
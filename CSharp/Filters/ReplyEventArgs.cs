@@ -0,0 +1,67 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.Filters
+{
+    /// <summary>
+    /// Class defining EventArgs for the device's reply to a command sent while sampling.
+    /// </summary>
+    public class ReplyEventArgs : EventArgs
+    {
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a ReplyEventArgs object.
+        /// </summary>
+        /// <param name="Command">The command the device replied to</param>
+        /// <param name="Done">'true' if the device carried the command out, 'false' if it refused it</param>
+        public ReplyEventArgs(string Command, bool Done)
+        {
+            this.Command = Command;
+            this.Done = Done;
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the command the device replied to
+        /// </summary>
+        public string Command
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets whether the device carried the command out ('false' if it refused it)
+        /// </summary>
+        public bool Done
+        {
+            get;
+            private set;
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,86 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.Filters
+{
+    /// <summary>
+    /// Class defining methods to filter run-length encoded data. Each record in the stream is a sample byte (which
+    /// may hold several stacked samples) followed by the number of times it repeats as a variable-length integer
+    /// (7 bits per byte, low bits first, with bit 7 set on all but the last byte). The sample byte is replicated
+    /// to the output of the filter, so the output is the same as in continuous mode.
+    /// </summary>
+    public class RunLengthFilter : AbstractDataFilter<byte>
+    {
+        // The record currently being received.
+        private bool valueReceived = false;
+        private byte value = 0;
+        private UInt32 count = 0;
+        private int countShift = 0;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a RunLengthFilter object.
+        /// </summary>
+        public RunLengthFilter()
+        {
+
+        }
+
+        #endregion
+
+        #region Overridden Methods
+
+        /// <summary>
+        /// Write a value to the run-length filter.
+        /// </summary>
+        /// <param name="Value">The data value being sent through the filter</param>
+        public override void Write(byte Value)
+        {
+            if (!valueReceived)
+            {
+                // First byte in the record -- the sample byte.
+                value = Value;
+                valueReceived = true;
+                return;
+            }
+
+            // Accumulate the variable-length count.
+            if (countShift > 28)
+                throw new Exception("RunLengthFilter.Write: Invalid Run Length");
+
+            count |= (UInt32)(Value & 0x7f) << countShift;
+            countShift += 7;
+            if ((Value & 0x80) != 0)
+                return;
+
+            // Repeat the sample byte for the length of the run.
+            WriteOutput(value, count);
+
+            count = 0;
+            valueReceived = false;
+            countShift = 0;
+        }
+
+        #endregion
+    }
+}
@@ -140,10 +140,10 @@ namespace LogicAnalyzer.Filters
                         // Repeat the previous sample as needed.
                         // NOTE: This generates a lot of data (just like Continuous mode,) and
                         // could probably be done differently.
-                        while (currentTimestamp < timestamp)
+                        if (currentTimestamp < timestamp)
                         {
-                            base.Write(prevSample);
-                            currentTimestamp += 1;
+                            WriteOutput(prevSample, timestamp - currentTimestamp);
+                            currentTimestamp = timestamp;
                         }
                         prevSample = Value;
                         break;
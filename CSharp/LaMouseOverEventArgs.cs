@@ -20,6 +20,7 @@ using System;
 using System.Collections.Generic;
 using System.Text;
 using LogicAnalyzer.Collections;
+using LogicAnalyzer.DataAcquisition;
 
 namespace LogicAnalyzer
 {
@@ -38,12 +39,13 @@ namespace LogicAnalyzer
         {
         }
 
-        public static LaMouseOverEventArgs GetInstance(int Channel, string Time)
+        public static LaMouseOverEventArgs GetInstance(int Channel, string Time, SampleSignal.State State)
         {
             LaMouseOverEventArgs args = objectPool.GetObject();
 
             args.Channel = Channel;
             args.Time = Time;
+            args.State = State;
             return args;
         }
 
@@ -63,6 +65,12 @@ namespace LogicAnalyzer
             internal set;
         }
 
+        public SampleSignal.State State
+        {
+            get;
+            internal set;
+        }
+
         #endregion
 
         #region Methods
@@ -45,9 +45,12 @@
             this.configureToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
             this.toolStripSeparator4 = new System.Windows.Forms.ToolStripSeparator();
             this.startSamplingToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
+            this.stopSamplingToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
+            this.rearmTriggerToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
             this.helpToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
             this.firmwareRevisionToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
             this.pingTheControllerToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
+            this.deviceStatusToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
             this.toolStripSeparator7 = new System.Windows.Forms.ToolStripSeparator();
             this.aboutToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
             this.toolStrip = new System.Windows.Forms.ToolStrip();
@@ -197,7 +200,9 @@
             this.samplingToolStripMenuItem.DropDownItems.AddRange(new System.Windows.Forms.ToolStripItem[] {
             this.configureToolStripMenuItem,
             this.toolStripSeparator4,
-            this.startSamplingToolStripMenuItem});
+            this.startSamplingToolStripMenuItem,
+            this.stopSamplingToolStripMenuItem,
+            this.rearmTriggerToolStripMenuItem});
             this.samplingToolStripMenuItem.Name = "samplingToolStripMenuItem";
             this.samplingToolStripMenuItem.Size = new System.Drawing.Size(69, 20);
             this.samplingToolStripMenuItem.Text = "Sampling";
@@ -221,11 +226,26 @@
             this.startSamplingToolStripMenuItem.Text = "Start Sampling...";
             this.startSamplingToolStripMenuItem.Click += new System.EventHandler(this.startSampling_Click);
             // 
+            // stopSamplingToolStripMenuItem
+            // 
+            this.stopSamplingToolStripMenuItem.Name = "stopSamplingToolStripMenuItem";
+            this.stopSamplingToolStripMenuItem.Size = new System.Drawing.Size(160, 22);
+            this.stopSamplingToolStripMenuItem.Text = "Stop Sampling";
+            this.stopSamplingToolStripMenuItem.Click += new System.EventHandler(this.stopSampling_Click);
+            // 
+            // rearmTriggerToolStripMenuItem
+            // 
+            this.rearmTriggerToolStripMenuItem.Name = "rearmTriggerToolStripMenuItem";
+            this.rearmTriggerToolStripMenuItem.Size = new System.Drawing.Size(160, 22);
+            this.rearmTriggerToolStripMenuItem.Text = "Re-arm Trigger";
+            this.rearmTriggerToolStripMenuItem.Click += new System.EventHandler(this.rearmTrigger_Click);
+            // 
             // helpToolStripMenuItem
             // 
             this.helpToolStripMenuItem.DropDownItems.AddRange(new System.Windows.Forms.ToolStripItem[] {
             this.firmwareRevisionToolStripMenuItem,
             this.pingTheControllerToolStripMenuItem,
+            this.deviceStatusToolStripMenuItem,
             this.toolStripSeparator7,
             this.aboutToolStripMenuItem});
             this.helpToolStripMenuItem.Name = "helpToolStripMenuItem";
@@ -246,6 +266,13 @@
             this.pingTheControllerToolStripMenuItem.Text = "Ping the Controller";
             this.pingTheControllerToolStripMenuItem.Click += new System.EventHandler(this.pingTheControllerToolStripMenuItem_Click);
             // 
+            // deviceStatusToolStripMenuItem
+            // 
+            this.deviceStatusToolStripMenuItem.Name = "deviceStatusToolStripMenuItem";
+            this.deviceStatusToolStripMenuItem.Size = new System.Drawing.Size(174, 22);
+            this.deviceStatusToolStripMenuItem.Text = "Device Status";
+            this.deviceStatusToolStripMenuItem.Click += new System.EventHandler(this.deviceStatusToolStripMenuItem_Click);
+            // 
             // toolStripSeparator7
             // 
             this.toolStripSeparator7.Name = "toolStripSeparator7";
@@ -720,6 +747,8 @@
         private System.Windows.Forms.ToolStripMenuItem configureToolStripMenuItem;
         private System.Windows.Forms.ToolStripSeparator toolStripSeparator4;
         private System.Windows.Forms.ToolStripMenuItem startSamplingToolStripMenuItem;
+        private System.Windows.Forms.ToolStripMenuItem stopSamplingToolStripMenuItem;
+        private System.Windows.Forms.ToolStripMenuItem rearmTriggerToolStripMenuItem;
         private System.Windows.Forms.ToolStrip toolStrip;
         private System.Windows.Forms.ToolStripSeparator toolStripSeparator5;
         private System.Windows.Forms.ToolStripMenuItem printStripMenuItem;
@@ -756,6 +785,7 @@
         private System.Windows.Forms.ToolStripMenuItem helpToolStripMenuItem;
         private System.Windows.Forms.ToolStripMenuItem firmwareRevisionToolStripMenuItem;
         private System.Windows.Forms.ToolStripMenuItem pingTheControllerToolStripMenuItem;
+        private System.Windows.Forms.ToolStripMenuItem deviceStatusToolStripMenuItem;
         private System.Windows.Forms.ToolStripSeparator toolStripSeparator7;
         private System.Windows.Forms.ToolStripMenuItem aboutToolStripMenuItem;
         private System.Windows.Forms.Label statChannel;
@@ -79,6 +79,7 @@ namespace LogicAnalyzer
             viewModel.OnStatusMessage += viewModel_StatusMessage;
             viewModel.OnProgress += viewModel_Progress;
             viewModel.OnPlot += viewModel_Plot;
+            viewModel.OnPlotUpdate += viewModel_PlotUpdate;
             viewModel.OnError += viewModel_Error;
 
             // This will attempt to open the controller.
@@ -123,6 +124,26 @@ namespace LogicAnalyzer
             commonStartSampling();
         }
 
+        /// <summary>
+        /// Stop Sampling menu event handler.
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        private void stopSampling_Click(object sender, EventArgs e)
+        {
+            viewModel.StopSampling();
+        }
+
+        /// <summary>
+        /// Re-arm Trigger menu event handler.
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        private void rearmTrigger_Click(object sender, EventArgs e)
+        {
+            viewModel.RearmTrigger();
+        }
+
         #endregion
 
         #region ViewModel Event Handlers
@@ -187,6 +208,21 @@ namespace LogicAnalyzer
             this.customLaDisplayControl1.Plot(e.Samples);
         }
 
+        /// <summary>
+        /// Plot update event handler (the capture so far).
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        void viewModel_PlotUpdate(object sender, PlotEventArgs e)
+        {
+            // This event occurs on the thread the data comes in on, which shouldn't wait for the display.
+            this.BeginInvoke((MethodInvoker)delegate
+            {
+                customLaDisplayControl1.SetSamplingRate(viewModel.Settings.SamplingRate);
+                this.customLaDisplayControl1.Follow(e.Samples);
+            });
+        }
+
         #endregion
 
         #region CustomLaDisplayControl Event Handlers
@@ -198,7 +234,7 @@ namespace LogicAnalyzer
         /// <param name="e"></param>
         void customLaDisplayControl1_OnMouseOver(object sender, LaMouseOverEventArgs e)
         {
-            this.statChannel.Text = e.Channel.ToString();
+            this.statChannel.Text = e.Channel.ToString() + " " + e.State.ToString();
             this.statTime.Text = e.Time;
 
             e.Dispose(); // Recycle.
@@ -280,6 +316,11 @@ namespace LogicAnalyzer
             viewModel.PingController();
         }
 
+        private void deviceStatusToolStripMenuItem_Click(object sender, EventArgs e)
+        {
+            viewModel.RequestStats();
+        }
+
         private void zoomInToolStripButton_Click(object sender, EventArgs e)
         {
             customLaDisplayControl1.ZoomIn();
@@ -40,6 +40,7 @@
             this.compression = new System.Windows.Forms.CheckBox();
             this.dataModeTransitions = new System.Windows.Forms.RadioButton();
             this.dataModeContinuous = new System.Windows.Forms.RadioButton();
+            this.dataModeRunLength = new System.Windows.Forms.RadioButton();
             this.label4 = new System.Windows.Forms.Label();
             this.samplingTime = new System.Windows.Forms.TextBox();
             this.serialPortName = new System.Windows.Forms.ComboBox();
@@ -111,7 +112,6 @@
             // startTrigger
             // 
             this.startTrigger.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
-            this.startTrigger.Enabled = false;
             this.startTrigger.FormattingEnabled = true;
             this.startTrigger.Items.AddRange(new object[] {
             "No Trigger",
@@ -139,7 +139,6 @@
             // label3
             // 
             this.label3.AutoSize = true;
-            this.label3.Enabled = false;
             this.label3.Location = new System.Drawing.Point(158, 335);
             this.label3.Name = "label3";
             this.label3.Size = new System.Drawing.Size(78, 13);
@@ -151,10 +150,11 @@
             this.groupBox1.Controls.Add(this.compression);
             this.groupBox1.Controls.Add(this.dataModeTransitions);
             this.groupBox1.Controls.Add(this.dataModeContinuous);
+            this.groupBox1.Controls.Add(this.dataModeRunLength);
             this.groupBox1.ForeColor = System.Drawing.Color.Blue;
             this.groupBox1.Location = new System.Drawing.Point(235, 25);
             this.groupBox1.Name = "groupBox1";
-            this.groupBox1.Size = new System.Drawing.Size(210, 100);
+            this.groupBox1.Size = new System.Drawing.Size(210, 120);
             this.groupBox1.TabIndex = 1;
             this.groupBox1.TabStop = false;
             this.groupBox1.Text = "Data Mode";
@@ -163,10 +163,10 @@
             // 
             this.compression.AutoSize = true;
             this.compression.ForeColor = System.Drawing.SystemColors.ControlText;
-            this.compression.Location = new System.Drawing.Point(17, 77);
+            this.compression.Location = new System.Drawing.Point(17, 96);
             this.compression.Name = "compression";
             this.compression.Size = new System.Drawing.Size(186, 17);
-            this.compression.TabIndex = 2;
+            this.compression.TabIndex = 3;
             this.compression.Text = "Compress the sample stream";
             this.compression.UseVisualStyleBackColor = true;
             // 
@@ -196,6 +196,19 @@
             this.dataModeContinuous.UseVisualStyleBackColor = true;
             this.dataModeContinuous.CheckedChanged += new System.EventHandler(this.dataModeTransitions_CheckedChanged);
             // 
+            // dataModeRunLength
+            // 
+            this.dataModeRunLength.AutoSize = true;
+            this.dataModeRunLength.ForeColor = System.Drawing.SystemColors.ControlText;
+            this.dataModeRunLength.Location = new System.Drawing.Point(17, 65);
+            this.dataModeRunLength.Name = "dataModeRunLength";
+            this.dataModeRunLength.Size = new System.Drawing.Size(127, 17);
+            this.dataModeRunLength.TabIndex = 2;
+            this.dataModeRunLength.TabStop = true;
+            this.dataModeRunLength.Text = "Run-length encoded";
+            this.dataModeRunLength.UseVisualStyleBackColor = true;
+            this.dataModeRunLength.CheckedChanged += new System.EventHandler(this.dataModeTransitions_CheckedChanged);
+            // 
             // label4
             // 
             this.label4.AutoSize = true;
@@ -333,6 +346,7 @@
         private System.Windows.Forms.CheckBox compression;
         private System.Windows.Forms.RadioButton dataModeTransitions;
         private System.Windows.Forms.RadioButton dataModeContinuous;
+        private System.Windows.Forms.RadioButton dataModeRunLength;
         private System.Windows.Forms.Label label4;
         private System.Windows.Forms.TextBox samplingTime;
         private System.Windows.Forms.ComboBox serialPortName;
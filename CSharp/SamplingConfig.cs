@@ -64,6 +64,8 @@ namespace LogicAnalyzer
 
             if (viewModel.Settings.SamplingMode == DataAcquisition.DataGrabber.SamplingModes.TransitionsOnly)
                 this.dataModeTransitions.Checked = true;
+            else if (viewModel.Settings.SamplingMode == DataAcquisition.DataGrabber.SamplingModes.RunLength)
+                this.dataModeRunLength.Checked = true;
             else
                 this.dataModeContinuous.Checked = true;
             this.compression.Checked = viewModel.Settings.SamplingCompression;
@@ -79,7 +81,12 @@ namespace LogicAnalyzer
                 this.serialPortName.SelectedIndex = 0;
             }
 
-            this.channels.SelectedItem = viewModel.Settings.SamplingChannels;
+            // Pins other than the first few can only be picked in the settings file (SamplingPins). They
+            // are shown as "Custom" and left as they are.
+            if (viewModel.Settings.SamplingPins != 0)
+                this.channels.SelectedIndex = this.channels.Items.Add("Custom");
+            else
+                this.channels.SelectedItem = viewModel.Settings.SamplingChannels;
 
             string sr;
 
@@ -91,7 +98,16 @@ namespace LogicAnalyzer
 
             this.samplingTime.Text = Convert.ToString(viewModel.Settings.SamplingTime);
 
-            this.startTrigger.SelectedIndex = 0;
+            // The list offers a high or low level on one channel ("CHn HI", "CHn LO"). Any other
+            // trigger (set in the settings file) is shown as "Custom" and left as it is.
+            int channel = Array.IndexOf(new byte[] { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 }, viewModel.Settings.TriggerMask);
+
+            if (viewModel.Settings.TriggerMode == DataGrabber.TriggerModes.None)
+                this.startTrigger.SelectedIndex = 0;
+            else if (viewModel.Settings.TriggerMode == DataGrabber.TriggerModes.Pattern && channel >= 0)
+                this.startTrigger.SelectedIndex = 1 + channel * 2 + (viewModel.Settings.TriggerValue != 0 ? 0 : 1);
+            else
+                this.startTrigger.SelectedIndex = this.startTrigger.Items.Add("Custom");
         }
 
         private void ok_Click(object sender, EventArgs e)
@@ -105,11 +121,16 @@ namespace LogicAnalyzer
             }
 
             viewModel.Settings.ControllerType = (testController.Checked ? ViewModel.ControllerTypes.Test : ViewModel.ControllerTypes.Serial);
-            viewModel.Settings.SamplingMode = (this.dataModeTransitions.Checked ? DataGrabber.SamplingModes.TransitionsOnly : DataGrabber.SamplingModes.Continuous);
+            viewModel.Settings.SamplingMode = (this.dataModeTransitions.Checked ? DataGrabber.SamplingModes.TransitionsOnly :
+                this.dataModeRunLength.Checked ? DataGrabber.SamplingModes.RunLength : DataGrabber.SamplingModes.Continuous);
             viewModel.Settings.SamplingCompression = this.compression.Checked;
             if (this.serialPortName.SelectedIndex >= 0)
                 viewModel.Settings.SerialPortName = this.serialPortName.SelectedItem.ToString();
-            viewModel.Settings.SamplingChannels = Convert.ToInt32(this.channels.SelectedItem);
+            if (!"Custom".Equals(this.channels.SelectedItem))
+            {
+                viewModel.Settings.SamplingChannels = Convert.ToInt32(this.channels.SelectedItem);
+                viewModel.Settings.SamplingPins = 0;
+            }
 
             string p = this.samplingRate.SelectedItem.ToString();
 
@@ -122,6 +143,17 @@ namespace LogicAnalyzer
 
             viewModel.Settings.SamplingTime = Convert.ToInt32(this.samplingTime.Text);
 
+            if (this.startTrigger.SelectedIndex == 0)
+                viewModel.Settings.TriggerMode = DataGrabber.TriggerModes.None;
+            else if (this.startTrigger.SelectedIndex <= 16)
+            {
+                byte mask = (byte)(0x01 << ((this.startTrigger.SelectedIndex - 1) / 2));
+
+                viewModel.Settings.TriggerMode = DataGrabber.TriggerModes.Pattern;
+                viewModel.Settings.TriggerMask = mask;
+                viewModel.Settings.TriggerValue = (this.startTrigger.SelectedIndex % 2 != 0 ? mask : (byte)0);
+            }
+
             this.DialogResult = System.Windows.Forms.DialogResult.OK;
             this.Close();
         }
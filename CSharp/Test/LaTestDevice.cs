@@ -20,9 +20,12 @@ using System;
 using System.Collections.Generic;
 using System.Text;
 using System.ComponentModel;
+using System.Diagnostics;
+using System.Threading;
 using System.Windows.Forms;
 using LogicAnalyzer.Controllers;
 using LogicAnalyzer.DataAcquisition;
+using LogicAnalyzer.Filters;
 
 namespace LogicAnalyzer.Test
 {
@@ -33,10 +36,13 @@ namespace LogicAnalyzer.Test
     {
         private static System.Text.ASCIIEncoding enc = new System.Text.ASCIIEncoding();
         private int samplingChannels = 8;
+        private byte samplingPins = 0xff;
         private DataGrabber.SamplingModes samplingMode = DataGrabber.SamplingModes.TransitionsOnly;
         private int samplingRate = 50000;
         private int samplingTime = 1000;
         private bool samplingCompression = false;
+        private volatile bool stopRequested;
+        private byte frameSequence;
 
         #region Constructors
 
@@ -90,13 +96,15 @@ namespace LogicAnalyzer.Test
             // Commands (requests from the controller):
             //
             // START: Start sampling and send sample data back to the controller.
+            // STOP: Stop sampling (for a sampling time of 0, which samples until stopped).
             // PING: Check if the device is active. Response is "pOng".
             // COPY: Respond with a firmware revision and copyright message.
             // CHAN=: Set the number of channels to sample.
+            // MASK=: Set the pins to sample (the number of channels is the number of pins).
             // RATE=: Set the sampling rate (in samples per second).
             // COMP=: Set compression Y/N.
             // TIME=: Set the total sampling time (in milliseconds).
-            // MODE=: Set the sampling mode (continuous or transitions-only).
+            // MODE=: Set the sampling mode (continuous, transitions-only or run-length).
             //
             if (cmd.Equals("START\r\n"))
             {
@@ -104,6 +112,7 @@ namespace LogicAnalyzer.Test
 
                 // Run the test samples in a thread -- mainly so the DataGrabber
                 // can get its modes and timers set before data starts arriving.
+                stopRequested = false;
                 worker = new BackgroundWorker();
                 worker.DoWork += GenerateSamples;
                 worker.RunWorkerAsync();
@@ -118,10 +127,30 @@ namespace LogicAnalyzer.Test
                 worker.DoWork += PingResponse;
                 worker.RunWorkerAsync();
             }
+            else if (cmd.Equals("STOP\r\n"))
+                stopRequested = true;
             else if (cmd.Equals("COPY\r\n"))
                 Copyright();
             else if (cmd.StartsWith("CHAN="))
+            {
                 samplingChannels = Convert.ToInt32(cmd.Substring(5, cmd.Length - 7));
+                samplingPins = (byte)((1 << samplingChannels) - 1);
+            }
+            else if (cmd.StartsWith("MASK="))
+            {
+                byte pins = Convert.ToByte(cmd.Substring(5, cmd.Length - 7));
+
+                if (pins != 0)
+                {
+                    samplingPins = pins;
+                    samplingChannels = 0;
+                    for (int p = 0; p < 8; p++)
+                    {
+                        if ((pins & (1 << p)) != 0)
+                            samplingChannels++;
+                    }
+                }
+            }
             else if (cmd.StartsWith("RATE="))
                 samplingRate = Convert.ToInt32(cmd.Substring(5, cmd.Length - 7));
             else if (cmd.StartsWith("COMP="))
@@ -129,7 +158,8 @@ namespace LogicAnalyzer.Test
             else if (cmd.StartsWith("TIME="))
                 samplingTime = Convert.ToInt32(cmd.Substring(5, cmd.Length - 7));
             else if (cmd.StartsWith("MODE="))
-                samplingMode = (cmd[5] == 'T' ? DataGrabber.SamplingModes.TransitionsOnly : DataGrabber.SamplingModes.Continuous);
+                samplingMode = (cmd[5] == 'T' ? DataGrabber.SamplingModes.TransitionsOnly :
+                    cmd[5] == 'R' ? DataGrabber.SamplingModes.RunLength : DataGrabber.SamplingModes.Continuous);
         }
 
         /// <summary>
@@ -169,18 +199,21 @@ namespace LogicAnalyzer.Test
 
         /// <summary>
         /// Broadcast sample data for the requested amount of time. Note, however, that sampling time it simulated.
-        /// We know the duration and rate, so we know how many samples we need to send.
+        /// We know the duration and rate, so we know how many samples we need to send. Without a sampling time,
+        /// samples are sent at the sampling rate until STOP.
         /// </summary>
         /// <param name="sender"></param>
         /// <param name="e"></param>
         private void GenerateSamples(object sender, DoWorkEventArgs e)
         {
-            byte[] channelMasks = { 0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff };
-            byte channelMask, channelShift;
+            byte channelShift;
             int totSamples;
             double samplePeriod;
-            byte bits = 0, stackedBits = 0, prevBits = 0;
+            byte bits = 0, sample, stackedBits = 0, prevBits = 0;
             byte stackShift = 0;
+            int prevTick = 0;
+            byte runValue = 0;
+            int runLength = 0;
 
             if (samplingChannels < 1 || samplingChannels > 8)
                 throw new Exception("Invalid value for Sampling Channels in Test Device");
@@ -204,14 +237,30 @@ namespace LogicAnalyzer.Test
                     channelShift = 8;
                     break;
             }
-            channelMask = channelMasks[samplingChannels - 1];
-            totSamples = samplingRate * samplingTime / 1000;
+            totSamples = (int)((long)samplingRate * samplingTime / 1000);
             sampleData = new List<byte>(1004);
 
             try
             {
-                for (int i = 0; i < totSamples; i++)
+                // Everything is sent in frames, starting with the sampling mode. Compression
+                // is not simulated.
+                frameSequence = 0;
+                BroadcastFrame(FrameFilter.FrameTypes.Start, new byte[] {
+                    (byte)(samplingMode == DataGrabber.SamplingModes.TransitionsOnly ? 1 :
+                        samplingMode == DataGrabber.SamplingModes.RunLength ? 2 : 0), 0 });
+
+                Stopwatch clock = Stopwatch.StartNew();
+                int i;
+
+                for (i = 0; samplingTime > 0 ? i < totSamples : !stopRequested; i++)
                 {
+                    // Keep to the sampling rate when there is no end to the capture.
+                    if (samplingTime == 0 && i % 1000 == 0)
+                    {
+                        while (!stopRequested && clock.ElapsedMilliseconds * samplingRate / 1000 < i)
+                            Thread.Sleep(10);
+                    }
+
                     for (int c = 0; c < 8; c++)
                     {
                         if ((clocks[c] += samplePeriod) >= periods[c])
@@ -240,29 +289,32 @@ namespace LogicAnalyzer.Test
                         }
                     }
 
-                    // Mask off the bits of the channels we're not using.
-                    bits &= channelMask;
-
-                    // If we're in transition-only mode, don't add a sample if it hasn't changed.
-                    if (samplingMode == DataGrabber.SamplingModes.TransitionsOnly)
+                    // Pack the pins we're sampling into the low bits, as the firmware does.
+                    sample = 0;
+                    for (int p = 0, c = 0; p < 8; p++)
                     {
-                        // If the sample number as rolled-over 16 bits, send a roll-over marker.
-                        if (i > 0 && (i & 0xffff) == 0)
+                        if ((samplingPins & (1 << p)) != 0)
                         {
-                            sampleData.Add((byte)LogicAnalyzer.Filters.TimestampFilter.Markers.Rollover);
-                            sampleData.Add((byte)((i >> 16) & 0xff));
-                            sampleData.Add((byte)((i >> 24) & 0xff));
-                            sampleData.Add(0);
+                            if ((bits & (1 << p)) != 0)
+                                sample |= (byte)(1 << c);
+                            c++;
                         }
+                    }
 
-                        if (i > 0 && bits == prevBits)
+                    // If we're in transition-only mode, don't add a sample if it hasn't changed.
+                    if (samplingMode == DataGrabber.SamplingModes.TransitionsOnly)
+                    {
+                        // Samples are counted from 1, as in the firmware, and the
+                        // host starts from all-low at tick 0.
+                        if (sample == prevBits)
                             continue;
 
-                        prevBits = bits;
-
-                        sampleData.Add((byte)LogicAnalyzer.Filters.TimestampFilter.Markers.Sample);
-                        sampleData.Add((byte)(i & 0xff));
-                        sampleData.Add((byte)((i >> 8) & 0xff));
+                        // The record is the variable-length tick delta followed
+                        // by the mask of the channels that changed.
+                        AddDelta(i + 1 - prevTick);
+                        sampleData.Add((byte)(sample ^ prevBits));
+                        prevBits = sample;
+                        prevTick = i + 1;
                     }
                     else
                     {
@@ -270,7 +322,7 @@ namespace LogicAnalyzer.Test
                         // Note that transition-only mode does not stack samples.
                         if (this.samplingChannels <= 4)
                         {
-                            stackedBits |= (byte)(bits << stackShift);
+                            stackedBits |= (byte)(sample << stackShift);
                             stackShift += channelShift;
 
                             // If we don't yet have a full byte, wait for the next sample
@@ -278,26 +330,56 @@ namespace LogicAnalyzer.Test
                             if (stackShift < 8)
                                 continue;
 
-                            bits = stackedBits;
+                            sample = stackedBits;
                             stackShift = 0;
                             stackedBits = 0;
                         }
+
+                        // In run-length mode, only send a byte when the run ends.
+                        if (samplingMode == DataGrabber.SamplingModes.RunLength)
+                        {
+                            if (runLength > 0 && sample == runValue)
+                            {
+                                runLength++;
+                                continue;
+                            }
+
+                            if (runLength > 0)
+                                AddRun(runValue, runLength);
+                            runValue = sample;
+                            runLength = 1;
+                        }
+                        else
+                            sampleData.Add(sample);
                     }
 
-                    sampleData.Add(bits);
-                    if (sampleData.Count >= 1000)
+                    if (sampleData.Count >= FrameFilter.MaxPayloadLength)
                     {
-                        BroadcastDataReceived(sampleData.ToArray());
-                        sampleData.Clear();
+                        BroadcastSamples();
                     }
                 }
+                totSamples = i;
+
+                // In transition-only mode, an empty change mask extends the last sample
+                // to the full sampling time.
+                if (samplingMode == DataGrabber.SamplingModes.TransitionsOnly)
+                {
+                    AddDelta(totSamples - prevTick);
+                    sampleData.Add(0);
+                }
+
+                // In run-length mode, send the last run.
+                if (samplingMode == DataGrabber.SamplingModes.RunLength && runLength > 0)
+                    AddRun(runValue, runLength);
 
                 // Send the last data buffer.
                 if (sampleData.Count > 0)
                 {
-                    BroadcastDataReceived(sampleData.ToArray());
-                    sampleData.Clear();
+                    BroadcastSamples();
                 }
+
+                // The end frame carries the number of samples taken.
+                BroadcastFrame(FrameFilter.FrameTypes.End, BitConverter.GetBytes((uint)totSamples));
             }
             catch (Exception ex)
             {
@@ -305,6 +387,73 @@ namespace LogicAnalyzer.Test
             }
         }
 
+        /// <summary>
+        /// Add a transition-only mode tick delta (or a run-length mode run length) to the sample data as a
+        /// variable-length integer.
+        /// </summary>
+        /// <param name="Delta">The number of ticks since the previous record</param>
+        private void AddDelta(int Delta)
+        {
+            while (Delta >= 0x80)
+            {
+                sampleData.Add((byte)((Delta & 0x7f) | 0x80));
+                Delta >>= 7;
+            }
+            sampleData.Add((byte)Delta);
+        }
+
+        /// <summary>
+        /// Add a run-length mode record to the sample data.
+        /// </summary>
+        /// <param name="Value">The (stacked) sample byte</param>
+        /// <param name="Length">The number of times the byte repeats</param>
+        private void AddRun(byte Value, int Length)
+        {
+            sampleData.Add(Value);
+            AddDelta(Length);
+        }
+
+        /// <summary>
+        /// Broadcast the sample data collected so far, in frames no longer than the firmware's.
+        /// </summary>
+        private void BroadcastSamples()
+        {
+            byte[] data = sampleData.ToArray();
+
+            for (int offset = 0; offset < data.Length; offset += FrameFilter.MaxPayloadLength)
+            {
+                byte[] payload = new byte[Math.Min(FrameFilter.MaxPayloadLength, data.Length - offset)];
+
+                Buffer.BlockCopy(data, offset, payload, 0, payload.Length);
+                BroadcastFrame(FrameFilter.FrameTypes.Samples, payload);
+            }
+            sampleData.Clear();
+        }
+
+        /// <summary>
+        /// Wrap a payload in a frame, as the firmware does, and broadcast it.
+        /// </summary>
+        /// <param name="Type">The frame type</param>
+        /// <param name="Payload">The frame payload</param>
+        private void BroadcastFrame(FrameFilter.FrameTypes Type, byte[] Payload)
+        {
+            byte[] frame = new byte[FrameFilter.HeaderSize + Payload.Length + FrameFilter.TrailerSize];
+            ushort crc;
+
+            frame[0] = FrameFilter.FrameSync;
+            frame[1] = (byte)Type;
+            frame[2] = frameSequence++;
+            frame[3] = (byte)Payload.Length;
+            frame[4] = (byte)(Payload.Length >> 8);
+            Buffer.BlockCopy(Payload, 0, frame, FrameFilter.HeaderSize, Payload.Length);
+
+            crc = FrameFilter.Crc(0xffff, frame, 1, FrameFilter.HeaderSize - 1 + Payload.Length);
+            frame[frame.Length - 2] = (byte)crc;
+            frame[frame.Length - 1] = (byte)(crc >> 8);
+
+            BroadcastDataReceived(frame);
+        }
+
         #endregion
 
         #region Events
@@ -0,0 +1,379 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using LogicAnalyzer.Compression;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// Checks of the decompressors against the firmware's compressors. The test vectors in Vectors were
+    /// written by the firmware simulator (make vectors in STM32/sim): for each waveform, the byte stream
+    /// of a capture (.raw), and what the firmware's LZW (.lzw) and block (.blk) compressors made of it. The LZW
+    /// decoder is also checked on random streams from the host's own Compressor, fed to it in random pieces; and
+    /// benchmarked against the decompressor it replaced (OldDecompressor).
+    /// </summary>
+    public class CompressionTests : TestSuite
+    {
+        // The random streams the LZW decoder is checked on. Every so often one is long enough to fill the
+        // string table, so the compressor clears it.
+        private const int LzwTrials = 1000;
+        private const int LzwLongStreams = 25;
+        private const int LzwLongStream = 200000;
+        private const int LzwShortStream = 5000;
+        // The output the LZW benchmarks decode, and the blocks their input comes in.
+        private const int LzwBenchLength = 16 << 20;
+        private const int LzwBenchBlock = 4096;
+
+        /// <summary>
+        /// The kinds of data the LZW decoder is checked and benchmarked on.
+        /// </summary>
+        private enum DataKinds
+        {
+            Random,
+            LogicLike,
+            Constant,
+            FourSymbols
+        }
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the name the suite is picked by on the command line.
+        /// </summary>
+        public override string Name
+        {
+            get
+            {
+                return "compression";
+            }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Run the checks.
+        /// </summary>
+        public override void Check()
+        {
+            string[] raws = Directory.GetFiles(VectorDirectory, "*.raw");
+
+            Array.Sort(raws);
+            Report(raws.Length > 0, "test vectors found in {0}", VectorDirectory);
+
+            foreach (string raw in raws)
+            {
+                byte[] expected = File.ReadAllBytes(raw);
+                string name = Path.GetFileNameWithoutExtension(raw);
+
+                checkVector(name + ".lzw", expected, new LzwDecompress());
+                checkVector(name + ".blk", expected, new BlockDecompress());
+            }
+
+            checkLzwRoundTrips();
+        }
+
+        /// <summary>
+        /// Run the benchmarks.
+        /// </summary>
+        public override void Bench()
+        {
+            Console.WriteLine("LZW data       ratio   MB/s out: old class  decoder  per-byte wrapper");
+            foreach (DataKinds kind in Enum.GetValues(typeof(DataKinds)))
+            {
+                if (kind != DataKinds.FourSymbols)
+                    benchLzw(kind);
+            }
+        }
+
+        /// <summary>
+        /// Decompress a test vector and compare it with the stream it was made from.
+        /// </summary>
+        /// <param name="File">The name of the compressed vector</param>
+        /// <param name="Expected">The stream it was made from</param>
+        /// <param name="Decompress">The decompressor to use</param>
+        private void checkVector(string File, byte[] Expected, Decompress Decompress)
+        {
+            byte[] compressed = System.IO.File.ReadAllBytes(Path.Combine(VectorDirectory, File));
+            byte[] decoded = Decompress.Run(compressed);
+            int difference = FirstDifference(Expected, decoded);
+
+            Report(difference < 0, "{0} decodes to its {1} bytes ({2:F2}:1){3}", File, Expected.Length,
+                (double)Expected.Length / compressed.Length,
+                difference < 0 ? "" : String.Format(", but differs at byte {0} of {1}", difference, decoded.Length));
+        }
+
+        /// <summary>
+        /// Compress random streams with the host's Compressor, and check that the LZW decoder gives them back. One
+        /// decoder is used for all of them (reset between streams), and each stream is fed to it in random pieces,
+        /// with random room for the output. The per-byte Decompressor is checked on some of them too.
+        /// </summary>
+        private void checkLzwRoundTrips()
+        {
+            Random random = new Random(11);
+            LzwDecoder decoder = new LzwDecoder();
+            LzwDecompress wrapper = new LzwDecompress();
+            long bytes = 0;
+            int clears = 0;
+
+            for (int trial = 0; trial < LzwTrials; trial++)
+            {
+                DataKinds kind = (DataKinds)random.Next(4);
+                int length = (trial % (LzwTrials / LzwLongStreams) == 0) ? LzwLongStream : random.Next(LzwShortStream);
+                byte[] data = makeData(random, kind, length);
+                byte[] compressed = compress(data);
+                byte[] decoded = decodeInPieces(decoder, compressed, random);
+                int difference = FirstDifference(data, decoded);
+
+                // (Compressor.Flush() leaves the last bits of the code that ends the stream in its output byte, so
+                // the end is only seen when the codes happen to finish on a byte; the decoded length shows
+                // nothing stray came out either way.)
+                if (difference >= 0)
+                {
+                    Report(false, "LZW round trip {0} ({1} bytes of {2} data) differs at byte {3} of {4}", trial, length, kind,
+                        difference, decoded.Length);
+                    return;
+                }
+                if (trial % 10 == 0 && FirstDifference(data, wrapper.Run(compressed)) >= 0)
+                {
+                    Report(false, "LZW round trip {0} ({1} bytes of {2} data) through the per-byte Decompressor", trial, length, kind);
+                    return;
+                }
+
+                bytes += length;
+                if (compressed.Length * 8L / Compressor.nBits > Compressor.MaxCode - Compressor.FirstCode)
+                    clears++;
+            }
+            Report(true, "LZW decoder gives back {0} random streams from Compressor ({1:F1} MB, {2} long enough to clear the table)",
+                LzwTrials, bytes / 1e6, clears);
+        }
+
+        /// <summary>
+        /// Time the LZW decoders on a kind of data.
+        /// </summary>
+        /// <param name="Kind">The kind of data</param>
+        private void benchLzw(DataKinds Kind)
+        {
+            byte[] data = makeData(new Random(12), Kind, LzwBenchLength);
+            byte[] compressed = compress(data);
+            byte[] output = new byte[LzwBenchBlock * 16];
+            long count = 0;
+            double mb = data.Length / 1e6;
+
+            double old = Time(delegate
+            {
+                OldDecompressor decompressor = new OldDecompressor(delegate(byte b) { count++; });
+
+                // The old class decodes the end of the stream as data, so it is left out.
+                for (int offset = 0; offset < compressed.Length - 2; offset += LzwBenchBlock)
+                {
+                    byte[] block = new byte[Math.Min(LzwBenchBlock, compressed.Length - 2 - offset)];
+
+                    Array.Copy(compressed, offset, block, 0, block.Length);
+                    decompressor.Decode(block);
+                }
+            });
+            LzwDecoder decoder = new LzwDecoder();
+            double bulk = Time(delegate
+            {
+                decoder.Reset();
+                for (int offset = 0; offset < compressed.Length; offset += LzwBenchBlock)
+                {
+                    int position = offset;
+                    int end = Math.Min(offset + LzwBenchBlock, compressed.Length);
+
+                    while (decoder.Decode(compressed, ref position, end, output, 0, output.Length) > 0)
+                        count++;
+                }
+            });
+            double wrapper = Time(delegate
+            {
+                Decompressor decompressor = new Decompressor(delegate(byte b) { count++; });
+                byte[] block = new byte[LzwBenchBlock];
+
+                for (int offset = 0; offset < compressed.Length; offset += LzwBenchBlock)
+                {
+                    if (compressed.Length - offset < block.Length)
+                        block = new byte[compressed.Length - offset];
+                    Array.Copy(compressed, offset, block, 0, block.Length);
+                    decompressor.Decode(block);
+                }
+            });
+
+            Console.WriteLine("{0,-12} {1,7:F2} {2,20:F1} {3,8:F1} {4,17:F1}", Kind, (double)compressed.Length / data.Length,
+                mb / old, mb / bulk, mb / wrapper);
+        }
+
+        /// <summary>
+        /// Make data to compress.
+        /// </summary>
+        /// <param name="Random">The source of the data</param>
+        /// <param name="Kind">The kind of data</param>
+        /// <param name="Length">The number of bytes</param>
+        /// <returns>The data</returns>
+        private static byte[] makeData(Random Random, DataKinds Kind, int Length)
+        {
+            byte[] data = new byte[Length];
+            byte value = (byte)Random.Next(256);
+            int meanRun = 1 + Random.Next(64);
+
+            for (int i = 0; i < Length; i++)
+            {
+                switch (Kind)
+                {
+                    case DataKinds.Random:
+                        value = (byte)Random.Next(256);
+                        break;
+                    case DataKinds.LogicLike:
+                        // A channel changes now and then.
+                        if (Random.Next(meanRun) == 0)
+                            value ^= (byte)(1 << Random.Next(8));
+                        break;
+                    case DataKinds.FourSymbols:
+                        value = (byte)(0x11 * Random.Next(4));
+                        break;
+                }
+                data[i] = value;
+            }
+            return data;
+        }
+
+        /// <summary>
+        /// Compress data with the host's Compressor, ending the stream.
+        /// </summary>
+        /// <param name="Data">The data</param>
+        /// <returns>The compressed stream</returns>
+        private static byte[] compress(byte[] Data)
+        {
+            List<byte> compressed = new List<byte>(Data.Length / 2);
+            Compressor compressor = new Compressor(compressed.Add);
+
+            compressor.Encode(Data);
+            compressor.Flush();
+            return compressed.ToArray();
+        }
+
+        /// <summary>
+        /// Decode a stream, feeding it to the decoder in random pieces with random room for the output.
+        /// </summary>
+        /// <param name="Decoder">The decoder (reset first)</param>
+        /// <param name="Compressed">The stream</param>
+        /// <param name="Random">The source of the pieces</param>
+        /// <returns>The decoded stream</returns>
+        private static byte[] decodeInPieces(LzwDecoder Decoder, byte[] Compressed, Random Random)
+        {
+            MemoryStream decoded = new MemoryStream();
+            byte[] output = new byte[2 * LzwDecoder.MaxStringLength];
+            int offset = 0;
+
+            Decoder.Reset();
+            while (offset < Compressed.Length && !Decoder.Ended)
+            {
+                int end = Math.Min(offset + 1 + Random.Next(600), Compressed.Length);
+
+                while (true)
+                {
+                    // Less room than the longest string at times, so the decoder stops short of the end of its input.
+                    int room = (Random.Next(4) == 0) ? 1 + Random.Next(output.Length) : output.Length;
+                    int length = Decoder.Decode(Compressed, ref offset, end, output, 0, room);
+
+                    // The decoder may hold whole codes once the piece is used up, so it's done when there's room
+                    // and nothing comes out.
+                    decoded.Write(output, 0, length);
+                    if (Decoder.Ended || (length == 0 && room == output.Length))
+                        break;
+                }
+            }
+            return decoded.ToArray();
+        }
+
+        #endregion
+
+        #region Decompressors
+
+        /// <summary>
+        /// A decompressor run over a whole stream.
+        /// </summary>
+        public abstract class Decompress
+        {
+            protected List<byte> output = new List<byte>();
+
+            /// <summary>
+            /// Decompress a stream.
+            /// </summary>
+            /// <param name="Data">The compressed stream</param>
+            /// <returns>The decompressed stream</returns>
+            public byte[] Run(byte[] Data)
+            {
+                output.Clear();
+                Decode(Data);
+                return output.ToArray();
+            }
+
+            /// <summary>
+            /// Take a byte of decompressor output.
+            /// </summary>
+            /// <param name="b">The byte</param>
+            protected void Output(byte b)
+            {
+                output.Add(b);
+            }
+
+            /// <summary>
+            /// Decode a compressed stream.
+            /// </summary>
+            /// <param name="Data">The compressed stream</param>
+            protected abstract void Decode(byte[] Data);
+        }
+
+        /// <summary>
+        /// The LZW decompressor (as used for SamplingCompression Y).
+        /// </summary>
+        public class LzwDecompress : Decompress
+        {
+            protected override void Decode(byte[] Data)
+            {
+                Decompressor decompressor = new Decompressor(Output);
+
+                decompressor.Decode(Data);
+                decompressor.Flush();
+            }
+        }
+
+        /// <summary>
+        /// The block decompressor (as used for SamplingCompression B).
+        /// </summary>
+        public class BlockDecompress : Decompress
+        {
+            protected override void Decode(byte[] Data)
+            {
+                BlockDecompressor decompressor = new BlockDecompressor(Output);
+
+                decompressor.Decode(Data);
+                decompressor.Flush();
+            }
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,240 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.Drawing.Imaging;
+using System.Text;
+
+namespace System.Drawing
+{
+    // The .NET SDK has no GDI+ (System.Drawing.Common is a Windows-only NuGet package), so the tests build the
+    // waveform rasterizer and tile cache against this stand-in for the parts of it they use. Images are 32-bit
+    // ARGB pixels in memory; a Graphics draws into one without antialiasing: a line is the pixels from one end to
+    // the other, both included, and a fill covers the rectangle's pixels, as GDI+ does with its default settings.
+    // Colors are the framework's own (System.Drawing.Primitives). Pixels drawn in a transparent color are left
+    // as they were.
+
+    public class Image : IDisposable
+    {
+        internal int[] Pixels;
+
+        protected Image(int Width, int Height)
+        {
+            if (Width <= 0 || Height <= 0)
+                throw new ArgumentException("Parameter is not valid.");
+            this.Width = Width;
+            this.Height = Height;
+            Pixels = new int[Width * Height];
+        }
+
+        public int Width { get; private set; }
+        public int Height { get; private set; }
+
+        public void Dispose()
+        {
+            Pixels = null;
+        }
+    }
+
+    public sealed class Bitmap : Image
+    {
+        public Bitmap(int Width, int Height)
+            : base(Width, Height)
+        {
+        }
+
+        public Bitmap(int Width, int Height, PixelFormat Format)
+            : base(Width, Height)
+        {
+        }
+
+        public Color GetPixel(int x, int y)
+        {
+            if (Pixels == null)
+                throw new ObjectDisposedException("Bitmap");
+            if (x < 0 || x >= Width || y < 0 || y >= Height)
+                throw new ArgumentOutOfRangeException("x");
+            return Color.FromArgb(Pixels[y * Width + x]);
+        }
+    }
+
+    public abstract class Brush : IDisposable
+    {
+        // The color of a pixel filled with the brush (the pattern of a brush is aligned with the image's origin).
+        internal abstract Color ColorAt(int x, int y);
+
+        public void Dispose()
+        {
+        }
+    }
+
+    public sealed class SolidBrush : Brush
+    {
+        public SolidBrush(Color Color)
+        {
+            this.Color = Color;
+        }
+
+        public Color Color { get; private set; }
+
+        internal override Color ColorAt(int x, int y)
+        {
+            return Color;
+        }
+    }
+
+    public sealed class Pen : IDisposable
+    {
+        public Pen(Color Color, float Width)
+        {
+            this.Color = Color;
+            this.Width = Width;
+        }
+
+        public Color Color { get; private set; }
+        public float Width { get; private set; }
+
+        public void Dispose()
+        {
+        }
+    }
+
+    public sealed class Graphics : IDisposable
+    {
+        private Image image;
+
+        private Graphics(Image Image)
+        {
+            image = Image;
+        }
+
+        public static Graphics FromImage(Image Image)
+        {
+            if (Image.Pixels == null)
+                throw new ObjectDisposedException("Image");
+            return new Graphics(Image);
+        }
+
+        public void Clear(Color Color)
+        {
+            int argb = Color.ToArgb();
+
+            for (int i = 0; i < image.Pixels.Length; i++)
+                image.Pixels[i] = argb;
+        }
+
+        public void DrawLine(Pen Pen, int x1, int y1, int x2, int y2)
+        {
+            // Bresenham's line, one pixel wide.
+            int dx = Math.Abs(x2 - x1), dy = -Math.Abs(y2 - y1);
+            int sx = (x1 < x2) ? 1 : -1, sy = (y1 < y2) ? 1 : -1;
+            int error = dx + dy;
+
+            while (true)
+            {
+                setPixel(x1, y1, Pen.Color);
+                if (x1 == x2 && y1 == y2)
+                    break;
+                if (2 * error >= dy)
+                {
+                    error += dy;
+                    x1 += sx;
+                }
+                if (2 * error <= dx)
+                {
+                    error += dx;
+                    y1 += sy;
+                }
+            }
+        }
+
+        public void FillRectangle(Brush Brush, int x, int y, int Width, int Height)
+        {
+            int left = Math.Max(x, 0), right = Math.Min(x + Width, image.Width);
+            int top = Math.Max(y, 0), bottom = Math.Min(y + Height, image.Height);
+
+            for (int row = top; row < bottom; row++)
+            {
+                for (int column = left; column < right; column++)
+                    setPixel(column, row, Brush.ColorAt(column, row));
+            }
+        }
+
+        public void DrawImageUnscaled(Image Image, int x, int y)
+        {
+            int left = Math.Max(x, 0), right = Math.Min(x + Image.Width, image.Width);
+            int top = Math.Max(y, 0), bottom = Math.Min(y + Image.Height, image.Height);
+
+            for (int row = top; row < bottom; row++)
+            {
+                for (int column = left; column < right; column++)
+                {
+                    int argb = Image.Pixels[(row - y) * Image.Width + column - x];
+
+                    if ((argb >> 24) != 0)
+                        image.Pixels[row * image.Width + column] = argb;
+                }
+            }
+        }
+
+        private void setPixel(int x, int y, Color Color)
+        {
+            if (x >= 0 && x < image.Width && y >= 0 && y < image.Height && Color.A != 0)
+                image.Pixels[y * image.Width + x] = Color.ToArgb();
+        }
+
+        public void Dispose()
+        {
+            image = null;
+        }
+    }
+}
+
+namespace System.Drawing.Drawing2D
+{
+    public enum HatchStyle { ForwardDiagonal, BackwardDiagonal }
+
+    public sealed class HatchBrush : Brush
+    {
+        public HatchBrush(HatchStyle HatchStyle, Color ForeColor, Color BackColor)
+        {
+            this.HatchStyle = HatchStyle;
+            this.ForegroundColor = ForeColor;
+            this.BackgroundColor = BackColor;
+        }
+
+        public HatchStyle HatchStyle { get; private set; }
+        public Color ForegroundColor { get; private set; }
+        public Color BackgroundColor { get; private set; }
+
+        internal override Color ColorAt(int x, int y)
+        {
+            // GDI+ hatches repeat every 8 pixels; a backward diagonal runs from the upper right to the lower left.
+            int phase = (HatchStyle == HatchStyle.BackwardDiagonal) ? (x + y) & 7 : (x - y) & 7;
+
+            return (phase == 0) ? ForegroundColor : BackgroundColor;
+        }
+    }
+}
+
+namespace System.Drawing.Imaging
+{
+    public enum PixelFormat { Format32bppArgb, Format32bppPArgb }
+}
@@ -0,0 +1,421 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using LogicAnalyzer.Filters;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// Checks and benchmarks of the filter stacks the host receives through: frames (as sampled in continuous or
+    /// compressed mode), frames then run-length records (run-length mode), run-length records alone, and the error
+    /// filter (used for command replies outside of captures). The checks make sure a stack gives the same output
+    /// written a block at a time (as the controller does) as a byte at a time. The benchmarks time both, and the
+    /// filter chain as it was before it worked on blocks (OldDataFilter) where there is a copy of it.
+    /// </summary>
+    public class FilterTests : TestSuite
+    {
+        private const int BlockSize = 4096;
+
+        private byte[] samples;
+        private byte[] frames;
+        private byte[] runs;
+        private byte[] expandedRuns;
+        private byte[] framedRuns;
+        private byte[] text;
+        private byte[] plainText;
+        private int textErrors;
+        private byte[] buffer = new byte[BlockSize];
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the name the suite is picked by on the command line.
+        /// </summary>
+        public override string Name
+        {
+            get
+            {
+                return "filter";
+            }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Run the checks.
+        /// </summary>
+        public override void Check()
+        {
+            int errors;
+
+            makeStreams();
+
+            checkStack("frames", frames, samples, 0, frameStack, null);
+            checkStack("frames + run-length", framedRuns, expandedRuns, 0, frameRunLengthStack, null);
+            checkStack("run-length", runs, expandedRuns, 0, runLengthStack, oldRunLengthStack);
+            checkStack("error filter", text, plainText, textErrors, errorStack, oldErrorStack);
+
+            // An error message split across blocks.
+            byte[] message = Encoding.ASCII.GetBytes("OK\r\n<err>Bad command</err>OK\r\n");
+            for (int split = 1; split < message.Length; split++)
+            {
+                MemoryStream output = new MemoryStream();
+                AbstractDataFilter<byte> filter = errorStack();
+
+                errors = write(filter, message, 0, split, output) + write(filter, message, split, message.Length - split, output);
+                if (errors != 1 || output.Length != 8)
+                {
+                    Report(false, "error filter finds a message split after byte {0}", split);
+                    return;
+                }
+            }
+            Report(true, "error filter finds a message split anywhere across two blocks");
+        }
+
+        /// <summary>
+        /// Run the benchmarks.
+        /// </summary>
+        public override void Bench()
+        {
+            makeStreams();
+
+            Console.WriteLine("stack                 MB in   MB/s in: blocks    bytes  old chain   out/in");
+            benchStack("frames", frames, frameStack, null);
+            benchStack("frames + run-length", framedRuns, frameRunLengthStack, null);
+            benchStack("run-length", runs, runLengthStack, oldRunLengthStack);
+            benchStack("error filter", text, errorStack, oldErrorStack);
+        }
+
+        /// <summary>
+        /// Make the streams to filter.
+        /// </summary>
+        private void makeStreams()
+        {
+            Random random = new Random(2);
+            MemoryStream stream;
+            byte sequence;
+
+            if (samples != null)
+                return;
+
+            // Four megabytes of sample data, in the biggest frames the firmware sends.
+            samples = new byte[4 << 20];
+            random.NextBytes(samples);
+            frames = frame(samples);
+
+            // A megabyte of run-length records, with runs of 1 to 32 samples.
+            MemoryStream record = new MemoryStream();
+            stream = new MemoryStream();
+            while (record.Length < (1 << 20))
+            {
+                byte value = (byte)random.Next(256);
+                int length = 1 + random.Next(32);
+
+                record.WriteByte(value);
+                for (int n = length; ; n >>= 7)
+                {
+                    record.WriteByte((byte)((n & 0x7f) | (n >= 0x80 ? 0x80 : 0)));
+                    if (n < 0x80)
+                        break;
+                }
+                for (int i = 0; i < length; i++)
+                    stream.WriteByte(value);
+            }
+            runs = record.ToArray();
+            expandedRuns = stream.ToArray();
+            framedRuns = frame(runs);
+
+            // A megabyte of replies, with an error message now and then.
+            MemoryStream plain = new MemoryStream();
+            stream = new MemoryStream();
+            sequence = 0;
+            textErrors = 0;
+            while (stream.Length < (1 << 20))
+            {
+                byte[] line = Encoding.ASCII.GetBytes(String.Format("OK ID={0} <{1}>\r\n", sequence++, random.Next()));
+
+                stream.Write(line, 0, line.Length);
+                plain.Write(line, 0, line.Length);
+                if (sequence == 0)
+                {
+                    line = Encoding.ASCII.GetBytes("<err>Bad command</err>");
+                    stream.Write(line, 0, line.Length);
+                    textErrors++;
+                }
+            }
+            text = stream.ToArray();
+            plainText = plain.ToArray();
+        }
+
+        /// <summary>
+        /// Wrap a stream in sample frames, as the firmware does.
+        /// </summary>
+        /// <param name="Data">The stream</param>
+        /// <returns>The frames</returns>
+        private static byte[] frame(byte[] Data)
+        {
+            MemoryStream stream = new MemoryStream();
+            byte sequence = 0;
+
+            for (int offset = 0; offset < Data.Length; offset += FrameFilter.MaxPayloadLength)
+                FrameTests.WriteFrame(stream, FrameFilter.FrameTypes.Samples, Data, offset,
+                    Math.Min(FrameFilter.MaxPayloadLength, Data.Length - offset), sequence++);
+            return stream.ToArray();
+        }
+
+        /// <summary>
+        /// Check that a stack gives the expected output, written in blocks and a byte at a time.
+        /// </summary>
+        /// <param name="Name">The name of the stack</param>
+        /// <param name="Input">What to write to it</param>
+        /// <param name="Expected">The output expected</param>
+        /// <param name="Errors">The number of errors expected</param>
+        /// <param name="Stack">Makes the stack</param>
+        /// <param name="OldStack">Makes the stack on the old chain (or null)</param>
+        private void checkStack(string Name, byte[] Input, byte[] Expected, int Errors, NewStack Stack, OldStack OldStack)
+        {
+            MemoryStream output = new MemoryStream();
+            int errors = writeBlocks(Stack(), Input, output);
+            int difference = FirstDifference(Expected, output.ToArray());
+
+            Report(difference < 0 && errors == Errors, "{0}: {1} bytes in blocks give {2} bytes out, {3} error(s){4}", Name, Input.Length,
+                output.Length, errors, difference < 0 ? "" : String.Format(" (differs at byte {0})", difference));
+
+            output = new MemoryStream();
+            errors = writeBytes(Stack(), Input, output);
+            difference = FirstDifference(Expected, output.ToArray());
+            Report(difference < 0 && errors == Errors, "{0}: the same a byte at a time{1}", Name,
+                difference < 0 ? "" : String.Format(" (differs at byte {0})", difference));
+
+            if (OldStack != null)
+            {
+                output = new MemoryStream();
+                errors = writeOld(OldStack(), Input, output);
+                difference = FirstDifference(Expected, output.ToArray());
+                Report(difference < 0 && errors == Errors, "{0}: the same on the old chain{1}", Name,
+                    difference < 0 ? "" : String.Format(" (differs at byte {0})", difference));
+            }
+        }
+
+        /// <summary>
+        /// Time a stack, written in blocks and a byte at a time, and on the old chain.
+        /// </summary>
+        /// <param name="Name">The name of the stack</param>
+        /// <param name="Input">What to write to it</param>
+        /// <param name="Stack">Makes the stack</param>
+        /// <param name="OldStack">Makes the stack on the old chain (or null)</param>
+        private void benchStack(string Name, byte[] Input, NewStack Stack, OldStack OldStack)
+        {
+            double mb = Input.Length / 1e6;
+            long outLength = 0;
+            double blocks = Time(delegate { outLength = writeBlocks(Stack(), Input, null); });
+            double bytes = Time(delegate { writeBytes(Stack(), Input, null); });
+            string old = "-";
+
+            if (OldStack != null)
+                old = String.Format("{0:F1}", mb / Time(delegate { writeOld(OldStack(), Input, null); }));
+
+            outLength = countOutput(Stack(), Input);
+            Console.WriteLine("{0,-20} {1,6:F1} {2,16:F1} {3,8:F1} {4,10} {5,8:F1}", Name, mb, mb / blocks, mb / bytes, old,
+                (double)outLength / Input.Length);
+        }
+
+        /// <summary>
+        /// Count the output of a stack.
+        /// </summary>
+        /// <param name="Filter">The stack</param>
+        /// <param name="Input">What to write to it</param>
+        /// <returns>The number of bytes out</returns>
+        private long countOutput(AbstractDataFilter<byte> Filter, byte[] Input)
+        {
+            MemoryStream output = new MemoryStream();
+
+            writeBlocks(Filter, Input, output);
+            return output.Length;
+        }
+
+        /// <summary>
+        /// Write a stream to a stack in blocks, as the controller does.
+        /// </summary>
+        /// <param name="Filter">The stack</param>
+        /// <param name="Input">The stream</param>
+        /// <param name="Output">Where to put the output (or null to drop it)</param>
+        /// <returns>The number of errors the stack reported</returns>
+        private int writeBlocks(AbstractDataFilter<byte> Filter, byte[] Input, Stream Output)
+        {
+            int errors = 0;
+
+            for (int offset = 0; offset < Input.Length; offset += BlockSize)
+                errors += write(Filter, Input, offset, Math.Min(BlockSize, Input.Length - offset), Output);
+            return errors;
+        }
+
+        /// <summary>
+        /// Write a stream to a stack a byte at a time, reading the output every BlockSize bytes.
+        /// </summary>
+        /// <param name="Filter">The stack</param>
+        /// <param name="Input">The stream</param>
+        /// <param name="Output">Where to put the output (or null to drop it)</param>
+        /// <returns>The number of errors the stack reported</returns>
+        private int writeBytes(AbstractDataFilter<byte> Filter, byte[] Input, Stream Output)
+        {
+            int errors = 0;
+
+            for (int i = 0; i < Input.Length; i++)
+            {
+                try
+                {
+                    Filter.Write(Input[i]);
+                }
+                catch (Exception ex)
+                {
+                    errors += ex.Message.Split('\n').Length;
+                }
+                if ((i + 1) % BlockSize == 0 || i == Input.Length - 1)
+                    read(Filter, Output);
+            }
+            return errors;
+        }
+
+        /// <summary>
+        /// Write a block to a stack and read its output.
+        /// </summary>
+        /// <param name="Filter">The stack</param>
+        /// <param name="Input">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        /// <param name="Output">Where to put the output (or null to drop it)</param>
+        /// <returns>The number of errors the stack reported</returns>
+        private int write(AbstractDataFilter<byte> Filter, byte[] Input, int Offset, int Count, Stream Output)
+        {
+            int errors = 0;
+
+            try
+            {
+                Filter.Write(Input, Offset, Count);
+            }
+            catch (Exception ex)
+            {
+                errors = ex.Message.Split('\n').Length;
+            }
+            read(Filter, Output);
+            return errors;
+        }
+
+        /// <summary>
+        /// Read everything a stack has output.
+        /// </summary>
+        /// <param name="Filter">The stack</param>
+        /// <param name="Output">Where to put it (or null to drop it)</param>
+        private void read(AbstractDataFilter<byte> Filter, Stream Output)
+        {
+            while (Filter.DataReady)
+            {
+                int count = Filter.Read(buffer, 0, buffer.Length);
+
+                if (Output != null)
+                    Output.Write(buffer, 0, count);
+            }
+        }
+
+        /// <summary>
+        /// Write a stream to a stack on the old chain a byte at a time, reading the output every BlockSize bytes (as
+        /// the controller did).
+        /// </summary>
+        /// <param name="Filter">The stack</param>
+        /// <param name="Input">The stream</param>
+        /// <param name="Output">Where to put the output (or null to drop it)</param>
+        /// <returns>The number of errors the stack reported</returns>
+        private int writeOld(OldDataFilter<byte> Filter, byte[] Input, Stream Output)
+        {
+            int errors = 0;
+
+            for (int i = 0; i < Input.Length; i++)
+            {
+                try
+                {
+                    Filter.Write(Input[i]);
+                }
+                catch (Exception)
+                {
+                    errors++;
+                }
+                if ((i + 1) % BlockSize == 0 || i == Input.Length - 1)
+                {
+                    while (Filter.DataReady)
+                    {
+                        int count = Filter.Read(buffer, buffer.Length);
+
+                        if (Output != null)
+                            Output.Write(buffer, 0, count);
+                    }
+                }
+            }
+            return errors;
+        }
+
+        #endregion
+
+        #region Stacks
+
+        private delegate AbstractDataFilter<byte> NewStack();
+        private delegate OldDataFilter<byte> OldStack();
+
+        private static AbstractDataFilter<byte> frameStack()
+        {
+            return new FrameFilter();
+        }
+
+        private static AbstractDataFilter<byte> frameRunLengthStack()
+        {
+            FrameFilter filter = new FrameFilter();
+
+            filter.AddFilter(new RunLengthFilter());
+            return filter;
+        }
+
+        private static AbstractDataFilter<byte> runLengthStack()
+        {
+            return new RunLengthFilter();
+        }
+
+        private static OldDataFilter<byte> oldRunLengthStack()
+        {
+            return new OldRunLengthFilter();
+        }
+
+        private static AbstractDataFilter<byte> errorStack()
+        {
+            return new ErrorFilter();
+        }
+
+        private static OldDataFilter<byte> oldErrorStack()
+        {
+            return new OldErrorFilter();
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,241 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using LogicAnalyzer.Filters;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// Checks of the frame filter: sample data sent in frames, as the firmware sends it, has to come out of the
+    /// filter whole, however the stream is cut into blocks, and whatever else is on the line between the frames.
+    /// </summary>
+    public class FrameTests : TestSuite
+    {
+        private const int StreamLength = 1 << 20;
+
+        private Random random = new Random(1);
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the name the suite is picked by on the command line.
+        /// </summary>
+        public override string Name
+        {
+            get
+            {
+                return "frame";
+            }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Run the checks.
+        /// </summary>
+        public override void Check()
+        {
+            byte[] samples = new byte[StreamLength];
+
+            // Sample data full of sync bytes, and of things that look like frame headers.
+            random.NextBytes(samples);
+            for (int i = 0; i < samples.Length; i += 1 + random.Next(16))
+                samples[i] = FrameFilter.FrameSync;
+
+            checkStream("clean", samples, false, -1);
+            checkStream("noisy", samples, true, -1);
+            checkStream("damaged", samples, false, 1000);
+            checkStream("noisy and damaged", samples, true, 1000);
+            checkPositions();
+        }
+
+        /// <summary>
+        /// Send gap and rate frames whose positions wrap past 32 bits, a little out of order (as the firmware may
+        /// send them), and check the positions come out of the filter unwrapped.
+        /// </summary>
+        private void checkPositions()
+        {
+            long[] positions = { 1000, 0x80000000L, 0xfff00000L, 0xffffff00L, 0xfffff000L, 0x100000100L, 0x17fffffffL, 0x180000001L,
+                                 0x17ffffff0L, 0x1f0000000L, 0x260000000L, 0x2a0000005L };
+            MemoryStream line = new MemoryStream();
+            FrameFilter filter = new FrameFilter();
+            byte[] payload = new byte[8];
+            byte sequence = 0;
+            bool same = true;
+
+            foreach (long position in positions)
+            {
+                Buffer.BlockCopy(BitConverter.GetBytes((uint)position), 0, payload, 0, 4);
+                Buffer.BlockCopy(BitConverter.GetBytes(2), 0, payload, 4, 4);
+                WriteFrame(line, (sequence & 1) != 0 ? FrameFilter.FrameTypes.Gap : FrameFilter.FrameTypes.Rate, payload, 0, 8, sequence++);
+            }
+            filter.Write(line.ToArray(), 0, (int)line.Length);
+
+            same = filter.Events.Count == positions.Length;
+            for (int i = 0; same && i < positions.Length; i++)
+                same = filter.Events[i].Position == positions[i];
+            Report(same, "{0} timeline positions unwrap past 32 bits, up to {1:x}", filter.Events.Count,
+                filter.Events.Count > 0 ? filter.Events[filter.Events.Count - 1].Position : 0);
+        }
+
+        /// <summary>
+        /// Send sample data through a frame filter, in frames of random lengths with short frames in between, cut
+        /// into blocks of random lengths, and check what comes out.
+        /// </summary>
+        /// <param name="Name">What is being checked</param>
+        /// <param name="Samples">The sample data</param>
+        /// <param name="Noise">Whether to put noise on the line between the frames</param>
+        /// <param name="Damage">The index of the sample frame to damage, or -1</param>
+        private void checkStream(string Name, byte[] Samples, bool Noise, int Damage)
+        {
+            MemoryStream line = new MemoryStream();
+            MemoryStream expected = new MemoryStream();
+            MemoryStream output = new MemoryStream();
+            FrameFilter filter = new FrameFilter();
+            StringBuilder errors = new StringBuilder();
+            byte[] buffer = new byte[4096];
+            byte sequence = 0;
+            int frames = 0;
+
+            for (int offset = 0; offset < Samples.Length; frames++)
+            {
+                int length = Math.Min(1 + random.Next(FrameFilter.MaxPayloadLength), Samples.Length - offset);
+                long start = line.Length;
+
+                if (Noise)
+                    writeNoise(line);
+                if (frames % 16 == 0)
+                    WriteFrame(line, FrameFilter.FrameTypes.Status, new byte[FrameFilter.SmallPayloadLength], 0, FrameFilter.SmallPayloadLength, sequence++);
+
+                start = line.Length;
+                WriteFrame(line, FrameFilter.FrameTypes.Samples, Samples, offset, length, sequence++);
+                if (frames == Damage)
+                {
+                    line.Position = start + FrameFilter.HeaderSize + random.Next(length);
+                    line.WriteByte((byte)~line.GetBuffer()[line.Position]);
+                    line.Position = line.Length;
+                }
+                else
+                    expected.Write(Samples, offset, length);
+                offset += length;
+            }
+            WriteFrame(line, FrameFilter.FrameTypes.End, BitConverter.GetBytes(Samples.Length), 0, 4, sequence++);
+
+            byte[] data = line.ToArray();
+
+            for (int offset = 0; offset < data.Length; )
+            {
+                int count = Math.Min(1 + random.Next(2048), data.Length - offset);
+
+                try
+                {
+                    filter.Write(data, offset, count);
+                }
+                catch (Exception ex)
+                {
+                    errors.AppendLine(ex.Message);
+                }
+                offset += count;
+
+                while (filter.DataReady)
+                    output.Write(buffer, 0, filter.Read(buffer, buffer.Length));
+            }
+
+            string[] lines = errors.ToString().Split(new char[] { '\r', '\n' }, StringSplitOptions.RemoveEmptyEntries);
+            int difference = FirstDifference(expected.ToArray(), output.ToArray());
+            int outside = 0, lost = 0;
+
+            foreach (string text in lines)
+            {
+                if (text.EndsWith("outside of frames"))
+                    outside++;
+                else if (text.Contains("lost before frame"))
+                    lost++;
+            }
+
+            Report(difference < 0 && filter.Ended, "{0}: {1} frames pass their {2} sample bytes{3}", Name, frames, expected.Length,
+                difference < 0 ? "" : String.Format(", but differ at byte {0} of {1}", difference, output.Length));
+            Report(lost == (Damage >= 0 ? 1 : 0) && (outside > 0) == (Noise || Damage >= 0) && outside + lost == lines.Length,
+                "{0}: {1} frame(s) reported lost, {2} report(s) of bytes outside of frames", Name, lost, outside);
+        }
+
+        /// <summary>
+        /// Write a frame, as the firmware does.
+        /// </summary>
+        /// <param name="Stream">Where to write it</param>
+        /// <param name="Type">The frame type</param>
+        /// <param name="Payload">An array holding the payload</param>
+        /// <param name="Offset">The offset of the payload in the array</param>
+        /// <param name="Count">The payload length</param>
+        /// <param name="Sequence">The sequence number</param>
+        public static void WriteFrame(Stream Stream, FrameFilter.FrameTypes Type, byte[] Payload, int Offset, int Count, byte Sequence)
+        {
+            byte[] frame = new byte[FrameFilter.HeaderSize + Count + FrameFilter.TrailerSize];
+            ushort crc;
+
+            frame[0] = FrameFilter.FrameSync;
+            frame[1] = (byte)Type;
+            frame[2] = Sequence;
+            frame[3] = (byte)Count;
+            frame[4] = (byte)(Count >> 8);
+            Buffer.BlockCopy(Payload, Offset, frame, FrameFilter.HeaderSize, Count);
+
+            crc = FrameFilter.Crc(0xffff, frame, 1, FrameFilter.HeaderSize - 1 + Count);
+            frame[frame.Length - 2] = (byte)crc;
+            frame[frame.Length - 1] = (byte)(crc >> 8);
+            Stream.Write(frame, 0, frame.Length);
+        }
+
+        /// <summary>
+        /// Write some noise: sometimes nothing, sometimes random bytes, sometimes a sync byte and a header that could
+        /// be real.
+        /// </summary>
+        /// <param name="Stream">Where to write it</param>
+        private void writeNoise(Stream Stream)
+        {
+            switch (random.Next(4))
+            {
+                case 1:
+                    for (int n = random.Next(8); n >= 0; n--)
+                        Stream.WriteByte((byte)random.Next(256));
+                    break;
+
+                case 2:
+                    Stream.WriteByte(FrameFilter.FrameSync);
+                    Stream.WriteByte((byte)FrameFilter.FrameTypes.Samples);
+                    Stream.WriteByte((byte)random.Next(256));
+                    Stream.WriteByte((byte)random.Next(256));
+                    Stream.WriteByte((byte)random.Next(2));
+                    break;
+
+                case 3:
+                    Stream.WriteByte(FrameFilter.FrameSync);
+                    break;
+            }
+        }
+
+        #endregion
+    }
+}
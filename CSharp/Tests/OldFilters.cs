@@ -0,0 +1,279 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+using LogicAnalyzer.Filters;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// The filter chain as it was before data went through it a block at a time, kept to benchmark against (see
+    /// FilterTests): every value goes through a Queue, under a lock, at every stage of the chain.
+    /// </summary>
+    /// <typeparam name="T">Data type of objects being filtered</typeparam>
+    public class OldDataFilter<T> : ITagTesterWriter<T>
+    {
+        private Queue<T> dataOut;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes an OldDataFilter object.
+        /// </summary>
+        public OldDataFilter()
+        {
+            dataOut = new Queue<T>(256);
+            TagTester = new TagTester<T>(this);
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Daisy-chained filter.
+        /// </summary>
+        private OldDataFilter<T> ChildFilter
+        {
+            get;
+            set;
+        }
+
+        /// <summary>
+        /// Gets the length of the filtered data.
+        /// </summary>
+        public int DataLength
+        {
+            get
+            {
+                int count;
+
+                lock (dataOut)
+                {
+                    count = dataOut.Count;
+                }
+                return count;
+            }
+        }
+
+        /// <summary>
+        /// Gets 'true' if data is available.
+        /// </summary>
+        public bool DataReady
+        {
+            get
+            {
+                return this.DataLength > 0;
+            }
+        }
+
+        /// <summary>
+        /// Gets the TagTester used to find delimiters in the data stream.
+        /// </summary>
+        internal TagTester<T> TagTester
+        {
+            get;
+            private set;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Daisy-chains a filter to this filter.
+        /// </summary>
+        /// <param name="Filter">A child filter to add to this filter.</param>
+        public void AddFilter(OldDataFilter<T> Filter)
+        {
+            if (this.ChildFilter != null)
+                this.ChildFilter.AddFilter(Filter);
+            else
+                this.ChildFilter = Filter;
+        }
+
+        /// <summary>
+        /// Writes a value to the filter, through any child filters.
+        /// </summary>
+        /// <param name="Data">A data value to be passed through the filter</param>
+        public virtual void Write(T Data)
+        {
+            if (ChildFilter != null)
+            {
+                ChildFilter.Write(Data);
+                while (ChildFilter.DataReady)
+                {
+                    T data = ChildFilter.Read();
+                    lock (dataOut)
+                    {
+                        dataOut.Enqueue(data);
+                    }
+                }
+            }
+            else
+            {
+                lock (dataOut)
+                {
+                    dataOut.Enqueue(Data);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Reads a data value from the filter.
+        /// </summary>
+        /// <returns>A data value that has been passed through the filter</returns>
+        public virtual T Read()
+        {
+            T value;
+
+            if (!this.DataReady)
+                throw new Exception("OldDataFilter.Read: Filter queue is empty");
+
+            lock (dataOut)
+            {
+                value = dataOut.Dequeue();
+            }
+            return value;
+        }
+
+        /// <summary>
+        /// Reads an array of values from the filter.
+        /// </summary>
+        /// <param name="Buffer">A pre-allocated output array</param>
+        /// <param name="MaxLength">The maximum number of values to read</param>
+        /// <returns>The number of values read</returns>
+        public virtual int Read(T[] Buffer, int MaxLength)
+        {
+            int cnt = 0;
+
+            while (cnt < MaxLength && this.DataLength > 0)
+                Buffer[cnt++] = this.Read();
+            return cnt;
+        }
+
+        /// <summary>
+        /// Override to write a value that turned out not to be part of a delimiter to the filter output.
+        /// </summary>
+        /// <param name="Data">The value</param>
+        public virtual void WriteTagTesterValue(T Data)
+        {
+        }
+
+        #endregion
+    }
+
+    /// <summary>
+    /// The run-length filter on the old chain.
+    /// </summary>
+    public class OldRunLengthFilter : OldDataFilter<byte>
+    {
+        private bool valueReceived = false;
+        private byte value = 0;
+        private UInt32 count = 0;
+        private int countShift = 0;
+
+        /// <summary>
+        /// Write a value to the run-length filter.
+        /// </summary>
+        /// <param name="Value">The data value being sent through the filter</param>
+        public override void Write(byte Value)
+        {
+            if (!valueReceived)
+            {
+                value = Value;
+                valueReceived = true;
+                return;
+            }
+
+            if (countShift > 28)
+                throw new Exception("OldRunLengthFilter.Write: Invalid Run Length");
+
+            count |= (UInt32)(Value & 0x7f) << countShift;
+            countShift += 7;
+            if ((Value & 0x80) != 0)
+                return;
+
+            while (count > 0)
+            {
+                base.Write(value);
+                count -= 1;
+            }
+
+            valueReceived = false;
+            countShift = 0;
+        }
+    }
+
+    /// <summary>
+    /// The error filter on the old chain.
+    /// </summary>
+    public class OldErrorFilter : OldDataFilter<byte>
+    {
+        private bool inErrorTag;
+        private List<byte> errorMessage = new List<byte>();
+
+        /// <summary>
+        /// Write a value that turned out not to be part of a tag.
+        /// </summary>
+        /// <param name="Data">The value</param>
+        public override void WriteTagTesterValue(byte Data)
+        {
+            if (inErrorTag)
+                errorMessage.Add(Data);
+            else
+                base.Write(Data);
+        }
+
+        /// <summary>
+        /// Write a value to the error filter.
+        /// </summary>
+        /// <param name="Data">The data value being sent through the filter</param>
+        public override void Write(byte Data)
+        {
+            if (inErrorTag)
+            {
+                if (!this.TagTester.ValueInTagCode(ErrorFilter.ErrorTagStop, Data))
+                    errorMessage.Add(Data);
+                else if (this.TagTester.Length == ErrorFilter.ErrorTagStop.Length)
+                {
+                    inErrorTag = false;
+                    this.TagTester.Clear();
+
+                    string error = Encoding.ASCII.GetString(errorMessage.ToArray());
+
+                    errorMessage.Clear();
+                    throw new Exception(error);
+                }
+            }
+            else
+            {
+                if (!this.TagTester.ValueInTagCode(ErrorFilter.ErrorTagStart, Data))
+                    base.Write(Data);
+                else if (this.TagTester.Length == ErrorFilter.ErrorTagStart.Length)
+                {
+                    this.TagTester.Clear();
+                    inErrorTag = true;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,265 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+using LogicAnalyzer.DataAcquisition;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// SamplePlot as it was before each channel's transitions went into a TransitionIndex, kept to check and
+    /// benchmark against (see PlotTests): each channel is a list of SampleSignal runs, one object per run, and
+    /// the state at a tick is found by walking the list from the start.
+    /// </summary>
+    public class OldSamplePlot
+    {
+        private int samplesPerByte;
+        private int sampleShift;
+        private SampleSignal[] currentChannelSignal;
+        private List<TimelineEvent> events;
+        private int nextEvent;
+        private int position;
+        private int divisor;
+        private int unknownUntil;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initalizes an OldSamplePlot object.
+        /// </summary>
+        /// <param name="Samples">Raw sampled data from the input device</param>
+        /// <param name="Channels">The number of channels being sampled</param>
+        /// <param name="StackedSamples">'true' if more than one sample is stacked in each byte</param>
+        /// <param name="Events">The gaps and rate changes of the capture (may be null)</param>
+        public OldSamplePlot(byte[] Samples, int Channels, bool StackedSamples, IList<TimelineEvent> Events)
+        {
+            samplesPerByte = 1;
+            sampleShift = 0;
+            if (StackedSamples)
+            {
+                // When the number of channels is 4 or fewer, samples are 'stacked'.
+                switch (Channels)
+                {
+                    case 1:
+                        samplesPerByte = 8;
+                        sampleShift = 1;
+                        break;
+                    case 2:
+                        samplesPerByte = 4;
+                        sampleShift = 2;
+                        break;
+                    case 3:
+                    case 4:
+                        samplesPerByte = 2;
+                        sampleShift = 4;
+                        break;
+                }
+            }
+
+            this.Channels = Channels;
+            this.StackedSamples = StackedSamples;
+            this.SampleSignals = new List<SampleSignal>[Channels];
+            currentChannelSignal = new SampleSignal[Channels];
+
+            for (int c = 0; c < Channels; c++)
+            {
+                // Initialize each channel low, 0 duration.
+                currentChannelSignal[c] = new SampleSignal(SampleSignal.State.Low, 0);
+                this.SampleSignals[c] = new List<SampleSignal>(2048);
+            }
+
+            events = (Events != null) ? new List<TimelineEvent>(Events) : new List<TimelineEvent>();
+            events.Sort(TimelineEvent.ComparePositions);
+            nextEvent = 0;
+            position = 0;
+            divisor = 1;
+            unknownUntil = 0;
+
+            buildSampleSignals(Samples);
+        }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the resulting signal plots for each channel.
+        /// </summary>
+        public List<SampleSignal>[] SampleSignals
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the number of channels being sampled.
+        /// </summary>
+        public int Channels
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// 'true' if more than one sample is stacked in each byte
+        /// </summary>
+        public bool StackedSamples
+        {
+            get;
+            private set;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Get the state of a channel at a tick, walking its runs from the start (as the display did).
+        /// </summary>
+        /// <param name="Channel">The channel</param>
+        /// <param name="Tick">The tick</param>
+        /// <returns>High, Low or Unknown</returns>
+        public SampleSignal.State StateAt(int Channel, long Tick)
+        {
+            long start = 0;
+
+            foreach (SampleSignal ss in SampleSignals[Channel])
+            {
+                start += ss.Duration;
+                if (start > Tick)
+                    return ss.SampleState;
+            }
+            return SampleSignal.State.Low;
+        }
+
+        /// <summary>
+        /// Extend a channel's signal by some ticks in the given state, adding the current signal to the channel's
+        /// list first if the state changes.
+        /// </summary>
+        /// <param name="channel"></param>
+        /// <param name="state"></param>
+        /// <param name="ticks"></param>
+        private void extend(int channel, SampleSignal.State state, int ticks)
+        {
+            SampleSignal ss = currentChannelSignal[channel];
+
+            if (ss.SampleState != state)
+            {
+                if (ss.Duration > 0)
+                    SampleSignals[channel].Add(ss);
+
+                ss = new SampleSignal(state, 0);
+                currentChannelSignal[channel] = ss;
+            }
+
+            ss.Duration += ticks;
+        }
+
+        /// <summary>
+        /// Extend every channel by some ticks of unknown state.
+        /// </summary>
+        /// <param name="ticks"></param>
+        private void extendUnknown(int ticks)
+        {
+            for (int c = 0; c < Channels; c++)
+                extend(c, SampleSignal.State.Unknown, ticks);
+        }
+
+        /// <summary>
+        /// Apply the events that take effect before the sample at the current position.
+        /// </summary>
+        private void processEvents()
+        {
+            while (nextEvent < events.Count && events[nextEvent].Position <= position)
+            {
+                TimelineEvent ev = events[nextEvent++];
+
+                if (ev.Kind == TimelineEvent.Kinds.RateChange)
+                    divisor = Math.Max(ev.Value, 1);
+                else if (StackedSamples)
+                {
+                    // The samples of a gap are missing from the data, so stand in for them.
+                    extendUnknown(ev.Value);
+                    position += ev.Value;
+                }
+                else
+                {
+                    // In transition mode the gap's samples are marked as unknown instead.
+                    unknownUntil = Math.Max(unknownUntil, (int)ev.Position + ev.Value);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Process one sample of Channels-wide bits.
+        /// </summary>
+        /// <param name="sample"></param>
+        private void processSample(byte sample)
+        {
+            if (nextEvent < events.Count)
+                processEvents();
+
+            if (position < unknownUntil)
+                extendUnknown(1);
+            else
+            {
+                int ticks = StackedSamples ? divisor : 1;
+
+                for (int c = 0; c < Channels; c++)
+                    extend(c, (sample & (1 << c)) != 0 ? SampleSignal.State.High : SampleSignal.State.Low, ticks);
+            }
+
+            position += StackedSamples ? divisor : 1;
+        }
+
+        /// <summary>
+        /// Build the signal arrays from the raw sample data.
+        /// </summary>
+        /// <param name="Samples">Raw sampled data from the input device</param>
+        private void buildSampleSignals(byte[] Samples)
+        {
+            byte shiftedSampleByte;
+
+            for (int i = 0; i < Samples.Length; i++)
+            {
+                shiftedSampleByte = Samples[i];
+                for (int s = 0; s < samplesPerByte; s++)
+                {
+                    processSample(shiftedSampleByte);
+                    shiftedSampleByte >>= sampleShift;
+                }
+            }
+
+            // A gap may run up to (or past) the end of the capture.
+            processEvents();
+            if (position < unknownUntil)
+                extendUnknown(unknownUntil - position);
+
+            for (int c = 0; c < Channels; c++)
+            {
+                if (currentChannelSignal[c].Duration > 0)
+                    SampleSignals[c].Add(currentChannelSignal[c]);
+            }
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,720 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using LogicAnalyzer.DataAcquisition;
+using LogicAnalyzer.Filters;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// Checks and benchmarks of how a capture is turned into signals to plot. A transitions-only capture is
+    /// plotted straight from its records (SamplePlot.FromTransitions()); the checks make sure that gives the
+    /// same signals as expanding the records into a sample per tick (DeltaTimestampFilter) and plotting those,
+    /// as the host did before, for sparse and dense signals, with and without gaps and rate changes. They also
+    /// make sure each channel's TransitionIndex holds the same runs as the lists of SampleSignal objects it
+    /// replaced (OldSamplePlot), and finds the same states and edges as walking them. The benchmarks time both
+    /// ways of plotting, and count the memory they allocate; and time building an index and looking it up,
+    /// against the lists. Lastly, the checks make sure a plot built as the capture comes in (SamplePlot.Begin(),
+    /// then Append() a block at a time) is the same as one built from the whole capture, and agrees with it up
+    /// to its Length all along; the benchmarks time both.
+    /// </summary>
+    public class PlotTests : TestSuite
+    {
+        // One second at 1 MHz, on all eight channels.
+        private const long Ticks = 1000000;
+        private const int SparseSpacing = 10000;
+        private const int DenseSpacing = 3;
+        // The random captures the index is checked on, and the lookups made in each.
+        private const int IndexTrials = 60;
+        private const int IndexLookups = 500;
+        // The capture the index is benchmarked on (a megabyte of random samples on eight channels), and the
+        // lookups timed.
+        private const int IndexSamples = 1 << 20;
+        private const int IndexLookupsTimed = 100000;
+        private const int ListLookupsTimed = 50;
+        // The random captures built a block at a time, and the capture that is benchmarked.
+        private const int ChunkTrials = 300;
+        private const int ChunkSamples = 16 << 20;
+
+        private static int[] pins = new int[] { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+        private byte[] sparse;
+        private byte[] dense;
+        private List<TimelineEvent> events;
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the name the suite is picked by on the command line.
+        /// </summary>
+        public override string Name
+        {
+            get
+            {
+                return "plot";
+            }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Run the checks.
+        /// </summary>
+        public override void Check()
+        {
+            makeCaptures();
+
+            checkTransitions("sparse", sparse, null);
+            checkTransitions("sparse, with gaps and rate changes", sparse, events);
+            checkTransitions("dense", dense, null);
+            checkTransitions("dense, with gaps and rate changes", dense, events);
+
+            checkIndexes();
+            checkChunked();
+        }
+
+        /// <summary>
+        /// Run the benchmarks.
+        /// </summary>
+        public override void Bench()
+        {
+            makeCaptures();
+
+            Console.WriteLine("transitions-only capture            edges   expanded: ms      MB   records: ms      MB");
+            benchTransitions("sparse", sparse, null);
+            benchTransitions("sparse, with gaps and rate changes", sparse, events);
+            benchTransitions("dense", dense, null);
+            benchTransitions("dense, with gaps and rate changes", dense, events);
+            Console.WriteLine();
+            benchIndex();
+            Console.WriteLine();
+            benchChunked();
+        }
+
+        /// <summary>
+        /// Make the captures to plot.
+        /// </summary>
+        private void makeCaptures()
+        {
+            if (sparse != null)
+                return;
+
+            // About a hundred records, and one every few ticks.
+            sparse = makeRecords(new Random(3), SparseSpacing, Ticks);
+            dense = makeRecords(new Random(4), DenseSpacing, Ticks);
+
+            // Two gaps, and the rate halved for a while in between.
+            events = new List<TimelineEvent>();
+            events.Add(new TimelineEvent(TimelineEvent.Kinds.Gap, 250000, 5000));
+            events.Add(new TimelineEvent(TimelineEvent.Kinds.RateChange, 400000, 2));
+            events.Add(new TimelineEvent(TimelineEvent.Kinds.RateChange, 600001, 1));
+            events.Add(new TimelineEvent(TimelineEvent.Kinds.Gap, 800003, 300));
+        }
+
+        /// <summary>
+        /// Make the transition records of a capture, as the firmware sends them: the first record
+        /// sets the starting value, the others each change a few channels, and the last one (with an empty
+        /// change mask) extends the last value to the end.
+        /// </summary>
+        /// <param name="Random">The source of the edges</param>
+        /// <param name="Spacing">The mean number of ticks between records</param>
+        /// <param name="Length">The length of the capture in ticks</param>
+        /// <returns>The records</returns>
+        private static byte[] makeRecords(Random Random, int Spacing, long Length)
+        {
+            MemoryStream records = new MemoryStream();
+            long tick = 0;
+
+            writeRecord(records, 0, (byte)Random.Next(256));
+            while (true)
+            {
+                long delta = 1 + Random.Next(2 * Spacing - 1);
+
+                if (tick + delta >= Length)
+                    break;
+                writeRecord(records, delta, (byte)(1 << Random.Next(8) | 1 << Random.Next(8)));
+                tick += delta;
+            }
+            writeRecord(records, Length - tick, 0);
+            return records.ToArray();
+        }
+
+        /// <summary>
+        /// Write a transition record.
+        /// </summary>
+        /// <param name="Records">Where to write it</param>
+        /// <param name="Delta">The number of ticks since the previous record</param>
+        /// <param name="Mask">The channels that change</param>
+        private static void writeRecord(Stream Records, long Delta, byte Mask)
+        {
+            for (long n = Delta; ; n >>= 7)
+            {
+                Records.WriteByte((byte)((int)(n & 0x7f) | (n >= 0x80 ? 0x80 : 0)));
+                if (n < 0x80)
+                    break;
+            }
+            Records.WriteByte(Mask);
+        }
+
+        /// <summary>
+        /// Plot a capture the way the host used to: expand the records into a sample per tick, then find the
+        /// edges again.
+        /// </summary>
+        /// <param name="Records">The transition records</param>
+        /// <param name="Events">The gaps and rate changes (may be null)</param>
+        /// <returns>The plot</returns>
+        private static SamplePlot plotExpanded(byte[] Records, IList<TimelineEvent> Events)
+        {
+            DeltaTimestampFilter filter = new DeltaTimestampFilter();
+            byte[] samples;
+
+            filter.Write(Records, 0, Records.Length);
+            samples = new byte[filter.DataLength];
+            filter.Read(samples, 0, samples.Length);
+            return new SamplePlot(samples, pins, false, Events);
+        }
+
+        /// <summary>
+        /// Plot a capture from its records.
+        /// </summary>
+        /// <param name="Records">The transition records</param>
+        /// <param name="Events">The gaps and rate changes (may be null)</param>
+        /// <returns>The plot</returns>
+        private static SamplePlot plotRecords(byte[] Records, IList<TimelineEvent> Events)
+        {
+            ArraySegment<byte>[] segments = new ArraySegment<byte>[] { new ArraySegment<byte>(Records) };
+
+            return SamplePlot.FromTransitions(segments, pins, Events);
+        }
+
+        /// <summary>
+        /// Check that plotting a capture from its records gives the same signals as expanding it.
+        /// </summary>
+        /// <param name="Name">What the capture is</param>
+        /// <param name="Records">The transition records</param>
+        /// <param name="Events">The gaps and rate changes (may be null)</param>
+        private void checkTransitions(string Name, byte[] Records, IList<TimelineEvent> Events)
+        {
+            SamplePlot expected = plotExpanded(Records, Events);
+            SamplePlot plot = plotRecords(Records, Events);
+            string difference = FirstDifference(expected, plot);
+
+            Report(difference == null, "{0}: {1} edges plotted from the records as when expanded{2}", Name, countEdges(plot),
+                difference == null ? "" : ", but the " + difference + " differ");
+        }
+
+        /// <summary>
+        /// Time plotting a capture both ways, and count the memory each allocates.
+        /// </summary>
+        /// <param name="Name">What the capture is</param>
+        /// <param name="Records">The transition records</param>
+        /// <param name="Events">The gaps and rate changes (may be null)</param>
+        private void benchTransitions(string Name, byte[] Records, IList<TimelineEvent> Events)
+        {
+            double expanded = Time(delegate { plotExpanded(Records, Events); });
+            double records = Time(delegate { plotRecords(Records, Events); });
+            long expandedBytes = allocated(delegate { plotExpanded(Records, Events); });
+            long recordBytes = allocated(delegate { plotRecords(Records, Events); });
+
+            Console.WriteLine("{0,-34} {1,7} {2,13:F2} {3,7:F2} {4,13:F2} {5,7:F2}", Name, countEdges(plotRecords(Records, Events)),
+                expanded * 1e3, expandedBytes / 1e6, records * 1e3, recordBytes / 1e6);
+        }
+
+        /// <summary>
+        /// Check the transition indexes of random captures against the old lists of runs: 1 to 8 channels, stacked
+        /// and not, with and without gaps and rate changes. The runs read back from the indexes must be the same
+        /// (with adjacent runs in the same state merged, which the lists did not always do), and so must the state
+        /// at random ticks and the number of edges before them.
+        /// </summary>
+        private void checkIndexes()
+        {
+            Random random = new Random(5);
+            int lookups = 0;
+
+            for (int trial = 0; trial < IndexTrials; trial++)
+            {
+                int channels = 1 + random.Next(8);
+                bool stacked = random.Next(2) == 0;
+                byte[] samples = MakeSamples(random, 1 + random.Next(20000), 1 + random.Next(16));
+                List<TimelineEvent> captureEvents = new List<TimelineEvent>();
+                string problem;
+
+                if (random.Next(2) == 0)
+                {
+                    for (int i = random.Next(6); i > 0; i--)
+                    {
+                        long position = random.Next(samples.Length * (stacked ? 8 / channels : 1) + 100);
+
+                        if (random.Next(2) == 0)
+                            captureEvents.Add(new TimelineEvent(TimelineEvent.Kinds.Gap, position, random.Next(500)));
+                        else
+                            captureEvents.Add(new TimelineEvent(TimelineEvent.Kinds.RateChange, position, 1 + random.Next(4)));
+                    }
+                }
+
+                SamplePlot plot = new SamplePlot(samples, channels, stacked, captureEvents);
+                OldSamplePlot old = new OldSamplePlot(samples, channels, stacked, captureEvents);
+
+                problem = compareIndexes(plot, old, random);
+                if (problem != null)
+                {
+                    Report(false, "transition index of random capture {0} ({1} channels, {2}stacked, {3} events): {4}",
+                        trial, channels, stacked ? "" : "not ", captureEvents.Count, problem);
+                    return;
+                }
+                lookups += channels * IndexLookups;
+            }
+            Report(true, "transition indexes of {0} random captures hold the runs of the old lists, and agree on {1} lookups",
+                IndexTrials, lookups);
+        }
+
+        /// <summary>
+        /// Make random samples, in runs.
+        /// </summary>
+        /// <param name="Random">The source of the samples</param>
+        /// <param name="Length">The number of bytes</param>
+        /// <param name="MeanRun">The mean length of a run of the same byte</param>
+        /// <returns>The samples</returns>
+        public static byte[] MakeSamples(Random Random, int Length, int MeanRun)
+        {
+            byte[] samples = new byte[Length];
+            byte value = 0;
+
+            for (int i = 0; i < Length; i++)
+            {
+                if (Random.Next(MeanRun) == 0)
+                    value = (byte)Random.Next(256);
+                samples[i] = value;
+            }
+            return samples;
+        }
+
+        /// <summary>
+        /// Compare the transition indexes of a plot with the old lists of runs.
+        /// </summary>
+        /// <param name="Plot">The plot</param>
+        /// <param name="Old">The old plot of the same capture</param>
+        /// <param name="Random">The source of the ticks to look up</param>
+        /// <returns>What differs (null if nothing does)</returns>
+        private static string compareIndexes(SamplePlot Plot, OldSamplePlot Old, Random Random)
+        {
+            for (int c = 0; c < Plot.Channels; c++)
+            {
+                TransitionIndex index = Plot.Transitions[c];
+                List<SampleSignal> runs = readRuns(Plot, c);
+                List<SampleSignal> oldRuns = mergeRuns(Old.SampleSignals[c]);
+                long[] ticks = new long[IndexLookups];
+                int from = 0;
+
+                if (runs.Count != oldRuns.Count)
+                    return String.Format("channel {0} has {1} runs, not {2}", c, runs.Count, oldRuns.Count);
+                for (int i = 0; i < runs.Count; i++)
+                {
+                    if (runs[i].SampleState != oldRuns[i].SampleState || runs[i].Duration != oldRuns[i].Duration)
+                        return String.Format("run {0} of channel {1} differs", i, c);
+                }
+
+                for (int i = 0; i < ticks.Length; i++)
+                    ticks[i] = (long)(Random.NextDouble() * Plot.Length);
+                Array.Sort(ticks);
+
+                foreach (long tick in ticks)
+                {
+                    int edges = 0;
+
+                    while (edges < index.EdgeCount && index[edges] <= tick)
+                        edges++;
+                    if (index.FindEdge(tick) != edges)
+                        return String.Format("channel {0} finds {1} edges before tick {2}, not {3}", c, index.FindEdge(tick), tick, edges);
+                    from = index.FindEdge(tick, from);
+                    if (from != edges)
+                        return String.Format("channel {0} finds {1} edges before tick {2} searching forward, not {3}", c, from, tick, edges);
+                    if (stateAt(Plot, c, tick) != Old.StateAt(c, tick))
+                        return String.Format("channel {0} is {1} at tick {2}, not {3}", c, stateAt(Plot, c, tick), tick, Old.StateAt(c, tick));
+                }
+            }
+            return null;
+        }
+
+        /// <summary>
+        /// Get the state of a channel at a tick, as the display shows it.
+        /// </summary>
+        /// <param name="Plot">The plot</param>
+        /// <param name="Channel">The channel</param>
+        /// <param name="Tick">The tick</param>
+        /// <returns>High, Low or Unknown</returns>
+        private static SampleSignal.State stateAt(SamplePlot Plot, int Channel, long Tick)
+        {
+            if (Plot.Unknown.StateAt(Tick) == SampleSignal.State.High)
+                return SampleSignal.State.Unknown;
+            return Plot.Transitions[Channel].StateAt(Tick);
+        }
+
+        /// <summary>
+        /// Read the runs of a channel back from a plot's transition indexes.
+        /// </summary>
+        /// <param name="Plot">The plot</param>
+        /// <param name="Channel">The channel</param>
+        /// <returns>The runs, with adjacent runs in the same state merged</returns>
+        private static List<SampleSignal> readRuns(SamplePlot Plot, int Channel)
+        {
+            List<SampleSignal> runs = new List<SampleSignal>();
+            TransitionIndex index = Plot.Transitions[Channel];
+            int edge = 0, unknownEdge = 0;
+            long tick = 0;
+
+            while (tick < Plot.Length)
+            {
+                long next = Plot.Length;
+
+                if (edge < index.EdgeCount)
+                    next = Math.Min(next, index[edge]);
+                if (unknownEdge < Plot.Unknown.EdgeCount)
+                    next = Math.Min(next, Plot.Unknown[unknownEdge]);
+
+                addRun(runs, stateAt(Plot, Channel, tick), next - tick);
+                tick = next;
+                while (edge < index.EdgeCount && index[edge] <= tick)
+                    edge++;
+                while (unknownEdge < Plot.Unknown.EdgeCount && Plot.Unknown[unknownEdge] <= tick)
+                    unknownEdge++;
+            }
+            return runs;
+        }
+
+        /// <summary>
+        /// Merge adjacent runs in the same state.
+        /// </summary>
+        /// <param name="Runs">The runs</param>
+        /// <returns>The merged runs</returns>
+        private static List<SampleSignal> mergeRuns(List<SampleSignal> Runs)
+        {
+            List<SampleSignal> merged = new List<SampleSignal>();
+
+            foreach (SampleSignal ss in Runs)
+                addRun(merged, ss.SampleState, ss.Duration);
+            return merged;
+        }
+
+        /// <summary>
+        /// Add a run to a list, merging it with the last one if it is in the same state.
+        /// </summary>
+        /// <param name="Runs">The list</param>
+        /// <param name="State">The state of the run</param>
+        /// <param name="Duration">The length of the run</param>
+        private static void addRun(List<SampleSignal> Runs, SampleSignal.State State, long Duration)
+        {
+            if (Duration <= 0)
+                return;
+            if (Runs.Count > 0 && Runs[Runs.Count - 1].SampleState == State)
+                Runs[Runs.Count - 1].Duration += (int)Duration;
+            else
+                Runs.Add(new SampleSignal(State, (int)Duration));
+        }
+
+        /// <summary>
+        /// Time building the transition indexes of a capture and looking them up, against the old lists of runs,
+        /// and count the memory each allocates and keeps.
+        /// </summary>
+        private void benchIndex()
+        {
+            byte[] samples = MakeSamples(new Random(6), IndexSamples, 1);
+            SamplePlot plot = null;
+            OldSamplePlot old = null;
+            long[] ticks = new long[IndexLookupsTimed];
+            Random random = new Random(7);
+            double transitions;
+
+            plot = new SamplePlot(samples, 8, false, null);
+            transitions = countEdges(plot) / 1e6;
+            for (int i = 0; i < ticks.Length; i++)
+                ticks[i] = (long)(random.NextDouble() * plot.Length);
+
+            Console.WriteLine("{0} samples, {1:F2} M transitions  build: ms/M  alloc MB/M  live MB/M   lookup: ns", samples.Length,
+                transitions);
+
+            double listBuild = Time(delegate { old = new OldSamplePlot(samples, 8, false, null); });
+            long listAllocated = allocated(delegate { old = new OldSamplePlot(samples, 8, false, null); });
+            old = null;
+            long listLive = live(delegate { old = new OldSamplePlot(samples, 8, false, null); });
+            double listLookup = Time(delegate
+            {
+                for (int i = 0; i < ListLookupsTimed; i++)
+                    old.StateAt(i & 7, ticks[i]);
+            }) / ListLookupsTimed;
+            Console.WriteLine("{0,-36} {1,11:F1} {2,11:F2} {3,10:F2} {4,13:F0}", "lists of runs", listBuild * 1e3 / transitions,
+                listAllocated / 1e6 / transitions, listLive / 1e6 / transitions, listLookup * 1e9);
+            old = null;
+
+            double indexBuild = Time(delegate { plot = new SamplePlot(samples, 8, false, null); });
+            long indexAllocated = allocated(delegate { plot = new SamplePlot(samples, 8, false, null); });
+            plot = null;
+            long indexLive = live(delegate { plot = new SamplePlot(samples, 8, false, null); });
+            double indexLookup = Time(delegate
+            {
+                for (int i = 0; i < IndexLookupsTimed; i++)
+                    plot.Transitions[i & 7].StateAt(ticks[i]);
+            }) / IndexLookupsTimed;
+            Console.WriteLine("{0,-36} {1,11:F1} {2,11:F2} {3,10:F2} {4,13:F0}", "transition index", indexBuild * 1e3 / transitions,
+                indexAllocated / 1e6 / transitions, indexLive / 1e6 / transitions, indexLookup * 1e9);
+
+            // Walking forward through the capture, as the display does from one window to the next.
+            Array.Sort(ticks);
+            double forward = Time(delegate
+            {
+                int from = 0;
+
+                for (int i = 0; i < IndexLookupsTimed; i++)
+                    from = plot.Transitions[0].FindEdge(ticks[i], from);
+            }) / IndexLookupsTimed;
+            Console.WriteLine("{0,-36} {1,11} {2,11} {3,10} {4,13:F0}", "transition index, searching forward", "", "", "",
+                forward * 1e9);
+        }
+
+        /// <summary>
+        /// Check that random captures built a block at a time are the same as when built in one go: stacked samples
+        /// on 1 to 8 channels, and transition records, with and without gaps and rate changes. The blocks are of
+        /// random sizes, and each event is added some time before the samples reach it (as the frame filter passes
+        /// them on). After each block, the state at a random tick before the plot's Length must already be the
+        /// final one. An event added after the samples past it must be flagged (EventsLate).
+        /// </summary>
+        private void checkChunked()
+        {
+            Random random = new Random(13);
+            int blocks = 0, withEvents = 0;
+
+            for (int trial = 0; trial < ChunkTrials; trial++)
+            {
+                bool records = random.Next(2) == 0;
+                int channels = records ? 8 : 1 + random.Next(8);
+                int[] capturePins = new int[channels];
+                byte[] data;
+                long length;
+                List<TimelineEvent> captureEvents = new List<TimelineEvent>();
+                SamplePlot batch, plot;
+                string problem = null;
+
+                for (int c = 0; c < channels; c++)
+                    capturePins[c] = c;
+                if (records)
+                {
+                    length = 1 + random.Next(100000);
+                    data = makeRecords(random, 1 + random.Next(200), length);
+                }
+                else
+                {
+                    data = MakeSamples(random, 1 + random.Next(20000), 1 + random.Next(16));
+                    length = data.Length * 8L / channels;
+                }
+
+                if (random.Next(2) == 0)
+                {
+                    for (int i = random.Next(6); i > 0; i--)
+                    {
+                        long position = (long)(random.NextDouble() * length);
+
+                        if (random.Next(2) == 0)
+                            captureEvents.Add(new TimelineEvent(TimelineEvent.Kinds.Gap, position, random.Next(500)));
+                        else
+                            captureEvents.Add(new TimelineEvent(TimelineEvent.Kinds.RateChange, position, 1 + random.Next(4)));
+                    }
+                    captureEvents.Sort(TimelineEvent.ComparePositions);
+                    withEvents++;
+                }
+
+                if (records)
+                    batch = SamplePlot.FromTransitions(new ArraySegment<byte>[] { new ArraySegment<byte>(data) }, capturePins, captureEvents);
+                else
+                    batch = new SamplePlot(data, capturePins, true, captureEvents);
+
+                plot = SamplePlot.Begin(capturePins, records);
+                for (int offset = 0, next = 0; offset < data.Length && problem == null; blocks++)
+                {
+                    int count = Math.Min(1 + random.Next(random.Next(2) == 0 ? 16 : 4096), data.Length - offset);
+                    // No block reaches further than this (with every sample decimated the most, and every gap in it).
+                    long reach = plot.Length + count * (records ? 400L : 32L) + 2500;
+
+                    while (next < captureEvents.Count && captureEvents[next].Position < reach)
+                        plot.AddEvent(captureEvents[next++]);
+                    plot.Append(data, offset, count);
+                    offset += count;
+
+                    if (plot.Length > 0)
+                    {
+                        long tick = (long)(random.NextDouble() * plot.Length);
+
+                        for (int c = 0; c < channels && problem == null; c++)
+                        {
+                            if (stateAt(plot, c, tick) != stateAt(batch, c, tick))
+                                problem = String.Format("channel {0} at tick {1} isn't final before the Length ({2})", c, tick, plot.Length);
+                        }
+                    }
+                    if (offset == data.Length)
+                    {
+                        while (next < captureEvents.Count)
+                            plot.AddEvent(captureEvents[next++]);
+                    }
+                }
+                plot.Finish();
+
+                if (problem == null && plot.EventsLate)
+                    problem = "an event was taken as late";
+                if (problem == null && FirstDifference(batch, plot) != null)
+                    problem = "the " + FirstDifference(batch, plot) + " differ";
+                if (problem == null)
+                {
+                    // An event added after the samples past it.
+                    plot.AddEvent(new TimelineEvent(TimelineEvent.Kinds.Gap, plot.Length / 2, 1));
+                    if (plot.Length > 1 && !plot.EventsLate)
+                        problem = "an event added late wasn't flagged";
+                }
+
+                if (problem != null)
+                {
+                    Report(false, "random capture {0} ({1}, {2} channels, {3} events) built a block at a time: {4}", trial,
+                        records ? "transition records" : "stacked samples", channels, captureEvents.Count, problem);
+                    return;
+                }
+            }
+            Report(true, "{0} random captures ({1} with events) built in {2} blocks are the same as when built in one go",
+                ChunkTrials, withEvents, blocks);
+        }
+
+        /// <summary>
+        /// Time building a plot a block at a time, against building it in one go.
+        /// </summary>
+        private void benchChunked()
+        {
+            byte[] samples = MakeSamples(new Random(14), ChunkSamples, 16);
+            int[] capturePins = new int[] { 0, 1, 2, 3 };
+            double mb = samples.Length / 1e6;
+
+            Console.WriteLine("{0:F1} MB of stacked samples, 4 channels ms    MB/s", mb);
+            double batch = Time(delegate { new SamplePlot(samples, capturePins, true, null); });
+            Console.WriteLine("{0,-36} {1,5:F0} {2,7:F1}", "in one go", batch * 1e3, mb / batch);
+            foreach (int block in new int[] { 64, 512, 4096 })
+            {
+                double chunked = Time(delegate
+                {
+                    SamplePlot plot = SamplePlot.Begin(capturePins, false);
+
+                    for (int offset = 0; offset < samples.Length; offset += block)
+                        plot.Append(samples, offset, Math.Min(block, samples.Length - offset));
+                    plot.Finish();
+                });
+                Console.WriteLine("{0,-36} {1,5:F0} {2,7:F1}", String.Format("in blocks of {0}", block), chunked * 1e3, mb / chunked);
+            }
+        }
+
+        /// <summary>
+        /// Count the memory a piece of work keeps (what is still reachable once it is done).
+        /// </summary>
+        /// <param name="Work">The work</param>
+        /// <returns>The number of bytes kept</returns>
+        private static long live(Work Work)
+        {
+            long before = GC.GetTotalMemory(true);
+
+            Work();
+            return GC.GetTotalMemory(true) - before;
+        }
+
+        /// <summary>
+        /// Count the memory a piece of work allocates.
+        /// </summary>
+        /// <param name="Work">The work</param>
+        /// <returns>The number of bytes allocated</returns>
+        private static long allocated(Work Work)
+        {
+            long before = GC.GetAllocatedBytesForCurrentThread();
+
+            Work();
+            return GC.GetAllocatedBytesForCurrentThread() - before;
+        }
+
+        /// <summary>
+        /// Count the edges of a plot, on all its channels.
+        /// </summary>
+        /// <param name="Plot">The plot</param>
+        /// <returns>The number of edges</returns>
+        private static int countEdges(SamplePlot Plot)
+        {
+            int edges = 0;
+
+            foreach (TransitionIndex index in Plot.Transitions)
+                edges += index.EdgeCount;
+            return edges;
+        }
+
+        /// <summary>
+        /// Compare two plots.
+        /// </summary>
+        /// <param name="A">One plot</param>
+        /// <param name="B">The other</param>
+        /// <returns>What differs first (null if nothing does)</returns>
+        public static string FirstDifference(SamplePlot A, SamplePlot B)
+        {
+            if (A.Length != B.Length)
+                return "lengths";
+            if (A.Channels != B.Channels)
+                return "channels";
+            for (int c = 0; c < A.Channels; c++)
+            {
+                if (!SameIndex(A.Transitions[c], B.Transitions[c]))
+                    return String.Format("edges of channel {0}", c);
+            }
+            if (!SameIndex(A.Unknown, B.Unknown))
+                return "unknown samples";
+            if (A.RateChanges.Count != B.RateChanges.Count)
+                return "rate changes";
+            for (int i = 0; i < A.RateChanges.Count; i++)
+            {
+                if (A.RateChanges[i].Position != B.RateChanges[i].Position || A.RateChanges[i].Value != B.RateChanges[i].Value)
+                    return "rate changes";
+            }
+            return null;
+        }
+
+        /// <summary>
+        /// Compare two transition indexes.
+        /// </summary>
+        /// <param name="A">One index</param>
+        /// <param name="B">The other</param>
+        /// <returns>'true' if they hold the same transitions</returns>
+        public static bool SameIndex(TransitionIndex A, TransitionIndex B)
+        {
+            if (A.InitialState != B.InitialState || A.EdgeCount != B.EdgeCount)
+                return false;
+            for (int i = 0; i < A.EdgeCount; i++)
+            {
+                if (A[i] != B[i])
+                    return false;
+            }
+            return true;
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,84 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// Headless checks and benchmarks of the host code. Run them from the CSharp directory with
+    ///
+    ///   dotnet run -c Release --project Tests -- [check|bench] [suite ...]
+    ///
+    /// "check" (the default) runs the checks of the suites named (all of them if none are), printing a
+    /// line starting with "ok" or "FAIL" for each; the exit status is the number that failed. "bench"
+    /// runs the benchmarks, printing a table for each.
+    /// </summary>
+    public static class Program
+    {
+        private static TestSuite[] suites = new TestSuite[]
+        {
+            new CompressionTests(),
+            new FrameTests(),
+            new FilterTests(),
+            new SerialTests(),
+            new PlotTests(),
+            new WaveformTests(),
+        };
+
+        /// <summary>
+        /// Program entry point.
+        /// </summary>
+        /// <param name="args">check or bench, then the names of the suites to run</param>
+        /// <returns>The number of checks that failed</returns>
+        public static int Main(string[] args)
+        {
+            bool bench = false;
+            List<string> names = new List<string>();
+
+            foreach (string arg in args)
+            {
+                if (arg == "bench")
+                    bench = true;
+                else if (arg != "check")
+                    names.Add(arg.ToLowerInvariant());
+            }
+
+            foreach (TestSuite suite in suites)
+            {
+                if (names.Count > 0 && !names.Contains(suite.Name))
+                    continue;
+
+                if (bench)
+                {
+                    Console.WriteLine("{0}:", suite.Name);
+                    suite.Bench();
+                    Console.WriteLine();
+                }
+                else
+                    suite.Check();
+            }
+
+            if (!bench)
+                Console.WriteLine("{0} check{1} failed", TestSuite.Failures, TestSuite.Failures == 1 ? "" : "s");
+            return TestSuite.Failures;
+        }
+    }
+}
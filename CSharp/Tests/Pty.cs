@@ -0,0 +1,213 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// Linux pseudo-terminals, through libc. A pty pair stands in for a serial port and the device on the other
+    /// end of it: the test writes what the device would send to the master side, and the controller reads it from
+    /// the slave side (see SerialPort.cs).
+    /// </summary>
+    public static class Pty
+    {
+        private const int O_RDWR = 0x2;
+        private const int O_NOCTTY = 0x100;
+        private const short POLLIN = 0x1;
+        private const short POLLOUT = 0x4;
+        private const int FIONREAD = 0x541b;
+        private const int EINTR = 4;
+        private const int EAGAIN = 11;
+
+        [StructLayout(LayoutKind.Sequential)]
+        private struct PollFd
+        {
+            public int Fd;
+            public short Events;
+            public short Revents;
+        }
+
+        [DllImport("libc", SetLastError = true)]
+        private static extern int posix_openpt(int flags);
+        [DllImport("libc", SetLastError = true)]
+        private static extern int grantpt(int fd);
+        [DllImport("libc", SetLastError = true)]
+        private static extern int unlockpt(int fd);
+        [DllImport("libc")]
+        private static extern IntPtr ptsname(int fd);
+        [DllImport("libc", SetLastError = true)]
+        private static extern int open(string path, int flags);
+        [DllImport("libc", SetLastError = true)]
+        private static extern int close(int fd);
+        [DllImport("libc", SetLastError = true)]
+        private static extern IntPtr read(int fd, ref byte buffer, IntPtr count);
+        [DllImport("libc", SetLastError = true)]
+        private static extern IntPtr write(int fd, ref byte buffer, IntPtr count);
+        [DllImport("libc", SetLastError = true)]
+        private static extern int poll(ref PollFd fds, uint count, int timeout);
+        [DllImport("libc", SetLastError = true)]
+        private static extern int ioctl(int fd, int request, out int value);
+        [DllImport("libc", SetLastError = true)]
+        private static extern int tcgetattr(int fd, byte[] termios);
+        [DllImport("libc")]
+        private static extern void cfmakeraw(byte[] termios);
+        [DllImport("libc", SetLastError = true)]
+        private static extern int tcsetattr(int fd, int when, byte[] termios);
+
+        #region Methods
+
+        /// <summary>
+        /// Open a new pty pair.
+        /// </summary>
+        /// <param name="SlavePath">Gets the path of the slave side (the "serial port")</param>
+        /// <returns>The master side</returns>
+        public static int OpenPair(out string SlavePath)
+        {
+            int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+            if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+                throw new IOException("Can't open a pty (error " + Marshal.GetLastWin32Error() + ")");
+            SlavePath = Marshal.PtrToStringAnsi(ptsname(master));
+            return master;
+        }
+
+        /// <summary>
+        /// Open the slave side of a pty, in raw mode (no echo, no line editing, no flow control characters).
+        /// </summary>
+        /// <param name="Path">The path of the slave side</param>
+        /// <returns>The slave side</returns>
+        public static int OpenSlave(string Path)
+        {
+            byte[] termios = new byte[256];
+            int fd = open(Path, O_RDWR | O_NOCTTY);
+
+            if (fd < 0)
+                throw new IOException("Can't open " + Path + " (error " + Marshal.GetLastWin32Error() + ")");
+            if (tcgetattr(fd, termios) == 0)
+            {
+                cfmakeraw(termios);
+                tcsetattr(fd, 0, termios);
+            }
+            return fd;
+        }
+
+        /// <summary>
+        /// Close a side of a pty.
+        /// </summary>
+        /// <param name="Fd">The side to close</param>
+        public static void Close(int Fd)
+        {
+            close(Fd);
+        }
+
+        /// <summary>
+        /// Wait for something to read.
+        /// </summary>
+        /// <param name="Fd">The side to read</param>
+        /// <param name="Timeout">How long to wait, in milliseconds</param>
+        /// <returns>'true' if there is something to read (or the other side has gone)</returns>
+        public static bool WaitReadable(int Fd, int Timeout)
+        {
+            PollFd fds = new PollFd();
+
+            fds.Fd = Fd;
+            fds.Events = POLLIN;
+            return poll(ref fds, 1, Timeout) > 0;
+        }
+
+        /// <summary>
+        /// Read whatever has arrived, waiting for something to arrive first.
+        /// </summary>
+        /// <param name="Fd">The side to read</param>
+        /// <param name="Buffer">An array for the data</param>
+        /// <param name="Offset">Where to put the data in the array</param>
+        /// <param name="Count">The most to read</param>
+        /// <param name="Timeout">How long to wait, in milliseconds</param>
+        /// <returns>The number of bytes read, zero if nothing arrived in time</returns>
+        public static int Read(int Fd, byte[] Buffer, int Offset, int Count, int Timeout)
+        {
+            long count;
+
+            if (Count == 0 || !WaitReadable(Fd, Timeout))
+                return 0;
+
+            count = (long)read(Fd, ref Buffer[Offset], (IntPtr)Count);
+            if (count < 0)
+            {
+                int error = Marshal.GetLastWin32Error();
+
+                if (error == EINTR || error == EAGAIN)
+                    return 0;
+                throw new IOException("Read failed (error " + error + ")");
+            }
+            return (int)count;
+        }
+
+        /// <summary>
+        /// Write all of a block, waiting for room as needed.
+        /// </summary>
+        /// <param name="Fd">The side to write</param>
+        /// <param name="Buffer">An array holding the block</param>
+        /// <param name="Offset">The offset of the block in the array</param>
+        /// <param name="Count">The length of the block</param>
+        public static void Write(int Fd, byte[] Buffer, int Offset, int Count)
+        {
+            PollFd fds = new PollFd();
+
+            fds.Fd = Fd;
+            fds.Events = POLLOUT;
+            while (Count > 0)
+            {
+                long count;
+
+                poll(ref fds, 1, 100);
+                count = (long)write(Fd, ref Buffer[Offset], (IntPtr)Count);
+                if (count < 0)
+                {
+                    int error = Marshal.GetLastWin32Error();
+
+                    if (error == EINTR || error == EAGAIN)
+                        continue;
+                    throw new IOException("Write failed (error " + error + ")");
+                }
+                Offset += (int)count;
+                Count -= (int)count;
+            }
+        }
+
+        /// <summary>
+        /// Gets the number of bytes waiting to be read.
+        /// </summary>
+        /// <param name="Fd">The side to read</param>
+        /// <returns>The number of bytes</returns>
+        public static int Available(int Fd)
+        {
+            int count;
+
+            return ioctl(Fd, FIONREAD, out count) == 0 ? count : 0;
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,267 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using System.Threading;
+using LogicAnalyzer.Tests;
+
+namespace System.IO.Ports
+{
+    // The .NET SDK has no System.IO.Ports without a NuGet package, so the tests build SerialController against this
+    // stand-in for the parts of SerialPort it uses. The port name is the path of the slave side of a pty (see Pty),
+    // opened in raw mode; the line settings are ignored. As with the real SerialPort, reads honour ReadTimeout, a
+    // read waiting when the port is closed fails, and DataReceived is raised on a thread of the port's own.
+
+    public enum Parity { None, Odd, Even, Mark, Space }
+    public enum StopBits { None, One, Two, OnePointFive }
+    public enum SerialData { Chars, Eof }
+    public enum SerialError { TXFull, RXOver, Overrun, RXParity, Frame }
+
+    public class SerialDataReceivedEventArgs : EventArgs
+    {
+        public SerialDataReceivedEventArgs(SerialData EventType)
+        {
+            this.EventType = EventType;
+        }
+
+        public SerialData EventType { get; private set; }
+    }
+
+    public class SerialErrorReceivedEventArgs : EventArgs
+    {
+        public SerialErrorReceivedEventArgs(SerialError EventType)
+        {
+            this.EventType = EventType;
+        }
+
+        public SerialError EventType { get; private set; }
+    }
+
+    public delegate void SerialDataReceivedEventHandler(object sender, SerialDataReceivedEventArgs e);
+    public delegate void SerialErrorReceivedEventHandler(object sender, SerialErrorReceivedEventArgs e);
+
+    /// <summary>
+    /// A serial port on a pty.
+    /// </summary>
+    public class SerialPort : IDisposable
+    {
+        // How long a wait for data goes before it checks whether the port has been closed.
+        private const int PollSlice = 20;
+
+        private int fd = -1;
+        private object fdLock = new object();
+        private volatile bool open;
+        private PortStream stream;
+        private Thread eventThread;
+
+        public SerialPort(string PortName, int BaudRate, Parity Parity, int DataBits, StopBits StopBits)
+        {
+            this.PortName = PortName;
+            this.ReadTimeout = -1;
+            this.ReadBufferSize = 4096;
+        }
+
+        public string PortName { get; private set; }
+        public int ReadTimeout { get; set; }
+        public int ReadBufferSize { get; set; }
+
+        public bool IsOpen
+        {
+            get
+            {
+                return open;
+            }
+        }
+
+        public Stream BaseStream
+        {
+            get
+            {
+                if (!open)
+                    throw new InvalidOperationException("The port is closed.");
+                return stream;
+            }
+        }
+
+        public int BytesToRead
+        {
+            get
+            {
+                lock (fdLock)
+                {
+                    return open ? Pty.Available(fd) : 0;
+                }
+            }
+        }
+
+        public event SerialDataReceivedEventHandler DataReceived;
+#pragma warning disable 67      // A pty has no line errors to report
+        public event SerialErrorReceivedEventHandler ErrorReceived;
+#pragma warning restore 67
+
+        public void Open()
+        {
+            if (open)
+                throw new InvalidOperationException("The port is already open.");
+
+            fd = Pty.OpenSlave(PortName);
+            stream = new PortStream(this);
+            open = true;
+
+            if (DataReceived != null)
+            {
+                eventThread = new Thread(EventLoop);
+                eventThread.IsBackground = true;
+                eventThread.Start();
+            }
+        }
+
+        public void Close()
+        {
+            if (!open)
+                return;
+
+            // Reads wait in slices, so the descriptor is only closed between them (and its number can't be
+            // reused under a read that is still going).
+            open = false;
+            lock (fdLock)
+            {
+                Pty.Close(fd);
+                fd = -1;
+            }
+
+            if (eventThread != null && eventThread != Thread.CurrentThread)
+                eventThread.Join();
+            eventThread = null;
+        }
+
+        public int Read(byte[] Buffer, int Offset, int Count)
+        {
+            return BaseStream.Read(Buffer, Offset, Count);
+        }
+
+        public void Write(byte[] Buffer, int Offset, int Count)
+        {
+            lock (fdLock)
+            {
+                if (!open)
+                    throw new InvalidOperationException("The port is closed.");
+                Pty.Write(fd, Buffer, Offset, Count);
+            }
+        }
+
+        public void Dispose()
+        {
+            Close();
+        }
+
+        /// <summary>
+        /// Read what has arrived, waiting up to ReadTimeout for something to arrive.
+        /// </summary>
+        private int ReadPort(byte[] Buffer, int Offset, int Count)
+        {
+            int waited = 0;
+
+            while (true)
+            {
+                int count;
+
+                lock (fdLock)
+                {
+                    if (!open)
+                        throw new IOException("The port is closed.");
+                    count = Pty.Read(fd, Buffer, Offset, Count, PollSlice);
+                }
+                if (count > 0)
+                    return count;
+
+                waited += PollSlice;
+                if (ReadTimeout >= 0 && waited >= ReadTimeout)
+                    throw new TimeoutException("The read timed out.");
+            }
+        }
+
+        /// <summary>
+        /// Raise DataReceived whenever there is something to read.
+        /// </summary>
+        private void EventLoop()
+        {
+            while (open)
+            {
+                bool readable;
+
+                lock (fdLock)
+                {
+                    readable = open && Pty.WaitReadable(fd, PollSlice);
+                }
+
+                SerialDataReceivedEventHandler handler = DataReceived;
+
+                if (readable && handler != null)
+                    handler(this, new SerialDataReceivedEventArgs(SerialData.Chars));
+            }
+        }
+
+        /// <summary>
+        /// The port's BaseStream.
+        /// </summary>
+        private class PortStream : Stream
+        {
+            private SerialPort port;
+
+            public PortStream(SerialPort Port)
+            {
+                port = Port;
+            }
+
+            public override bool CanRead { get { return true; } }
+            public override bool CanSeek { get { return false; } }
+            public override bool CanWrite { get { return true; } }
+            public override long Length { get { throw new NotSupportedException(); } }
+            public override long Position { get { throw new NotSupportedException(); } set { throw new NotSupportedException(); } }
+
+            public override int Read(byte[] Buffer, int Offset, int Count)
+            {
+                return port.ReadPort(Buffer, Offset, Count);
+            }
+
+            public override void Write(byte[] Buffer, int Offset, int Count)
+            {
+                port.Write(Buffer, Offset, Count);
+            }
+
+            public override void Flush()
+            {
+            }
+
+            public override long Seek(long Offset, SeekOrigin Origin)
+            {
+                throw new NotSupportedException();
+            }
+
+            public override void SetLength(long Value)
+            {
+                throw new NotSupportedException();
+            }
+        }
+    }
+}
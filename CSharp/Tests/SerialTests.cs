@@ -0,0 +1,338 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.Ports;
+using System.Text;
+using System.Threading;
+using LogicAnalyzer.Controllers;
+using LogicAnalyzer.Filters;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// Checks and benchmarks of the serial controller, reading from a pty as it would from the device's serial
+    /// port. The checks pass a stream through the controller with its dedicated reader thread and with the port's
+    /// DataReceived event, and reopen the port quickly over and over (with a reader that may not have finished yet)
+    /// before passing a stream through again. The benchmarks give the rate the controller takes data at, and the
+    /// memory allocated per megabyte while it does (a few hundred bytes a run are the test's writer thread; with
+    /// DataReceived, most of it is the event arguments the port raises the event with).
+    /// </summary>
+    public class SerialTests : TestSuite
+    {
+        private const int ReadSize = 65536;
+
+        private int master = -1;
+        private string slave;
+        private SerialController controller;
+        private byte[] readBuffer = new byte[ReadSize];
+        private AutoResetEvent received = new AutoResetEvent(false);
+        private int errors;
+        private string lastError;
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the name the suite is picked by on the command line.
+        /// </summary>
+        public override string Name
+        {
+            get
+            {
+                return "serial";
+            }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Run the checks.
+        /// </summary>
+        public override void Check()
+        {
+            byte[] data = makeData(8 << 20);
+            long length;
+
+            if (!openPty())
+                return;
+
+            foreach (bool dedicated in new bool[] { true, false })
+            {
+                string reader = dedicated ? "reader thread" : "DataReceived";
+
+                openController(dedicated, 3000, null);
+                length = transfer(data, true);
+                Report(length == data.Length && errors == 0, "{0}: {1} of {2} bytes pass intact, {3} error(s){4}", reader, length,
+                    data.Length, errors, lastError == null ? "" : " (" + lastError + ")");
+                closeController();
+            }
+
+            // Reopen with the reader of the port just closed still going (Close() only waits the timeout for it
+            // to finish, so with no timeout it doesn't wait at all).
+            openController(true, 0, null);
+            for (int i = 0; i < 50; i++)
+            {
+                controller.Close();
+                controller.Open();
+            }
+            controller.Timeout = 3000;
+            length = transfer(data, true);
+            Report(length == data.Length && errors == 0, "reader thread after 50 quick reopens: {0} of {1} bytes pass intact, {2} error(s){3}",
+                length, data.Length, errors, lastError == null ? "" : " (" + lastError + ")");
+            closeController();
+
+            closePty();
+        }
+
+        /// <summary>
+        /// Run the benchmarks.
+        /// </summary>
+        public override void Bench()
+        {
+            byte[] data = makeData(32 << 20);
+            byte[] frames = makeFrames(data);
+
+            if (!openPty())
+                return;
+
+            Console.WriteLine("reader         filters   MB/s  allocated bytes/MB");
+            foreach (bool dedicated in new bool[] { true, false })
+            {
+                benchController(dedicated, false, data);
+                benchController(dedicated, true, frames);
+            }
+            closePty();
+        }
+
+        /// <summary>
+        /// Time a stream through the controller, and count what it allocates.
+        /// </summary>
+        /// <param name="Dedicated">Whether to read on the dedicated thread (otherwise on DataReceived)</param>
+        /// <param name="Frames">Whether the stream is frames, to go through a frame filter</param>
+        /// <param name="Data">The stream</param>
+        private void benchController(bool Dedicated, bool Frames, byte[] Data)
+        {
+            double best = double.MaxValue;
+            long allocated = long.MaxValue;
+
+            for (int run = 0; run < BenchRuns; run++)
+            {
+                FrameFilter filter = Frames ? new FrameFilter() : null;
+
+                openController(Dedicated, 3000, filter);
+
+                // Get the controller going before counting, so its buffers are made.
+                if (Frames)
+                {
+                    transfer(makeFrames(makeData(ReadSize)), false);
+                    filter.Initialize();
+                }
+                else
+                    transfer(makeData(ReadSize), false);
+
+                long before = GC.GetTotalAllocatedBytes(true);
+                DateTime start = DateTime.UtcNow;
+
+                transfer(Data, false);
+                best = Math.Min(best, (DateTime.UtcNow - start).TotalSeconds);
+                allocated = Math.Min(allocated, GC.GetTotalAllocatedBytes(true) - before);
+                closeController();
+            }
+
+            Console.WriteLine("{0,-14} {1,-7} {2,6:F1} {3,19:F0}", Dedicated ? "thread" : "DataReceived", Frames ? "frame" : "none",
+                Data.Length / 1e6 / best, allocated / (Data.Length / 1e6));
+        }
+
+        /// <summary>
+        /// Open a pty pair for the controller to read.
+        /// </summary>
+        /// <returns>'true' if it could be opened</returns>
+        private bool openPty()
+        {
+            try
+            {
+                master = Pty.OpenPair(out slave);
+            }
+            catch (Exception ex)
+            {
+                Report(false, "pty: {0}", ex.Message);
+                return false;
+            }
+            return true;
+        }
+
+        /// <summary>
+        /// Close the pty pair.
+        /// </summary>
+        private void closePty()
+        {
+            Pty.Close(master);
+            master = -1;
+        }
+
+        /// <summary>
+        /// Open a controller on the pty.
+        /// </summary>
+        /// <param name="Dedicated">Whether to read on the dedicated thread (otherwise on DataReceived)</param>
+        /// <param name="Timeout">The read timeout</param>
+        /// <param name="Filter">The input filter (or null)</param>
+        private void openController(bool Dedicated, int Timeout, AbstractDataFilter<byte> Filter)
+        {
+            controller = new SerialController(slave, 115200, Parity.None, 8, StopBits.One);
+            controller.DedicatedReader = Dedicated;
+            controller.Timeout = Timeout;
+            if (Filter != null)
+                controller.AddInputFilter(Filter);
+            controller.OnDataReceived += controller_OnDataReceived;
+            controller.OnError += controller_OnError;
+            errors = 0;
+            lastError = null;
+            controller.Open();
+        }
+
+        /// <summary>
+        /// Close the controller.
+        /// </summary>
+        private void closeController()
+        {
+            controller.Dispose();
+            controller = null;
+        }
+
+        /// <summary>
+        /// Send a stream from the device end of the pty, and take what comes out of the controller.
+        /// </summary>
+        /// <param name="Data">The stream</param>
+        /// <param name="Verify">Whether to check what comes out is the stream (from makeData())</param>
+        /// <returns>The number of bytes that came out (up to the first one that was wrong)</returns>
+        private long transfer(byte[] Data, bool Verify)
+        {
+            Thread writer = new Thread(delegate()
+            {
+                for (int offset = 0; offset < Data.Length; offset += 4096)
+                    Pty.Write(master, Data, offset, Math.Min(4096, Data.Length - offset));
+            });
+            long expected = Data.Length;
+            long length = 0;
+            int idle = 0;
+
+            // A frame filter passes the payloads on.
+            if (Data.Length > 0 && Data[0] == FrameFilter.FrameSync)
+                expected = Data.Length / (FrameFilter.HeaderSize + FrameFilter.MaxPayloadLength + FrameFilter.TrailerSize) * FrameFilter.MaxPayloadLength;
+
+            writer.IsBackground = true;
+            writer.Start();
+            while (length < expected && idle < 50)
+            {
+                if (controller.BytesToRead == 0)
+                {
+                    idle = received.WaitOne(100) ? 0 : idle + 1;
+                    continue;
+                }
+
+                int count = controller.Read(readBuffer, readBuffer.Length);
+
+                if (Verify)
+                {
+                    for (int i = 0; i < count; i++, length++)
+                    {
+                        if (readBuffer[i] != dataByte(length))
+                            return length;
+                    }
+                }
+                else
+                    length += count;
+            }
+            writer.Join();
+            return length;
+        }
+
+        /// <summary>
+        /// Gets a byte of the test stream.
+        /// </summary>
+        /// <param name="Position">Its position in the stream</param>
+        /// <returns>The byte</returns>
+        private static byte dataByte(long Position)
+        {
+            return (byte)(((uint)Position * 2654435761u) >> 24);
+        }
+
+        /// <summary>
+        /// Make a test stream.
+        /// </summary>
+        /// <param name="Length">Its length</param>
+        /// <returns>The stream</returns>
+        private static byte[] makeData(int Length)
+        {
+            byte[] data = new byte[Length];
+
+            for (int i = 0; i < Length; i++)
+                data[i] = dataByte(i);
+
+            // The stream mustn't look like frames (see transfer()).
+            if (Length > 0 && data[0] == FrameFilter.FrameSync)
+                throw new Exception("makeData: the stream starts with a sync byte");
+            return data;
+        }
+
+        /// <summary>
+        /// Wrap a stream in sample frames, as the firmware does.
+        /// </summary>
+        /// <param name="Data">The stream</param>
+        /// <returns>The frames</returns>
+        private static byte[] makeFrames(byte[] Data)
+        {
+            MemoryStream stream = new MemoryStream();
+            byte sequence = 0;
+
+            for (int offset = 0; offset + FrameFilter.MaxPayloadLength <= Data.Length; offset += FrameFilter.MaxPayloadLength)
+                FrameTests.WriteFrame(stream, FrameFilter.FrameTypes.Samples, Data, offset, FrameFilter.MaxPayloadLength, sequence++);
+            return stream.ToArray();
+        }
+
+        /// <summary>
+        /// Handler for the controller's OnDataReceived events.
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        private void controller_OnDataReceived(object sender, ControllerEventArgs e)
+        {
+            e.Dispose();
+            received.Set();
+        }
+
+        /// <summary>
+        /// Handler for the controller's OnError events.
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        private void controller_OnError(object sender, ControllerEventArgs e)
+        {
+            errors++;
+            lastError = e.Message;
+            e.Dispose();
+        }
+
+        #endregion
+    }
+}
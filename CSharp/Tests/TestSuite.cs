@@ -0,0 +1,141 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Text;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// The base class of a set of checks and benchmarks of one part of the host code.
+    /// </summary>
+    public abstract class TestSuite
+    {
+        /// <summary>
+        /// The number of benchmark runs each timing is the best of, to keep the machine's own noise out.
+        /// </summary>
+        public const int BenchRuns = 5;
+
+        /// <summary>
+        /// A piece of work to time.
+        /// </summary>
+        public delegate void Work();
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the number of checks that have failed so far.
+        /// </summary>
+        public static int Failures
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// Gets the name the suite is picked by on the command line.
+        /// </summary>
+        public abstract string Name
+        {
+            get;
+        }
+
+        /// <summary>
+        /// Gets the directory holding the test vectors (copied next to the program when it is built).
+        /// </summary>
+        public static string VectorDirectory
+        {
+            get
+            {
+                return Path.Combine(AppContext.BaseDirectory, "Vectors");
+            }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Run the checks.
+        /// </summary>
+        public virtual void Check()
+        {
+        }
+
+        /// <summary>
+        /// Run the benchmarks.
+        /// </summary>
+        public virtual void Bench()
+        {
+        }
+
+        /// <summary>
+        /// Print the result of a check.
+        /// </summary>
+        /// <param name="Ok">Whether the check passed</param>
+        /// <param name="Format">What was checked (as for String.Format)</param>
+        /// <param name="Args">The values to format</param>
+        public static void Report(bool Ok, string Format, params object[] Args)
+        {
+            Console.WriteLine((Ok ? "ok   " : "FAIL ") + String.Format(Format, Args));
+            if (!Ok)
+                Failures++;
+        }
+
+        /// <summary>
+        /// Time a piece of work, taking the best of BenchRuns runs.
+        /// </summary>
+        /// <param name="Work">The work to time</param>
+        /// <returns>The best time, in seconds</returns>
+        public static double Time(Work Work)
+        {
+            double best = double.MaxValue;
+
+            for (int run = 0; run < BenchRuns; run++)
+            {
+                Stopwatch watch = Stopwatch.StartNew();
+                Work();
+                best = Math.Min(best, watch.Elapsed.TotalSeconds);
+            }
+            return best;
+        }
+
+        /// <summary>
+        /// Compare two arrays of bytes.
+        /// </summary>
+        /// <param name="A">One array</param>
+        /// <param name="B">The other</param>
+        /// <returns>The index of the first byte that differs, or -1 if they are the same</returns>
+        public static int FirstDifference(byte[] A, byte[] B)
+        {
+            int length = Math.Min(A.Length, B.Length);
+
+            for (int i = 0; i < length; i++)
+            {
+                if (A[i] != B[i])
+                    return i;
+            }
+            return A.Length == B.Length ? -1 : length;
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,509 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Drawing;
+using System.IO;
+using System.Text;
+using System.Threading;
+using LogicAnalyzer.DataAcquisition;
+
+namespace LogicAnalyzer.Tests
+{
+    /// <summary>
+    /// Checks and benchmarks of drawing the waveform, headless: tiles are drawn into bitmaps in memory (see
+    /// Drawing.cs). The checks compare tiles drawn by WaveformRasterizer with the reference images in Images, at
+    /// zooms in and out, across a gap and at the end of a capture; and make sure the tiles WaveformTileCache hands
+    /// back are the same, after the signals change and as they grow. A reference image that is missing or differs
+    /// is written to the current directory, to look at (and copy to Images if the change is meant). The benchmarks
+    /// time drawing a tile, and the frames of a window as it is first drawn, scrolled and zoomed.
+    /// </summary>
+    public class WaveformTests : TestSuite
+    {
+        // As in CustomLaDisplayControl.
+        private const int PlotHeight = 50;
+        private const int HighStateYValue = 5;
+        private const int LowStateYValue = 45;
+        // The window the frames are timed in: eight channels, four tiles wide.
+        private const int FrameWidth = 4 * WaveformTileCache.TileWidth;
+        private const int FrameChannels = 8;
+        // How long to wait for a tile to be drawn before giving up, in ms.
+        private const int TileTimeout = 5000;
+
+        /// <summary>
+        /// A tile to compare with its reference image.
+        /// </summary>
+        private struct ReferenceTile
+        {
+            public string Name;
+            public int ZoomShift;
+            public long Tile;
+            public int Channel;
+
+            public ReferenceTile(string Name, int ZoomShift, long Tile, int Channel)
+            {
+                this.Name = Name;
+                this.ZoomShift = ZoomShift;
+                this.Tile = Tile;
+                this.Channel = Channel;
+            }
+        }
+
+        // 5000 ticks of runs of about 40, with 200 ticks lost at 1500.
+        private static ReferenceTile[] referenceTiles = new ReferenceTile[]
+        {
+            new ReferenceTile("zoom2-tile26-ch0-gap-end", 2, 26, 0),
+            new ReferenceTile("zoom0-tile5-ch1-gap", 0, 5, 1),
+            new ReferenceTile("zoom0-tile19-ch2-end", 0, 19, 2),
+            new ReferenceTile("zoom-3-tile0-ch3-gap", -3, 0, 3),
+            new ReferenceTile("zoom-5-tile0-ch7-all", -5, 0, 7),
+        };
+
+        private AutoResetEvent tileRendered = new AutoResetEvent(false);
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the name the suite is picked by on the command line.
+        /// </summary>
+        public override string Name
+        {
+            get
+            {
+                return "waveform";
+            }
+        }
+
+        /// <summary>
+        /// Gets the directory holding the reference images (copied next to the program when it is built).
+        /// </summary>
+        public static string ImageDirectory
+        {
+            get
+            {
+                return Path.Combine(AppContext.BaseDirectory, "Images");
+            }
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Run the checks.
+        /// </summary>
+        public override void Check()
+        {
+            byte[] samples = PlotTests.MakeSamples(new Random(8), 5000, 40);
+            List<TimelineEvent> gap = new List<TimelineEvent>();
+            SamplePlot plot, other;
+
+            gap.Add(new TimelineEvent(TimelineEvent.Kinds.Gap, 1500, 200));
+            plot = new SamplePlot(samples, 8, false, gap);
+            other = new SamplePlot(PlotTests.MakeSamples(new Random(9), 5000, 40), 8, false, null);
+
+            foreach (ReferenceTile reference in referenceTiles)
+                checkReference(plot, reference);
+
+            checkCache(plot, other);
+            checkGrowth(samples);
+        }
+
+        /// <summary>
+        /// Run the benchmarks.
+        /// </summary>
+        public override void Bench()
+        {
+            SamplePlot plot = new SamplePlot(PlotTests.MakeSamples(new Random(10), 1 << 22, 16), 8, false, null);
+            Bitmap image = new Bitmap(WaveformTileCache.TileWidth, PlotHeight);
+            WaveformRasterizer rasterizer = new WaveformRasterizer(HighStateYValue, LowStateYValue);
+
+            Console.WriteLine("{0} ticks, {1} transitions on channel 0", plot.Length, plot.Transitions[0].EdgeCount);
+            Console.WriteLine("draw a tile     ms");
+            foreach (int zoomShift in new int[] { 4, 0, -4, -8, -12 })
+            {
+                long pixels = zoomShift >= 0 ? plot.Length << zoomShift : plot.Length >> -zoomShift;
+                long tiles = Math.Max(pixels / WaveformTileCache.TileWidth, 1);
+                double time = Time(delegate
+                {
+                    // Sixteen tiles, spread across the capture.
+                    for (int i = 0; i < 16; i++)
+                    {
+                        using (Graphics g = Graphics.FromImage(image))
+                        {
+                            g.Clear(Color.Transparent);
+                            rasterizer.Render(g, plot.Transitions[0], plot.Unknown, zoomShift, i * tiles / 16 * WaveformTileCache.TileWidth,
+                                WaveformTileCache.TileWidth);
+                        }
+                    }
+                }) / 16;
+
+                Console.WriteLine("zoom {0,3} {1,11:F3}", zoomShift, time * 1e3);
+            }
+            rasterizer.Dispose();
+
+            Console.WriteLine();
+            Console.WriteLine("frame ({0} x {1})          ms  frames", FrameWidth, FrameChannels * PlotHeight);
+            using (WaveformTileCache cache = new WaveformTileCache(PlotHeight, HighStateYValue, LowStateYValue))
+            {
+                Bitmap frame = new Bitmap(FrameWidth, FrameChannels * PlotHeight);
+                long left = 64 * WaveformTileCache.TileWidth;
+
+                cache.TileRendered += tileRenderedHandler;
+                cache.SetSignals(plot.Transitions, plot.Unknown);
+
+                benchFrames("first, nothing cached", cache, plot, frame, -4, left);
+                benchFrames("scroll by a tile", cache, plot, frame, -4, left + WaveformTileCache.TileWidth);
+                benchFrames("zoom out", cache, plot, frame, -5, left / 2);
+                benchFrames("zoom back in, cached", cache, plot, frame, -4, left + WaveformTileCache.TileWidth);
+
+                double cached = Time(delegate { paint(cache, plot, frame, -4, left + WaveformTileCache.TileWidth); });
+                Console.WriteLine("{0,-24} {1,7:F3} {2,7}", "all cached", cached * 1e3, 1);
+
+                cache.TileRendered -= tileRenderedHandler;
+            }
+        }
+
+        /// <summary>
+        /// Draw a tile and compare it with its reference image.
+        /// </summary>
+        /// <param name="Plot">The capture</param>
+        /// <param name="Reference">The tile</param>
+        private void checkReference(SamplePlot Plot, ReferenceTile Reference)
+        {
+            Bitmap image = render(Plot, Reference.ZoomShift, Reference.Tile, Reference.Channel);
+            string path = Path.Combine(ImageDirectory, Reference.Name + ".pbm");
+            bool[] expected = File.Exists(path) ? ReadPbm(path, image.Width, image.Height) : null;
+            bool[] actual = toBits(image);
+            int differences = 0, first = -1;
+
+            if (expected == null)
+            {
+                WritePbm(Reference.Name + ".pbm", actual, image.Width, image.Height, Reference.Name);
+                Report(false, "tile {0}: no reference image, so wrote it to {1}", Reference.Name, Path.GetFullPath(Reference.Name + ".pbm"));
+                return;
+            }
+
+            for (int i = 0; i < actual.Length; i++)
+            {
+                if (actual[i] != expected[i])
+                {
+                    if (differences++ == 0)
+                        first = i;
+                }
+            }
+            if (differences > 0)
+                WritePbm(Reference.Name + ".pbm", actual, image.Width, image.Height, Reference.Name);
+
+            Report(differences == 0, "tile {0} is drawn as its reference image{1}", Reference.Name,
+                differences == 0 ? "" : String.Format(", but {0} pixels differ, the first at ({1}, {2}); wrote it to {3}", differences,
+                first % image.Width, first / image.Width, Path.GetFullPath(Reference.Name + ".pbm")));
+        }
+
+        /// <summary>
+        /// Check that the tile cache hands back the tiles the rasterizer draws, and only those of the signals
+        /// set last.
+        /// </summary>
+        /// <param name="Plot">A capture</param>
+        /// <param name="Other">Another capture</param>
+        private void checkCache(SamplePlot Plot, SamplePlot Other)
+        {
+            using (WaveformTileCache cache = new WaveformTileCache(PlotHeight, HighStateYValue, LowStateYValue))
+            {
+                int tiles = 0;
+                string problem = null;
+
+                cache.TileRendered += tileRenderedHandler;
+
+                foreach (SamplePlot plot in new SamplePlot[] { Plot, Other })
+                {
+                    cache.SetSignals(plot.Transitions, plot.Unknown);
+                    foreach (ReferenceTile reference in referenceTiles)
+                    {
+                        Bitmap tile = waitTile(cache, reference.ZoomShift, reference.Tile, reference.Channel);
+
+                        if (tile == null)
+                            problem = String.Format("tile {0} wasn't drawn", reference.Name);
+                        else if (!samePixels(tile, render(plot, reference.ZoomShift, reference.Tile, reference.Channel)))
+                            problem = String.Format("tile {0} differs from the rasterizer's", reference.Name);
+                        if (problem != null)
+                            break;
+                        tiles++;
+                    }
+                    if (problem != null)
+                        break;
+                }
+
+                cache.TileRendered -= tileRenderedHandler;
+                Report(problem == null, "tile cache hands back the {0} tiles drawn by the rasterizer, for the signals set last{1}", tiles,
+                    problem == null ? "" : ", but " + problem);
+            }
+        }
+
+        /// <summary>
+        /// Check that a tile at the end of a plot that is still growing is drawn again as it grows.
+        /// </summary>
+        /// <param name="Samples">The samples to plot</param>
+        private void checkGrowth(byte[] Samples)
+        {
+            SamplePlot plot = SamplePlot.Begin(new int[] { 0, 1, 2, 3, 4, 5, 6, 7 }, false);
+            int half = Samples.Length / 2;
+            long tile = half / WaveformTileCache.TileWidth;
+            Bitmap expected, image;
+            Stopwatch watch;
+
+            using (WaveformTileCache cache = new WaveformTileCache(PlotHeight, HighStateYValue, LowStateYValue))
+            {
+                cache.TileRendered += tileRenderedHandler;
+
+                plot.Append(Samples, 0, half);
+                cache.SetSignals(plot.Transitions, plot.Unknown);
+                image = waitTile(cache, 0, tile, 0);
+                expected = render(plot, 0, tile, 0);
+                if (image == null || !samePixels(image, expected))
+                {
+                    cache.TileRendered -= tileRenderedHandler;
+                    Report(false, "tile cache draws the tile at the end of a growing plot");
+                    return;
+                }
+
+                // The tile is drawn again once the cache is told, and replaces the old one on a later call.
+                plot.Append(Samples, half, Samples.Length - half);
+                plot.Finish();
+                cache.SignalsExtended();
+                expected = render(plot, 0, tile, 0);
+                watch = Stopwatch.StartNew();
+                while (!samePixels(image = cache.GetTile(0, tile, 0), expected) && watch.ElapsedMilliseconds < TileTimeout)
+                    tileRendered.WaitOne(100);
+
+                cache.TileRendered -= tileRenderedHandler;
+                Report(samePixels(image, expected), "tile cache draws the tile at the end of a growing plot again as it grows");
+            }
+        }
+
+        /// <summary>
+        /// Time painting a window until all of its tiles are in, as the display does: each frame blits the tiles
+        /// that are ready, and the next is painted when another arrives.
+        /// </summary>
+        /// <param name="Name">What the frames are</param>
+        /// <param name="Cache">The tile cache</param>
+        /// <param name="Plot">The capture</param>
+        /// <param name="Frame">The window's image</param>
+        /// <param name="ZoomShift">The zoom</param>
+        /// <param name="LeftPixel">The pixel at the left of the window</param>
+        private void benchFrames(string Name, WaveformTileCache Cache, SamplePlot Plot, Bitmap Frame, int ZoomShift, long LeftPixel)
+        {
+            Stopwatch watch = Stopwatch.StartNew();
+            int frames = 1;
+
+            while (paint(Cache, Plot, Frame, ZoomShift, LeftPixel) > 0)
+            {
+                tileRendered.WaitOne(TileTimeout);
+                frames++;
+            }
+            Console.WriteLine("{0,-24} {1,7:F3} {2,7}", Name, watch.Elapsed.TotalMilliseconds, frames);
+        }
+
+        /// <summary>
+        /// Paint the signals of a window from the tile cache, as CustomLaDisplayControl does.
+        /// </summary>
+        /// <param name="Cache">The tile cache</param>
+        /// <param name="Plot">The capture</param>
+        /// <param name="Frame">The window's image</param>
+        /// <param name="ZoomShift">The zoom</param>
+        /// <param name="LeftPixel">The pixel at the left of the window</param>
+        /// <returns>The number of tiles that weren't ready</returns>
+        private static int paint(WaveformTileCache Cache, SamplePlot Plot, Bitmap Frame, int ZoomShift, long LeftPixel)
+        {
+            long firstTile = LeftPixel / WaveformTileCache.TileWidth;
+            long lastTile = (LeftPixel + FrameWidth - 1) / WaveformTileCache.TileWidth;
+            long length = ZoomShift >= 0 ? Plot.Length << ZoomShift : Plot.Length >> -ZoomShift;
+            long endTile = Math.Min(lastTile, length / WaveformTileCache.TileWidth);
+            int missing = 0;
+
+            using (Graphics g = Graphics.FromImage(Frame))
+            {
+                g.Clear(Color.White);
+                for (int channel = 0; channel < FrameChannels; channel++)
+                {
+                    for (long t = firstTile; t <= endTile; t++)
+                    {
+                        Bitmap tile = Cache.GetTile(ZoomShift, t, channel);
+
+                        if (tile != null)
+                            g.DrawImageUnscaled(tile, (int)(t * WaveformTileCache.TileWidth - LeftPixel), channel * PlotHeight);
+                        else
+                            missing++;
+                    }
+                }
+            }
+            return missing;
+        }
+
+        /// <summary>
+        /// Get a tile from the cache, waiting for it to be drawn.
+        /// </summary>
+        /// <param name="Cache">The tile cache</param>
+        /// <param name="ZoomShift">The zoom</param>
+        /// <param name="Tile">The tile's place along the capture</param>
+        /// <param name="Channel">The channel</param>
+        /// <returns>The tile (null if it wasn't drawn in time)</returns>
+        private Bitmap waitTile(WaveformTileCache Cache, int ZoomShift, long Tile, int Channel)
+        {
+            Stopwatch watch = Stopwatch.StartNew();
+            Bitmap tile;
+
+            while ((tile = Cache.GetTile(ZoomShift, Tile, Channel)) == null && watch.ElapsedMilliseconds < TileTimeout)
+                tileRendered.WaitOne(100);
+            return tile;
+        }
+
+        /// <summary>
+        /// Handle a tile being drawn by the cache (on its thread).
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        private void tileRenderedHandler(object sender, EventArgs e)
+        {
+            tileRendered.Set();
+        }
+
+        /// <summary>
+        /// Draw a tile of a capture with a rasterizer of its own.
+        /// </summary>
+        /// <param name="Plot">The capture</param>
+        /// <param name="ZoomShift">The zoom</param>
+        /// <param name="Tile">The tile's place along the capture</param>
+        /// <param name="Channel">The channel</param>
+        /// <returns>The tile</returns>
+        private static Bitmap render(SamplePlot Plot, int ZoomShift, long Tile, int Channel)
+        {
+            Bitmap image = new Bitmap(WaveformTileCache.TileWidth, PlotHeight);
+
+            using (WaveformRasterizer rasterizer = new WaveformRasterizer(HighStateYValue, LowStateYValue))
+            using (Graphics g = Graphics.FromImage(image))
+                rasterizer.Render(g, Plot.Transitions[Channel], Plot.Unknown, ZoomShift, Tile * WaveformTileCache.TileWidth,
+                    WaveformTileCache.TileWidth);
+            return image;
+        }
+
+        /// <summary>
+        /// Compare the pixels of two images.
+        /// </summary>
+        /// <param name="A">One image (may be null)</param>
+        /// <param name="B">The other</param>
+        /// <returns>'true' if they are the same</returns>
+        private static bool samePixels(Bitmap A, Bitmap B)
+        {
+            if (A == null || A.Width != B.Width || A.Height != B.Height)
+                return false;
+            for (int y = 0; y < A.Height; y++)
+            {
+                for (int x = 0; x < A.Width; x++)
+                {
+                    if (A.GetPixel(x, y) != B.GetPixel(x, y))
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        /// <summary>
+        /// Get which pixels of a tile are drawn on.
+        /// </summary>
+        /// <param name="Image">The tile</param>
+        /// <returns>'true' for each pixel drawn on, a row at a time</returns>
+        private static bool[] toBits(Bitmap Image)
+        {
+            bool[] bits = new bool[Image.Width * Image.Height];
+
+            for (int y = 0; y < Image.Height; y++)
+            {
+                for (int x = 0; x < Image.Width; x++)
+                    bits[y * Image.Width + x] = Image.GetPixel(x, y).A != 0;
+            }
+            return bits;
+        }
+
+        /// <summary>
+        /// Read a plain (P1) PBM image.
+        /// </summary>
+        /// <param name="Path">The file</param>
+        /// <param name="Width">The width it must have</param>
+        /// <param name="Height">The height it must have</param>
+        /// <returns>'true' for each black pixel, a row at a time (null if it isn't a PBM image of that size)</returns>
+        public static bool[] ReadPbm(string Path, int Width, int Height)
+        {
+            string[] lines = File.ReadAllLines(Path);
+            StringBuilder text = new StringBuilder();
+            string[] header;
+            bool[] bits = new bool[Width * Height];
+            int n = 0;
+
+            // Drop the comments, then the header is the first three words and the pixels follow.
+            foreach (string line in lines)
+            {
+                int hash = line.IndexOf('#');
+
+                text.Append(hash >= 0 ? line.Substring(0, hash) : line);
+                text.Append(' ');
+            }
+            header = text.ToString().Split(new char[] { ' ', '\t' }, 4, StringSplitOptions.RemoveEmptyEntries);
+            if (header.Length < 4 || header[0] != "P1" || header[1] != Width.ToString() || header[2] != Height.ToString())
+                return null;
+
+            foreach (char c in header[3])
+            {
+                if ((c == '0' || c == '1') && n < bits.Length)
+                    bits[n++] = (c == '1');
+            }
+            return (n == bits.Length) ? bits : null;
+        }
+
+        /// <summary>
+        /// Write a plain (P1) PBM image.
+        /// </summary>
+        /// <param name="Path">The file</param>
+        /// <param name="Bits">'true' for each black pixel, a row at a time</param>
+        /// <param name="Width">The width of the image</param>
+        /// <param name="Height">The height of the image</param>
+        /// <param name="Comment">What the image is</param>
+        public static void WritePbm(string Path, bool[] Bits, int Width, int Height, string Comment)
+        {
+            StringBuilder text = new StringBuilder();
+
+            text.AppendFormat("P1\n# {0}\n{1} {2}\n", Comment, Width, Height);
+            for (int y = 0; y < Height; y++)
+            {
+                // Plain PBM lines are kept to 70 characters.
+                for (int x = 0; x < Width; x++)
+                {
+                    text.Append(Bits[y * Width + x] ? '1' : '0');
+                    if (x % 64 == 63 || x == Width - 1)
+                        text.Append('\n');
+                }
+            }
+            File.WriteAllText(Path, text.ToString());
+        }
+
+        #endregion
+    }
+}
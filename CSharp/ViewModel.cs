@@ -86,6 +86,15 @@ namespace LogicAnalyzer
                 set;
             }
 
+            /// <summary>
+            /// Gets/Sets the pins to sample as a mask, or 0 to sample the first SamplingChannels pins
+            /// </summary>
+            public byte SamplingPins
+            {
+                get;
+                set;
+            }
+
             /// <summary>
             /// Gets/Sets whether samples are compressed or not
             /// </summary>
@@ -95,6 +104,105 @@ namespace LogicAnalyzer
                 set;
             }
 
+            /// <summary>
+            /// Gets/Sets the compression method used when samples are compressed
+            /// </summary>
+            public Compression.CompressionMethods SamplingCompressionMethod
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets whether the device captures with timer-triggered DMA
+            /// </summary>
+            public bool SamplingDma
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets whether the device may halve its sampling rate while it is overloaded
+            /// </summary>
+            public bool SamplingDecimate
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the trigger mode
+            /// </summary>
+            public DataGrabber.TriggerModes TriggerMode
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the channels compared by a pattern trigger
+            /// </summary>
+            public byte TriggerMask
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the channel states a pattern trigger looks for
+            /// </summary>
+            public byte TriggerValue
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the channels whose rising edge fires an edge trigger
+            /// </summary>
+            public byte TriggerRising
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the channels whose falling edge fires an edge trigger
+            /// </summary>
+            public byte TriggerFalling
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the number of samples skipped after the trigger
+            /// </summary>
+            public int TriggerHoldoff
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the number of samples recorded in burst mode (0 to stream samples)
+            /// </summary>
+            public int BurstDepth
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the number of pre-trigger samples sent in burst mode
+            /// </summary>
+            public int BurstPre
+            {
+                get;
+                set;
+            }
+
             /// <summary>
             /// Gets/Set the sampling mode
             /// </summary>
@@ -114,7 +222,7 @@ namespace LogicAnalyzer
             }
 
             /// <summary>
-            /// Gets/Sets the total time to sample (in milliseconds)
+            /// Gets/Sets the total time to sample (in milliseconds), or 0 to sample until stopped
             /// </summary>
             public int SamplingTime
             {
@@ -122,6 +230,35 @@ namespace LogicAnalyzer
                 set;
             }
 
+            /// <summary>
+            /// Gets/Sets the flow control window (in bytes), or 0 for no flow control
+            /// </summary>
+            public int FlowControlWindow
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets the most sample data to keep in memory (in MB), or 0 for the default; the rest is
+            /// kept in a temporary file. Only set in the settings file.
+            /// </summary>
+            public int CaptureMemoryBudget
+            {
+                get;
+                set;
+            }
+
+            /// <summary>
+            /// Gets/Sets a file to write the sample data to as it arrives, instead of plotting it (null or
+            /// empty to plot it). Only set in the settings file.
+            /// </summary>
+            public string StreamFile
+            {
+                get;
+                set;
+            }
+
             /// <summary>
             /// Gets/Sets the port name for a serial-type controller
             /// </summary>
@@ -151,10 +288,27 @@ namespace LogicAnalyzer
                     BaudRate = Convert.ToInt32(reader["BaudRate"]);
                     ControllerType = reader["ControllerType"].Equals(ControllerTypes.Test.ToString()) ? ControllerTypes.Test : ControllerTypes.Serial;
                     SamplingChannels = Convert.ToInt32(reader["SamplingChannels"]);
+                    SamplingPins = Convert.ToByte(reader["SamplingPins"]);
                     SamplingCompression = Convert.ToBoolean(reader["SamplingCompression"]);
-                    SamplingMode = reader["SamplingMode"].Equals(DataGrabber.SamplingModes.TransitionsOnly.ToString()) ? DataGrabber.SamplingModes.TransitionsOnly : DataGrabber.SamplingModes.Continuous;
+                    SamplingCompressionMethod = Compression.CompressionMethods.Lzw.ToString().Equals(reader["SamplingCompressionMethod"]) ? Compression.CompressionMethods.Lzw : Compression.CompressionMethods.Block;
+                    SamplingDma = Convert.ToBoolean(reader["SamplingDma"]);
+                    SamplingDecimate = Convert.ToBoolean(reader["SamplingDecimate"]);
+                    TriggerMode = reader["TriggerMode"] == null ? DataGrabber.TriggerModes.None :
+                        (DataGrabber.TriggerModes)Enum.Parse(typeof(DataGrabber.TriggerModes), reader["TriggerMode"]);
+                    TriggerMask = Convert.ToByte(reader["TriggerMask"]);
+                    TriggerValue = Convert.ToByte(reader["TriggerValue"]);
+                    TriggerRising = Convert.ToByte(reader["TriggerRising"]);
+                    TriggerFalling = Convert.ToByte(reader["TriggerFalling"]);
+                    TriggerHoldoff = Convert.ToInt32(reader["TriggerHoldoff"]);
+                    BurstDepth = Convert.ToInt32(reader["BurstDepth"]);
+                    BurstPre = Convert.ToInt32(reader["BurstPre"]);
+                    SamplingMode = reader["SamplingMode"].Equals(DataGrabber.SamplingModes.TransitionsOnly.ToString()) ? DataGrabber.SamplingModes.TransitionsOnly :
+                        reader["SamplingMode"].Equals(DataGrabber.SamplingModes.RunLength.ToString()) ? DataGrabber.SamplingModes.RunLength : DataGrabber.SamplingModes.Continuous;
                     SamplingRate = Convert.ToInt32(reader["SamplingRate"]);
                     SamplingTime = Convert.ToInt32(reader["SamplingTime"]);
+                    FlowControlWindow = Convert.ToInt32(reader["FlowControlWindow"]);
+                    CaptureMemoryBudget = Convert.ToInt32(reader["CaptureMemoryBudget"]);
+                    StreamFile = reader["StreamFile"];
                     SerialPortName = reader["SerialPortName"];
                 }
             }
@@ -168,10 +322,27 @@ namespace LogicAnalyzer
                 writer.WriteAttributeString("BaudRate", BaudRate.ToString());
                 writer.WriteAttributeString("ControllerType", ControllerType.ToString());
                 writer.WriteAttributeString("SamplingChannels", SamplingChannels.ToString());
+                writer.WriteAttributeString("SamplingPins", SamplingPins.ToString());
                 writer.WriteAttributeString("SamplingCompression", SamplingCompression.ToString());
+                writer.WriteAttributeString("SamplingCompressionMethod", SamplingCompressionMethod.ToString());
+                writer.WriteAttributeString("SamplingDma", SamplingDma.ToString());
+                writer.WriteAttributeString("SamplingDecimate", SamplingDecimate.ToString());
+                writer.WriteAttributeString("TriggerMode", TriggerMode.ToString());
+                writer.WriteAttributeString("TriggerMask", TriggerMask.ToString());
+                writer.WriteAttributeString("TriggerValue", TriggerValue.ToString());
+                writer.WriteAttributeString("TriggerRising", TriggerRising.ToString());
+                writer.WriteAttributeString("TriggerFalling", TriggerFalling.ToString());
+                writer.WriteAttributeString("TriggerHoldoff", TriggerHoldoff.ToString());
+                writer.WriteAttributeString("BurstDepth", BurstDepth.ToString());
+                writer.WriteAttributeString("BurstPre", BurstPre.ToString());
                 writer.WriteAttributeString("SamplingMode", SamplingMode.ToString());
                 writer.WriteAttributeString("SamplingRate", SamplingRate.ToString());
                 writer.WriteAttributeString("SamplingTime", SamplingTime.ToString());
+                writer.WriteAttributeString("FlowControlWindow", FlowControlWindow.ToString());
+                if (CaptureMemoryBudget > 0)
+                    writer.WriteAttributeString("CaptureMemoryBudget", CaptureMemoryBudget.ToString());
+                if (!string.IsNullOrEmpty(StreamFile))
+                    writer.WriteAttributeString("StreamFile", StreamFile);
                 writer.WriteAttributeString("SerialPortName", SerialPortName);
             }
 
@@ -186,6 +357,13 @@ namespace LogicAnalyzer
         private const int defaultSamplingRate = 50000;
         private const int defaultSamplingTime = 1000;
         private const bool defaultSamplingCompression = false;
+        private const Compression.CompressionMethods defaultSamplingCompressionMethod = Compression.CompressionMethods.Block;
+        private const bool defaultSamplingDma = false;
+        private const bool defaultSamplingDecimate = false;
+        private const DataGrabber.TriggerModes defaultTriggerMode = DataGrabber.TriggerModes.None;
+        private const int defaultBurstDepth = 0;
+        private const int defaultBurstPre = 0;
+        private const int defaultFlowControlWindow = 16384;
 
         private DataGrabber grabber;
         private AbstractController Controller;
@@ -211,9 +389,24 @@ namespace LogicAnalyzer
             this.Settings.BaudRate = defaultBaudRate;
             this.Settings.SamplingRate = defaultSamplingRate;
             this.Settings.SamplingChannels = defaultSamplingChannels;
+            this.Settings.SamplingPins = 0;
             this.Settings.SamplingMode = defaultSamplingMode;
             this.Settings.SamplingTime = defaultSamplingTime;
             this.Settings.SamplingCompression = defaultSamplingCompression;
+            this.Settings.SamplingCompressionMethod = defaultSamplingCompressionMethod;
+            this.Settings.SamplingDma = defaultSamplingDma;
+            this.Settings.SamplingDecimate = defaultSamplingDecimate;
+            this.Settings.TriggerMode = defaultTriggerMode;
+            this.Settings.TriggerMask = 0;
+            this.Settings.TriggerValue = 0;
+            this.Settings.TriggerRising = 0;
+            this.Settings.TriggerFalling = 0;
+            this.Settings.TriggerHoldoff = 0;
+            this.Settings.BurstDepth = defaultBurstDepth;
+            this.Settings.BurstPre = defaultBurstPre;
+            this.Settings.FlowControlWindow = defaultFlowControlWindow;
+            this.Settings.CaptureMemoryBudget = 0;
+            this.Settings.StreamFile = null;
             this.ConfigChanged = false;
         }
 
@@ -256,8 +449,10 @@ namespace LogicAnalyzer
             grabber = new DataGrabber(Controller, this.Settings.SamplingRate, this.Settings.SamplingChannels, this.Settings.SamplingTime, this.Settings.SamplingMode, this.Settings.SamplingCompression);
             grabber.OnComplete += grabber_Complete;
             grabber.OnProgress += grabber_Progress;
+            grabber.OnPlotUpdate += grabber_PlotUpdate;
             grabber.OnError += grabber_Error;
             grabber.OnConsoleMessage += grabber_ConsoleMessage;
+            grabber.StatsLogFile = this.AppDataPath + "\\CaptureStats.csv";
             grabber.Open();
         }
         
@@ -295,6 +490,17 @@ namespace LogicAnalyzer
             grabber.PingController();
         }
 
+        /// <summary>
+        /// Requests the performance counters of the last capture from the device controller
+        /// </summary>
+        public void RequestStats()
+        {
+            if (grabber == null)
+                throw new Exception("DataGrabber not initialized");
+
+            grabber.RequestStats();
+        }
+
         /// <summary>
         /// Initiate sampling from the device controller
         /// </summary>
@@ -305,13 +511,50 @@ namespace LogicAnalyzer
 
             grabber.SamplingRate = this.Settings.SamplingRate;
             grabber.SamplingChannels = this.Settings.SamplingChannels;
+            grabber.SamplingPins = this.Settings.SamplingPins;
             grabber.SamplingMode = this.Settings.SamplingMode;
             grabber.SamplingTime = this.Settings.SamplingTime;
             grabber.SamplingCompression = this.Settings.SamplingCompression;
+            grabber.SamplingCompressionMethod = this.Settings.SamplingCompressionMethod;
+            grabber.SamplingDma = this.Settings.SamplingDma;
+            grabber.SamplingDecimate = this.Settings.SamplingDecimate;
+            grabber.TriggerMode = this.Settings.TriggerMode;
+            grabber.TriggerMask = this.Settings.TriggerMask;
+            grabber.TriggerValue = this.Settings.TriggerValue;
+            grabber.TriggerRising = this.Settings.TriggerRising;
+            grabber.TriggerFalling = this.Settings.TriggerFalling;
+            grabber.TriggerHoldoff = this.Settings.TriggerHoldoff;
+            grabber.BurstDepth = this.Settings.BurstDepth;
+            grabber.BurstPre = this.Settings.BurstPre;
+            grabber.FlowControlWindow = this.Settings.FlowControlWindow;
+            grabber.MemoryBudget = (long)this.Settings.CaptureMemoryBudget << 20;
+            grabber.StreamFile = this.Settings.StreamFile;
             BroadcastStatusMessage("Sampling Started\r\n", MessageEventArgs.MessageTypes.Important);
             grabber.StartSampling();
         }
 
+        /// <summary>
+        /// Stop sampling early (or end a capture without a time limit)
+        /// </summary>
+        public void StopSampling()
+        {
+            if (grabber == null)
+                throw new Exception("DataGrabber not initialized");
+
+            grabber.StopSampling();
+        }
+
+        /// <summary>
+        /// Have the device look for the next trigger, while sampling.
+        /// </summary>
+        public void RearmTrigger()
+        {
+            if (grabber == null)
+                throw new Exception("DataGrabber not initialized");
+
+            grabber.RearmTrigger();
+        }
+
         #endregion
 
         #region Configuration Properties and Methods
@@ -607,6 +850,24 @@ namespace LogicAnalyzer
                 handler(this, new PlotEventArgs(samples));
         }
 
+        /// <summary>
+        /// Handle this event to follow the plot of a capture while it comes in (it is raised on the thread the
+        /// data comes in on).
+        /// </summary>
+        public event EventHandler<PlotEventArgs> OnPlotUpdate;
+
+        /// <summary>
+        /// Broadcast a plot update event to anyone who's listening
+        /// </summary>
+        /// <param name="args"></param>
+        private void BroadcastPlotUpdate(PlotEventArgs args)
+        {
+            EventHandler<PlotEventArgs> handler = OnPlotUpdate;
+
+            if (handler != null)
+                handler(this, args);
+        }
+
         #endregion
 
         #region DataGrabber Event Handlers
@@ -621,8 +882,21 @@ namespace LogicAnalyzer
             // Send a console message...
             BroadcastStatusMessage("Sampling Complete\r\n", MessageEventArgs.MessageTypes.Important);
 
-            // and tell our listeners to plot the data.
-            BroadcastPlot(new SamplePlot(grabber.Data.ToArray(), grabber.SamplingChannels, grabber.SamplingMode != DataGrabber.SamplingModes.TransitionsOnly));
+            // Sample data that went straight to a file is left there.
+            if (!string.IsNullOrEmpty(grabber.StreamFile))
+            {
+                BroadcastStatusMessage("Sample data written to " + grabber.StreamFile + "\r\n", MessageEventArgs.MessageTypes.Important);
+                return;
+            }
+
+            // and tell our listeners to plot the data. It was mostly plotted as it came in; otherwise it's
+            // plotted from the data (transition records are plotted as they are).
+            if (grabber.Plot != null)
+                BroadcastPlot(grabber.Plot);
+            else if (grabber.SamplingMode == DataGrabber.SamplingModes.TransitionsOnly)
+                BroadcastPlot(SamplePlot.FromTransitions(grabber.Data.Segments, grabber.Pins, grabber.TimelineEvents));
+            else
+                BroadcastPlot(new SamplePlot(grabber.Data.Segments, grabber.Pins, true, grabber.TimelineEvents));
         }
 
         /// <summary>
@@ -658,6 +932,17 @@ namespace LogicAnalyzer
             BroadcastProgress(e);
         }
 
+        /// <summary>
+        /// Handles the data acquisition 'PlotUpdate' event
+        /// </summary>
+        /// <param name="sender"></param>
+        /// <param name="e"></param>
+        void grabber_PlotUpdate(object sender, PlotEventArgs e)
+        {
+            // Just pass the even on the our listeners
+            BroadcastPlotUpdate(e);
+        }
+
         #endregion
     }
 }
\ No newline at end of file
@@ -0,0 +1,261 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Text;
+using LogicAnalyzer.DataAcquisition;
+
+namespace LogicAnalyzer
+{
+    /// <summary>
+    /// Class defining methods to draw the waveform of one signal into any Graphics (a control, or the bitmap of a
+    /// tile, see WaveformTileCache). Positions are in pixels from the start of the capture at the given zoom, so a
+    /// tile is drawn the same whichever part of the window it ends up in. Each rasterizer has its own pens and
+    /// brushes, since GDI+ objects can't be shared between threads.
+    /// </summary>
+    public class WaveformRasterizer : IDisposable
+    {
+        private int highStateYValue;
+        private int lowStateYValue;
+        private Pen signalPen;
+        private Brush signalBrush;
+        private Brush unknownBrush;
+
+        /// <summary>
+        /// What a pixel column of a zoomed out signal holds (see renderColumns()).
+        /// </summary>
+        private enum ColumnKind
+        {
+            None,
+            Low,
+            High,
+            Active, // At least one transition
+            Unknown // Some samples the device lost
+        }
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a WaveformRasterizer object.
+        /// </summary>
+        /// <param name="HighStateYValue">The Y position of the high state</param>
+        /// <param name="LowStateYValue">The Y position of the low state</param>
+        public WaveformRasterizer(int HighStateYValue, int LowStateYValue)
+        {
+            highStateYValue = HighStateYValue;
+            lowStateYValue = LowStateYValue;
+            signalPen = new Pen(Color.Red, 1);
+            signalBrush = new SolidBrush(Color.Red);
+
+            // Samples the device lost are hatched.
+            unknownBrush = new System.Drawing.Drawing2D.HatchBrush(System.Drawing.Drawing2D.HatchStyle.BackwardDiagonal, Color.Red, Color.Transparent);
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Draw part of a signal.
+        /// </summary>
+        /// <param name="g">The graphics to draw on (X is 0 at the left pixel, Y is 0 at the top of the plot)</param>
+        /// <param name="Signal">The transitions of the signal</param>
+        /// <param name="Unknown">The ranges where the state of the signal isn't known (may be null)</param>
+        /// <param name="ZoomShift">The zoom, as a power of two (0 is a pixel per tick, positive zooms in)</param>
+        /// <param name="LeftPixel">The pixel to draw from, counted from the start of the capture</param>
+        /// <param name="Width">The number of pixels to draw</param>
+        public void Render(Graphics g, TransitionIndex Signal, TransitionIndex Unknown, int ZoomShift, long LeftPixel, int Width)
+        {
+            // Zoomed in, no pixel holds more than one transition, so the signal is drawn a state at a time.
+            // Zoomed out, any number of transitions may fall in a pixel, so it's drawn a column at a time.
+            if (ZoomShift >= 0)
+                renderTransitions(g, Signal, Unknown, ZoomShift, LeftPixel, Width);
+            else
+                renderColumns(g, Signal, Unknown, ZoomShift, LeftPixel, Width);
+        }
+
+        /// <summary>
+        /// Convert ticks to pixels (counted from the start of the capture).
+        /// </summary>
+        /// <param name="SampleTicks"></param>
+        /// <param name="ZoomShift"></param>
+        /// <returns></returns>
+        private static long ticksToPixels(long SampleTicks, int ZoomShift)
+        {
+            return ZoomShift >= 0 ? SampleTicks << ZoomShift : SampleTicks >> -ZoomShift;
+        }
+
+        /// <summary>
+        /// Convert pixels (counted from the start of the capture) to ticks.
+        /// </summary>
+        /// <param name="Pixels"></param>
+        /// <param name="ZoomShift"></param>
+        /// <returns></returns>
+        private static long pixelsToTicks(long Pixels, int ZoomShift)
+        {
+            return ZoomShift >= 0 ? Pixels >> ZoomShift : Pixels << -ZoomShift;
+        }
+
+        /// <summary>
+        /// Draw a signal one state at a time.
+        /// </summary>
+        private void renderTransitions(Graphics g, TransitionIndex Signal, TransitionIndex Unknown, int ZoomShift, long LeftPixel, int Width)
+        {
+            // Start a tick early, so a transition on the left pixel is drawn.
+            long start = Math.Max(pixelsToTicks(LeftPixel, ZoomShift) - 1, 0);
+            long end = Math.Min(pixelsToTicks(LeftPixel + Width, ZoomShift) + 1, Signal.Length);
+            long next;
+
+            // Start at the first transitions drawn, rather than walking the signal from the beginning.
+            int edge = Signal.FindEdge(start);
+            int unknownEdge = (Unknown != null) ? Unknown.FindEdge(start) : 0;
+            int unknownEdges = (Unknown != null) ? Unknown.EdgeCount : 0;
+            int prevX, x, y;
+
+            while (start < end)
+            {
+                // The state holds until the next transition of the signal, or the
+                // next start or end of unknown samples.
+                next = end;
+                if (edge < Signal.EdgeCount && Signal[edge] < next)
+                    next = Signal[edge];
+                if (unknownEdge < unknownEdges && Unknown[unknownEdge] < next)
+                    next = Unknown[unknownEdge];
+
+                prevX = (int)(ticksToPixels(start, ZoomShift) - LeftPixel);
+                x = (int)(ticksToPixels(next, ZoomShift) - LeftPixel);
+
+                if ((unknownEdge & 1) != 0)
+                {
+                    // The state isn't known, so hatch the whole band between low and high.
+                    g.FillRectangle(unknownBrush, prevX, highStateYValue, Math.Max(x - prevX, 1), lowStateYValue - highStateYValue);
+                }
+                else
+                {
+                    // Draw a line between the previous X and the current X.
+                    y = (Signal.StateAfter(edge) == SampleSignal.State.High) ? highStateYValue : lowStateYValue;
+                    g.DrawLine(signalPen, prevX, y, x, y);
+                }
+
+                // Draw a transition between low and high.
+                if (next < end)
+                    g.DrawLine(signalPen, x, lowStateYValue, x, highStateYValue);
+
+                while (edge < Signal.EdgeCount && Signal[edge] <= next)
+                    edge++;
+                while (unknownEdge < unknownEdges && Unknown[unknownEdge] <= next)
+                    unknownEdge++;
+                start = next;
+            }
+        }
+
+        /// <summary>
+        /// Draw a signal a pixel column at a time. Each column is summed up from the transition index (the
+        /// number of transitions in it, and the state it starts in), and consecutive columns that look the
+        /// same are drawn together. The transitions before a column are found by searching forward from the
+        /// previous column's, so the cost depends on the width drawn, not on the length of the capture or
+        /// the position in it.
+        /// </summary>
+        private void renderColumns(Graphics g, TransitionIndex Signal, TransitionIndex Unknown, int ZoomShift, long LeftPixel, int Width)
+        {
+            long start = Math.Max(pixelsToTicks(LeftPixel, ZoomShift), 0);
+            long length = Signal.Length;
+            long end;
+            int edge, nextEdge, unknownEdge, nextUnknownEdge;
+            int x, runX = 0;
+            ColumnKind kind, runKind = ColumnKind.None;
+
+            // The transitions before the first column.
+            edge = Signal.FindEdge(start - 1);
+            unknownEdge = (Unknown != null) ? Unknown.FindEdge(start - 1) : 0;
+
+            for (x = 0; x < Width && start < length; x++)
+            {
+                end = Math.Min(pixelsToTicks(LeftPixel + x + 1, ZoomShift), length);
+
+                // The transitions before the next column, which leaves those inside this one between the two.
+                nextEdge = Signal.FindEdge(end - 1, edge);
+                nextUnknownEdge = (Unknown != null) ? Unknown.FindEdge(end - 1, unknownEdge) : 0;
+
+                if ((unknownEdge & 1) != 0 || nextUnknownEdge != unknownEdge)
+                    kind = ColumnKind.Unknown;
+                else if (nextEdge != edge)
+                    kind = ColumnKind.Active;
+                else
+                    kind = (Signal.StateAfter(edge) == SampleSignal.State.High) ? ColumnKind.High : ColumnKind.Low;
+
+                if (kind != runKind)
+                {
+                    renderColumnRun(g, runKind, runX, x);
+                    runKind = kind;
+                    runX = x;
+                }
+
+                edge = nextEdge;
+                unknownEdge = nextUnknownEdge;
+                start = end;
+            }
+
+            renderColumnRun(g, runKind, runX, x);
+        }
+
+        /// <summary>
+        /// Draw a run of pixel columns that look the same (see renderColumns()).
+        /// </summary>
+        /// <param name="g"></param>
+        /// <param name="Kind">What the columns hold</param>
+        /// <param name="Left">The first column</param>
+        /// <param name="Right">The column after the last one</param>
+        private void renderColumnRun(Graphics g, ColumnKind Kind, int Left, int Right)
+        {
+            int y;
+
+            switch (Kind)
+            {
+                case ColumnKind.Low:
+                case ColumnKind.High:
+                    // Draw a line across the columns, joining the columns on either side.
+                    y = (Kind == ColumnKind.High) ? highStateYValue : lowStateYValue;
+                    g.DrawLine(signalPen, Left, y, Right, y);
+                    break;
+                case ColumnKind.Active:
+                    // The signal is both low and high in each column, so fill the band between them.
+                    g.FillRectangle(signalBrush, Left, highStateYValue, Right - Left, lowStateYValue - highStateYValue + 1);
+                    break;
+                case ColumnKind.Unknown:
+                    // The state isn't known, so hatch the whole band between low and high.
+                    g.FillRectangle(unknownBrush, Left, highStateYValue, Right - Left, lowStateYValue - highStateYValue);
+                    break;
+            }
+        }
+
+        /// <summary>
+        /// Release the pens and brushes.
+        /// </summary>
+        public void Dispose()
+        {
+            signalPen.Dispose();
+            signalBrush.Dispose();
+            unknownBrush.Dispose();
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,356 @@
+﻿//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Text;
+using System.Threading;
+using LogicAnalyzer.DataAcquisition;
+
+namespace LogicAnalyzer
+{
+    /// <summary>
+    /// Class defining a cache of waveform tiles: bitmaps of one channel, TileWidth pixels wide, at one zoom. Tiles
+    /// are drawn on a thread of their own (see WaveformRasterizer), so the display only blits them. A tile that
+    /// isn't ready yet is requested and left out; TileRendered is raised when it is, so the display fills in as
+    /// the tiles arrive. The least recently used tiles are dropped once there are more than MaxTiles. While the
+    /// signals are still growing (see SignalsExtended()), the tiles at their end are drawn again as they grow.
+    /// </summary>
+    public class WaveformTileCache : IDisposable
+    {
+        public const int TileWidth = 256;
+        private const int MaxTiles = 1024;
+        private const int MaxRequests = 256;
+
+        /// <summary>
+        /// Identifies a tile: the zoom, the channel, and the tile's place along the capture at that zoom.
+        /// </summary>
+        private struct TileKey : IEquatable<TileKey>
+        {
+            public int ZoomShift;
+            public int Channel;
+            public long Tile;
+
+            public bool Equals(TileKey Other)
+            {
+                return ZoomShift == Other.ZoomShift && Channel == Other.Channel && Tile == Other.Tile;
+            }
+
+            public override int GetHashCode()
+            {
+                return Tile.GetHashCode() ^ (ZoomShift << 24) ^ (Channel << 16);
+            }
+        }
+
+        /// <summary>
+        /// A rendered tile.
+        /// </summary>
+        private class Tile
+        {
+            public TileKey Key;
+            public Bitmap Image;
+            public bool Partial;        // Drawn short of the end of the signal
+            public int Extension;       // The extension of the signals it was drawn at
+            public Bitmap Update;       // Drawn again, waiting to replace the image (on the UI thread)
+        }
+
+        private int tileHeight;
+        private int highStateYValue;
+        private int lowStateYValue;
+        private object tileLock = new object();
+        private Dictionary<TileKey, LinkedListNode<Tile>> tiles = new Dictionary<TileKey, LinkedListNode<Tile>>();
+        private LinkedList<Tile> recentTiles = new LinkedList<Tile>();   // Most recently used first
+        private LinkedList<TileKey> requests = new LinkedList<TileKey>();
+        private TransitionIndex[] signals;
+        private TransitionIndex unknown;
+        private int generation = 0;     // Changes with the plot, so tiles of an earlier one are dropped
+        private int extension = 0;      // Changes as the plot grows, so tiles at its end are drawn again
+        private Thread renderThread;
+        private bool running;
+
+        #region Constructors
+
+        /// <summary>
+        /// Creates and initializes a WaveformTileCache object.
+        /// </summary>
+        /// <param name="TileHeight">The height of a tile (one channel's plot)</param>
+        /// <param name="HighStateYValue">The Y position of the high state in a tile</param>
+        /// <param name="LowStateYValue">The Y position of the low state in a tile</param>
+        public WaveformTileCache(int TileHeight, int HighStateYValue, int LowStateYValue)
+        {
+            tileHeight = TileHeight;
+            highStateYValue = HighStateYValue;
+            lowStateYValue = LowStateYValue;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Set the signals to draw, dropping the tiles of the previous ones.
+        /// </summary>
+        /// <param name="Signals">The transitions of each channel (may be null)</param>
+        /// <param name="Unknown">The ranges where the state of the channels isn't known (may be null)</param>
+        public void SetSignals(TransitionIndex[] Signals, TransitionIndex Unknown)
+        {
+            lock (tileLock)
+            {
+                signals = Signals;
+                unknown = Unknown;
+                generation++;
+                requests.Clear();
+                foreach (Tile tile in recentTiles)
+                    disposeTile(tile);
+                recentTiles.Clear();
+                tiles.Clear();
+            }
+        }
+
+        /// <summary>
+        /// Tell the cache that the signals have grown, so the tiles drawn short of their end are drawn again
+        /// (the old ones are shown until the new ones are ready).
+        /// </summary>
+        public void SignalsExtended()
+        {
+            lock (tileLock)
+                extension++;
+        }
+
+        /// <summary>
+        /// Get a tile, requesting it if it isn't ready. Tiles are only disposed in here (and when the signals
+        /// change), so a tile handed out stays valid until the next call on the same thread.
+        /// </summary>
+        /// <param name="ZoomShift">The zoom, as a power of two (0 is a pixel per tick, positive zooms in)</param>
+        /// <param name="Tile">The tile's place along the capture (its left pixel is Tile * TileWidth)</param>
+        /// <param name="Channel">The channel</param>
+        /// <returns>The tile's bitmap, or null if it isn't ready</returns>
+        public Bitmap GetTile(int ZoomShift, long Tile, int Channel)
+        {
+            LinkedListNode<Tile> node;
+            TileKey key;
+
+            key.ZoomShift = ZoomShift;
+            key.Channel = Channel;
+            key.Tile = Tile;
+
+            lock (tileLock)
+            {
+                // Drop the least recently used tiles.
+                while (recentTiles.Count > MaxTiles)
+                {
+                    Tile oldest = recentTiles.Last.Value;
+
+                    recentTiles.RemoveLast();
+                    tiles.Remove(oldest.Key);
+                    disposeTile(oldest);
+                }
+
+                if (tiles.TryGetValue(key, out node))
+                {
+                    Tile tile = node.Value;
+
+                    recentTiles.Remove(node);
+                    recentTiles.AddFirst(node);
+
+                    // A tile drawn again replaces the old one here, since it can only be disposed of on this thread.
+                    if (tile.Update != null)
+                    {
+                        tile.Image.Dispose();
+                        tile.Image = tile.Update;
+                        tile.Update = null;
+                    }
+
+                    // A tile at the end of signals that have grown since is drawn again.
+                    if (tile.Partial && tile.Extension != extension)
+                        requestTile(key);
+                    return tile.Image;
+                }
+
+                if (signals == null || Channel >= signals.Length || signals[Channel] == null)
+                    return null;
+
+                requestTile(key);
+            }
+            return null;
+        }
+
+        /// <summary>
+        /// Ask for a tile to be drawn (with the lock held).
+        /// </summary>
+        /// <param name="key">The tile</param>
+        private void requestTile(TileKey key)
+        {
+            // The latest requests are for what's on display, so they go first, and requests for
+            // another zoom (or too old to be on display any more) are dropped.
+            if (requests.Count > 0 && requests.First.Value.ZoomShift != key.ZoomShift)
+                requests.Clear();
+            if (!requests.Contains(key))
+            {
+                requests.AddFirst(key);
+                if (requests.Count > MaxRequests)
+                    requests.RemoveLast();
+            }
+
+            if (renderThread == null)
+            {
+                running = true;
+                renderThread = new Thread(RenderLoop);
+                renderThread.Name = "Waveform tiles";
+                renderThread.IsBackground = true;
+                renderThread.Start();
+            }
+            else
+                Monitor.Pulse(tileLock);
+        }
+
+        /// <summary>
+        /// Dispose of a tile's images.
+        /// </summary>
+        /// <param name="tile"></param>
+        private static void disposeTile(Tile tile)
+        {
+            tile.Image.Dispose();
+            if (tile.Update != null)
+                tile.Update.Dispose();
+        }
+
+        /// <summary>
+        /// Render the requested tiles on a thread of their own.
+        /// </summary>
+        private void RenderLoop()
+        {
+            WaveformRasterizer rasterizer = new WaveformRasterizer(highStateYValue, lowStateYValue);
+
+            try
+            {
+                while (true)
+                {
+                    TileKey key;
+                    TransitionIndex signal, unknownRanges;
+                    int tileGeneration, tileExtension;
+                    long right;
+                    bool partial;
+                    Bitmap image;
+                    LinkedListNode<Tile> node;
+
+                    lock (tileLock)
+                    {
+                        while (running && requests.Count == 0)
+                            Monitor.Wait(tileLock);
+                        if (!running)
+                            break;
+
+                        key = requests.First.Value;
+                        requests.RemoveFirst();
+                        signal = signals[key.Channel];
+                        unknownRanges = unknown;
+                        tileGeneration = generation;
+                        tileExtension = extension;
+                    }
+
+                    // The tile reaches a tick past its right side (see WaveformRasterizer.Render()).
+                    right = (key.Tile + 1) * TileWidth;
+                    right = (key.ZoomShift >= 0 ? right >> key.ZoomShift : right << -key.ZoomShift) + 1;
+                    partial = (right > signal.Length);
+
+                    image = new Bitmap(TileWidth, tileHeight, PixelFormat.Format32bppPArgb);
+                    using (Graphics g = Graphics.FromImage(image))
+                        rasterizer.Render(g, signal, unknownRanges, key.ZoomShift, key.Tile * TileWidth, TileWidth);
+
+                    lock (tileLock)
+                    {
+                        // The signals changed while the tile was drawn.
+                        if (tileGeneration != generation)
+                        {
+                            image.Dispose();
+                            continue;
+                        }
+
+                        if (tiles.TryGetValue(key, out node))
+                        {
+                            // The tile was drawn again as the signals grew.
+                            if (node.Value.Update != null)
+                                node.Value.Update.Dispose();
+                            node.Value.Update = image;
+                        }
+                        else
+                        {
+                            node = recentTiles.AddFirst(new Tile());
+                            node.Value.Key = key;
+                            node.Value.Image = image;
+                            tiles.Add(key, node);
+                        }
+                        node.Value.Partial = partial;
+                        node.Value.Extension = tileExtension;
+                    }
+
+                    BroadcastTileRendered();
+                }
+            }
+            finally
+            {
+                rasterizer.Dispose();
+            }
+        }
+
+        /// <summary>
+        /// Stop rendering and drop the tiles.
+        /// </summary>
+        public void Dispose()
+        {
+            Thread thread;
+
+            lock (tileLock)
+            {
+                running = false;
+                thread = renderThread;
+                renderThread = null;
+                Monitor.Pulse(tileLock);
+            }
+
+            if (thread != null)
+                thread.Join();
+            SetSignals(null, null);
+        }
+
+        #endregion
+
+        #region Events
+
+        /// <summary>
+        /// Handle this event to be told when a requested tile is ready (it is raised on the rendering thread).
+        /// </summary>
+        public event EventHandler TileRendered;
+
+        /// <summary>
+        /// Broadcast a message signalling to listeners that a tile is ready.
+        /// </summary>
+        protected void BroadcastTileRendered()
+        {
+            EventHandler handler = TileRendered;
+
+            if (handler != null)
+                handler(this, EventArgs.Empty);
+        }
+
+        #endregion
+    }
+}
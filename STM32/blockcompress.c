@@ -0,0 +1,266 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <string.h>
+#include "blockcompress.h"
+
+// Matches may refer back this many bytes (the decoder keeps this much history).
+#define HISTORY_SIZE 1024
+
+// New input is collected after the history, then compressed in one go.
+#define INPUT_SIZE 1024
+
+#define MIN_MATCH 3
+#define MAX_MATCH 0x7fffffffUL
+#define MAX_LITERALS 128
+#define SHORT_MATCH 127
+
+#define HASH_BITS 10
+#define HASH_SIZE (1 << HASH_BITS)
+
+static uint8_t window[HISTORY_SIZE + INPUT_SIZE];
+static uint16_t windowPos; // the next byte to compress
+static uint16_t windowFill; // the end of the data in the window
+static uint32_t windowBase; // the stream offset of window[0]
+
+// The (low 16 bits of the) stream offset where each 3-byte hash was last seen.
+static uint16_t hashTable[HASH_SIZE];
+
+static uint8_t literals[MAX_LITERALS];
+static uint8_t literalCount;
+
+// The match being extended. It is only sent once it ends, so a long run of
+// idle samples (that spans many calls) becomes a single token.
+static uint32_t matchLength;
+static uint16_t matchDistance;
+static uint16_t lastDistance;
+
+static void (*outputCallback)(uint8_t OutChar);
+
+static void compressWindow(uint8_t final);
+static uint32_t findMatch(uint16_t pos, uint16_t end);
+static void sendLiterals(void);
+static void sendMatch(void);
+static void sendVarint(uint32_t value);
+
+/**
+ * @brief  Initialize block compression
+ * @param  Callback: a pointer to a function that will receive output bytes
+ *         from the compression process
+ * @retval none
+ */
+void BlockCompressInit(void (*Callback)(uint8_t)) {
+	outputCallback = Callback;
+
+	memset(hashTable, 0, sizeof(hashTable));
+	windowPos = 0;
+	windowFill = 0;
+	windowBase = 0;
+	literalCount = 0;
+	matchLength = 0;
+	matchDistance = 0;
+	lastDistance = 1;
+}
+
+/**
+ * @brief  De-initialize block compression
+ * @param  none
+ * @retval none
+ */
+void BlockCompressDenit() {
+	outputCallback = NULL;
+}
+
+/**
+ * @brief  Add a span of bytes to the compression stream. Output is only
+ *         produced when a literal run or a match ends, so some of the input
+ *         may be held until later calls (or BlockCompressFlush()).
+ * @param  data: the bytes to compress
+ * @param  len: the number of bytes
+ * @retval none
+ */
+void BlockCompress(const uint8_t *data, uint16_t len) {
+	uint16_t n, shift;
+
+	while (len > 0) {
+		n = sizeof(window) - windowFill;
+		if (n > len)
+			n = len;
+
+		memcpy(&window[windowFill], data, n);
+		windowFill += n;
+		data += n;
+		len -= n;
+
+		compressWindow(0);
+
+		// Keep only as much history as a match can refer to.
+		if (windowPos > HISTORY_SIZE) {
+			shift = windowPos - HISTORY_SIZE;
+			memmove(window, &window[shift], windowFill - shift);
+			windowPos -= shift;
+			windowFill -= shift;
+			windowBase += shift;
+		}
+	}
+}
+
+/**
+ * @brief  Compress and send all of the remaining input.
+ * @param  none
+ * @retval none
+ */
+void BlockCompressFlush() {
+	compressWindow(1);
+	if (matchLength > 0)
+		sendMatch();
+	sendLiterals();
+}
+
+/**
+ * @brief  Compress the window from 'windowPos' up to 'windowFill'. Unless
+ *         this is the final call, up to MIN_MATCH - 1 bytes are left for the
+ *         next call, since a match can't be looked for without them.
+ * @param  final: non-zero to compress all of the input
+ * @retval none
+ */
+static void compressWindow(uint8_t final) {
+	uint16_t pos = windowPos;
+	uint16_t end = windowFill;
+
+	while (pos < end) {
+		// Extend the current match for as long as it keeps matching.
+		if (matchLength > 0) {
+			if (window[pos] == window[pos - matchDistance] && matchLength < MAX_MATCH) {
+				matchLength++;
+				pos++;
+				continue;
+			}
+			sendMatch();
+		}
+
+		if (pos + MIN_MATCH > end) {
+			if (!final)
+				break;
+		} else if ((matchLength = findMatch(pos, end)) > 0) {
+			sendLiterals();
+			pos += matchLength;
+			continue;
+		}
+
+		literals[literalCount++] = window[pos++];
+		if (literalCount == MAX_LITERALS)
+			sendLiterals();
+	}
+
+	windowPos = pos;
+}
+
+/**
+ * @brief  Look for a match at a window position. The candidates are the
+ *         previous byte (a run), the distance of the last match (a repeating
+ *         pattern), and the last position with the same 3-byte hash. The
+ *         longest one is used.
+ * @param  pos: the window position
+ * @param  end: the end of the data in the window
+ * @retval the match length (0 if there is no match of at least MIN_MATCH),
+ *         with 'matchDistance' set
+ */
+static uint32_t findMatch(uint16_t pos, uint16_t end) {
+	uint16_t candidates[3];
+	uint16_t hash, offset, distance, len, best = 0;
+	uint8_t i;
+
+	hash = ((window[pos] << 7) ^ (window[pos + 1] << 3) ^ window[pos + 2]) & (HASH_SIZE - 1);
+	offset = (uint16_t) (windowBase + pos);
+
+	candidates[0] = 1;
+	candidates[1] = lastDistance;
+	candidates[2] = offset - hashTable[hash];
+	hashTable[hash] = offset;
+
+	for (i = 0; i < 3; i++) {
+		distance = candidates[i];
+		if (distance == 0 || distance > HISTORY_SIZE || distance > pos)
+			continue;
+
+		len = 0;
+		while (pos + len < end && window[pos + len] == window[pos + len - distance])
+			len++;
+
+		if (len > best) {
+			best = len;
+			matchDistance = distance;
+		}
+	}
+
+	if (best < MIN_MATCH)
+		return 0;
+
+	lastDistance = matchDistance;
+	return best;
+}
+
+/**
+ * @brief  Send the pending literal bytes (if any) as a literal token.
+ * @param  none
+ * @retval none
+ */
+static void sendLiterals() {
+	uint8_t i;
+
+	if (literalCount == 0)
+		return;
+
+	outputCallback(literalCount - 1);
+	for (i = 0; i < literalCount; i++)
+		outputCallback(literals[i]);
+	literalCount = 0;
+}
+
+/**
+ * @brief  Send the current match as a match token.
+ * @param  none
+ * @retval none
+ */
+static void sendMatch() {
+	uint32_t len = matchLength - MIN_MATCH;
+
+	if (len < SHORT_MATCH)
+		outputCallback(0x80 | len);
+	else {
+		outputCallback(0x80 | SHORT_MATCH);
+		sendVarint(len - SHORT_MATCH);
+	}
+	sendVarint(matchDistance - 1);
+	matchLength = 0;
+}
+
+/**
+ * @brief  Send a variable-length integer.
+ * @param  value: the value to send
+ * @retval none
+ */
+static void sendVarint(uint32_t value) {
+	while (value >= 0x80) {
+		outputCallback((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	outputCallback(value);
+}
@@ -0,0 +1,50 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BLOCKCOMPRESS_H_
+#define BLOCKCOMPRESS_H_
+
+#include <stdint.h>
+
+// A byte-oriented LZ77 compressor for spans of sample data. It keeps a small
+// window of history, so it needs only a few KB of RAM, and long runs of idle
+// samples become a single match token. The stream format is:
+//
+//   0xxxxxxx <x + 1 literal bytes>
+//   1xxxxxxx [length extension] <distance - 1>
+//
+// A match copies (x + 3) bytes from 'distance' (1 to 1024) bytes back in the
+// output. The distance is a variable-length integer (7 bits per byte, low bits
+// first, bit 7 set on all but the last byte), so the usual short distances
+// take one byte. When x is 127, another variable-length integer follows the
+// token and the match length is 130 plus that value.
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+extern void BlockCompressInit(void (*Callback)(uint8_t));
+extern void BlockCompressDenit(void);
+extern void BlockCompress(const uint8_t *data, uint16_t len);
+extern void BlockCompressFlush(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BLOCKCOMPRESS_H_ */
@@ -0,0 +1,195 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "main.h"
+#include "capture.h"
+#include "burst.h"
+#include "trigger.h"
+#include "stats.h"
+
+// The most queue space one sample can take once it has been through the
+// capture routines (a transition-only record with a 5-byte delta).
+#define MAX_BYTES_PER_SAMPLE 6
+
+// The most samples passed to CaptureBlock() in one go.
+#define DRAIN_SPAN_MAX 512
+
+static const volatile uint8_t *buffer;
+static uint32_t size;
+static uint32_t depth;
+static uint32_t pre;
+
+static uint32_t scanned; // the position of the next sample to check for the trigger
+static uint8_t triggered;
+static uint8_t stopped;
+static uint32_t windowStart; // the first and last + 1 positions to be sent
+static uint32_t windowEnd;
+static uint32_t drained; // the position of the next sample to be sent
+
+/**
+ * @brief  Initialize burst mode for a new capture.
+ * @param  samples: the circular buffer the capture engine writes to
+ * @param  bufferSize: the size of the buffer, in samples
+ * @param  totalDepth: the number of samples to send (pre- plus post-trigger);
+ *         limited to the buffer size
+ * @param  preTrigger: the number of samples to send from before the trigger;
+ *         limited to the depth
+ * @retval none
+ */
+void BurstInit(const volatile uint8_t *samples, uint32_t bufferSize, uint32_t totalDepth, uint32_t preTrigger) {
+	buffer = samples;
+	size = bufferSize;
+	depth = (totalDepth < bufferSize) ? totalDepth : bufferSize;
+	pre = (preTrigger < depth) ? preTrigger : depth;
+
+	// The trigger (see trigger.c) is only looked for once the pre-trigger
+	// samples have been recorded. With no trigger set, the window starts
+	// straight away (after the hold-off).
+	scanned = pre;
+	triggered = 0;
+	stopped = 0;
+	windowStart = 0;
+	windowEnd = 0;
+	drained = 0;
+}
+
+/**
+ * @brief  Set the trigger position and the window to send around it.
+ * @param  position: the position of the trigger sample
+ * @retval none
+ */
+static void setTrigger(uint32_t position) {
+	windowStart = position - pre;
+	windowEnd = windowStart + depth;
+	triggered = 1;
+}
+
+/**
+ * @brief  Check the newly written samples for the trigger. Called regularly
+ *         while recording.
+ * @param  written: the number of samples written to the buffer so far
+ * @retval 1 if the window is complete and recording should stop, otherwise 0
+ */
+uint8_t BurstUpdate(uint32_t written) {
+	uint32_t index, count, skip;
+
+	if (!triggered) {
+		// If the capture engine has lapped us, skip the samples that have
+		// already been overwritten.
+		if (scanned < written && written - scanned >= size)
+			scanned = written - size + 1;
+
+		while (!triggered && scanned < written) {
+			// Scan one contiguous part of the buffer at a time.
+			index = scanned % size;
+			count = written - scanned;
+			if (count > size - index)
+				count = size - index;
+
+			skip = TriggerScan(buffer + index, count);
+			scanned += skip;
+			if (skip < count)
+				setTrigger(scanned);
+		}
+	}
+
+	return triggered && (written >= windowEnd);
+}
+
+/**
+ * @brief  Trigger now, whether or not the trigger condition has been seen
+ *         (used when the sampling time runs out without a trigger).
+ * @param  none
+ * @retval none
+ */
+void BurstTrigger() {
+	if (!triggered)
+		setTrigger(scanned);
+}
+
+/**
+ * @brief  Check if the trigger has fired.
+ * @param  none
+ * @retval 1 if the trigger has fired, otherwise 0
+ */
+uint8_t BurstTriggered() {
+	return triggered;
+}
+
+/**
+ * @brief  Forget the trigger, if it has fired, and look for the next one
+ *         from there on (the trigger may have caught the wrong event). This
+ *         is only possible while recording.
+ * @param  none
+ * @retval 1 if successful, 0 if recording has stopped
+ */
+uint8_t BurstRearm() {
+	if (stopped)
+		return 0;
+
+	TriggerInit();
+	triggered = 0;
+	return 1;
+}
+
+/**
+ * @brief  End recording and get ready to send the window. The capture engine
+ *         must have stopped writing to the buffer.
+ * @param  written: the number of samples written to the buffer
+ * @retval none
+ */
+void BurstStop(uint32_t written) {
+	// Recording may have stopped a little after the end of the window; any
+	// samples that were overwritten in that time are lost.
+	if (windowEnd > written)
+		windowEnd = written;
+	if (written - windowStart > size) {
+		Stats.dropped += written - windowStart - size;
+		windowStart = written - size;
+		Overflow = 1;
+	}
+
+	drained = windowStart;
+	stopped = 1;
+	Irqs = 0;
+}
+
+/**
+ * @brief  Pass as much of the window through the capture routines as the
+ *         sample queue has room for. Called regularly after BurstStop().
+ * @param  none
+ * @retval 1 if the whole window has been sent, otherwise 0
+ */
+uint8_t BurstDrain() {
+	uint32_t index, count;
+
+	index = drained % size;
+	count = windowEnd - drained;
+	if (count > size - index)
+		count = size - index;
+	if (count > SampleQueueFree() / MAX_BYTES_PER_SAMPLE)
+		count = SampleQueueFree() / MAX_BYTES_PER_SAMPLE;
+	if (count > DRAIN_SPAN_MAX)
+		count = DRAIN_SPAN_MAX;
+
+	CaptureBlock(buffer + index, count);
+	drained += count;
+
+	return drained == windowEnd;
+}
@@ -0,0 +1,48 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BURST_H_
+#define BURST_H_
+
+#include <stdint.h>
+
+// Burst mode records samples into a large circular buffer at rates the link
+// can't sustain. Once the trigger fires, recording continues for the
+// post-trigger part of the depth, then the window (pre-trigger samples, then
+// post-trigger samples) is passed through the capture routines at whatever
+// rate the output can take. These routines only deal with positions in the
+// buffer (the count of samples written so far); the capture engine that fills
+// the buffer is elsewhere, so they can be exercised on a host as well.
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+extern void BurstInit(const volatile uint8_t *buffer, uint32_t size, uint32_t depth, uint32_t pre);
+extern uint8_t BurstUpdate(uint32_t written);
+extern void BurstTrigger(void);
+extern uint8_t BurstTriggered(void);
+extern uint8_t BurstRearm(void);
+extern void BurstStop(uint32_t written);
+extern uint8_t BurstDrain(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BURST_H_ */
@@ -0,0 +1,707 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "main.h"
+#include "capture.h"
+#include "trigger.h"
+#include "frame.h"
+#include "stats.h"
+
+// In transition-only mode, the last sample and sample counter that were
+// actually queued. Records are relative to these.
+static uint8_t prevSample;
+static uint32_t prevTick;
+
+// In run-length mode, the (stacked) sample byte being repeated and the number
+// of times it has been seen so far. Runs are cut at RUN_MAX so that a record
+// never takes more than 4 bytes, and so that an idle input still shows up on
+// the host every so often.
+#define RUN_MAX 0x1fffff
+static uint8_t runValue;
+static uint32_t runLength;
+static uint32_t runStart;
+
+// The pins being sampled (SamplingPins) can be any of the 8, so each raw
+// sample is first looked up in 'gather', which packs the sampled pins into
+// the low bits (lowest pin first); 3 scattered pins then take up no more room
+// than the first 3. If our SamplingChannels setting is such that we
+// can send more than one sample per byte (SamplingChannels <= 4)
+// then we 'stack' samples before enqueuing them. In continuous mode, a whole
+// word of stacked samples is put together before the queue is touched; in
+// run-length mode, each stacked byte goes to the current run.
+static uint32_t stackedWord;
+static uint8_t stackShift;
+static uint8_t gather[256];
+static uint8_t gatherPins;
+static uint8_t channelShift;
+
+// Set while samples are being discarded until the trigger (and the hold-off
+// after it) is over. Burst mode handles the trigger itself.
+static uint8_t waitForTrigger;
+
+// Set by CaptureRearm() for the capture routine to start looking for the
+// trigger afresh.
+static volatile uint8_t rearmRequest;
+
+// The capture routines for the current mode and channel width (see
+// CAPTURE_KERNEL below). EnqueueSample() points at one of them.
+typedef struct {
+	int16_t (*sample)(uint8_t sample);		// One sample at the full rate
+	int16_t (*decimated)(uint8_t sample);		// One sample while decimating
+	void (*block)(const volatile uint8_t *samples, uint16_t count);
+} CaptureKernel;
+
+static const CaptureKernel kernels[3][4];
+static const CaptureKernel *kernel;
+static int16_t waitTrigger(uint8_t sample);
+
+// Samples that can't be queued are not just dropped: they are counted, and
+// once the queue has room again the host is sent a gap record (see
+// CaptureNextEvent()), so that everything after the gap still shows up at the
+// time it was sampled. Positions are on the host's timeline, in samples since
+// the start of the capture. In transition-only mode that is the sample tick;
+// in the other modes it is kept in 'streamPos', every sample byte (queued or
+// not) taking up 'byteSpan' samples of the timeline.
+static uint32_t streamPos;
+static uint32_t byteSpan;
+static uint8_t samplesPerByte;
+static uint8_t gapOpen;
+static uint32_t gapStart;
+
+// Once samples have been lost, the gap is only closed when the queue has this
+// much room again. An overloaded capture then has a few long gaps rather than
+// a gap record for every other byte.
+#define GAP_RESUME_FREE 1024
+
+// While the main loop asks for it (see CaptureDecimate()), only one sample in
+// DECIMATION_DIVISOR is taken. The switch is made at a queuing boundary (once
+// a word of stacked samples is queued in continuous mode, once a stacked byte
+// is added to the run in run-length mode, after any sample in transition-only
+// mode; it ends the current run in run-length mode) and recorded in the
+// stream, so the host can stretch the decimated samples back over the
+// timeline.
+#define DECIMATION_DIVISOR 2
+static volatile uint8_t decimateRequest;
+static uint8_t divisor;
+static uint8_t decimationSkip; // samples until the next one is taken (counting it)
+
+// Gap records and rate changes waiting to be sent by the main loop. This is a
+// single-producer/single-consumer ring, like the sample queue: the capture
+// routines only write 'eventTail' and the main loop only writes 'eventHead'.
+#define EVENT_QSIZE 16
+static CaptureEvent events[EVENT_QSIZE];
+static volatile uint32_t eventHead, eventTail;
+
+/**
+ * @brief  Initialize the sample packing state for a new capture. The pins,
+ *         channel count and sampling mode must be set before calling this.
+ * @param  none
+ * @retval none
+ */
+void CaptureInit() {
+	uint16_t raw;
+	uint8_t pin, bit, packed;
+
+	// The table is only rebuilt when the pins change.
+	if (gatherPins != SamplingPins) {
+		for (raw = 0; raw < 256; raw++) {
+			packed = 0;
+			bit = 0;
+			for (pin = 0; pin < 8; pin++) {
+				if (SamplingPins & (1 << pin)) {
+					if (raw & (1 << pin))
+						packed |= 1 << bit;
+					bit++;
+				}
+			}
+			gather[raw] = packed;
+		}
+		gatherPins = SamplingPins;
+	}
+
+	switch (SamplingChannels) {
+	case 1:
+		channelShift = 1;
+		break;
+	case 2:
+		channelShift = 2;
+		break;
+	case 3:
+	case 4:
+		channelShift = 4;
+		break;
+	default:
+		channelShift = 8;
+		break;
+	}
+
+	stackShift = 0;
+	stackedWord = 0;
+	samplesPerByte = (SamplingMode == SAMPLING_MODE_TRANSITIONONLY) ? 1 : 8 / channelShift;
+
+	// The host starts from an all-low sample at tick 0 as well.
+	prevSample = 0;
+	prevTick = 0;
+
+	runValue = 0;
+	runLength = 0;
+	runStart = 0;
+
+	streamPos = 0;
+	byteSpan = samplesPerByte;
+	gapOpen = 0;
+	gapStart = 0;
+
+	decimateRequest = 0;
+	divisor = 1;
+	decimationSkip = 1;
+	eventHead = eventTail = 0;
+
+	waitForTrigger = !TriggerFired() && (BurstDepth == 0);
+	rearmRequest = 0;
+
+	// Pick the capture routines for this capture once, here, rather than
+	// checking the mode and channels for every sample.
+	kernel = &kernels[SamplingMode][channelShift == 8 ? 3 : channelShift >> 1];
+	EnqueueSample = waitForTrigger ? waitTrigger : kernel->sample;
+}
+
+/**
+ * @brief  Ask for the trigger to be looked for afresh (e.g. a pattern then
+ *         edge trigger that has seen the pattern forgets it). Called from the
+ *         main loop; the capture routine does it before the next sample.
+ * @param  none
+ * @retval 1 if the capture is still waiting for the trigger, 0 if it has
+ *         already fired (the capture can't be re-armed then)
+ */
+uint8_t CaptureRearm() {
+	if (!waitForTrigger)
+		return 0;
+	rearmRequest = 1;
+	return 1;
+}
+
+/**
+ * @brief  Ask for decimation to be switched on or off. Called from the main
+ *         loop; the capture routines make the switch at the next queuing
+ *         boundary.
+ * @param  on: non-zero to take only one sample in DECIMATION_DIVISOR
+ * @retval none
+ */
+void CaptureDecimate(uint8_t on) {
+	decimateRequest = (on != 0);
+}
+
+/**
+ * @brief  Get the next gap record or rate change to send to the host. Only
+ *         called by the main loop.
+ * @param  event: receives the event
+ * @retval 1 if an event was returned, 0 if there are none waiting
+ */
+uint8_t CaptureNextEvent(CaptureEvent *event) {
+	uint32_t head = eventHead;
+
+	if (eventTail == head)
+		return 0;
+
+	__DMB();
+	*event = events[head % EVENT_QSIZE];
+
+	__DMB();
+	eventHead = head + 1;
+	return 1;
+}
+
+/**
+ * @brief  Add an event for the main loop to send.
+ * @param  type: the frame type to send it in (FRAME_GAP or FRAME_RATE)
+ * @param  position: the position of the event on the host's timeline
+ * @param  value: the number of samples lost, or the new divisor
+ * @retval 1 if successful, 0 if there is no room for it
+ */
+static uint8_t pushEvent(uint8_t type, uint32_t position, uint32_t value) {
+	uint32_t tail = eventTail;
+	CaptureEvent *event;
+
+	if ((tail - eventHead) >= EVENT_QSIZE)
+		return 0;
+
+	event = &events[tail % EVENT_QSIZE];
+	event->position = position;
+	event->value = value;
+	event->type = type;
+
+	__DMB();
+	eventTail = tail + 1;
+	return 1;
+}
+
+/**
+ * @brief  Send the record for the current gap.
+ * @param  position: the position of the first sample after the gap
+ * @retval 1 if successful, 0 if there is no room for it
+ */
+static uint8_t closeGap(uint32_t position) {
+	if (!pushEvent(FRAME_GAP, gapStart, position - gapStart))
+		return 0;
+
+	Stats.gaps++;
+	Stats.gapSamples += position - gapStart;
+	gapOpen = 0;
+	return 1;
+}
+
+/**
+ * @brief  Queue a record, or count it as lost. After a gap, records are
+ *         counted as lost until the queue has GAP_RESUME_FREE bytes free.
+ * @param  record: the record
+ * @param  len: the length of the record
+ * @param  position: the position of the first sample the record covers
+ * @retval 0 if successful, -1 if the record was lost
+ */
+static int16_t queueRecord(const uint8_t *record, uint16_t len, uint32_t position) {
+	if (gapOpen && (SampleQueueFree() < GAP_RESUME_FREE || !closeGap(position))) {
+		Stats.dropped += len;
+		return -1;
+	}
+
+	if (EnqueueBytes(record, len) == 0)
+		return 0;
+
+	gapOpen = 1;
+	gapStart = position;
+	return -1;
+}
+
+/**
+ * @brief  Queue a word of stacked sample bytes in continuous mode (low byte
+ *         first), or count it as lost.
+ * @param  word: the sample bytes
+ * @retval 0 if successful, -1 if the word was lost
+ */
+static inline int16_t queueWord(uint32_t word) {
+	uint32_t position = streamPos;
+	uint8_t bytes[4];
+
+	streamPos += 4 * byteSpan;
+	if (!gapOpen) {
+		if (EnqueueWord(word) == 0)
+			return 0;
+		gapOpen = 1;
+		gapStart = position;
+		return -1;
+	}
+
+	bytes[0] = word;
+	bytes[1] = word >> 8;
+	bytes[2] = word >> 16;
+	bytes[3] = word >> 24;
+	return queueRecord(bytes, 4, position);
+}
+
+/**
+ * @brief  Queue a transition-only mode record. A record is the number of
+ *         ticks since the previous record as a variable-length integer (7 bits
+ *         per byte, low bits first, bit 7 set on all but the last byte),
+ *         followed by a mask of the channels that changed (the XOR of the
+ *         previous and the new sample). A mask of zero marks the end of the
+ *         capture. The record is queued whole or not at all; if it is dropped,
+ *         the next record is still relative to the last one that was queued.
+ * @param  tick: the sample counter at the time the sample was taken
+ * @param  sample: the (masked) sample
+ * @retval 0 if successful, -1 if the queue is full
+ */
+static int16_t enqueueTransition(uint32_t tick, uint8_t sample) {
+	uint8_t record[6];
+	uint32_t delta = tick - prevTick;
+	uint8_t len = 0;
+
+	while (delta >= 0x80) {
+		record[len++] = (delta & 0x7f) | 0x80;
+		delta >>= 7;
+	}
+	record[len++] = delta;
+	record[len++] = sample ^ prevSample;
+
+	if (queueRecord(record, len, tick) < 0)
+		return -1;
+
+	prevTick = tick;
+	prevSample = sample;
+	return 0;
+}
+
+/**
+ * @brief  Queue the current run-length mode run, if any. A record is the
+ *         (stacked) sample byte followed by the number of times it repeats as
+ *         a variable-length integer (encoded as for transition-only records).
+ * @param  none
+ * @retval 0 if successful, -1 if the queue is full
+ */
+static int16_t flushRun() {
+	uint8_t record[5];
+	uint32_t count = runLength;
+	uint8_t len = 0;
+
+	if (count == 0)
+		return 0;
+
+	record[len++] = runValue;
+	while (count >= 0x80) {
+		record[len++] = (count & 0x7f) | 0x80;
+		count >>= 7;
+	}
+	record[len++] = count;
+
+	runLength = 0;
+	return queueRecord(record, len, runStart);
+}
+
+/**
+ * @brief  Add a (stacked) sample byte to the current run-length mode run,
+ *         queuing the run first if the byte is different or the run is full.
+ * @param  value: the (stacked) sample byte
+ * @retval 0 if successful, -1 if the queue is full
+ */
+static inline int16_t extendRun(uint8_t value) {
+	uint32_t position = streamPos;
+	int16_t result;
+
+	streamPos += byteSpan;
+	if (runLength != 0 && value == runValue && runLength < RUN_MAX) {
+		runLength++;
+		return 0;
+	}
+
+	result = flushRun();
+	runValue = value;
+	runLength = 1;
+	runStart = position;
+	return result;
+}
+
+/**
+ * @brief  Switch decimation on or off, as the main loop asked for. This must
+ *         only be called at a queuing boundary (see DECIMATION_DIVISOR).
+ * @param  position: the position of the first sample at the new rate
+ * @retval none
+ */
+static void changeRate(uint32_t position) {
+	uint8_t newDivisor = decimateRequest ? DECIMATION_DIVISOR : 1;
+
+	// If the host can't be told yet, try again at the next boundary.
+	if (!pushEvent(FRAME_RATE, position, newDivisor))
+		return;
+
+	// A run covers samples at one rate only.
+	if (SamplingMode == SAMPLING_MODE_RUNLENGTH)
+		flushRun();
+
+	divisor = newDivisor;
+	byteSpan = samplesPerByte * divisor;
+	decimationSkip = divisor;
+	EnqueueSample = (divisor > 1) ? kernel->decimated : kernel->sample;
+}
+
+/**
+ * @brief  Check if the main loop wants decimation switched on or off. Called
+ *         at every queuing boundary, so it's kept short.
+ * @param  position: the position of the next sample
+ * @retval none
+ */
+static inline void checkRate(uint32_t position) {
+	if (decimateRequest != (divisor > 1))
+		changeRate(position);
+}
+
+/**
+ * @brief  Take one sample: the body of every per-sample capture routine. It
+ *         is always inlined with a constant width and mode, so each routine
+ *         ends up with only the code for its own mode and channel width. A
+ *         sample may be less than 8 bits, so if the width is less than 8,
+ *         samples are stacked several to a byte.
+ * @param  sample: the raw sample
+ * @param  width: the bits each sample takes up when stacked (1, 2, 4 or 8)
+ * @param  mode: the sampling mode
+ * @retval 0 if successful, -1 if the queue is full
+ */
+static inline __attribute__((always_inline)) int16_t captureSample(uint8_t sample, const uint8_t width,
+		const uint8_t mode) {
+	int16_t result;
+
+	// Pack the pins we're using into the low bits.
+	sample = gather[sample];
+
+	if (mode == SAMPLING_MODE_TRANSITIONONLY) {
+		// Skip samples that are the same. If we're in transition mode, the
+		// record is time-stamped relative to the previous one using 'Irqs'.
+		result = (prevSample == sample) ? 0 : enqueueTransition(Irqs, sample);
+
+		// The rate changes after this sample, once any gap it closed has
+		// been recorded, as in the block routine.
+		checkRate(Irqs + 1);
+		return result;
+	}
+
+	if (mode == SAMPLING_MODE_RUNLENGTH) {
+		// Stack samples up to a byte, which goes to the current run.
+		if (width < 8) {
+			stackedWord |= sample << stackShift;
+			stackShift += width;
+			if (stackShift < 8)
+				return 0;
+
+			sample = stackedWord;
+			stackShift = 0;
+			stackedWord = 0;
+		}
+		result = extendRun(sample);
+	} else {
+		// Stack samples up to a word before queuing them.
+		stackedWord |= (uint32_t) sample << stackShift;
+		stackShift += width;
+		if (stackShift < 32)
+			return 0;
+
+		result = queueWord(stackedWord);
+		stackShift = 0;
+		stackedWord = 0;
+	}
+
+	checkRate(streamPos);
+	return result;
+}
+
+/**
+ * @brief  Process a block of raw samples: the body of every block capture
+ *         routine, inlined with a constant width and mode as for
+ *         captureSample(). This produces exactly the same output as taking
+ *         the samples one at a time, but the packing state is kept in
+ *         registers for the duration of the block.
+ * @param  samples: the raw samples (one byte per sample)
+ * @param  count: the number of samples in the block
+ * @param  width: the bits each sample takes up when stacked (1, 2, 4 or 8)
+ * @param  mode: the sampling mode
+ * @retval none
+ */
+static inline __attribute__((always_inline)) void captureBlock(const volatile uint8_t *samples, uint16_t count,
+		const uint8_t width, const uint8_t mode) {
+	const volatile uint8_t *first = samples, *end = samples + count;
+	const uint8_t *table = gather;
+
+	// While decimating, only one sample in 'divisor' is taken, so the first
+	// one to take may be part-way into the block. The divisor can change at
+	// any queuing boundary.
+	samples += decimationSkip - 1;
+
+	if (mode == SAMPLING_MODE_TRANSITIONONLY) {
+		uint8_t sample;
+		uint32_t tick;
+
+		while (samples < end) {
+			sample = table[*samples];
+
+			// Every sample counts as one tick, just as every timer interrupt
+			// does in interrupt-driven mode, whether it is taken or not.
+			tick = Irqs + (samples - first) + 1;
+
+			if (sample != prevSample)
+				enqueueTransition(tick, sample);
+
+			checkRate(tick + 1);
+			samples += divisor;
+		}
+	} else if (mode == SAMPLING_MODE_RUNLENGTH) {
+		uint8_t stacked = stackedWord;
+		uint8_t shift = stackShift;
+
+		while (samples < end) {
+			stacked |= table[*samples] << shift;
+			shift += width;
+
+			if (shift == 8) {
+				extendRun(stacked);
+				shift = 0;
+				stacked = 0;
+				checkRate(streamPos);
+			}
+			samples += divisor;
+		}
+
+		stackedWord = stacked;
+		stackShift = shift;
+	} else {
+		uint32_t stacked = stackedWord;
+		uint8_t shift = stackShift;
+
+		while (samples < end) {
+			stacked |= (uint32_t) table[*samples] << shift;
+			shift += width;
+
+			if (shift == 32) {
+				queueWord(stacked);
+				shift = 0;
+				stacked = 0;
+				checkRate(streamPos);
+			}
+			samples += divisor;
+		}
+
+		stackedWord = stacked;
+		stackShift = shift;
+	}
+
+	decimationSkip = samples - end + 1;
+}
+
+// The capture routines for each mode and channel width: one taking a sample
+// at a time at the full rate, one taking a sample at a time while decimating,
+// and one taking a block of samples. Transition-only mode does not stack
+// samples, so it only needs one set.
+#define CAPTURE_KERNEL(name, width, mode) \
+	static int16_t name##Sample(uint8_t sample) { \
+		return captureSample(sample, width, mode); \
+	} \
+	static int16_t name##Decimated(uint8_t sample) { \
+		if (--decimationSkip) \
+			return 0; \
+		decimationSkip = divisor; \
+		return captureSample(sample, width, mode); \
+	} \
+	static void name##Block(const volatile uint8_t *samples, uint16_t count) { \
+		captureBlock(samples, count, width, mode); \
+	}
+
+CAPTURE_KERNEL(continuous1, 1, SAMPLING_MODE_CONTINUOUS)
+CAPTURE_KERNEL(continuous2, 2, SAMPLING_MODE_CONTINUOUS)
+CAPTURE_KERNEL(continuous4, 4, SAMPLING_MODE_CONTINUOUS)
+CAPTURE_KERNEL(continuous8, 8, SAMPLING_MODE_CONTINUOUS)
+CAPTURE_KERNEL(transitions, 8, SAMPLING_MODE_TRANSITIONONLY)
+CAPTURE_KERNEL(runLength1, 1, SAMPLING_MODE_RUNLENGTH)
+CAPTURE_KERNEL(runLength2, 2, SAMPLING_MODE_RUNLENGTH)
+CAPTURE_KERNEL(runLength4, 4, SAMPLING_MODE_RUNLENGTH)
+CAPTURE_KERNEL(runLength8, 8, SAMPLING_MODE_RUNLENGTH)
+
+#define KERNEL(name) { name##Sample, name##Decimated, name##Block }
+
+// Indexed by sampling mode, then by channel width (1, 2, 4 and 8 bits).
+static const CaptureKernel kernels[3][4] = {
+	{ KERNEL(continuous1), KERNEL(continuous2), KERNEL(continuous4), KERNEL(continuous8) },
+	{ KERNEL(transitions), KERNEL(transitions), KERNEL(transitions), KERNEL(transitions) },
+	{ KERNEL(runLength1), KERNEL(runLength2), KERNEL(runLength4), KERNEL(runLength8) }
+};
+
+static const CaptureKernel *kernel = &kernels[SAMPLING_MODE_CONTINUOUS][3];
+
+/**
+ * @brief  Discard samples until the trigger (and the hold-off after it) is
+ *         over, then switch to the capture routine. The sample count is held
+ *         at zero meanwhile, so the first sample captured is sample 1.
+ * @param  sample: the raw sample
+ * @retval 0 if successful, -1 if the queue is full
+ */
+static int16_t waitTrigger(uint8_t sample) {
+	if (rearmRequest) {
+		TriggerInit();
+		rearmRequest = 0;
+	}
+
+	if (TriggerScan(&sample, 1) != 0) {
+		Irqs = 0;
+		return 0;
+	}
+
+	waitForTrigger = 0;
+	EnqueueSample = kernel->sample;
+	return EnqueueSample(sample);
+}
+
+/**
+ * @brief  Add a sample to the queue. This is called once per sample from the
+ *         timer interrupt, and points at the capture routine for the current
+ *         mode, channel width and rate (see CaptureInit()).
+ * @param  sample: the sample to add to the queue
+ * @retval 0 if successful, -1 if the queue is full
+ */
+int16_t (*EnqueueSample)(uint8_t sample) = continuous8Sample;
+
+/**
+ * @brief  Add a final record to the queue at the end of a capture. In
+ *         transition-only mode, the last sample we sent may have been a while
+ *         ago and we need to have a 'duration' of the last signal state, so a
+ *         record with an empty change mask is sent. In run-length mode, the
+ *         current run is sent. In continuous mode, the stacked sample bytes not
+ *         yet queued are sent (a byte that isn't full is dropped). If samples
+ *         are still being lost, the gap record runs to the end of the capture.
+ * @param  none
+ * @retval none
+ */
+void EnqueueFinalSample() {
+	uint8_t bytes[4], len = 0;
+
+	if (SamplingMode == SAMPLING_MODE_TRANSITIONONLY)
+		enqueueTransition(Irqs, prevSample);
+	else if (SamplingMode == SAMPLING_MODE_RUNLENGTH)
+		flushRun();
+	else {
+		// Send the whole bytes of the word being put together.
+		while (stackShift >= 8) {
+			bytes[len++] = stackedWord;
+			stackedWord >>= 8;
+			stackShift -= 8;
+		}
+		if (len != 0) {
+			queueRecord(bytes, len, streamPos);
+			streamPos += len * byteSpan;
+		}
+	}
+
+	if (gapOpen)
+		closeGap(SamplingMode == SAMPLING_MODE_TRANSITIONONLY ? Irqs : streamPos);
+}
+
+/**
+ * @brief  Process a block of raw samples, as delivered by the DMA capture
+ *         engine. This produces exactly the same output as calling
+ *         EnqueueSample() for every sample.
+ * @param  samples: the raw samples (one byte per sample)
+ * @param  count: the number of samples in the block
+ * @retval none
+ */
+void CaptureBlock(const volatile uint8_t *samples, uint16_t count) {
+	uint16_t skip;
+
+	// Until the trigger, samples are discarded (see waitTrigger()).
+	if (waitForTrigger) {
+		if (rearmRequest) {
+			TriggerInit();
+			rearmRequest = 0;
+		}
+
+		skip = TriggerScan(samples, count);
+		if (skip == count)
+			return;
+
+		samples += skip;
+		count -= skip;
+		waitForTrigger = 0;
+	}
+
+	kernel->block(samples, count);
+	Irqs += count;
+}
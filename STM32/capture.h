@@ -0,0 +1,62 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdint.h>
+
+// The capture routines turn raw 8-bit pin samples into the byte stream that
+// is queued for output (stacked samples in continuous mode, runs of stacked
+// samples in run-length mode, time-stamped records in transition-only mode).
+// They do not touch any peripherals, so they can be built and exercised on a
+// host as well as on the micro. There is a set of routines for each mode and
+// channel width, picked by CaptureInit() at the start of a capture;
+// EnqueueSample() points at the one that takes a sample at a time.
+//
+// Alongside the byte stream, they produce events for the main loop to send
+// in frames of their own: a gap record when samples could not be queued, and
+// a rate change when decimation is switched on or off. The frame payload is
+// the position of the event on the host's timeline (in samples since the
+// start of the capture, wrapping at 32 bits; see frame.h) followed by the
+// value, 4 bytes each.
+
+#define CAPTURE_EVENT_PAYLOAD 8
+
+typedef struct {
+	uint32_t position;	// Where on the timeline the event is
+	uint32_t value;		// Number of samples lost, or the new divisor
+	uint8_t type;		// FRAME_GAP or FRAME_RATE
+} CaptureEvent;
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+extern void CaptureInit(void);
+extern int16_t (*EnqueueSample)(uint8_t sample);
+extern void EnqueueFinalSample(void);
+extern void CaptureBlock(const volatile uint8_t *samples, uint16_t count);
+extern void CaptureDecimate(uint8_t on);
+extern uint8_t CaptureRearm(void);
+extern uint8_t CaptureNextEvent(CaptureEvent *event);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CAPTURE_H_ */
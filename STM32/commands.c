@@ -20,13 +20,35 @@
 #include <string.h>
 #include <stdlib.h>
 #include "main.h"
+#include "evalboard.h"
+#include "trigger.h"
+#include "frame.h"
+#include "stats.h"
+#include "capture.h"
+#include "burst.h"
 
 uint8_t SamplingActive = 0;
-uint16_t SamplingTime = 1000;
+uint8_t SamplingStop = 0;
+uint32_t SamplingTime = 1000;
 uint8_t SamplingChannels = 4;
+uint8_t SamplingPins = 0x0f;
 uint32_t SamplingRate = 1000;
 uint8_t SamplingCompression = 0;
 uint8_t SamplingMode = SAMPLING_MODE_CONTINUOUS;
+uint8_t SamplingDma = 0;
+uint8_t SamplingDecimate = 0;
+uint32_t BurstDepth = 0;
+uint32_t BurstPre = 0;
+uint8_t TriggerMode = TRIGGER_NONE;
+uint8_t TriggerMask = 0;
+uint8_t TriggerValue = 0;
+uint8_t TriggerRising = 0;
+uint8_t TriggerFalling = 0;
+uint32_t TriggerHoldoff = 0;
+uint8_t FlowControl = 0;
+int32_t FlowCredit = 0;
+
+static void SendReply(const char *command, uint8_t result);
 
 /**
  * @brief  Process commands and settings sent to us over the serial port.
@@ -38,11 +60,24 @@ uint8_t SamplingMode = SAMPLING_MODE_CONTINUOUS;
  *   Settings are sent via USART in a simple format: a 4 character setting name
  *   followed by an equal sign with a value.
  *
- *   CHAN=<# channels>
+ *   CHAN=<# channels (the first pins)>
+ *   MASK=<pins to sample (any of them; the channel count follows)>
  *   RATE=<sampling rate in Hz>
- *   TIME=<total sample time in ms>
- *   COMP=<Y/N compression>
- *   MODE=<T/C compression>
+ *   TRIG=<N/P/E/PE trigger (none, pattern, edge, pattern then edge)>
+ *   TMSK=<trigger pattern mask>
+ *   TVAL=<trigger pattern value>
+ *   TRIS=<trigger rising edge channels>
+ *   TFAL=<trigger falling edge channels>
+ *   HOLD=<samples to skip after the trigger>
+ *   TIME=<total sample time in ms (0 to sample until STOP)>
+ *   COMP=<Y/B/N compression (LZW, block, none)>
+ *   MODE=<T/C/R mode (transitions, continuous, run-length)>
+ *   DMAC=<Y/N DMA capture>
+ *   DECI=<Y/N halve the sampling rate while the sample queue is nearly full>
+ *   DPTH=<burst mode depth in samples (0 to stream)>
+ *   PRE=<burst mode pre-trigger samples>
+ *   CRED=<bytes> (before START: turn flow control on for the next capture
+ *         with this many bytes of credit; while sampling: add credit)
  *
  *   Commands
  *   ========
@@ -50,6 +85,29 @@ uint8_t SamplingMode = SAMPLING_MODE_CONTINUOUS;
  *   STOP
  *   COPY
  *   PING
+ *   STAT  (replies with a status frame holding the performance counters of
+ *          the last capture, see stats.h)
+ *   ARM   (while sampling: forget the trigger and look for the next one, see
+ *          BurstRearm() and CaptureRearm())
+ *
+ *   While sampling, commands are taken as soon as the line is free to reply
+ *   (see SampleLoop()), and each one but CRED= is answered with a reply frame
+ *   (see frame.h): REPLY_DONE or REPLY_REFUSED, then the command. STOP ends
+ *   the capture; the samples already queued are still sent. STAT sends the
+ *   counters of the capture so far, before the reply. Settings are refused,
+ *   so they can't change under a capture.
+ *
+ *   Flow control
+ *   ============
+ *   With flow control on, sample data (the payload of sample and compressed
+ *   frames) is only sent while there is credit for it, and the host sends
+ *   CRED= as it takes the data in. Once the credit runs out, the queue fills
+ *   up and the capture degrades as it does on a slow line (decimation, then
+ *   gaps), so a host that stalls never loses the timeline. Other frames are
+ *   small and are always sent, as is the tail of the capture. The window
+ *   should be at least two frames (1024 bytes); 4 KB or more keeps the line
+ *   busy. A second STOP turns flow control off, for a host that has stopped
+ *   reading.
  */
 void ProcessCommands() {
 	char *p = UsartGets();
@@ -58,6 +116,27 @@ void ProcessCommands() {
 	if (p == NULL )
 		return;
 
+	if (SamplingActive) {
+		if (strncmp(p, "CRED=", 5) == 0)
+			FlowCredit += strtoul(p + 5, NULL, 10);
+		else if (strcmp(p, "STOP") == 0) {
+			// A second STOP sends the rest without waiting for credit.
+			if (SamplingStop)
+				FlowControl = 0;
+			SamplingStop = 1;
+			SendReply(p, REPLY_DONE);
+		} else if (strcmp(p, "PING") == 0)
+			SendReply(p, REPLY_DONE);
+		else if (strcmp(p, "STAT") == 0) {
+			StatsSend();
+			SendReply(p, REPLY_DONE);
+		} else if (strcmp(p, "ARM") == 0)
+			SendReply(p, (BurstDepth ? BurstRearm() : CaptureRearm()) ? REPLY_DONE : REPLY_REFUSED);
+		else
+			SendReply(p, REPLY_REFUSED);
+		return;
+	}
+
 	if (strcmp(p, "START") == 0)
 		SamplingActive = 1;
 	else if (strcmp(p, "STOP") == 0)
@@ -66,27 +145,108 @@ void ProcessCommands() {
 		Copyright();
 	else if (strcmp(p, "PING") == 0)
 		PingResponse();
+	else if (strcmp(p, "STAT") == 0) {
+		FrameReset();
+		StatsSend();
+	}
 	else if (strncmp(p, "CHAN=", 5) == 0) {
 		v = atoi(p + 5);
 
 		// Must be 1-8 */
-		if (v >= 1 && v <= 8)
+		if (v >= 1 && v <= 8) {
 			SamplingChannels = v;
+			SamplingPins = (1 << v) - 1;
+		}
+	} else if (strncmp(p, "MASK=", 5) == 0) {
+		v = strtoul(p + 5, NULL, 0) & 0xff;
+
+		// Sampled pins are packed together (see CaptureInit()), so the
+		// channel count is the number of pins.
+		if (v != 0) {
+			SamplingPins = v;
+			SamplingChannels = __builtin_popcount(v);
+		}
 	} else if (strncmp(p, "RATE=", 5) == 0) {
 		v = atoi(p + 5);
 
 		// Minimum of 10 Hz, maximum of 10 MHz
 		if (v > 10 && v < 10000000)
 			SamplingRate = v;
-	} else if (strncmp(p, "TIME=", 5) == 0) {
-		v = atoi(p + 5);
+	} else if (strncmp(p, "TRIG=", 5) == 0) {
+		if (*(p + 5) == 'P' && *(p + 6) == 'E')
+			TriggerMode = TRIGGER_PATTERN_EDGE;
+		else if (*(p + 5) == 'P')
+			TriggerMode = TRIGGER_PATTERN;
+		else if (*(p + 5) == 'E')
+			TriggerMode = TRIGGER_EDGE;
+		else
+			TriggerMode = TRIGGER_NONE;
+	}
+	// Channel masks may be given in decimal or hex (0x..)
+	else if (strncmp(p, "TMSK=", 5) == 0)
+		TriggerMask = strtoul(p + 5, NULL, 0);
+	else if (strncmp(p, "TVAL=", 5) == 0)
+		TriggerValue = strtoul(p + 5, NULL, 0);
+	else if (strncmp(p, "TRIS=", 5) == 0)
+		TriggerRising = strtoul(p + 5, NULL, 0);
+	else if (strncmp(p, "TFAL=", 5) == 0)
+		TriggerFalling = strtoul(p + 5, NULL, 0);
+	else if (strncmp(p, "HOLD=", 5) == 0)
+		TriggerHoldoff = strtoul(p + 5, NULL, 10);
+	else if (strncmp(p, "TIME=", 5) == 0) {
+		v = strtoul(p + 5, NULL, 10);
 
-		// Minimum of 10 ms, maximum of 100 s
-		if(v > 10 && v < 100000)
+		// Minimum of 10 ms (or 0, for no limit)
+		if (v > 10 || v == 0)
 			SamplingTime = v;
 	}
-	else if (strncmp(p, "COMP=", 5) == 0)
-		SamplingCompression = (*(p + 5) == 'Y');
-	else if (strncmp(p, "MODE=", 5) == 0)
-		SamplingMode = (*(p + 5) == 'T') ? SAMPLING_MODE_TRANSITIONONLY : SAMPLING_MODE_CONTINUOUS;
+	else if (strncmp(p, "COMP=", 5) == 0) {
+		if (*(p + 5) == 'Y')
+			SamplingCompression = SAMPLING_COMPRESSION_LZW;
+		else if (*(p + 5) == 'B')
+			SamplingCompression = SAMPLING_COMPRESSION_BLOCK;
+		else
+			SamplingCompression = SAMPLING_COMPRESSION_NONE;
+	}
+	else if (strncmp(p, "MODE=", 5) == 0) {
+		if (*(p + 5) == 'T')
+			SamplingMode = SAMPLING_MODE_TRANSITIONONLY;
+		else if (*(p + 5) == 'R')
+			SamplingMode = SAMPLING_MODE_RUNLENGTH;
+		else
+			SamplingMode = SAMPLING_MODE_CONTINUOUS;
+	}
+	else if (strncmp(p, "DMAC=", 5) == 0)
+		SamplingDma = (*(p + 5) == 'Y');
+	else if (strncmp(p, "DECI=", 5) == 0)
+		SamplingDecimate = (*(p + 5) == 'Y');
+	else if (strncmp(p, "DPTH=", 5) == 0) {
+		v = atoi(p + 5);
+
+		// Limited to the burst buffer size
+		if (v <= BURST_BUFFER_SIZE)
+			BurstDepth = v;
+	} else if (strncmp(p, "PRE=", 4) == 0)
+		BurstPre = atoi(p + 4);
+	else if (strncmp(p, "CRED=", 5) == 0) {
+		FlowControl = 1;
+		FlowCredit = strtoul(p + 5, NULL, 10);
+	}
+}
+
+/**
+ * @brief  Answer a command taken while sampling with a reply frame.
+ * @param  command: the command line
+ * @param  result: REPLY_DONE or REPLY_REFUSED
+ * @retval none
+ */
+static void SendReply(const char *command, uint8_t result) {
+	uint8_t reply[32];
+	uint16_t len = strlen(command);
+
+	if (len > sizeof(reply) - 1)
+		len = sizeof(reply) - 1;
+	reply[0] = result;
+	memcpy(reply + 1, command, len);
+	FrameSend(FRAME_REPLY, reply, len + 1);
 }
@@ -20,6 +20,7 @@
 #include <string.h>
 #include "compress.h"
 #include "main.h"
+#include "evalboard.h"
 
 #define USE_MALLOC 0 // set to 1 if using malloc()
 #define MINBITS 9
@@ -44,8 +45,9 @@ static int32_t *hashTable; // 32-bit hash table.
 static uint16_t *codeTable;// 16-bit code table.
 #else
 // If no malloc, just allocate directly. Hard-coded for 13-bits.
-int32_t hashTable[9001]; // 32-bit hash table.
-uint16_t codeTable[9001]; // 16-bit code table.
+// The tables are in CCM to leave SRAM for the burst buffer.
+int32_t hashTable[9001] CCM_RAM; // 32-bit hash table.
+uint16_t codeTable[9001] CCM_RAM; // 16-bit code table.
 #endif
 
 static uint32_t crc;
@@ -27,12 +27,61 @@
 #define USART_IRQ        USART2_IRQn
 #define USART_IRQHANDLER USART2_IRQHandler
 
+// Board-specific USART transmit DMA mappings (USART2_TX is DMA1 stream 6, channel 4).
+#define USART_DMA_PERIPH    RCC_AHB1Periph_DMA1
+#define USART_DMA_STREAM    DMA1_Stream6
+#define USART_DMA_CHANNEL   DMA_Channel_4
+#define USART_DMA_FLAGS     (DMA_FLAG_TCIF6 | DMA_FLAG_HTIF6 | DMA_FLAG_TEIF6 | DMA_FLAG_DMEIF6 | DMA_FLAG_FEIF6)
+
 // Board-specific Timer mappings
 #define TIMER_AH_PERIPH  RCC_AHB1Periph_GPIOE
 #define TIMER_GPIO       GPIOE
 #define TIMER_PINS       GPIO_Pin_8 | GPIO_Pin_9 | GPIO_Pin_10 | GPIO_Pin_11 | GPIO_Pin_12 | GPIO_Pin_13 | GPIO_Pin_14 | GPIO_Pin_15
 #define TIMER_HI_PINS    1
 
+// Board-specific DMA capture mappings. The DMA1 controller cannot reach the
+// AHB1 GPIO ports, so DMA capture must use DMA2, which in turn can only be
+// triggered by the APB2 timers (TIM1/TIM8). TIM8_UP is DMA2 stream 1, channel 7.
+#define CAPTURE_TIM            TIM8
+#define CAPTURE_TIM_PERIPH     RCC_APB2Periph_TIM8
+#define CAPTURE_DMA_PERIPH     RCC_AHB1Periph_DMA2
+#define CAPTURE_DMA_STREAM     DMA2_Stream1
+#define CAPTURE_DMA_CHANNEL    DMA_Channel_7
+#define CAPTURE_DMA_IRQ        DMA2_Stream1_IRQn
+#define CAPTURE_DMA_IRQHANDLER DMA2_Stream1_IRQHandler
+#define CAPTURE_DMA_IT_HT      DMA_IT_HTIF1
+#define CAPTURE_DMA_IT_TC      DMA_IT_TCIF1
+
+// The core-coupled memory (64 KB) can't be reached by DMA, so it can hold
+// the CPU-only tables (the LZW compressor's, 54 KB) that would otherwise
+// crowd out the burst buffer. This needs a linker script that places the
+// .ccmram section in CCM, without loading it:
+//
+//   .ccmram (NOLOAD) : { *(.ccmram) } >CCMRAM
+//
+// so it has to be asked for by building with USE_CCM_RAM set to 1. Without
+// it, the tables are placed in SRAM like everything else.
+#ifndef USE_CCM_RAM
+#define USE_CCM_RAM 0
+#endif
+
+#if USE_CCM_RAM
+#define CCM_RAM __attribute__((section(".ccmram")))
+#else
+#define CCM_RAM
+#endif
+
+// Burst mode records into the largest block of SRAM (SRAM1 and SRAM2 are
+// contiguous, 128 KB in all). The DMA capture engine fills it in
+// double-buffer mode, since one DMA transfer is limited to 65535 samples
+// (so half the buffer may be no larger than that). It takes what the rest
+// of the firmware leaves, which is less when the LZW tables are in SRAM.
+#if USE_CCM_RAM
+#define BURST_BUFFER_SIZE      (96 * 1024)
+#else
+#define BURST_BUFFER_SIZE      (48 * 1024)
+#endif
+
 #define LED_MODE_EXCL_ON 0 // Turn on the specified LED ONLY.
 #define LED_MODE_ON      1 // Turn on the specified LED and keep others on too.
 #define LED_MODE_OFF     2
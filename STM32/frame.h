@@ -0,0 +1,77 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stdint.h>
+
+// While sampling, everything sent to the host is wrapped in frames:
+//
+//   sync (0xa5), type, sequence, payload length (2 bytes), payload, CRC (2 bytes)
+//
+// Multi-byte values are little-endian. The sequence number counts every frame
+// sent since the start of the capture (modulo 256), so the host can tell when
+// frames have been lost. The CRC is CRC-16/CCITT (polynomial 0x1021, initial
+// value 0xffff) over everything after the sync byte up to the end of the
+// payload.
+//
+// The position in a gap or rate frame is where the event is on the host's
+// timeline: the number of samples since the start of the capture, counted at
+// the full sampling rate. It is an unsigned 32-bit count that wraps around
+// (after 71 minutes at 1 MHz), so in a long capture the host has to unwrap it
+// against the positions it has already seen.
+
+#define FRAME_SYNC          0xa5
+#define FRAME_HEADER_SIZE   5
+#define FRAME_TRAILER_SIZE  2
+#define FRAME_OVERHEAD      (FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE)
+
+// The longest payload FrameSend() takes (longer ones are truncated). Bulk data
+// is framed in place by FrameSeal() instead.
+#define FRAME_SMALL_PAYLOAD_MAX 64
+
+// Frame types.
+#define FRAME_START         0x01	// Sampling mode, compression method
+#define FRAME_SAMPLES       0x02	// Sample stream bytes, as queued by capture.c
+#define FRAME_COMPRESSED    0x03	// Compressed sample stream bytes
+#define FRAME_ERROR         0x04	// Error message text
+#define FRAME_STATUS        0x05	// Device status
+#define FRAME_END           0x06	// Sample count (4 bytes)
+#define FRAME_GAP           0x07	// Position, number of samples lost (4 bytes each)
+#define FRAME_RATE          0x08	// Position, decimation divisor from there on (4 bytes each)
+#define FRAME_REPLY         0x09	// Result, command text (see ProcessCommands())
+
+// Results in a reply frame.
+#define REPLY_DONE          0
+#define REPLY_REFUSED       1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+extern void FrameReset(void);
+extern uint16_t FrameCrc(uint16_t crc, const uint8_t *data, uint16_t len);
+extern uint16_t FrameSeal(uint8_t *frame, uint8_t type, uint16_t len);
+extern void FrameSend(uint8_t type, const uint8_t *payload, uint16_t len);
+extern void FrameSendString(uint8_t type, const char *s);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* FRAME_H_ */
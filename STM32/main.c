@@ -21,12 +21,48 @@
 #include "main.h"
 #include "evalboard.h"
 #include "compress.h"
+#include "blockcompress.h"
+#include "capture.h"
+#include "burst.h"
+#include "trigger.h"
+#include "frame.h"
+#include "stats.h"
 
 uint32_t ClockRate;
 volatile uint32_t Ticks = 0;
 uint32_t TimerBaseClockRate;
+uint32_t CaptureTimerBaseClockRate;
+
+// Output is collected in two frame buffers: one is filled (by the compressor,
+// or straight from the queue) while the other is being sent by the USART
+// transmit DMA. The payload starts after the frame header.
+#define TX_PAYLOAD_SIZE 512
+
+// Without compression, a frame of samples is sent once it holds TX_FLUSH_MIN
+// bytes, or once its first byte has waited TX_FLUSH_MS milliseconds. Frames
+// sent whenever the line was free carried only a word or two at low rates,
+// and the framing then cost more than the samples.
+#define TX_FLUSH_MIN 256
+#define TX_FLUSH_MS  10
+
+// The longest span of samples handed to the block compressor in one go.
+#define TX_SPAN_MAX 512
+
+// With decimation enabled, the sampling rate is halved once the free space in
+// the sample queue drops to DECIMATE_ON_FREE, and restored once it is back up
+// to DECIMATE_OFF_FREE.
+#define DECIMATE_ON_FREE  1024
+#define DECIMATE_OFF_FREE 3072
+
+static uint8_t txFrames[2][FRAME_OVERHEAD + TX_PAYLOAD_SIZE];
+static uint8_t txIndex;
+static uint16_t txCount;
+static uint32_t txStartTicks;
 
 static void SendCompressedByte(uint8_t b);
+static void SendCaptureEvents(void);
+static void FlushFrame(uint8_t type);
+static void SetStatusLeds(uint8_t idle, uint8_t full);
 static void SampleLoop(void);
 
 /**
@@ -48,6 +84,9 @@ int main(void) {
 	// Our timer (TIM2) uses the APB1 (PCLK1) clock.
 	TimerBaseClockRate = RCC_Clocks.PCLK1_Frequency;
 
+	// The DMA capture timer (TIM8) uses the APB2 (PCLK2) clock.
+	CaptureTimerBaseClockRate = RCC_Clocks.PCLK2_Frequency;
+
 	// Set the SysTick interrupt to fire once every millisecond.
 	SysTick_Config(RCC_Clocks.SYSCLK_Frequency / 1000);
 
@@ -59,8 +98,6 @@ int main(void) {
 	UsartInit();
 	Copyright();
 
-	uint32_t commandTicks = Ticks;
-
 	LedSet(LED_ORANGE, LED_MODE_OFF);
 
 	// Loop forever...
@@ -74,11 +111,9 @@ int main(void) {
 			LedSet(LED_BLUE, LED_MODE_OFF);
 		}
 
-		// Check for commands every 1/10 second.
-		if ((Ticks - commandTicks) >= 100) {
-			ProcessCommands();
-			commandTicks = Ticks;
-		}
+		// Command lines are queued by the receive interrupt (see usart.c),
+		// so checking for one is cheap enough to do all the time.
+		ProcessCommands();
 	}
 	return 0;
 }
@@ -86,93 +121,287 @@ int main(void) {
 /**
  * @brief  Get samples from the input pins and queue them for output via USART.
  *         The loop continues even after the sampling time is over in order to
- *         clear the queue.
+ *         clear the queue. The output is a start frame, then sample (or
+ *         compressed sample) frames with any gap and rate change frames in
+ *         between, then an error frame if there was an overflow, a status
+ *         frame with the capture's performance counters (see stats.h) and
+ *         finally an end frame (see frame.h).
  * @param  none
  * @retval none
  */
 static void SampleLoop() {
-	uint32_t startTicks;
-
-	// In compression mode, initialize and send a "start compression" marker.
+	static uint8_t drainBuffer[64];
+	uint8_t *txSpan;
+	uint8_t start[2];
+	uint32_t startTicks, passStart;
+	uint16_t count, free, i;
+	uint8_t idle;
+	uint8_t capturing = 1;
+	uint8_t burstRecording = 0;
+
+	StatsInit();
+
+	// In compression mode, initialize the compressor.
 	if (SamplingCompression) {
 		// Initialize compression, sending a pointer to the callback
 		// function below that will receive the compressed data.
-		if (CompressInit(&SendCompressedByte) < 0) {
+		if (SamplingCompression == SAMPLING_COMPRESSION_BLOCK)
+			BlockCompressInit(&SendCompressedByte);
+		else if (CompressInit(&SendCompressedByte) < 0) {
 			LedSet(LED_RED, LED_MODE_ON);
+			FrameReset();
+			FrameSendString(FRAME_ERROR, "Compression unavailable");
+			FlowControl = 0;
+			SamplingActive = 0;
 			return;
 		}
-		UsartSendString("<cmp>");
 	}
 
-	// Clear the output queue and set the timer to send an interrupt at our
-	// current sampling rate.
+	// The start frame tells the host how to read the frames that follow.
+	txIndex = 0;
+	txCount = 0;
+	start[0] = SamplingMode;
+	start[1] = SamplingCompression;
+	FrameReset();
+	FrameSend(FRAME_START, start, sizeof(start));
+
+	// Clear the output queue and set the timer to send an interrupt (or a DMA
+	// request) at our current sampling rate. Burst mode always uses DMA.
 	ClearSampleQueue();
-	TimerInit(TimerBaseClockRate, SamplingRate);
+	TriggerInit();
+	CaptureInit();
+	if (BurstDepth) {
+		BurstInit(BurstBuffer, BURST_BUFFER_SIZE, BurstDepth, BurstPre);
+		BurstDmaInit(CaptureTimerBaseClockRate, SamplingRate);
+		burstRecording = 1;
+	} else if (SamplingDma)
+		CaptureDmaInit(CaptureTimerBaseClockRate, SamplingRate);
+	else
+		TimerInit(TimerBaseClockRate, SamplingRate);
 
 	// Get our start time.
 	startTicks = Ticks;
+	SamplingStop = 0;
 
-	// Loop until our time is up.
+	// Loop until our time is up (or we are told to stop).
 	while (1) {
-		if (!SampleQueueIsEmpty()) {
-			// Send the next available sample to the output.
-			if (SamplingCompression) {
-				CompressByte(DequeueSample());
-			} else
-				UsartSendChar(DequeueSample());
-			LedSet(LED_ORANGE, LED_MODE_OFF);
+		passStart = StatsCycles();
+
+		// Take a command as soon as the line is free for the reply, so it
+		// doesn't hold up the sample stream (see ProcessCommands()).
+		if (!UsartTxBusy())
+			ProcessCommands();
+
+		free = SampleQueueFree();
+		StatsQueueLevel(Stats.queueSize - free);
+
+		// Degrade gracefully rather than lose samples when the queue is
+		// filling up faster than it can be sent. The burst window is only
+		// drained as fast as the queue allows, so it never needs this.
+		if (SamplingDecimate && !BurstDepth) {
+			if (free <= DECIMATE_ON_FREE)
+				CaptureDecimate(1);
+			else if (free >= DECIMATE_OFF_FREE)
+				CaptureDecimate(0);
+		}
+
+		// Gap and rate change frames go out whenever the line is free. They
+		// carry their own position, so they needn't wait for the samples.
+		if (!UsartTxBusy())
+			SendCaptureEvents();
+
+		// In burst mode, look for the trigger while recording, then send the
+		// recorded window as fast as the output allows.
+		if (BurstDepth && capturing) {
+			if (burstRecording) {
+				if (BurstUpdate(BurstDmaPosition())) {
+					BurstStop(BurstDmaDenit());
+					burstRecording = 0;
+				}
+			} else if (BurstDrain()) {
+				EnqueueFinalSample();
+				capturing = 0;
+			}
+		}
+
+		// With flow control, the compressor only takes samples while there
+		// is credit for a full frame of its output. Until then, they are
+		// left in the queue.
+		count = 0;
+		if (SamplingCompression == SAMPLING_COMPRESSION_BLOCK) {
+			// The block compressor takes a whole span of samples straight
+			// from the queue.
+			if (!FlowControl || FlowCredit >= TX_PAYLOAD_SIZE) {
+				count = SampleQueuePeek(&txSpan, TX_SPAN_MAX);
+				BlockCompress(txSpan, count);
+				SampleQueueRelease(count);
+				Stats.compressIn += count;
+			}
+		} else if (SamplingCompression) {
+			// Drain a contiguous span of samples from the queue and compress
+			// it while the previous output buffer is still on the wire.
+			if (!FlowControl || FlowCredit >= TX_PAYLOAD_SIZE) {
+				count = DequeueBlock(drainBuffer, sizeof(drainBuffer));
+				for (i = 0; i < count; i++)
+					CompressByte(drainBuffer[i]);
+				Stats.compressIn += count;
+			}
 		} else {
-			// If the queue is empty and sampling is not active, we're done.
-			if (!SamplingActive)
-				break;
-			LedSet(LED_ORANGE, LED_MODE_ON);
+			// Top up the frame being filled from the queue, and send it once
+			// it is full enough (or has waited long enough) and the previous
+			// one is off the wire (and, with flow control, the host has given
+			// credit for it). While the line is busy, frames fill up further.
+			if (txCount < TX_PAYLOAD_SIZE) {
+				count = DequeueBlock(txFrames[txIndex] + FRAME_HEADER_SIZE + txCount,
+						TX_PAYLOAD_SIZE - txCount);
+				if (txCount == 0)
+					txStartTicks = Ticks;
+				txCount += count;
+			}
+			if ((txCount >= TX_FLUSH_MIN || (txCount != 0 && (Ticks - txStartTicks) >= TX_FLUSH_MS)) &&
+					!UsartTxBusy() && (!FlowControl || FlowCredit >= txCount))
+				FlushFrame(FRAME_SAMPLES);
 		}
 
-		// Turn on the RED LED if the queue is full.
-		if (SampleQueueIsFull()) {
-			LedSet(LED_RED, LED_MODE_ON);
-		} else
-			LedSet(LED_RED, LED_MODE_OFF);
+		if (count)
+			StatsDrainDone(passStart);
+
+		// If the queue is empty and sampling is over, we're done.
+		idle = SampleQueueIsEmpty();
+		if (idle && !capturing)
+			break;
+
+		SetStatusLeds(idle, SampleQueueIsFull());
 
 		// 'startTicks' is the millisecond count of when we started sampling.
-		// 'Ticks' is the millisecond count now.
-		if (SamplingActive && ((Ticks - startTicks) > SamplingTime)) {
+		// 'Ticks' is the millisecond count now. A sampling time of 0 means
+		// there is no limit, so only STOP ends the capture.
+		if (BurstDepth) {
+			// In burst mode, the sampling time is how long to wait for the
+			// trigger. If it doesn't come (or we are stopped), trigger anyway.
+			if (burstRecording && (SamplingStop || (SamplingTime && (Ticks - startTicks) > SamplingTime)))
+				BurstTrigger();
+		} else if (capturing && (SamplingStop || (SamplingTime && (Ticks - startTicks) > SamplingTime))) {
 			// Turn sampling off when time expires.
 			// But continue in the loop until the queue is empty.
-			TimerDenit();
+			if (SamplingDma)
+				CaptureDmaDenit();
+			else
+				TimerDenit();
 
-			// If we're in transition-only mode, we need to send a final sample
-			// to expand to the full sample time.
-			if (SamplingMode == SAMPLING_MODE_TRANSITIONONLY)
-				EnqueueFinalSample();
+			// In transition-only mode, we need to send a final sample to
+			// expand to the full sample time. In run-length mode, the current
+			// run has to be sent.
+			EnqueueFinalSample();
 
-			SamplingActive = 0;
+			capturing = 0;
 		}
 	}
 
-	// If compression is active, de-intialize and send and "stop compression" marker.
+	// If compression is active, de-intialize and send the rest of the
+	// compressed output.
 	if (SamplingCompression) {
-		CompressFlush();
-		CompressDenit();
-		UsartSendString("</cmp>");
-	}
+		if (SamplingCompression == SAMPLING_COMPRESSION_BLOCK) {
+			BlockCompressFlush();
+			BlockCompressDenit();
+		} else {
+			CompressFlush();
+			CompressDenit();
+		}
+		FlushFrame(FRAME_COMPRESSED);
+	} else
+		FlushFrame(FRAME_SAMPLES);
+
+	SendCaptureEvents();
+	SetStatusLeds(1, 0);
 
 	// If we had an overflow (i.e. we are sending data to the queue faster than it can be
 	// sent out,) turn on the RED LED and send an overflow error.
 	if (Overflow) {
 		LedSet(LED_RED, LED_MODE_ON);
-		UsartSendString("<err>Overflow</err>");
+		FrameSendString(FRAME_ERROR, "Overflow");
+	}
+
+	StatsSend();
+
+	// The end frame carries the number of samples taken.
+	FrameSend(FRAME_END, (const uint8_t *)&Irqs, sizeof(Irqs));
+	UsartTxWait();
+
+	// Flow control has to be asked for again for the next capture.
+	FlowControl = 0;
+	SamplingActive = 0;
+}
+
+/**
+ * @brief  Show the state of the sample queue on the LEDs: orange when the
+ *         queue is empty, red when it is full. The LEDs are only written when
+ *         the state changes, so this is cheap enough to call from the sample
+ *         loop on every iteration.
+ * @param  idle: non-zero if the queue is empty
+ * @param  full: non-zero if the queue is full
+ * @retval none
+ */
+static void SetStatusLeds(uint8_t idle, uint8_t full) {
+	static uint8_t prevIdle = 0xff, prevFull = 0xff;
+
+	if (idle != prevIdle) {
+		LedSet(LED_ORANGE, idle ? LED_MODE_ON : LED_MODE_OFF);
+		prevIdle = idle;
+	}
+
+	if (full != prevFull) {
+		LedSet(LED_RED, full ? LED_MODE_ON : LED_MODE_OFF);
+		prevFull = full;
 	}
 }
 
 /**
  * @brief  Callback function used to receive data output from the compression
- *         routines. This data simply gets sent out via USART.
+ *         routines. The data is collected in a frame that is sent out via
+ *         USART (by DMA) when it is full.
  * @param  b: a byte output from the compression stream
  * @retval none
  */
 static void SendCompressedByte(uint8_t b) {
-	UsartSendChar(b);
+	txFrames[txIndex][FRAME_HEADER_SIZE + txCount++] = b;
+	Stats.compressOut++;
+	if (txCount == TX_PAYLOAD_SIZE)
+		FlushFrame(FRAME_COMPRESSED);
+}
+
+/**
+ * @brief  Send the gap records and rate changes the capture routines have
+ *         produced so far (see capture.h).
+ * @param  none
+ * @retval none
+ */
+static void SendCaptureEvents() {
+	CaptureEvent event;
+
+	while (CaptureNextEvent(&event))
+		FrameSend(event.type, (const uint8_t *)&event, CAPTURE_EVENT_PAYLOAD);
+}
+
+/**
+ * @brief  Seal the frame being filled, start sending it and switch to the
+ *         other frame buffer. This only waits if the other buffer is still
+ *         being sent.
+ * @param  type: the frame type
+ * @retval none
+ */
+static void FlushFrame(uint8_t type) {
+	uint16_t len;
+
+	if (txCount == 0)
+		return;
+
+	FlowCredit -= txCount;
+	len = FrameSeal(txFrames[txIndex], type, txCount);
+	UsartTxWait();
+	UsartSendBlock(txFrames[txIndex], len);
+	txIndex ^= 1;
+	txCount = 0;
 }
 
 /**
@@ -30,19 +30,42 @@ extern volatile uint32_t Irqs;
 
 #define SAMPLING_MODE_CONTINUOUS     0
 #define SAMPLING_MODE_TRANSITIONONLY 1
+#define SAMPLING_MODE_RUNLENGTH      2
 
-// Markers for data transmitted for transition-only mode.
-#define SAMPLE_MARKER 0xbf
-#define PERIOD_MARKER 0xbd
-#define ROLLOVER_MARKER 0xbe
+#define SAMPLING_COMPRESSION_NONE    0
+#define SAMPLING_COMPRESSION_LZW     1
+#define SAMPLING_COMPRESSION_BLOCK   2
+
+// In transition-only mode, each change of the inputs is transmitted as a
+// record: a variable-length count of ticks since the previous record,
+// followed by an XOR mask of the channels that changed (see capture.c).
+// In run-length mode, each run of identical (stacked) sample bytes is
+// transmitted as the byte followed by a variable-length repeat count.
 
 // Settings
 extern uint8_t SamplingActive;
-extern uint16_t SamplingTime;
+extern uint8_t SamplingStop;
+extern uint32_t SamplingTime;
 extern uint8_t SamplingChannels;
+extern uint8_t SamplingPins;
 extern uint32_t SamplingRate;
 extern uint8_t SamplingCompression;
 extern uint8_t SamplingMode;
+extern uint8_t SamplingDma;
+extern uint8_t SamplingDecimate;
+extern uint32_t BurstDepth;
+extern uint32_t BurstPre;
+extern uint8_t TriggerMode;
+extern uint8_t TriggerMask;
+extern uint8_t TriggerValue;
+extern uint8_t TriggerRising;
+extern uint8_t TriggerFalling;
+extern uint32_t TriggerHoldoff;
+extern uint8_t FlowControl;
+extern int32_t FlowCredit;
+
+// Burst mode capture buffer (see burst.c).
+extern volatile uint8_t BurstBuffer[];
 
 #ifdef __cplusplus
  extern "C" {
@@ -50,6 +73,11 @@ extern uint8_t SamplingMode;
 
 extern void TimerInit(uint32_t TimerBaseClockRate, uint32_t DesiredFequency);
 extern void TimerDenit(void);
+extern void CaptureDmaInit(uint32_t TimerBaseClockRate, uint32_t DesiredFequency);
+extern void CaptureDmaDenit(void);
+extern void BurstDmaInit(uint32_t TimerBaseClockRate, uint32_t DesiredFequency);
+extern uint32_t BurstDmaPosition(void);
+extern uint32_t BurstDmaDenit(void);
 
 extern void Copyright(void);
 extern char *itoa(signed long);
@@ -57,15 +85,22 @@ extern void PingResponse(void);
 extern void UsartInit(void);
 extern void UsartSendString(char *);
 extern void UsartSendChar(char);
-extern char UsartGetchar(void);
+extern int16_t UsartSendBlock(const uint8_t *buf, uint16_t len);
+extern int16_t UsartTxBusy(void);
+extern void UsartTxWait(void);
 extern char *UsartGets(void);
 
 extern void ClearSampleQueue(void);
 extern int16_t SampleQueueIsEmpty(void);
 extern int16_t SampleQueueIsFull(void);
-extern int16_t EnqueueSample(uint8_t sample);
-extern void EnqueueFinalSample(void);
+extern uint16_t SampleQueueFree(void);
+extern int16_t EnqueueByte(uint8_t byte);
+extern int16_t EnqueueBytes(const uint8_t *bytes, uint16_t len);
+extern int16_t EnqueueWord(uint32_t word);
 extern uint8_t DequeueSample(void);
+extern uint16_t DequeueBlock(uint8_t *buf, uint16_t max);
+extern uint16_t SampleQueuePeek(uint8_t **span, uint16_t max);
+extern void SampleQueueRelease(uint16_t count);
 extern void ProcessCommands(void);
 
 #ifdef __cplusplus
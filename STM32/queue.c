@@ -16,61 +16,35 @@
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <string.h>
 #include "main.h"
+#include "stats.h"
 
-// 4K sample queue
+// 4K sample queue. The size must be a power of two so that the free-running
+// head and tail indices can be masked instead of wrapped.
 #define QSIZE 4096
-
-// The sample queue is fed by the timer interrupt and read from the main sample
-// loop. Note that the 'qCount' variable is used by both of these 'threads',
-// so it must be protected by a simple semaphore (enqueueBusy and dequeueBusy).
-// NOTE: the semaphore didn't work, so it was commented-out.
-static volatile uint8_t queue[QSIZE];
-static volatile uint32_t qHead, qTail, qCount;
-//static volatile uint8_t enqueueBusy, dequeueBusy;
-static volatile uint8_t firstSample;
-static volatile uint8_t prevSample;
+#define QMASK (QSIZE - 1)
+
+// The sample queue is a single-producer/single-consumer ring. It is fed by
+// the capture interrupt (the only writer of 'qTail') and read from the main
+// sample loop (the only writer of 'qHead'). The indices are free-running;
+// the number of queued bytes is always 'qTail - qHead', so no count needs to
+// be shared between the two 'threads'. Each side publishes its index only
+// after a memory barrier, so the other side never sees an index that is
+// ahead of the data it guards.
+static uint8_t queue[QSIZE] __attribute__ ((aligned (4)));
+static volatile uint32_t qHead, qTail;
 volatile uint8_t Overflow;
 
-// If our SamplingChannels setting is such that we
-// can send more than one sample per byte (SamplingChannels <= 4)
-// then we 'stack' samples before enqueuing them.
-static uint8_t stackedSample;
-static uint8_t stackShift;
-static uint8_t channelMask;
-static uint8_t channelShift;
-
 /**
- * @brief  Clear the sample queue
+ * @brief  Clear the sample queue. This must not be called while the capture
+ *         interrupt is active.
  * @param  none
  * @retval none
  */
 void ClearSampleQueue() {
-	uint8_t channelMasks[] = { 0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff };
-	qHead = qTail = qCount = 0;
-//	enqueueBusy = dequeueBusy = 0;
-
-	channelMask = channelMasks[SamplingChannels - 1];
-	switch (SamplingChannels) {
-	case 1:
-		channelShift = 1;
-		break;
-	case 2:
-		channelShift = 2;
-		break;
-	case 3:
-	case 4:
-		channelShift = 4;
-		break;
-	default:
-		channelShift = 8;
-		break;
-	}
-
-	stackShift = 0;
-	stackedSample = 0;
+	qHead = qTail = 0;
 	Overflow = 0;
-	firstSample = 1;
 }
 
 /**
@@ -79,7 +53,7 @@ void ClearSampleQueue() {
  * @retval non-zero if the sample queue is empty, otherwise 0
  */
 int16_t SampleQueueIsEmpty() {
-	return qCount == 0;
+	return qTail == qHead;
 }
 
 /**
@@ -88,136 +62,187 @@ int16_t SampleQueueIsEmpty() {
  * @retval non-zero if the sample queue is full, otherwise 0
  */
 int16_t SampleQueueIsFull() {
-	return qCount >= QSIZE;
+	return (qTail - qHead) >= QSIZE;
 }
 
 /**
- * @brief  Add a byte to the queue
+ * @brief  Get the free space in the sample queue.
+ * @param  none
+ * @retval the number of bytes that can be added to the queue
+ */
+uint16_t SampleQueueFree() {
+	return QSIZE - (qTail - qHead);
+}
+
+/**
+ * @brief  Add a byte to the queue. Only called by the producer.
  * @param  byte: the byte to add to the queue
  * @retval 0 if successful, -1 if the queue is full
  */
-static uint16_t enqueueByte(uint8_t byte) {
+int16_t EnqueueByte(uint8_t byte) {
+	uint32_t tail = qTail;
+
 	// Check if the queue is full.
-	if (qCount >= QSIZE) {
+	if ((tail - qHead) >= QSIZE) {
 		Overflow = 1;
+		Stats.dropped++;
 		return -1;
 	}
 
-	queue[qTail++] = byte;
-	if (qTail == QSIZE)
-		qTail = 0;
-
-	// We need to protect 'qCount' with a simple semaphore. If the main
-	// 'thread' is dequeuing, we need to wait before incrementing the count.
-//	while (dequeueBusy)
-//		;
-//	enqueueBusy = 1;
-	qCount++;
-//	enqueueBusy = 0;
+	queue[tail & QMASK] = byte;
+
+	// Make sure the byte is in memory before the consumer can see it.
+	__DMB();
+	qTail = tail + 1;
 	return 0;
 }
 
 /**
- * @brief  Add a sample to the queue. A sample may be less than 8 bits,
- *         so if the sampling channels is 4 or less, we can stack multiple
- *         samples per byte.
- * @param  sample: the sample to add to the queue
- * @retval 0 if successful, -1 if the queue is full
+ * @brief  Add a short record to the queue. Either all of the bytes are
+ *         queued or none of them are. Only called by the producer.
+ * @param  bytes: the bytes to add to the queue
+ * @param  len: the number of bytes to add
+ * @retval 0 if successful, -1 if the queue does not have room for all of them
  */
-int16_t EnqueueSample(uint8_t sample) {
-	// Mask off the bits we're not using.
-	sample &= channelMask;
-
-	if (SamplingMode == SAMPLING_MODE_TRANSITIONONLY) {
-		// When in transition mode, we need to send a
-		// rollover marker every time we roll over 16 bits.
-		if ((Irqs & 0xffff) == 0) {
-			uint16_t rolloverCnt = (Irqs >> 16);
-
-			// Queue the marker.
-			enqueueByte(ROLLOVER_MARKER);
-
-			// Queue the timestamp -- low byte first.
-			enqueueByte(rolloverCnt & 0xff);
-			enqueueByte((rolloverCnt >> 8) & 0xff);
-			enqueueByte(0);
-		}
-	} else {
-		// Check if we can stack more samples per byte.
-		// Note that transition-only mode does not stack samples.
-		if (SamplingChannels <= 4) {
-			stackedSample |= sample << stackShift;
-			stackShift += channelShift;
-
-			// If we don't yet have a full byte, wait for the next sample
-			// before queuing it.
-			if (stackShift < 8)
-				return 0;
-
-			sample = stackedSample;
-			stackShift = 0;
-			stackedSample = 0;
-		}
-	}
+int16_t EnqueueBytes(const uint8_t *bytes, uint16_t len) {
+	uint32_t tail = qTail;
+	uint16_t i;
 
-	if (SamplingMode == SAMPLING_MODE_TRANSITIONONLY) {
-		// If we're in transition mode, we need to add a timestamp as well.
-		// This comes in the form of the lower 16 bits of 'Irqs'.
+	if ((tail - qHead) > (uint32_t) (QSIZE - len)) {
+		Overflow = 1;
+		Stats.dropped += len;
+		return -1;
+	}
 
-		// Skip samples that are the same.
-		if (!firstSample && (prevSample == sample))
-			return 0;
+	for (i = 0; i < len; i++)
+		queue[(tail + i) & QMASK] = bytes[i];
 
-		firstSample = 0;
-		prevSample = sample;
+	__DMB();
+	qTail = tail + len;
+	return 0;
+}
 
-		// Queue the marker.
-		enqueueByte(SAMPLE_MARKER);
+/**
+ * @brief  Add four bytes to the queue (low byte first) with a single space
+ *         check and a single update of the tail. Only called by the producer.
+ * @param  word: the four bytes to add to the queue
+ * @retval 0 if successful, -1 if the queue does not have room for all four
+ */
+int16_t EnqueueWord(uint32_t word) {
+	uint32_t tail = qTail;
 
-		// Queue the timestamp -- low byte first.
-		enqueueByte(Irqs & 0xff);
-		enqueueByte((Irqs >> 8) & 0xff);
+	if ((tail - qHead) > (QSIZE - 4)) {
+		Overflow = 1;
+		Stats.dropped += 4;
+		return -1;
 	}
 
-	// Finally, enqueue the sample byte (possibly multiple samples).
-	return enqueueByte(sample);
-}
+	if ((tail & 3) == 0) {
+		// Aligned: a single store (QSIZE is a multiple of 4, so an aligned
+		// word never straddles the end of the queue).
+		*(uint32_t *) &queue[tail & QMASK] = word;
+	} else {
+		queue[tail & QMASK] = word;
+		queue[(tail + 1) & QMASK] = word >> 8;
+		queue[(tail + 2) & QMASK] = word >> 16;
+		queue[(tail + 3) & QMASK] = word >> 24;
+	}
 
-/**
- * @brief  Add a final sample to the queue. This is used in transition-only
- *         mode. This is done because the last sample we sent may have been a
- *         while ago and we need to have a 'duration' of the last signal state.
- * @param  none
- * @retval none
- */
-void EnqueueFinalSample() {
-	EnqueueSample(prevSample == 0 ? 0xff : 0);
+	__DMB();
+	qTail = tail + 4;
+	return 0;
 }
 
 /**
  * @brief  Remove a sample (or multiple samples if they are 'stacked' in a
  *         single byte) from the queue. A call to SampleQueueIsEmpty() should
- *         be made prior to calling this function.
+ *         be made prior to calling this function. Only called by the consumer.
  * @param  none
  * @retval the sample byte, or zero if the queue was empty
  */
 uint8_t DequeueSample() {
+	uint32_t head = qHead;
 	uint8_t sample;
 
 	// Check if the queue is empty -- return zero if it is.
-	if (qCount == 0)
+	if (qTail == head)
 		return 0;
 
-	sample = queue[qHead++];
-	if (qHead == QSIZE)
-		qHead = 0;
-
-	// We need to protect 'qCount' with a simple semaphore. If the interrupt
-	// 'thread' is enqueuing, we need to wait before decrementing the count.
-//	while (enqueueBusy)
-//		;
-//	dequeueBusy = 1;
-	qCount--;
-//	dequeueBusy = 0;
+	// Don't read the byte before we've seen the tail that covers it.
+	__DMB();
+	sample = queue[head & QMASK];
+
+	// Don't give the slot back before we're done reading it.
+	__DMB();
+	qHead = head + 1;
 	return sample;
 }
+
+/**
+ * @brief  Remove up to 'max' bytes from the queue in one go. This copies at
+ *         most two contiguous spans (before and after the end of the ring)
+ *         and updates the head once. Only called by the consumer.
+ * @param  buf: the buffer to receive the bytes
+ * @param  max: the size of the buffer
+ * @retval the number of bytes removed (zero if the queue was empty)
+ */
+uint16_t DequeueBlock(uint8_t *buf, uint16_t max) {
+	uint32_t head = qHead;
+	uint32_t count = qTail - head;
+	uint32_t offset, span;
+
+	if (count == 0)
+		return 0;
+	if (count > max)
+		count = max;
+
+	__DMB();
+
+	offset = head & QMASK;
+	span = QSIZE - offset;
+	if (span >= count)
+		memcpy(buf, &queue[offset], count);
+	else {
+		memcpy(buf, &queue[offset], span);
+		memcpy(buf + span, &queue[0], count - span);
+	}
+
+	__DMB();
+	qHead = head + count;
+	return count;
+}
+
+/**
+ * @brief  Get the longest contiguous span of queued bytes (up to 'max') without
+ *         removing them, so they can be transmitted straight from the queue.
+ *         The span stays valid (the producer will not overwrite it) until it
+ *         is given back with SampleQueueRelease(). Only called by the consumer.
+ * @param  span: receives a pointer to the first queued byte
+ * @param  max: the maximum length of span wanted
+ * @retval the length of the span (zero if the queue is empty)
+ */
+uint16_t SampleQueuePeek(uint8_t **span, uint16_t max) {
+	uint32_t head = qHead;
+	uint32_t count = qTail - head;
+	uint32_t offset = head & QMASK;
+
+	if (count > QSIZE - offset)
+		count = QSIZE - offset;
+	if (count > max)
+		count = max;
+
+	__DMB();
+	*span = &queue[offset];
+	return count;
+}
+
+/**
+ * @brief  Remove bytes that were previously returned by SampleQueuePeek()
+ *         and are no longer needed. Only called by the consumer.
+ * @param  count: the number of bytes to remove
+ * @retval none
+ */
+void SampleQueueRelease(uint16_t count) {
+	__DMB();
+	qHead += count;
+}
@@ -0,0 +1,644 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Self-checks of the firmware routines that don't need the peripherals
+// (lasim -x, or make check). Each check drives the routines directly, the way
+// the interrupt handlers and the main loop do, and compares what they produce
+// with what it should be. A line is printed for each check, and lasim exits
+// with a non-zero status if any of them failed.
+//
+// The input is generated here rather than taken from the waveform, so the
+// checks don't depend on -w: stretches of a slow pattern, where most samples
+// repeat, alternate with stretches of noise, where most don't.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sched.h>
+#include "main.h"
+#include "capture.h"
+#include "trigger.h"
+#include "stats.h"
+#include "frame.h"
+#include "periph.h"
+
+#define CHECK_SAMPLES 200000
+#define CHECK_QUEUE_BYTES (32 * 1024 * 1024)
+
+static int failures;
+static uint32_t seed;
+
+// What a capture produced: the queued byte stream and the events.
+typedef struct {
+	uint8_t *bytes;
+	size_t len, size;
+	CaptureEvent events[4096];
+	uint32_t eventCount;
+	uint32_t samples;
+	CaptureStats stats;
+} CaptureOutput;
+
+/**
+ * @brief  Get the next pseudo-random number. The checks start from a fixed
+ *         seed, so every run sees the same input.
+ * @param  none
+ * @retval the next number
+ */
+static uint32_t nextRandom() {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/**
+ * @brief  Print the result of a check.
+ * @param  ok: non-zero if the check passed
+ * @param  format: what was checked (printf style)
+ * @retval none
+ */
+static void report(int ok, const char *format, ...) {
+	va_list args;
+
+	printf("%s ", ok ? "ok  " : "FAIL");
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+	fflush(stdout);
+
+	if (!ok)
+		failures++;
+}
+
+/**
+ * @brief  Fill a buffer with the check input: a slow pattern and noise, in
+ *         stretches of random length.
+ * @param  samples: the buffer
+ * @param  count: the number of samples
+ * @retval none
+ */
+static void makeInput(uint8_t *samples, uint32_t count) {
+	uint32_t i = 0, end, period;
+	uint8_t value = 0;
+
+	seed = 2463534242UL;
+	while (i < count) {
+		end = i + 1 + nextRandom() % 20000;
+		if (end > count)
+			end = count;
+
+		if (nextRandom() & 1) {
+			period = 1 + nextRandom() % 100;
+			for (; i < end; i++) {
+				if (i % period == 0)
+					value = (value + 1) ^ (nextRandom() & 0x11);
+				samples[i] = value;
+			}
+		} else
+			for (; i < end; i++)
+				samples[i] = nextRandom() >> 8;
+	}
+}
+
+/**
+ * @brief  Set up the firmware for a capture, as StartSampling does.
+ * @param  mode: sampling mode (C, T or R)
+ * @param  channels: number of channels
+ * @param  pins: the pins sampled
+ * @param  trigger: the trigger mode
+ * @retval none
+ */
+static void setupCapture(char mode, int channels, uint8_t pins, uint8_t trigger) {
+	SamplingMode = (mode == 'T') ? SAMPLING_MODE_TRANSITIONONLY :
+			(mode == 'R') ? SAMPLING_MODE_RUNLENGTH : SAMPLING_MODE_CONTINUOUS;
+	SamplingChannels = channels;
+	SamplingPins = pins;
+	BurstDepth = 0;
+
+	TriggerMode = trigger;
+	TriggerMask = 0x0c;
+	TriggerValue = 0x04;
+	TriggerRising = 0x01;
+	TriggerFalling = 0x00;
+	TriggerHoldoff = 37;
+
+	memset(&Stats, 0, sizeof(Stats));
+	ClearSampleQueue();
+	TriggerInit();
+	Irqs = 0;
+	CaptureInit();
+}
+
+/**
+ * @brief  Take what has been queued and the events waiting to be sent, as
+ *         the main loop does.
+ * @param  out: where to put them
+ * @retval none
+ */
+static void drainCapture(CaptureOutput *out) {
+	CaptureEvent event;
+	uint8_t *span;
+	uint16_t n;
+
+	while ((n = SampleQueuePeek(&span, 0xffff)) > 0) {
+		if (out->len + n > out->size) {
+			out->size = (out->len + n) * 2;
+			out->bytes = realloc(out->bytes, out->size);
+		}
+		memcpy(out->bytes + out->len, span, n);
+		out->len += n;
+		SampleQueueRelease(n);
+	}
+
+	while (CaptureNextEvent(&event))
+		if (out->eventCount < sizeof(out->events) / sizeof(out->events[0]))
+			out->events[out->eventCount++] = event;
+}
+
+/**
+ * @brief  Run a capture over the check input, in blocks of random length.
+ *         The blocks, the queue draining and the decimation switches depend
+ *         only on the seed, so the two engines see exactly the same capture.
+ * @param  samples: the input
+ * @param  count: the number of samples
+ * @param  engine: capture engine (I to take a sample at a time, as the timer
+ *         interrupt does, or D to take a block at a time, as the DMA does)
+ * @param  drainEvery: drain the queue after every so many blocks (the larger
+ *         this is, the more samples are lost)
+ * @param  decimate: non-zero to switch decimation on and off now and then
+ * @param  out: where to put the output
+ * @retval none
+ */
+static void runCapture(const uint8_t *samples, uint32_t count, char engine, uint32_t drainEvery, uint8_t decimate,
+		CaptureOutput *out) {
+	uint32_t i, j, n, blocks = 0;
+
+	seed = 88172645UL;
+	out->len = 0;
+	out->eventCount = 0;
+
+	for (i = 0; i < count; i += n) {
+		n = 1 + nextRandom() % 512;
+		if (n > count - i)
+			n = count - i;
+
+		if (decimate && nextRandom() % 16 == 0)
+			CaptureDecimate(nextRandom() & 1);
+
+		if (engine == 'D')
+			CaptureBlock(samples + i, n);
+		else
+			for (j = i; j < i + n; j++) {
+				Irqs++;
+				EnqueueSample(samples[j]);
+			}
+
+		if (++blocks % drainEvery == 0)
+			drainCapture(out);
+	}
+	EnqueueFinalSample();
+	drainCapture(out);
+
+	out->samples = Irqs;
+	out->stats = Stats;
+}
+
+/**
+ * @brief  Compare the events of two captures.
+ * @param  a: one capture
+ * @param  b: the other
+ * @retval non-zero if they are the same
+ */
+static int sameEvents(const CaptureOutput *a, const CaptureOutput *b) {
+	uint32_t i;
+
+	if (a->eventCount != b->eventCount)
+		return 0;
+	for (i = 0; i < a->eventCount; i++)
+		if (a->events[i].type != b->events[i].type || a->events[i].position != b->events[i].position ||
+				a->events[i].value != b->events[i].value)
+			return 0;
+	return 1;
+}
+
+/**
+ * @brief  Check that the DMA capture engine's block routines produce exactly
+ *         the same output as the timer interrupt's per-sample routines, for
+ *         every mode and channel width, with and without a trigger,
+ *         decimation and lost samples.
+ * @param  none
+ * @retval none
+ */
+static void checkCaptureEngines() {
+	static const struct {
+		int channels;
+		uint8_t pins;
+	} widths[] = { { 1, 0x04 }, { 2, 0x0a }, { 3, 0x0b }, { 4, 0xa5 }, { 8, 0xff } };
+	static const struct {
+		const char *name;
+		uint8_t trigger;
+		uint32_t drainEvery;
+		uint8_t decimate;
+	} cases[] = {
+		{ "plain", TRIGGER_NONE, 1, 0 },
+		{ "trigger", TRIGGER_PATTERN_EDGE, 1, 0 },
+		{ "decimated", TRIGGER_NONE, 1, 1 },
+		{ "gaps", TRIGGER_NONE, 24, 1 },
+	};
+	static uint8_t samples[CHECK_SAMPLES];
+	static CaptureOutput irq, dma;
+	const char *mode;
+	unsigned w, c;
+
+	makeInput(samples, CHECK_SAMPLES);
+
+	for (mode = "CTR"; *mode; mode++)
+		for (w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+			for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+				setupCapture(*mode, widths[w].channels, widths[w].pins, cases[c].trigger);
+				runCapture(samples, CHECK_SAMPLES, 'I', cases[c].drainEvery, cases[c].decimate, &irq);
+				setupCapture(*mode, widths[w].channels, widths[w].pins, cases[c].trigger);
+				runCapture(samples, CHECK_SAMPLES, 'D', cases[c].drainEvery, cases[c].decimate, &dma);
+
+				report(irq.len == dma.len && memcmp(irq.bytes, dma.bytes, irq.len) == 0 &&
+						sameEvents(&irq, &dma) &&
+						irq.samples == dma.samples && irq.stats.dropped == dma.stats.dropped &&
+						irq.stats.gaps == dma.stats.gaps && irq.stats.gapSamples == dma.stats.gapSamples,
+						"capture engines agree: mode %c, %d channels, %-9s (%zu bytes, %u events, %u lost)",
+						*mode, widths[w].channels, cases[c].name, irq.len, (unsigned) irq.eventCount,
+						(unsigned) irq.stats.gapSamples);
+			}
+}
+
+/**
+ * @brief  Find where a capture starts with the current trigger settings, the
+ *         slow way: straight from the definitions in trigger.h.
+ * @param  samples: the input
+ * @param  count: the number of samples
+ * @retval the index of the first sample captured, or 'count' if the trigger
+ *         never fires (or the hold-off runs past the end)
+ */
+static uint32_t triggerStart(const uint8_t *samples, uint32_t count) {
+	uint32_t i, fire = count;
+	uint8_t seen = 0, edge, pattern;
+
+	for (i = 0; i < count && fire == count; i++) {
+		pattern = (samples[i] & TriggerMask) == (TriggerValue & TriggerMask);
+		edge = i > 0 && ((~samples[i - 1] & samples[i] & TriggerRising) | (samples[i - 1] & ~samples[i] & TriggerFalling));
+		seen |= pattern;
+
+		switch (TriggerMode) {
+		case TRIGGER_PATTERN:
+			if (pattern)
+				fire = i;
+			break;
+		case TRIGGER_EDGE:
+			if (edge)
+				fire = i;
+			break;
+		case TRIGGER_PATTERN_EDGE:
+			if (seen && edge)
+				fire = i;
+			break;
+		default:
+			fire = i;
+			break;
+		}
+	}
+
+	return (count - fire > TriggerHoldoff) ? fire + TriggerHoldoff : count;
+}
+
+/**
+ * @brief  Check the trigger: for random settings and input, scanning the
+ *         input in blocks of random length (as the DMA does) or a sample at
+ *         a time (as the timer interrupt does) must start the capture at the
+ *         same sample as the definitions of the trigger modes say.
+ * @param  none
+ * @retval none
+ */
+static void checkTrigger() {
+#define TRIGGER_SAMPLES 4096
+#define TRIGGER_TRIALS 4000
+	static const char *names[] = { "none", "pattern", "edge", "pattern-edge" };
+	static uint8_t samples[TRIGGER_SAMPLES];
+	uint32_t trial, i, n, start, expected, wrong[4], fired[4], trials[4];
+	uint8_t bits, value, byBlock;
+	int mode;
+
+	memset(wrong, 0, sizeof(wrong));
+	memset(fired, 0, sizeof(fired));
+	memset(trials, 0, sizeof(trials));
+	seed = 1234567;
+
+	for (trial = 0; trial < TRIGGER_TRIALS; trial++) {
+		// Input that mostly holds still, with a few channels changing now
+		// and then, so the trigger fires anywhere (or nowhere).
+		bits = nextRandom();
+		value = nextRandom();
+		for (i = 0; i < TRIGGER_SAMPLES; i++) {
+			if (nextRandom() % 64 == 0)
+				value ^= nextRandom() & bits;
+			samples[i] = value;
+		}
+
+		mode = trial % 4;
+		TriggerMode = mode;
+		TriggerMask = nextRandom() & nextRandom();
+		TriggerValue = nextRandom();
+		TriggerRising = nextRandom() & nextRandom() & nextRandom();
+		TriggerFalling = nextRandom() & nextRandom() & nextRandom();
+		TriggerHoldoff = (nextRandom() & 1) ? nextRandom() % 300 : 0;
+		byBlock = trial & 4;
+		expected = triggerStart(samples, TRIGGER_SAMPLES);
+
+		TriggerInit();
+		for (start = 0; start < TRIGGER_SAMPLES; start += n) {
+			n = byBlock ? 1 + nextRandom() % 512 : 1;
+			if (n > TRIGGER_SAMPLES - start)
+				n = TRIGGER_SAMPLES - start;
+			i = TriggerScan(samples + start, n);
+			if (i < n) {
+				start += i;
+				break;
+			}
+		}
+
+		trials[mode]++;
+		fired[mode] += expected < TRIGGER_SAMPLES;
+		wrong[mode] += start != expected;
+	}
+
+	for (mode = 0; mode < 4; mode++)
+		report(wrong[mode] == 0, "trigger %-12s starts where it should (%u of %u trials fired, %u wrong)",
+				names[mode], (unsigned) fired[mode], (unsigned) trials[mode], (unsigned) wrong[mode]);
+
+	// Leave the trigger as the firmware starts up, so later checks capture
+	// straight away.
+	TriggerMode = TRIGGER_NONE;
+	TriggerMask = 0;
+	TriggerValue = 0;
+	TriggerRising = 0;
+	TriggerFalling = 0;
+	TriggerHoldoff = 0;
+	TriggerInit();
+}
+
+/**
+ * @brief  Pack the sampled pins of a raw sample into the low bits, as the
+ *         capture routines do.
+ * @param  sample: the raw sample
+ * @param  pins: the pins sampled
+ * @retval the packed sample
+ */
+static uint8_t packPins(uint8_t sample, uint8_t pins) {
+	uint8_t packed = 0, bit = 0, pin;
+
+	for (pin = 0; pin < 8; pin++)
+		if (pins & (1 << pin)) {
+			if (sample & (1 << pin))
+				packed |= 1 << bit;
+			bit++;
+		}
+	return packed;
+}
+
+/**
+ * @brief  Check that the transition-only records decode back to the samples
+ *         they were made from: each record is the ticks since the last one as
+ *         a variable-length integer, then the mask of the channels that
+ *         changed, and a mask of zero ends the capture.
+ * @param  none
+ * @retval none
+ */
+static void checkTransitionRecords() {
+	static const uint8_t pinSets[] = { 0xff, 0xa5, 0x01 };
+	static uint8_t samples[CHECK_SAMPLES];
+	static CaptureOutput out;
+	uint32_t tick, delta, t, wrong, records;
+	uint8_t value, mask, shift, ended;
+	size_t pos;
+	unsigned p;
+
+	makeInput(samples, CHECK_SAMPLES);
+
+	for (p = 0; p < sizeof(pinSets); p++) {
+		setupCapture('T', 8, pinSets[p], TRIGGER_NONE);
+		runCapture(samples, CHECK_SAMPLES, 'D', 1, 0, &out);
+
+		// Every tick from the last record up to this one has the last value.
+		tick = 0;
+		value = 0;
+		wrong = 0;
+		records = 0;
+		ended = 0;
+		for (pos = 0; pos < out.len && !ended;) {
+			delta = 0;
+			shift = 0;
+			while (pos < out.len && (out.bytes[pos] & 0x80)) {
+				delta |= (uint32_t) (out.bytes[pos++] & 0x7f) << shift;
+				shift += 7;
+			}
+			if (pos + 1 >= out.len)
+				break;
+			delta |= (uint32_t) out.bytes[pos++] << shift;
+			mask = out.bytes[pos++];
+			records++;
+
+			for (t = tick + 1; t < tick + delta && t <= CHECK_SAMPLES; t++)
+				wrong += packPins(samples[t - 1], pinSets[p]) != value;
+			tick += delta;
+			value ^= mask;
+			if (mask == 0)
+				ended = 1;
+			else if (tick >= 1 && tick <= CHECK_SAMPLES)
+				wrong += packPins(samples[tick - 1], pinSets[p]) != value;
+		}
+
+		report(ended && pos == out.len && tick == CHECK_SAMPLES && wrong == 0,
+				"transition records decode: pins 0x%02x, %u records in %zu bytes (%u samples wrong)",
+				pinSets[p], (unsigned) records, out.len, (unsigned) wrong);
+	}
+}
+
+/**
+ * @brief  Get the byte at a position in the queue check's byte stream.
+ * @param  i: the position
+ * @retval the byte
+ */
+static inline uint8_t queueCheckByte(uint32_t i) {
+	return (i * 2654435761UL) >> 24;
+}
+
+/**
+ * @brief  Producer thread of the queue check: queue the byte stream with a
+ *         mix of the producer's calls, trying again whenever the queue is
+ *         full.
+ * @param  arg: unused
+ * @retval none
+ */
+static void *queueProducer(void *arg) {
+	uint8_t record[16];
+	uint32_t i = 0, n, k, r = 12345;
+
+	while (i < CHECK_QUEUE_BYTES) {
+		r = r * 1103515245 + 12345;
+		switch ((r >> 16) % 3) {
+		case 0:
+			while (EnqueueByte(queueCheckByte(i)) < 0)
+				sched_yield();
+			i++;
+			break;
+		case 1:
+			n = 1 + (r >> 20) % sizeof(record);
+			if (n > CHECK_QUEUE_BYTES - i)
+				n = CHECK_QUEUE_BYTES - i;
+			for (k = 0; k < n; k++)
+				record[k] = queueCheckByte(i + k);
+			while (EnqueueBytes(record, n) < 0)
+				sched_yield();
+			i += n;
+			break;
+		default:
+			if (CHECK_QUEUE_BYTES - i < 4)
+				break;
+			while (EnqueueWord(queueCheckByte(i) | queueCheckByte(i + 1) << 8 |
+					queueCheckByte(i + 2) << 16 | (uint32_t) queueCheckByte(i + 3) << 24) < 0)
+				sched_yield();
+			i += 4;
+			break;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief  Check the sample queue with the producer and the consumer on
+ *         threads of their own, running at the same time (which is harder on
+ *         it than the capture interrupt and the main loop taking turns). The
+ *         consumer takes bytes off with a mix of its calls and checks that
+ *         every byte comes out once, in order.
+ * @param  none
+ * @retval none
+ */
+static void checkQueue() {
+	static uint8_t block[600];
+	uint32_t i = 0, n, k, r = 54321, wrong = 0;
+	pthread_t producer;
+	uint8_t *span;
+
+	ClearSampleQueue();
+	pthread_create(&producer, NULL, queueProducer, NULL);
+
+	while (i < CHECK_QUEUE_BYTES) {
+		if (SampleQueueIsEmpty()) {
+			sched_yield();
+			continue;
+		}
+
+		r = r * 1103515245 + 12345;
+		switch ((r >> 16) % 3) {
+		case 0:
+			wrong += DequeueSample() != queueCheckByte(i++);
+			break;
+		case 1:
+			n = DequeueBlock(block, 1 + (r >> 20) % sizeof(block));
+			for (k = 0; k < n; k++)
+				wrong += block[k] != queueCheckByte(i++);
+			break;
+		default:
+			n = SampleQueuePeek(&span, 1 + (r >> 20) % 2048);
+			for (k = 0; k < n; k++)
+				wrong += span[k] != queueCheckByte(i++);
+			SampleQueueRelease(n);
+			break;
+		}
+	}
+
+	pthread_join(producer, NULL);
+	report(wrong == 0 && SampleQueueIsEmpty(), "queue passes %u bytes between threads intact (%u wrong)",
+			(unsigned) i, (unsigned) wrong);
+	ClearSampleQueue();
+}
+
+/**
+ * @brief  Check that frames of uncompressed samples are not sent so often
+ *         that the framing costs more than a small part of the line. Each
+ *         capture runs in a simulation of its own (see SimTrial()), with the
+ *         defaults for the speed-up and the baud rate, and must have taken
+ *         nearly all of its samples, so an empty capture can't pass. The
+ *         start, status and end frames are part of the count, so the limit
+ *         is a little above the framing overhead alone. At low rates a frame
+ *         goes out every TX_FLUSH_MS with what little has come in, trading
+ *         framing for latency, so the limit there is a frame's overhead per
+ *         TX_FLUSH_MS of samples.
+ * @param  none
+ * @retval none
+ */
+static void checkLineOverhead() {
+#define LINE_MS       500
+#define LINE_FLUSH_MS 10	// TX_FLUSH_MS in main.c
+	static const struct {
+		int channels;
+		uint32_t rate;
+	} cases[] = { { 8, 1000 }, { 8, 20000 }, { 8, 50000 }, { 1, 100000 } };
+	SimResult r;
+	double payload, overhead, flushBytes, limit;
+	uint32_t expected;
+	unsigned c;
+
+	for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		r = SimTrial('C', cases[c].channels, 'N', 'I', cases[c].rate, LINE_MS);
+		expected = (uint64_t) cases[c].rate * LINE_MS / 1000;
+		payload = (double) r.samples * cases[c].channels / 8;
+		overhead = payload ? r.stats.bytesSent / payload - 1 : 0;
+
+		// The bytes that come in between flushes; while that's less than ten
+		// frames' overhead, the flush timeout sets the framing.
+		flushBytes = (double) cases[c].rate * cases[c].channels / 8 * LINE_FLUSH_MS / 1000;
+		limit = 0.1;
+		if (flushBytes < 10 * FRAME_OVERHEAD)
+			limit += FRAME_OVERHEAD / flushBytes;
+
+		report(r.done && !r.overflow && r.samples >= expected / 10 * 9 && overhead < limit,
+				"line overhead: %d channels at %6u Hz, %llu bytes for %u of %u samples (%.1f%% framing, limit %.0f%%)",
+				cases[c].channels, (unsigned) cases[c].rate, (unsigned long long) r.stats.bytesSent,
+				(unsigned) r.samples, (unsigned) expected, 100 * overhead, 100 * limit);
+	}
+}
+
+/**
+ * @brief  Run the self-checks.
+ * @param  none
+ * @retval the number of checks that failed
+ */
+int SimCheck() {
+	failures = 0;
+
+	checkCaptureEngines();
+	checkTransitionRecords();
+	checkTrigger();
+	checkQueue();
+	checkLineOverhead();
+
+	printf("%d check%s failed\n", failures, failures == 1 ? "" : "s");
+	return failures;
+}
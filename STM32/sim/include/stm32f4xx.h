@@ -0,0 +1,351 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef STM32F4XX_H
+#define STM32F4XX_H
+
+#include <stdint.h>
+
+// Host simulation stand-in for the CMSIS device header and the parts of the
+// Standard Peripheral Library the firmware uses. The peripherals are plain
+// structs that are updated by the simulator (see periph.c); only the
+// registers and bits the firmware (or the simulator) looks at are modelled.
+// Fields marked 'sim' do not exist on the real part.
+
+typedef enum { RESET = 0, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+
+typedef enum {
+	TIM2_IRQn = 28,
+	USART2_IRQn = 38,
+	DMA2_Stream1_IRQn = 57,
+	SIM_IRQ_COUNT = 96
+} IRQn_Type;
+
+// The Cortex-M data memory barrier. The simulated 'interrupts' run on the
+// same thread, so all it has to do is keep the compiler from moving queue
+// accesses across it. The queue check (check.c) puts the two sides of the
+// queue on threads of their own, though; on x86, where stores are not
+// reordered with other stores or loads with other loads, that still needs
+// no more than a compiler barrier, so a full barrier is only used elsewhere.
+#if defined(__x86_64__) || defined(__i386__)
+#define __DMB() __asm__ volatile ("" ::: "memory")
+#else
+#define __DMB() __sync_synchronize()
+#endif
+
+extern void SystemInit(void);
+extern uint32_t SysTick_Config(uint32_t ticks);
+
+/* Core debug (cycle counter) ---------------------------------------------- */
+
+typedef struct {
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+#define CoreDebug_DEMCR_TRCENA_Msk 0x01000000
+#define DWT_CTRL_CYCCNTENA_Msk     0x00000001
+
+// Every read of the cycle counter goes through SimDwt(), which brings it up
+// to the simulated time, including the host time the firmware has spent since
+// the simulator last ran.
+extern CoreDebug_Type SimCoreDebug;
+extern DWT_Type *SimDwt(void);
+
+#define CoreDebug (&SimCoreDebug)
+#define DWT (SimDwt())
+
+/* RCC --------------------------------------------------------------------- */
+
+typedef struct {
+	uint32_t SYSCLK_Frequency;
+	uint32_t HCLK_Frequency;
+	uint32_t PCLK1_Frequency;
+	uint32_t PCLK2_Frequency;
+} RCC_ClocksTypeDef;
+
+#define RCC_AHB1Periph_GPIOA  0x00000001
+#define RCC_AHB1Periph_GPIOD  0x00000008
+#define RCC_AHB1Periph_GPIOE  0x00000010
+#define RCC_AHB1Periph_DMA1   0x00200000
+#define RCC_AHB1Periph_DMA2   0x00400000
+#define RCC_APB1Periph_TIM2   0x00000001
+#define RCC_APB1Periph_USART2 0x00020000
+#define RCC_APB2Periph_TIM8   0x00000002
+
+extern void RCC_GetClocksFreq(RCC_ClocksTypeDef *clocks);
+extern void RCC_AHB1PeriphClockCmd(uint32_t periph, FunctionalState state);
+extern void RCC_APB1PeriphClockCmd(uint32_t periph, FunctionalState state);
+extern void RCC_APB2PeriphClockCmd(uint32_t periph, FunctionalState state);
+
+/* NVIC -------------------------------------------------------------------- */
+
+typedef struct {
+	uint8_t NVIC_IRQChannel;
+	uint8_t NVIC_IRQChannelPreemptionPriority;
+	uint8_t NVIC_IRQChannelSubPriority;
+	FunctionalState NVIC_IRQChannelCmd;
+} NVIC_InitTypeDef;
+
+extern void NVIC_Init(NVIC_InitTypeDef *init);
+
+/* GPIO -------------------------------------------------------------------- */
+
+typedef struct {
+	volatile uint32_t MODER;
+	volatile uint32_t OTYPER;
+	volatile uint32_t OSPEEDR;
+	volatile uint32_t PUPDR;
+	volatile uint32_t IDR;
+	volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum { GPIO_Mode_IN = 0, GPIO_Mode_OUT = 1, GPIO_Mode_AF = 2, GPIO_Mode_AN = 3 } GPIOMode_TypeDef;
+typedef enum { GPIO_OType_PP = 0, GPIO_OType_OD = 1 } GPIOOType_TypeDef;
+typedef enum { GPIO_Speed_2MHz = 0, GPIO_Speed_25MHz = 1, GPIO_Speed_50MHz = 2, GPIO_Speed_100MHz = 3 } GPIOSpeed_TypeDef;
+typedef enum { GPIO_PuPd_NOPULL = 0, GPIO_PuPd_UP = 1, GPIO_PuPd_DOWN = 2 } GPIOPuPd_TypeDef;
+
+typedef struct {
+	uint32_t GPIO_Pin;
+	GPIOMode_TypeDef GPIO_Mode;
+	GPIOSpeed_TypeDef GPIO_Speed;
+	GPIOOType_TypeDef GPIO_OType;
+	GPIOPuPd_TypeDef GPIO_PuPd;
+} GPIO_InitTypeDef;
+
+#define GPIO_Pin_0  0x0001
+#define GPIO_Pin_1  0x0002
+#define GPIO_Pin_2  0x0004
+#define GPIO_Pin_3  0x0008
+#define GPIO_Pin_4  0x0010
+#define GPIO_Pin_5  0x0020
+#define GPIO_Pin_6  0x0040
+#define GPIO_Pin_7  0x0080
+#define GPIO_Pin_8  0x0100
+#define GPIO_Pin_9  0x0200
+#define GPIO_Pin_10 0x0400
+#define GPIO_Pin_11 0x0800
+#define GPIO_Pin_12 0x1000
+#define GPIO_Pin_13 0x2000
+#define GPIO_Pin_14 0x4000
+#define GPIO_Pin_15 0x8000
+
+#define GPIO_PinSource2 2
+#define GPIO_PinSource3 3
+#define GPIO_AF_USART2  7
+
+extern GPIO_TypeDef SimGPIOA, SimGPIOD, SimGPIOE;
+#define GPIOA (&SimGPIOA)
+#define GPIOD (&SimGPIOD)
+#define GPIOE (&SimGPIOE)
+
+extern void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *init);
+extern void GPIO_PinAFConfig(GPIO_TypeDef *GPIOx, uint16_t source, uint8_t af);
+extern uint16_t GPIO_ReadInputData(GPIO_TypeDef *GPIOx);
+extern void GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t pins);
+extern void GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t pins);
+extern void GPIO_Write(GPIO_TypeDef *GPIOx, uint16_t value);
+
+/* USART ------------------------------------------------------------------- */
+
+typedef struct {
+	volatile uint16_t SR;
+	uint16_t reserved0;
+	volatile uint16_t DR;
+	uint16_t reserved1;
+	volatile uint16_t BRR;
+	uint16_t reserved2;
+	volatile uint16_t CR1;
+	uint16_t reserved3;
+	volatile uint16_t CR2;
+	uint16_t reserved4;
+	volatile uint16_t CR3;
+	uint16_t reserved5;
+	uint32_t BaudRate;		// sim
+} USART_TypeDef;
+
+#define USART_SR_RXNE 0x0020
+#define USART_SR_TC   0x0040
+#define USART_SR_TXE  0x0080
+#define USART_CR1_RXNEIE 0x0020
+#define USART_CR1_UE  0x2000
+
+typedef struct {
+	uint32_t USART_BaudRate;
+	uint16_t USART_WordLength;
+	uint16_t USART_StopBits;
+	uint16_t USART_Parity;
+	uint16_t USART_Mode;
+	uint16_t USART_HardwareFlowControl;
+} USART_InitTypeDef;
+
+#define USART_WordLength_8b 0x0000
+#define USART_StopBits_1    0x0000
+#define USART_Parity_No     0x0000
+#define USART_Mode_Rx       0x0004
+#define USART_Mode_Tx       0x0008
+#define USART_HardwareFlowControl_None 0x0000
+#define USART_IT_RXNE       USART_SR_RXNE
+#define USART_DMAReq_Tx     0x0080
+
+extern USART_TypeDef SimUSART2;
+#define USART2 (&SimUSART2)
+
+extern void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *init);
+extern void USART_Cmd(USART_TypeDef *USARTx, FunctionalState state);
+extern void USART_ITConfig(USART_TypeDef *USARTx, uint16_t it, FunctionalState state);
+extern void USART_DMACmd(USART_TypeDef *USARTx, uint16_t req, FunctionalState state);
+extern void USART_SendData(USART_TypeDef *USARTx, uint16_t data);
+extern uint16_t USART_ReceiveData(USART_TypeDef *USARTx);
+extern ITStatus USART_GetITStatus(USART_TypeDef *USARTx, uint16_t it);
+extern void USART_ClearITPendingBit(USART_TypeDef *USARTx, uint16_t it);
+
+/* TIM --------------------------------------------------------------------- */
+
+typedef struct {
+	volatile uint32_t CR1;
+	volatile uint32_t DIER;
+	volatile uint32_t SR;
+	volatile uint32_t PSC;
+	volatile uint32_t ARR;
+	uint8_t Apb;			// sim: 1 or 2, the APB bus the timer is on
+} TIM_TypeDef;
+
+#define TIM_CR1_CEN 0x0001
+
+typedef struct {
+	uint16_t TIM_Prescaler;
+	uint16_t TIM_CounterMode;
+	uint32_t TIM_Period;
+	uint16_t TIM_ClockDivision;
+	uint8_t TIM_RepetitionCounter;
+} TIM_TimeBaseInitTypeDef;
+
+#define TIM_CounterMode_Up 0x0000
+#define TIM_CKD_DIV1       0x0000
+#define TIM_IT_Update      0x0001
+#define TIM_DMA_Update     0x0100
+
+extern TIM_TypeDef SimTIM2, SimTIM8;
+#define TIM2 (&SimTIM2)
+#define TIM8 (&SimTIM8)
+
+extern void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *init);
+extern void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState state);
+extern void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t it, FunctionalState state);
+extern void TIM_DMACmd(TIM_TypeDef *TIMx, uint16_t source, FunctionalState state);
+extern ITStatus TIM_GetITStatus(TIM_TypeDef *TIMx, uint16_t it);
+extern void TIM_ClearITPendingBit(TIM_TypeDef *TIMx, uint16_t it);
+
+/* DMA --------------------------------------------------------------------- */
+
+typedef struct {
+	volatile uint32_t CR;
+	volatile uint32_t NDTR;
+	volatile uint32_t PAR;
+	volatile uint32_t M0AR;
+	volatile uint32_t M1AR;
+	volatile uint32_t FCR;
+	volatile uint32_t ISR;		// sim: this stream's flags from LISR/HISR
+	uint32_t Size;			// sim: NDTR reload value
+} DMA_Stream_TypeDef;
+
+#define DMA_SxCR_EN   0x00000001
+#define DMA_SxCR_HTIE 0x00000008
+#define DMA_SxCR_TCIE 0x00000010
+#define DMA_SxCR_DIR  0x000000c0
+#define DMA_SxCR_CIRC 0x00000100
+#define DMA_SxCR_DBM  0x00040000
+#define DMA_SxCR_CT   0x00080000
+
+typedef struct {
+	uint32_t DMA_Channel;
+	uint32_t DMA_PeripheralBaseAddr;
+	uint32_t DMA_Memory0BaseAddr;
+	uint32_t DMA_DIR;
+	uint32_t DMA_BufferSize;
+	uint32_t DMA_PeripheralInc;
+	uint32_t DMA_MemoryInc;
+	uint32_t DMA_PeripheralDataSize;
+	uint32_t DMA_MemoryDataSize;
+	uint32_t DMA_Mode;
+	uint32_t DMA_Priority;
+	uint32_t DMA_FIFOMode;
+	uint32_t DMA_FIFOThreshold;
+	uint32_t DMA_MemoryBurst;
+	uint32_t DMA_PeripheralBurst;
+} DMA_InitTypeDef;
+
+#define DMA_Channel_4 0x08000000
+#define DMA_Channel_7 0x0e000000
+#define DMA_DIR_PeripheralToMemory 0x00000000
+#define DMA_DIR_MemoryToPeripheral 0x00000040
+#define DMA_PeripheralInc_Disable 0x00000000
+#define DMA_MemoryInc_Enable 0x00000400
+#define DMA_PeripheralDataSize_Byte 0x00000000
+#define DMA_MemoryDataSize_Byte 0x00000000
+#define DMA_Mode_Normal 0x00000000
+#define DMA_Mode_Circular DMA_SxCR_CIRC
+#define DMA_Priority_High 0x00020000
+#define DMA_Priority_VeryHigh 0x00030000
+#define DMA_FIFOMode_Disable 0x00000000
+#define DMA_FIFOThreshold_Full 0x00000003
+#define DMA_MemoryBurst_Single 0x00000000
+#define DMA_PeripheralBurst_Single 0x00000000
+#define DMA_Memory_0 0x00000000
+
+#define DMA_IT_HT DMA_SxCR_HTIE
+#define DMA_IT_TC DMA_SxCR_TCIE
+
+// The flags are kept per stream, so the same bits serve every stream.
+#define DMA_FLAG_FE   0x01
+#define DMA_FLAG_DME  0x04
+#define DMA_FLAG_TE   0x08
+#define DMA_FLAG_HT   0x10
+#define DMA_FLAG_TC   0x20
+#define DMA_IT_HTIF1  DMA_FLAG_HT
+#define DMA_IT_TCIF1  DMA_FLAG_TC
+#define DMA_FLAG_FEIF6  DMA_FLAG_FE
+#define DMA_FLAG_DMEIF6 DMA_FLAG_DME
+#define DMA_FLAG_TEIF6  DMA_FLAG_TE
+#define DMA_FLAG_HTIF6  DMA_FLAG_HT
+#define DMA_FLAG_TCIF6  DMA_FLAG_TC
+
+extern DMA_Stream_TypeDef SimDMA1_Stream6, SimDMA2_Stream1;
+#define DMA1_Stream6 (&SimDMA1_Stream6)
+#define DMA2_Stream1 (&SimDMA2_Stream1)
+
+extern void DMA_DeInit(DMA_Stream_TypeDef *stream);
+extern void DMA_Init(DMA_Stream_TypeDef *stream, DMA_InitTypeDef *init);
+extern void DMA_Cmd(DMA_Stream_TypeDef *stream, FunctionalState state);
+extern FunctionalState DMA_GetCmdStatus(DMA_Stream_TypeDef *stream);
+extern void DMA_ITConfig(DMA_Stream_TypeDef *stream, uint32_t it, FunctionalState state);
+extern ITStatus DMA_GetITStatus(DMA_Stream_TypeDef *stream, uint32_t it);
+extern void DMA_ClearITPendingBit(DMA_Stream_TypeDef *stream, uint32_t it);
+extern void DMA_ClearFlag(DMA_Stream_TypeDef *stream, uint32_t flags);
+extern uint16_t DMA_GetCurrDataCounter(DMA_Stream_TypeDef *stream);
+extern uint32_t DMA_GetCurrentMemoryTarget(DMA_Stream_TypeDef *stream);
+extern void DMA_DoubleBufferModeConfig(DMA_Stream_TypeDef *stream, uint32_t memory1, uint32_t memory);
+extern void DMA_DoubleBufferModeCmd(DMA_Stream_TypeDef *stream, FunctionalState state);
+
+#endif /* STM32F4XX_H */
@@ -0,0 +1,730 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "stm32f4xx.h"
+#include "evalboard.h"
+#include "main.h"
+#include "periph.h"
+
+// The simulated peripherals. Time only moves in SimAdvance(), which runs the
+// peripheral events (timer updates, DMA transfers, USART bytes) that are due,
+// calling the firmware's interrupt handlers as the real ones would be.
+//
+// The core is modelled too: an interrupt handler keeps it busy for the host
+// time it took (times the speed-up) plus the entry and exit cost, holding up
+// both the main loop and any other interrupt. An interrupt that is raised
+// again while it is still pending is lost, as on the real part.
+
+GPIO_TypeDef SimGPIOA, SimGPIOD, SimGPIOE;
+USART_TypeDef SimUSART2;
+TIM_TypeDef SimTIM2 = { .Apb = 1 };
+TIM_TypeDef SimTIM8 = { .Apb = 2 };
+DMA_Stream_TypeDef SimDMA1_Stream6, SimDMA2_Stream1;
+CoreDebug_Type SimCoreDebug;
+
+SimTime SimNow;
+SimStats SimStat;
+uint32_t SimBaudOverride;
+uint32_t SimIsrCycles = 24;
+double SimSpeed = 20;
+
+extern void SysTick_Handler(void);
+extern void TIM2_IRQHandler(void);
+extern void USART2_IRQHandler(void);
+extern void DMA2_Stream1_IRQHandler(void);
+
+#define NEVER UINT64_MAX
+
+// The interrupts, highest priority first.
+enum {
+	IRQ_TIM2, IRQ_DMA2_STREAM1, IRQ_USART2, IRQ_SYSTICK, IRQ_COUNT
+};
+
+// How often an idle receiver looks for input.
+#define RX_POLL (SIM_PS_PER_SECOND / 1000)
+
+// Interrupt handlers are timed with the host's clock, which is noisy: the
+// host takes interrupts of its own, and any hiccup is multiplied by the
+// speed-up. A handler is charged the least time it took in its last few
+// runs instead, which follows changes in what it does without the noise.
+#define ISR_HISTORY 8
+
+// If interrupts keep the core busy for this long without a break, the main
+// loop is starved (it would be on the real part too) and the run is over.
+#define STARVED (SIM_PS_PER_SECOND / 10)
+
+static uint8_t irqEnabled[SIM_IRQ_COUNT];
+static SimTime sysTickPeriod;
+static SimTime nextSysTick, nextTim2, nextTim8, nextTx, nextRx, txeAt;
+static SimTime lineFreeAt;
+static SimTime horizon, cpuFreeAt;
+static uint8_t pendingIrqs;
+static int64_t isrTimes[IRQ_COUNT][ISR_HISTORY];
+static uint8_t isrRuns[IRQ_COUNT];
+static uint8_t sampling;
+static int64_t clockCost;
+static DWT_Type dwt;
+static struct timespec hostRef;
+static SimTime simRef, dwtTime;
+
+static uint8_t outBuf[4096];
+static size_t outLen;
+
+/**
+ * @brief  Get the time between two host clock readings.
+ * @param  a: the first reading
+ * @param  b: the second reading
+ * @retval the time in nanoseconds
+ */
+static int64_t elapsed(const struct timespec *a, const struct timespec *b) {
+	return (b->tv_sec - a->tv_sec) * 1000000000LL + (b->tv_nsec - a->tv_nsec);
+}
+
+/**
+ * @brief  Reset the simulated peripherals.
+ * @param  none
+ * @retval none
+ */
+void SimReset() {
+	struct timespec a, b;
+	int i;
+
+	// The firmware hands buffer addresses to the DMA as 32-bit values.
+	if ((uintptr_t) &SimGPIOE > 0xffffffffUL || (uintptr_t) outBuf > 0xffffffffUL) {
+		static const char msg[] = "lasim: static data is above 4 GB; link with -no-pie\n";
+		write(2, msg, sizeof(msg) - 1);
+		exit(1);
+	}
+
+	clockCost = INT64_MAX;
+	for (i = 0; i < 1000; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &a);
+		clock_gettime(CLOCK_MONOTONIC, &b);
+		if (elapsed(&a, &b) < clockCost)
+			clockCost = elapsed(&a, &b);
+	}
+
+	memset(irqEnabled, 0, sizeof(irqEnabled));
+	memset(&SimStat, 0, sizeof(SimStat));
+	SimNow = 0;
+	sysTickPeriod = 0;
+	nextSysTick = nextTim2 = nextTim8 = nextTx = nextRx = txeAt = NEVER;
+	lineFreeAt = 0;
+	horizon = cpuFreeAt = 0;
+	pendingIrqs = 0;
+	for (i = 0; i < IRQ_COUNT * ISR_HISTORY; i++)
+		isrTimes[i / ISR_HISTORY][i % ISR_HISTORY] = INT64_MAX;
+	memset(isrRuns, 0, sizeof(isrRuns));
+	sampling = 0;
+	outLen = 0;
+	SimUSART2.SR = USART_SR_TXE | USART_SR_TC;
+	memset(&dwt, 0, sizeof(dwt));
+	SimCoreDebug.DEMCR = 0;
+	clock_gettime(CLOCK_MONOTONIC, &hostRef);
+	simRef = dwtTime = 0;
+}
+
+/**
+ * @brief  Get the DWT registers, with the cycle counter brought up to date.
+ * @param  none
+ * @retval the registers
+ */
+DWT_Type *SimDwt() {
+	struct timespec now;
+	SimTime t;
+
+	if ((SimCoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) && (dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		t = simRef + (SimTime) (elapsed(&hostRef, &now) * 1000 * SimSpeed);
+
+		// The host clock and simulated time don't quite agree, but the
+		// counter must never go backwards.
+		if (t > dwtTime)
+			dwtTime = t;
+		dwt.CYCCNT = (uint32_t) (uint64_t) ((double) dwtTime * SIM_SYSCLK / SIM_PS_PER_SECOND);
+	}
+	return &dwt;
+}
+
+/**
+ * @brief  Check if the blue (sampling) LED is on.
+ * @param  none
+ * @retval non-zero while the firmware is sampling
+ */
+uint8_t SimSampling() {
+	return sampling;
+}
+
+/**
+ * @brief  Check if the USART has finished sending everything it was given.
+ * @param  none
+ * @retval non-zero if the line is idle
+ */
+uint8_t SimLineIdle() {
+	return !(SimDMA1_Stream6.CR & DMA_SxCR_EN) && lineFreeAt <= SimNow;
+}
+
+static void (* const handlers[IRQ_COUNT])(void) = {
+	TIM2_IRQHandler, DMA2_Stream1_IRQHandler, USART2_IRQHandler, SysTick_Handler
+};
+
+/**
+ * @brief  Make an interrupt pending. It is run as soon as the core is free.
+ * @param  irq: the interrupt (IRQ_xxx)
+ * @retval none
+ */
+static void raise(uint8_t irq) {
+	if ((pendingIrqs & (1 << irq)) && sampling)
+		SimStat.missed++;
+	pendingIrqs |= 1 << irq;
+}
+
+/**
+ * @brief  Run the highest priority pending interrupt handler, keeping track
+ *         of the time it takes (during which the core is busy, and which
+ *         holds up the main loop) and of the queue level.
+ * @param  none
+ * @retval none
+ */
+static void runIsr() {
+	struct timespec a, b;
+	int64_t t;
+	SimTime cost;
+	uint16_t free;
+	uint8_t irq = 0, i;
+
+	while (!(pendingIrqs & (1 << irq)))
+		irq++;
+	pendingIrqs &= ~(1 << irq);
+
+	clock_gettime(CLOCK_MONOTONIC, &a);
+	hostRef = a;
+	simRef = SimNow;
+	handlers[irq]();
+	clock_gettime(CLOCK_MONOTONIC, &b);
+
+	isrTimes[irq][isrRuns[irq]++ % ISR_HISTORY] = elapsed(&a, &b) - clockCost;
+	t = INT64_MAX;
+	for (i = 0; i < ISR_HISTORY; i++)
+		if (isrTimes[irq][i] < t)
+			t = isrTimes[irq][i];
+	if (t < 0)
+		t = 0;
+
+	cost = (SimTime) (t * 1000 * SimSpeed) + (SimTime) SimIsrCycles * SIM_PS_PER_SECOND / SIM_SYSCLK;
+	cpuFreeAt = SimNow + cost;
+	horizon += cost;
+
+	if (sampling) {
+		SimStat.isrCalls++;
+		free = SampleQueueFree();
+		if (free < SimStat.queueMinFree)
+			SimStat.queueMinFree = free;
+	}
+}
+
+/**
+ * @brief  Latch the input waveform into the sample port.
+ * @param  none
+ * @retval none
+ */
+static void latchInputs() {
+#if TIMER_HI_PINS
+	SimGPIOE.IDR = (uint32_t) SimWaveform(SimNow) << 8;
+#else
+	SimGPIOE.IDR = SimWaveform(SimNow);
+#endif
+}
+
+/* Clocks and interrupts --------------------------------------------------- */
+
+void SystemInit() {
+}
+
+uint32_t SysTick_Config(uint32_t ticks) {
+	sysTickPeriod = (SimTime) ticks * SIM_PS_PER_SECOND / SIM_SYSCLK;
+	nextSysTick = SimNow + sysTickPeriod;
+	return 0;
+}
+
+void RCC_GetClocksFreq(RCC_ClocksTypeDef *clocks) {
+	clocks->SYSCLK_Frequency = SIM_SYSCLK;
+	clocks->HCLK_Frequency = SIM_SYSCLK;
+	clocks->PCLK1_Frequency = SIM_PCLK1;
+	clocks->PCLK2_Frequency = SIM_PCLK2;
+}
+
+void RCC_AHB1PeriphClockCmd(uint32_t periph, FunctionalState state) {
+}
+
+void RCC_APB1PeriphClockCmd(uint32_t periph, FunctionalState state) {
+}
+
+void RCC_APB2PeriphClockCmd(uint32_t periph, FunctionalState state) {
+}
+
+void NVIC_Init(NVIC_InitTypeDef *init) {
+	irqEnabled[init->NVIC_IRQChannel] = (init->NVIC_IRQChannelCmd != DISABLE);
+}
+
+/* GPIO -------------------------------------------------------------------- */
+
+/**
+ * @brief  Follow the blue LED, which is on while the firmware is sampling,
+ *         to start and stop collecting the capture statistics.
+ * @param  none
+ * @retval none
+ */
+static void ledsChanged() {
+	uint8_t on = (LED_GPIO->ODR & LED_BLUE) != 0;
+
+	if (on && !sampling) {
+		SimStat.captureStart = SimNow;
+		SimStat.lineBusy = 0;
+		SimStat.bytesSent = 0;
+		SimStat.isrCalls = 0;
+		SimStat.missed = 0;
+		SimStat.queueFree = SampleQueueFree();
+		SimStat.queueMinFree = SimStat.queueFree;
+	} else if (!on && sampling) {
+		SimStat.captureEnd = SimNow;
+		SimStat.captures++;
+	}
+	sampling = on;
+}
+
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *init) {
+}
+
+void GPIO_PinAFConfig(GPIO_TypeDef *GPIOx, uint16_t source, uint8_t af) {
+}
+
+uint16_t GPIO_ReadInputData(GPIO_TypeDef *GPIOx) {
+	if (GPIOx == GPIOE)
+		latchInputs();
+	return GPIOx->IDR;
+}
+
+void GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t pins) {
+	GPIOx->ODR |= pins;
+	if (GPIOx == LED_GPIO)
+		ledsChanged();
+}
+
+void GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t pins) {
+	GPIOx->ODR &= ~pins;
+	if (GPIOx == LED_GPIO)
+		ledsChanged();
+}
+
+void GPIO_Write(GPIO_TypeDef *GPIOx, uint16_t value) {
+	GPIOx->ODR = value;
+	if (GPIOx == LED_GPIO)
+		ledsChanged();
+}
+
+/* USART ------------------------------------------------------------------- */
+
+/**
+ * @brief  Get the time taken to send one byte (8N1).
+ * @param  none
+ * @retval the byte time
+ */
+static SimTime byteTime() {
+	uint32_t baud = SimBaudOverride ? SimBaudOverride : SimUSART2.BaudRate;
+
+	return 10 * SIM_PS_PER_SECOND / (baud ? baud : 9600);
+}
+
+/**
+ * @brief  Get the time at which the transmit data register is (or was) free:
+ *         when the byte now on the line started, as it moved to the shift
+ *         register.
+ * @param  none
+ * @retval the time
+ */
+static SimTime dataRegisterFree() {
+	SimTime bt = byteTime();
+
+	return lineFreeAt > SimNow + bt ? lineFreeAt - bt : SimNow;
+}
+
+/**
+ * @brief  Put a byte on the line after the ones already on it.
+ * @param  b: the byte
+ * @retval the time the byte starts
+ */
+static SimTime transmit(uint8_t b) {
+	SimTime start = lineFreeAt > SimNow ? lineFreeAt : SimNow;
+	SimTime bt = byteTime();
+
+	lineFreeAt = start + bt;
+	if (sampling) {
+		SimStat.bytesSent++;
+		SimStat.lineBusy += bt;
+	}
+
+	SimSent(b, lineFreeAt);
+	outBuf[outLen++] = b;
+	if (outLen == sizeof(outBuf)) {
+		SimOutput(outBuf, outLen);
+		outLen = 0;
+	}
+	return start;
+}
+
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *init) {
+	USARTx->BaudRate = init->USART_BaudRate;
+}
+
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState state) {
+	if (state != DISABLE) {
+		USARTx->CR1 |= USART_CR1_UE;
+		nextRx = SimNow;
+	} else {
+		USARTx->CR1 &= ~USART_CR1_UE;
+		nextRx = NEVER;
+	}
+}
+
+void USART_ITConfig(USART_TypeDef *USARTx, uint16_t it, FunctionalState state) {
+	if (state != DISABLE)
+		USARTx->CR1 |= USART_CR1_RXNEIE;
+	else
+		USARTx->CR1 &= ~USART_CR1_RXNEIE;
+}
+
+void USART_DMACmd(USART_TypeDef *USARTx, uint16_t req, FunctionalState state) {
+	if (state != DISABLE)
+		USARTx->CR3 |= req;
+	else
+		USARTx->CR3 &= ~req;
+}
+
+void USART_SendData(USART_TypeDef *USARTx, uint16_t data) {
+	SimTime start = transmit(data);
+
+	// The data register stays full until the byte moves to the shift register.
+	if (start > SimNow) {
+		USARTx->SR &= ~USART_SR_TXE;
+		txeAt = start;
+	}
+}
+
+uint16_t USART_ReceiveData(USART_TypeDef *USARTx) {
+	USARTx->SR &= ~USART_SR_RXNE;
+	return USARTx->DR & 0xff;
+}
+
+ITStatus USART_GetITStatus(USART_TypeDef *USARTx, uint16_t it) {
+	return ((USARTx->SR & it) && (USARTx->CR1 & USART_CR1_RXNEIE)) ? SET : RESET;
+}
+
+void USART_ClearITPendingBit(USART_TypeDef *USARTx, uint16_t it) {
+	USARTx->SR &= ~it;
+}
+
+/* TIM --------------------------------------------------------------------- */
+
+/**
+ * @brief  Get a timer's update period. The timers run at twice their APB
+ *         clock, since the APB prescalers are not 1.
+ * @param  TIMx: the timer
+ * @retval the period
+ */
+static SimTime timerPeriod(TIM_TypeDef *TIMx) {
+	uint64_t clock = 2ULL * (TIMx->Apb == 1 ? SIM_PCLK1 : SIM_PCLK2);
+
+	return (SimTime) (TIMx->PSC + 1) * (TIMx->ARR + 1) * SIM_PS_PER_SECOND / clock;
+}
+
+/**
+ * @brief  Schedule a timer's next update after a change to its settings.
+ * @param  TIMx: the timer
+ * @retval none
+ */
+static void scheduleTimer(TIM_TypeDef *TIMx) {
+	SimTime next = (TIMx->CR1 & TIM_CR1_CEN) ? SimNow + timerPeriod(TIMx) : NEVER;
+
+	if (TIMx == TIM2)
+		nextTim2 = next;
+	else if (TIMx == TIM8)
+		nextTim8 = next;
+}
+
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *init) {
+	TIMx->PSC = init->TIM_Prescaler;
+	TIMx->ARR = init->TIM_Period;
+	scheduleTimer(TIMx);
+}
+
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState state) {
+	if (state != DISABLE)
+		TIMx->CR1 |= TIM_CR1_CEN;
+	else
+		TIMx->CR1 &= ~TIM_CR1_CEN;
+	scheduleTimer(TIMx);
+}
+
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t it, FunctionalState state) {
+	if (state != DISABLE)
+		TIMx->DIER |= it;
+	else
+		TIMx->DIER &= ~it;
+}
+
+void TIM_DMACmd(TIM_TypeDef *TIMx, uint16_t source, FunctionalState state) {
+	if (state != DISABLE)
+		TIMx->DIER |= source;
+	else
+		TIMx->DIER &= ~source;
+}
+
+ITStatus TIM_GetITStatus(TIM_TypeDef *TIMx, uint16_t it) {
+	return ((TIMx->SR & it) && (TIMx->DIER & it)) ? SET : RESET;
+}
+
+void TIM_ClearITPendingBit(TIM_TypeDef *TIMx, uint16_t it) {
+	TIMx->SR &= ~it;
+}
+
+/* DMA --------------------------------------------------------------------- */
+
+void DMA_DeInit(DMA_Stream_TypeDef *stream) {
+	memset((void *) stream, 0, sizeof(*stream));
+	if (stream == DMA1_Stream6)
+		nextTx = NEVER;
+}
+
+void DMA_Init(DMA_Stream_TypeDef *stream, DMA_InitTypeDef *init) {
+	stream->CR = (stream->CR & (DMA_SxCR_EN | DMA_SxCR_HTIE | DMA_SxCR_TCIE))
+			| init->DMA_DIR | init->DMA_Mode;
+	stream->NDTR = init->DMA_BufferSize;
+	stream->Size = init->DMA_BufferSize;
+	stream->PAR = init->DMA_PeripheralBaseAddr;
+	stream->M0AR = init->DMA_Memory0BaseAddr;
+}
+
+void DMA_Cmd(DMA_Stream_TypeDef *stream, FunctionalState state) {
+	if (state != DISABLE)
+		stream->CR |= DMA_SxCR_EN;
+	else
+		stream->CR &= ~DMA_SxCR_EN;
+
+	if (stream == DMA1_Stream6)
+		nextTx = (state != DISABLE && stream->NDTR) ? dataRegisterFree() : NEVER;
+}
+
+FunctionalState DMA_GetCmdStatus(DMA_Stream_TypeDef *stream) {
+	return (stream->CR & DMA_SxCR_EN) ? ENABLE : DISABLE;
+}
+
+void DMA_ITConfig(DMA_Stream_TypeDef *stream, uint32_t it, FunctionalState state) {
+	if (state != DISABLE)
+		stream->CR |= it;
+	else
+		stream->CR &= ~it;
+}
+
+ITStatus DMA_GetITStatus(DMA_Stream_TypeDef *stream, uint32_t it) {
+	return (stream->ISR & it) ? SET : RESET;
+}
+
+void DMA_ClearITPendingBit(DMA_Stream_TypeDef *stream, uint32_t it) {
+	stream->ISR &= ~it;
+}
+
+void DMA_ClearFlag(DMA_Stream_TypeDef *stream, uint32_t flags) {
+	stream->ISR &= ~flags;
+}
+
+uint16_t DMA_GetCurrDataCounter(DMA_Stream_TypeDef *stream) {
+	return stream->NDTR;
+}
+
+uint32_t DMA_GetCurrentMemoryTarget(DMA_Stream_TypeDef *stream) {
+	return (stream->CR & DMA_SxCR_CT) != 0;
+}
+
+void DMA_DoubleBufferModeConfig(DMA_Stream_TypeDef *stream, uint32_t memory1, uint32_t memory) {
+	stream->M1AR = memory1;
+	if (memory == DMA_Memory_0)
+		stream->CR &= ~DMA_SxCR_CT;
+	else
+		stream->CR |= DMA_SxCR_CT;
+}
+
+void DMA_DoubleBufferModeCmd(DMA_Stream_TypeDef *stream, FunctionalState state) {
+	if (state != DISABLE)
+		stream->CR |= DMA_SxCR_DBM;
+	else
+		stream->CR &= ~DMA_SxCR_DBM;
+}
+
+/* Events ------------------------------------------------------------------ */
+
+/**
+ * @brief  The transmit DMA moves the next byte of its block to the USART.
+ * @param  none
+ * @retval none
+ */
+static void txDmaEvent() {
+	DMA_Stream_TypeDef *s = DMA1_Stream6;
+	const uint8_t *src = (const uint8_t *) (uintptr_t) s->M0AR;
+
+	transmit(src[s->Size - s->NDTR]);
+
+	// The stream disables itself once the last byte has been handed over.
+	if (--s->NDTR == 0) {
+		s->CR &= ~DMA_SxCR_EN;
+		s->ISR |= DMA_FLAG_TC;
+		nextTx = NEVER;
+	} else
+		nextTx = dataRegisterFree();
+}
+
+/**
+ * @brief  The capture timer's update event makes the capture DMA copy the
+ *         input port to memory.
+ * @param  none
+ * @retval none
+ */
+static void captureDmaEvent() {
+	DMA_Stream_TypeDef *s = DMA2_Stream1;
+	uint8_t *dst;
+	uint8_t interrupt = 0;
+
+	if (!(TIM8->DIER & TIM_DMA_Update) || !(s->CR & DMA_SxCR_EN))
+		return;
+
+	latchInputs();
+	dst = (uint8_t *) (uintptr_t) ((s->CR & DMA_SxCR_CT) ? s->M1AR : s->M0AR);
+	dst[s->Size - s->NDTR] = *(const uint8_t *) (uintptr_t) s->PAR;
+
+	if (--s->NDTR == s->Size / 2) {
+		s->ISR |= DMA_FLAG_HT;
+		interrupt = (s->CR & DMA_SxCR_HTIE) != 0;
+	} else if (s->NDTR == 0) {
+		s->ISR |= DMA_FLAG_TC;
+		interrupt = (s->CR & DMA_SxCR_TCIE) != 0;
+		s->NDTR = s->Size;
+		if (s->CR & DMA_SxCR_DBM)
+			s->CR ^= DMA_SxCR_CT;
+		else if (!(s->CR & DMA_SxCR_CIRC))
+			s->CR &= ~DMA_SxCR_EN;
+	}
+
+	if (interrupt && irqEnabled[DMA2_Stream1_IRQn])
+		raise(IRQ_DMA2_STREAM1);
+}
+
+/**
+ * @brief  A byte of input (if there is any) arrives at the USART. Input is
+ *         held back until the firmware has enabled its receiver, as a host
+ *         would wait for the banner, and while the last byte is unread.
+ * @param  none
+ * @retval none
+ */
+static void rxEvent() {
+	uint8_t c;
+
+	if (!(SimUSART2.CR1 & USART_CR1_RXNEIE) || (SimUSART2.SR & USART_SR_RXNE) || !SimInput(&c)) {
+		nextRx = SimNow + RX_POLL;
+		return;
+	}
+
+	SimUSART2.DR = c;
+	SimUSART2.SR |= USART_SR_RXNE;
+	if ((SimUSART2.CR1 & USART_CR1_RXNEIE) && irqEnabled[USART2_IRQn])
+		raise(IRQ_USART2);
+	nextRx = SimNow + byteTime();
+}
+
+/**
+ * @brief  Run all the peripheral events due up to a given time, in order.
+ *         Interrupt handlers push the time the main loop gets to on by the
+ *         time they take.
+ * @param  until: the time to run the main loop to
+ * @retval none
+ */
+void SimAdvance(SimTime until) {
+	SimTime t;
+
+	horizon = until;
+	for (;;) {
+		t = nextSysTick;
+		if (nextTim2 < t)
+			t = nextTim2;
+		if (nextTim8 < t)
+			t = nextTim8;
+		if (nextTx < t)
+			t = nextTx;
+		if (nextRx < t)
+			t = nextRx;
+		if (txeAt < t)
+			t = txeAt;
+		if (pendingIrqs && cpuFreeAt < t)
+			t = cpuFreeAt;
+		if (t > horizon)
+			break;
+		if (t > until + STARVED) {
+			SimStat.starved = 1;
+			break;
+		}
+
+		if (t > SimNow)
+			SimNow = t;
+		if (pendingIrqs && t == cpuFreeAt)
+			runIsr();
+		else if (t == nextSysTick) {
+			nextSysTick += sysTickPeriod;
+			raise(IRQ_SYSTICK);
+		} else if (t == nextTim2) {
+			nextTim2 += timerPeriod(TIM2);
+			TIM2->SR |= TIM_IT_Update;
+			if ((TIM2->DIER & TIM_IT_Update) && irqEnabled[TIM2_IRQn])
+				raise(IRQ_TIM2);
+		} else if (t == nextTim8) {
+			nextTim8 += timerPeriod(TIM8);
+			captureDmaEvent();
+		} else if (t == nextTx)
+			txDmaEvent();
+		else if (t == nextRx)
+			rxEvent();
+		else {
+			txeAt = NEVER;
+			SimUSART2.SR |= USART_SR_TXE;
+		}
+
+		if (pendingIrqs && cpuFreeAt <= SimNow)
+			cpuFreeAt = SimNow;
+	}
+
+	SimNow = horizon;
+	if (outLen) {
+		SimOutput(outBuf, outLen);
+		outLen = 0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &hostRef);
+	simRef = SimNow;
+}
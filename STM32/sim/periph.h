@@ -0,0 +1,87 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PERIPH_H_
+#define PERIPH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Simulated time, in picoseconds since reset.
+typedef uint64_t SimTime;
+
+#define SIM_PS_PER_SECOND 1000000000000ULL
+
+// The board's clocks (168 MHz core, APB1 at 42 MHz, APB2 at 84 MHz).
+#define SIM_SYSCLK 168000000UL
+#define SIM_PCLK1  42000000UL
+#define SIM_PCLK2  84000000UL
+
+typedef struct {
+	SimTime captureStart;		// When the blue (sampling) LED came on
+	SimTime captureEnd;		// When it went off
+	SimTime lineBusy;		// Time the USART spent sending during the capture
+	uint64_t bytesSent;		// Bytes sent during the capture
+	uint64_t isrCalls;		// Interrupt handlers run during the capture
+	uint32_t missed;		// Interrupts lost during the capture (raised again while pending)
+	uint16_t queueFree;		// Queue free space before the capture
+	uint16_t queueMinFree;		// The least free space seen during the capture
+	uint8_t captures;		// Number of captures completed
+	uint8_t starved;		// Set if interrupts left no time for the main loop
+} SimStats;
+
+// The result of a benchmark trial (see SimTrial()).
+typedef struct {
+	uint8_t done;			// Set if the run finished
+	uint8_t overflow;		// Set if the queue overflowed
+	uint32_t samples;		// Samples taken
+	SimStats stats;
+} SimResult;
+
+extern SimTime SimNow;
+extern SimStats SimStat;
+
+// Set by the simulator.
+extern uint32_t SimBaudOverride;	// Replaces the firmware's baud rate if non-zero
+extern uint32_t SimIsrCycles;		// Interrupt entry and exit cost, in core cycles
+extern double SimSpeed;			// How many times faster the host is than the target
+
+extern void SimReset(void);
+extern void SimAdvance(SimTime until);
+extern uint8_t SimSampling(void);
+extern uint8_t SimLineIdle(void);
+
+// Provided by sim.c.
+extern void SimOutput(const uint8_t *data, size_t len);
+extern int SimInput(uint8_t *c);
+extern void SimSent(uint8_t b, SimTime end);
+extern SimResult SimTrial(char mode, int channels, char compression, char engine, uint32_t rate, uint32_t ms);
+
+// Provided by check.c.
+extern int SimCheck(void);
+
+// Provided by profile.c.
+extern void SimProfile(const char *units, const char *modes, const char *channels, const char *engines);
+extern int SimWriteVectors(const char *dir);
+
+// Provided by waveform.c.
+extern int SimWaveformLoad(const char *name);
+extern const char *SimWaveformName(void);
+extern uint8_t SimWaveform(SimTime t);
+
+#endif /* PERIPH_H_ */
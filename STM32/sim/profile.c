@@ -0,0 +1,777 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Timings of the firmware routines on their own (lasim -p, or make profile).
+// The routines are called directly, with no timer or USART in the way, and
+// each timing gives the host time, and the target time going by -s. Each
+// timing is the best of a few runs, to keep the host's own noise out. The
+// tables to print are picked with -u (default: all of them).
+//
+//   capture  Each capture routine (for every mode/channels/engine combination
+//            given with -m, -n and -d) is fed a second of samples taken from
+//            the waveform at 1 MHz, and the time it took per sample is
+//            printed, along with the sampling rate in MS/s the routine alone
+//            would keep up with on the target. The queue is emptied as
+//            needed; the time that takes is included, but it is a small part
+//            of the total.
+//   queue    Bytes are passed through the sample queue, a sample's worth at a
+//            time and a block at a time, as the capture routines and the main
+//            loop do, and through the queue as it was before it was made a
+//            lock-free ring (a byte at a time both ways, with a count shared
+//            by both sides). The last line has the producer and the consumer
+//            on threads of their own, as the capture interrupt and the main
+//            loop are on the target, but running at the same time.
+//   records  Four seconds of each waveform, sampled at 1 MHz on 8 channels,
+//            is captured in transition-only mode, and the bytes queued per
+//            transition are printed, next to what the records took before
+//            they were made variable-length (4 bytes per transition, and a
+//            4-byte rollover record every 65536 samples). The waveform given
+//            with -w comes first, so a capture saved as a waveform file (see
+//            waveform.c) can be compared with the built-in ones.
+//   compress The byte stream of a second of each waveform, sampled at 1 MHz
+//            in continuous mode on 8 and on 4 channels, is put through the
+//            LZW compressor a byte at a time and the block compressor a span
+//            at a time, as the sample loop does, and the time it took per
+//            input byte and the compression ratio (input/output) are printed.
+//   trigger  The trigger is scanned over a million samples a sample at a time
+//            (as the timer interrupt does) and in blocks (as the DMA capture
+//            engine does), for each trigger mode, on input that holds still
+//            and on input that changes every sample. The trigger is set so it
+//            never fires (so every sample is looked at), and the time it took
+//            per sample is printed. It should not depend on the input; a
+//            sample at a time, the cost of the call itself is on top.
+//
+// With -V, the same compressors write test vectors for the host's
+// decompressors (see SimWriteVectors()).
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "main.h"
+#include "capture.h"
+#include "trigger.h"
+#include "stats.h"
+#include "compress.h"
+#include "blockcompress.h"
+#include "periph.h"
+
+#define PROFILE_RUNS 5
+
+/**
+ * @brief  Get the CPU time the calling thread has used.
+ * @param  none
+ * @retval the CPU time in nanoseconds
+ */
+static uint64_t cpuNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief  Get the host time.
+ * @param  none
+ * @retval the host time in nanoseconds
+ */
+static uint64_t hostNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief  Convert host nanoseconds to target cycles, going by -s.
+ * @param  ns: host nanoseconds
+ * @retval target cycles
+ */
+static double targetCycles(double ns) {
+	return ns * SimSpeed * SIM_SYSCLK / 1e9;
+}
+
+/**
+ * @brief  Sample the input waveform at 1 MHz.
+ * @param  samples: the buffer for the samples
+ * @param  count: the number of samples
+ * @retval none
+ */
+static void takeSamples(uint8_t *samples, uint32_t count) {
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		samples[i] = SimWaveform((SimTime) i * (SIM_PS_PER_SECOND / 1000000));
+}
+
+/**
+ * @brief  Time one capture routine: feed it a second's worth of samples
+ *         taken at 1 MHz, as the timer interrupt or the DMA capture engine
+ *         would.
+ * @param  mode: sampling mode (C, T or R)
+ * @param  channels: number of channels
+ * @param  engine: capture engine (I or D)
+ * @retval host nanoseconds per sample
+ */
+static double profileCapture(char mode, int channels, char engine) {
+#define PROFILE_SAMPLES 1000000
+#define PROFILE_BLOCK 512
+	static uint8_t samples[PROFILE_SAMPLES];
+	uint64_t start, used = 0;
+	uint8_t *span;
+	uint32_t i, j;
+	uint16_t n;
+
+	takeSamples(samples, PROFILE_SAMPLES);
+
+	SamplingMode = (mode == 'T') ? SAMPLING_MODE_TRANSITIONONLY :
+			(mode == 'R') ? SAMPLING_MODE_RUNLENGTH : SAMPLING_MODE_CONTINUOUS;
+	SamplingChannels = channels;
+	SamplingPins = (1 << channels) - 1;
+	SamplingDma = (engine == 'D');
+	TriggerMode = TRIGGER_NONE;
+	BurstDepth = 0;
+	memset(&Stats, 0, sizeof(Stats));
+	ClearSampleQueue();
+	TriggerInit();
+	Irqs = 0;
+	CaptureInit();
+
+	for (i = 0; i + PROFILE_BLOCK <= PROFILE_SAMPLES; i += PROFILE_BLOCK) {
+		start = cpuNs();
+		if (engine == 'D')
+			CaptureBlock(samples + i, PROFILE_BLOCK);
+		else
+			for (j = i; j < i + PROFILE_BLOCK; j++) {
+				Irqs++;
+				EnqueueSample(samples[j]);
+			}
+		used += cpuNs() - start;
+
+		while ((n = SampleQueuePeek(&span, 0xffff)) > 0)
+			SampleQueueRelease(n);
+	}
+	EnqueueFinalSample();
+
+	if (Stats.dropped)
+		fprintf(stderr, "lasim: %c/%d/%c dropped %u bytes\n", mode, channels, engine, (unsigned) Stats.dropped);
+	return (double) used / (PROFILE_SAMPLES / PROFILE_BLOCK * PROFILE_BLOCK);
+}
+
+/**
+ * @brief  Time every capture routine.
+ * @param  modes: the sampling modes to try
+ * @param  channels: the channel counts to try
+ * @param  engines: the capture engines to try
+ * @retval none
+ */
+static void profileCaptures(const char *modes, const char *channels, const char *engines) {
+	const char *m, *n, *d;
+	double ns, best;
+	int k;
+
+	printf("mode chan engine  ns/sample  cycles/sample   MS/s\n");
+	for (m = modes; *m; m++)
+		for (n = channels; *n; n++)
+			for (d = engines; *d; d++) {
+				best = profileCapture(*m, *n - '0', *d);
+				for (k = 1; k < PROFILE_RUNS; k++) {
+					ns = profileCapture(*m, *n - '0', *d);
+					if (ns < best)
+						best = ns;
+				}
+				printf("%c    %c    %-6s %10.2f %14.1f %6.2f\n", *m, *n, *d == 'D' ? "dma" : "irq",
+						best, targetCycles(best), 1e3 / (best * SimSpeed));
+				fflush(stdout);
+			}
+}
+
+// The sample queue as it was before it was made a lock-free ring: a byte at
+// a time both ways, with the count of queued bytes updated by both sides.
+#define OLD_QSIZE 4096
+static volatile uint8_t oldQueue[OLD_QSIZE];
+static volatile uint32_t oldHead, oldTail, oldCount;
+
+/**
+ * @brief  Add a byte to the old queue.
+ * @param  byte: the byte to add to the queue
+ * @retval 0 if successful, -1 if the queue is full
+ */
+static int16_t oldEnqueueByte(uint8_t byte) {
+	if (oldCount >= OLD_QSIZE) {
+		Overflow = 1;
+		return -1;
+	}
+
+	oldQueue[oldTail++] = byte;
+	if (oldTail == OLD_QSIZE)
+		oldTail = 0;
+	oldCount++;
+	return 0;
+}
+
+/**
+ * @brief  Remove a byte from the old queue.
+ * @param  none
+ * @retval the byte, or zero if the queue was empty
+ */
+static uint8_t oldDequeueSample() {
+	uint8_t sample;
+
+	if (oldCount == 0)
+		return 0;
+
+	sample = oldQueue[oldHead++];
+	if (oldHead == OLD_QSIZE)
+		oldHead = 0;
+	oldCount--;
+	return sample;
+}
+
+#define QUEUE_BYTES (64 * 1024 * 1024)
+#define QUEUE_BATCH 512
+
+// What one pass of the queue table measures.
+enum { QUEUE_OLD, QUEUE_BYTE, QUEUE_WORD, QUEUE_THREADS };
+
+/**
+ * @brief  Consumer thread of the two-thread pass: take blocks off the queue
+ *         until the producer is done and the queue is empty.
+ * @param  arg: points at the producer's done flag
+ * @retval none
+ */
+static void *queueConsumer(void *arg) {
+	volatile uint8_t *done = arg;
+	uint8_t *span;
+	uint16_t n;
+
+	for (;;) {
+		if ((n = SampleQueuePeek(&span, 0xffff)) > 0)
+			SampleQueueRelease(n);
+		else if (*done && SampleQueueIsEmpty())
+			break;
+		else
+			sched_yield();
+	}
+	return NULL;
+}
+
+/**
+ * @brief  Pass QUEUE_BYTES through a queue.
+ * @param  kind: the queue and the calls to use (QUEUE_...)
+ * @retval host nanoseconds per byte
+ */
+static double profileQueue(int kind) {
+	static volatile uint8_t sink;
+	volatile uint8_t done = 0;
+	pthread_t consumer;
+	uint64_t start, used;
+	uint32_t i, j;
+	uint8_t *span;
+	uint16_t n;
+
+	ClearSampleQueue();
+	oldHead = oldTail = oldCount = 0;
+
+	if (kind == QUEUE_THREADS) {
+		pthread_create(&consumer, NULL, queueConsumer, (void *) &done);
+		start = hostNs();
+		for (i = 0; i < QUEUE_BYTES; i += 4)
+			while (EnqueueWord(i) < 0)
+				sched_yield();
+		done = 1;
+		pthread_join(consumer, NULL);
+		return (double) (hostNs() - start) / QUEUE_BYTES;
+	}
+
+	// A batch at a time in, then out, as the interrupt and the main loop take
+	// turns on the target.
+	start = cpuNs();
+	for (i = 0; i < QUEUE_BYTES; i += QUEUE_BATCH) {
+		switch (kind) {
+		case QUEUE_OLD:
+			for (j = 0; j < QUEUE_BATCH; j++)
+				oldEnqueueByte(j);
+			while (oldCount != 0)
+				sink += oldDequeueSample();
+			break;
+		case QUEUE_BYTE:
+			for (j = 0; j < QUEUE_BATCH; j++)
+				EnqueueByte(j);
+			while (!SampleQueueIsEmpty())
+				sink += DequeueSample();
+			break;
+		default:
+			for (j = 0; j < QUEUE_BATCH; j += 4)
+				EnqueueWord(j);
+			while ((n = SampleQueuePeek(&span, 0xffff)) > 0)
+				SampleQueueRelease(n);
+			break;
+		}
+	}
+	used = cpuNs() - start;
+	return (double) used / QUEUE_BYTES;
+}
+
+/**
+ * @brief  Time the sample queue, old and new.
+ * @param  none
+ * @retval none
+ */
+static void profileQueues() {
+	static const char *names[] = {
+		"old, a byte at a time",
+		"a byte at a time",
+		"words in, spans out",
+		"words in, spans out, 2 threads",
+	};
+	double ns, best;
+	int kind, k;
+
+	printf("queue                            ns/byte  host MB/s  cycles/byte\n");
+	for (kind = QUEUE_OLD; kind <= QUEUE_THREADS; kind++) {
+		best = profileQueue(kind);
+		for (k = 1; k < PROFILE_RUNS; k++) {
+			ns = profileQueue(kind);
+			if (ns < best)
+				best = ns;
+		}
+
+		// Two threads at once have no equivalent on the target.
+		if (kind == QUEUE_THREADS)
+			printf("%-30s %9.3f %10.1f %12s\n", names[kind], best, 1e3 / best, "-");
+		else
+			printf("%-30s %9.3f %10.1f %12.2f\n", names[kind], best, 1e3 / best, targetCycles(best));
+		fflush(stdout);
+	}
+}
+
+/**
+ * @brief  Compare the transition-only records, old and new, for each of the
+ *         waveforms.
+ * @param  none
+ * @retval none
+ */
+static void profileRecords() {
+#define RECORD_SAMPLES 4000000
+	static uint8_t samples[RECORD_SAMPLES];
+	char selected[256];
+	const char *names[] = { selected, "square", "bus", "noise" };
+	uint64_t bytes, transitions, old;
+	uint32_t i;
+	uint8_t *span, prev;
+	uint16_t n;
+	unsigned w;
+
+	snprintf(selected, sizeof(selected), "%s", SimWaveformName());
+
+	printf("waveform     transitions  bytes/transition    old  saved\n");
+	for (w = 0; w < sizeof(names) / sizeof(names[0]); w++) {
+		if (w > 0 && strcmp(names[w], selected) == 0)
+			continue;
+		SimWaveformLoad(names[w]);
+		takeSamples(samples, RECORD_SAMPLES);
+
+		SamplingMode = SAMPLING_MODE_TRANSITIONONLY;
+		SamplingChannels = 8;
+		SamplingPins = 0xff;
+		TriggerMode = TRIGGER_NONE;
+		BurstDepth = 0;
+		memset(&Stats, 0, sizeof(Stats));
+		ClearSampleQueue();
+		TriggerInit();
+		Irqs = 0;
+		CaptureInit();
+
+		bytes = 0;
+		for (i = 0; i < RECORD_SAMPLES; i += PROFILE_BLOCK) {
+			CaptureBlock(samples + i, PROFILE_BLOCK);
+			while ((n = SampleQueuePeek(&span, 0xffff)) > 0) {
+				bytes += n;
+				SampleQueueRelease(n);
+			}
+		}
+		EnqueueFinalSample();
+		while ((n = SampleQueuePeek(&span, 0xffff)) > 0) {
+			bytes += n;
+			SampleQueueRelease(n);
+		}
+
+		// The host starts from an all-low sample. The old records also had
+		// one for the first sample and one for the last.
+		transitions = 0;
+		prev = 0;
+		for (i = 0; i < RECORD_SAMPLES; i++) {
+			transitions += samples[i] != prev;
+			prev = samples[i];
+		}
+		old = 4 * (transitions + 2) + 4 * (RECORD_SAMPLES / 65536);
+
+		printf("%-12.12s %11llu %17.2f %6.2f %5.0f%%\n", names[w], (unsigned long long) transitions,
+				transitions ? (double) bytes / transitions : 0.0, transitions ? (double) old / transitions : 0.0,
+				100.0 - 100.0 * bytes / old);
+		fflush(stdout);
+	}
+
+	SimWaveformLoad(selected);
+}
+
+/**
+ * @brief  Move what has been queued to the end of a stream.
+ * @param  stream: the stream
+ * @param  len: the length of the stream so far
+ * @param  max: the size of the buffer
+ * @retval the new length of the stream
+ */
+static uint32_t drainStream(uint8_t *stream, uint32_t len, uint32_t max) {
+	uint8_t *span;
+	uint16_t n;
+
+	while ((n = SampleQueuePeek(&span, 0xffff)) > 0) {
+		if (n > max - len)
+			n = max - len;
+		memcpy(stream + len, span, n);
+		len += n;
+		SampleQueueRelease(n);
+	}
+	return len;
+}
+
+/**
+ * @brief  Capture samples and collect the byte stream the capture routines
+ *         queue, as it would be handed to the compressors.
+ * @param  mode: sampling mode (C, T or R)
+ * @param  channels: number of channels
+ * @param  samples: the raw samples
+ * @param  count: the number of samples
+ * @param  stream: the buffer for the stream
+ * @param  max: the size of the buffer
+ * @retval the length of the stream
+ */
+static uint32_t captureStream(char mode, int channels, const uint8_t *samples, uint32_t count, uint8_t *stream,
+		uint32_t max) {
+	uint32_t i, len = 0;
+	uint16_t block;
+
+	SamplingMode = (mode == 'T') ? SAMPLING_MODE_TRANSITIONONLY :
+			(mode == 'R') ? SAMPLING_MODE_RUNLENGTH : SAMPLING_MODE_CONTINUOUS;
+	SamplingChannels = channels;
+	SamplingPins = (1 << channels) - 1;
+	TriggerMode = TRIGGER_NONE;
+	BurstDepth = 0;
+	memset(&Stats, 0, sizeof(Stats));
+	ClearSampleQueue();
+	TriggerInit();
+	Irqs = 0;
+	CaptureInit();
+
+	for (i = 0; i < count; i += block) {
+		block = (count - i < PROFILE_BLOCK) ? count - i : PROFILE_BLOCK;
+		CaptureBlock(samples + i, block);
+		len = drainStream(stream, len, max);
+	}
+	EnqueueFinalSample();
+	return drainStream(stream, len, max);
+}
+
+// The compressor output: counted, and kept if there is a buffer for it.
+static uint8_t *compressed;
+static uint32_t compressedLen, compressedMax;
+
+/**
+ * @brief  Take a byte of compressor output.
+ * @param  b: the byte
+ * @retval none
+ */
+static void takeCompressed(uint8_t b) {
+	if (compressedLen < compressedMax)
+		compressed[compressedLen] = b;
+	compressedLen++;
+}
+
+/**
+ * @brief  Compress a stream with the LZW or the block compressor.
+ * @param  block: non-zero for the block compressor
+ * @param  stream: the stream
+ * @param  len: the length of the stream
+ * @param  used: receives the host nanoseconds it took
+ * @retval the length of the compressed stream
+ */
+static uint32_t compressStream(uint8_t block, const uint8_t *stream, uint32_t len, uint64_t *used) {
+	uint64_t start;
+	uint32_t i, n;
+
+	compressedLen = 0;
+	start = cpuNs();
+	if (block) {
+		BlockCompressInit(takeCompressed);
+		for (i = 0; i < len; i += n) {
+			n = (len - i < PROFILE_BLOCK) ? len - i : PROFILE_BLOCK;
+			BlockCompress(stream + i, n);
+		}
+		BlockCompressFlush();
+		BlockCompressDenit();
+	} else {
+		CompressInit(takeCompressed);
+		for (i = 0; i < len; i++)
+			CompressByte(stream[i]);
+		CompressFlush();
+		CompressDenit();
+	}
+	*used = cpuNs() - start;
+	return compressedLen;
+}
+
+/**
+ * @brief  Time the compressors, and compare their ratios.
+ * @param  none
+ * @retval none
+ */
+static void profileCompressors() {
+#define COMPRESS_SAMPLES 1000000
+	static uint8_t samples[COMPRESS_SAMPLES], stream[COMPRESS_SAMPLES];
+	char selected[256];
+	const char *names[] = { selected, "square", "bus", "noise" };
+	static const int channels[] = { 8, 4 };
+	uint64_t used, best[2];
+	uint32_t len, out[2];
+	unsigned w, c, k, z;
+
+	snprintf(selected, sizeof(selected), "%s", SimWaveformName());
+	compressedMax = 0;
+
+	printf("waveform     chan     bytes    lzw: cycles/byte  ratio  block: cycles/byte  ratio\n");
+	for (w = 0; w < sizeof(names) / sizeof(names[0]); w++) {
+		if (w > 0 && strcmp(names[w], selected) == 0)
+			continue;
+		SimWaveformLoad(names[w]);
+		takeSamples(samples, COMPRESS_SAMPLES);
+
+		for (c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+			len = captureStream('C', channels[c], samples, COMPRESS_SAMPLES, stream, sizeof(stream));
+			for (z = 0; z < 2; z++) {
+				out[z] = compressStream(z, stream, len, &best[z]);
+				for (k = 1; k < PROFILE_RUNS; k++) {
+					compressStream(z, stream, len, &used);
+					if (used < best[z])
+						best[z] = used;
+				}
+			}
+
+			printf("%-12.12s %4d %9u %18.1f %6.2f %19.1f %6.2f\n", names[w], channels[c], (unsigned) len,
+					targetCycles((double) best[0] / len), (double) len / out[0],
+					targetCycles((double) best[1] / len), (double) len / out[1]);
+			fflush(stdout);
+		}
+	}
+
+	SimWaveformLoad(selected);
+}
+
+/**
+ * @brief  Write test vectors for the host's decompressors: for each waveform,
+ *         the byte stream of a capture (<name>.raw), and what the LZW
+ *         (<name>.lzw) and the block compressor (<name>.blk) make of it. The
+ *         host decodes the compressed files and compares them with the raw
+ *         ones.
+ * @param  dir: the directory to write them to
+ * @retval 0 if successful, -1 if a file could not be written
+ */
+int SimWriteVectors(const char *dir) {
+	static const struct {
+		const char *waveform;
+		char mode;
+		int channels;
+		uint32_t samples;
+	} vectors[] = {
+		{ "square", 'C', 8, 16384 },
+		{ "square", 'C', 1, 65536 },
+		{ "bus", 'C', 4, 65536 },
+		{ "bus", 'T', 8, 1000000 },
+		{ "noise", 'C', 8, 16384 },
+	};
+#define VECTOR_SAMPLES 1000000
+#define VECTOR_MAX 65536
+	static uint8_t samples[VECTOR_SAMPLES], stream[VECTOR_MAX], output[2 * VECTOR_MAX];
+	static const char *extensions[] = { "lzw", "blk" };
+	char selected[256], name[512];
+	const uint8_t *data;
+	uint32_t len, size, i;
+	uint64_t used;
+	unsigned v;
+	FILE *f;
+
+	snprintf(selected, sizeof(selected), "%s", SimWaveformName());
+	compressed = output;
+	compressedMax = sizeof(output);
+
+	for (v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+		SimWaveformLoad(vectors[v].waveform);
+		takeSamples(samples, vectors[v].samples);
+		len = captureStream(vectors[v].mode, vectors[v].channels, samples, vectors[v].samples, stream,
+				sizeof(stream));
+
+		for (i = 0; i < 3; i++) {
+			data = stream;
+			size = len;
+			if (i) {
+				data = output;
+				size = compressStream(i - 1, stream, len, &used);
+				if (size > compressedMax)
+					size = compressedMax;
+			}
+
+			snprintf(name, sizeof(name), "%s/%s-%c%d.%s", dir, vectors[v].waveform, vectors[v].mode,
+					vectors[v].channels, i ? extensions[i - 1] : "raw");
+			if ((f = fopen(name, "wb")) == NULL || fwrite(data, 1, size, f) != size || fclose(f) != 0) {
+				perror(name);
+				return -1;
+			}
+			printf("%s: %u bytes\n", name, (unsigned) size);
+		}
+	}
+
+	compressedMax = 0;
+	SimWaveformLoad(selected);
+	return 0;
+}
+
+/**
+ * @brief  Time the trigger scan over samples it never fires on.
+ * @param  samples: the samples
+ * @param  block: the number of samples scanned per call
+ * @retval host nanoseconds per sample (the best of PROFILE_RUNS)
+ */
+static double profileTrigger(const uint8_t *samples, uint32_t block) {
+	uint64_t start;
+	double ns, best = 0;
+	uint32_t i, fired;
+	int k;
+
+	for (k = 0; k < PROFILE_RUNS; k++) {
+		TriggerInit();
+		fired = 0;
+		start = cpuNs();
+		for (i = 0; i < PROFILE_SAMPLES; i += block)
+			fired |= TriggerScan(samples + i, block) != block;
+		ns = (double) (cpuNs() - start) / PROFILE_SAMPLES;
+		if (fired)
+			fprintf(stderr, "lasim: trigger mode %d fired\n", TriggerMode);
+		if (k == 0 || ns < best)
+			best = ns;
+	}
+	return best;
+}
+
+/**
+ * @brief  Time the trigger scan for each mode, input and block size.
+ * @param  none
+ * @retval none
+ */
+static void profileTriggers() {
+	static const char *names[] = { "none", "pattern", "edge", "pattern-edge" };
+	static const uint32_t blocks[] = { 1, 16, PROFILE_BLOCK };
+	static uint8_t samples[PROFILE_SAMPLES];
+	uint32_t i, b, seed = 2463534242u;
+	int mode, busy;
+	double ns;
+
+	printf("trigger       input  ns/sample (cycles/sample) by block size\n");
+	printf("%-20s", "");
+	for (b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++)
+		printf("  %14u", (unsigned) blocks[b]);
+	printf("\n");
+
+	// Channel 7 never changes, and is what the trigger waits for: a 1 for
+	// the pattern, an edge for the edges. Pattern-then-edge is armed by a 0
+	// on channel 0, which is seen early on, so it goes on to look for the
+	// edge at every sample.
+	TriggerMask = 0x80;
+	TriggerValue = 0x80;
+	TriggerRising = 0x80;
+	TriggerFalling = 0x80;
+	TriggerHoldoff = 0;
+
+	for (mode = TRIGGER_PATTERN; mode <= TRIGGER_PATTERN_EDGE; mode++)
+		for (busy = 0; busy < 2; busy++) {
+			for (i = 0; i < PROFILE_SAMPLES; i++) {
+				seed ^= seed << 13;
+				seed ^= seed >> 17;
+				seed ^= seed << 5;
+				samples[i] = busy ? (seed & 0x7f) : 0;
+			}
+
+			TriggerMode = mode;
+			if (mode == TRIGGER_PATTERN_EDGE) {
+				TriggerMask = 0x01;
+				TriggerValue = 0x00;
+			}
+			printf("%-13s %-6s", names[mode], busy ? "busy" : "idle");
+			for (b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+				ns = profileTrigger(samples, blocks[b]);
+				printf("  %5.2f (%6.1f)", ns, targetCycles(ns));
+			}
+			printf("\n");
+			fflush(stdout);
+		}
+	TriggerMode = TRIGGER_NONE;
+}
+
+/**
+ * @brief  Print the timing tables.
+ * @param  units: the tables to print, separated by commas, or "all"
+ * @param  modes: the sampling modes to try
+ * @param  channels: the channel counts to try
+ * @param  engines: the capture engines to try
+ * @retval none
+ */
+void SimProfile(const char *units, const char *modes, const char *channels, const char *engines) {
+	uint8_t all = (strcmp(units, "all") == 0), first = 1;
+
+	if (all || strstr(units, "capture")) {
+		profileCaptures(modes, channels, engines);
+		first = 0;
+	}
+	if (all || strstr(units, "queue")) {
+		if (!first)
+			printf("\n");
+		profileQueues();
+		first = 0;
+	}
+	if (all || strstr(units, "records")) {
+		if (!first)
+			printf("\n");
+		profileRecords();
+		first = 0;
+	}
+	if (all || strstr(units, "compress")) {
+		if (!first)
+			printf("\n");
+		profileCompressors();
+		first = 0;
+	}
+	if (all || strstr(units, "trigger")) {
+		if (!first)
+			printf("\n");
+		profileTriggers();
+		first = 0;
+	}
+}
@@ -0,0 +1,675 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Host simulation of the firmware.
+//
+// The firmware is compiled unchanged for the host against stand-in peripheral
+// headers (include/) and runs on the main thread. A periodic host timer
+// signal plays the part of the hardware: on each tick, simulated time moves
+// on by the host CPU time the main loop has used since the last tick times
+// the speed-up given with -s, and the peripheral events that are due are
+// run, calling the firmware's interrupt handlers (which take simulated time
+// of their own, see periph.c). The result is only as good as the speed-up
+// figure, but it shows where the firmware stops keeping up, and why.
+//
+//   lasim [-c commands] [-i input] [-o output] [-w waveform] [-B baud]
+//         [-s speed-up] [-e cycles] [-q usec] [-t ms] [-k]
+//   lasim -b [-m modes] [-n channels] [-z compression] [-d engines] [-T ms]
+//         [-w waveform] [-B baud] [-s speed-up] [-e cycles] [-q usec]
+//   lasim -p [-u tables] [-m modes] [-n channels] [-d engines] [-w waveform]
+//         [-s speed-up]
+//   lasim -x
+//   lasim -V directory
+//
+//   -c  Commands to send, separated by ';' (e.g. "CHAN=8;RATE=100000;START").
+//       An entry of +<ms> waits for the firmware to take the commands before
+//       it, then holds the rest back for that much simulated time (e.g.
+//       "TIME=0;START;+500;STOP" samples for about half a second).
+//   -i  Read commands from a file, FIFO or terminal.
+//   -o  Write the USART output (the byte stream the host reads) to a file,
+//       FIFO or terminal. It is discarded otherwise.
+//   -w  Input waveform: square (default), noise, bus, or a file (see
+//       waveform.c).
+//   -B  USART baud rate (default: the firmware's own).
+//   -s  How many times faster the host runs the firmware than the 168 MHz
+//       target (default 20). Calibrate this against a board if you have one.
+//   -e  Interrupt entry and exit cost in core cycles (default 24).
+//   -q  Host timer tick in microseconds (default 10).
+//   -t  Give up after this much simulated time in ms (default 60000).
+//   -k  Keep running once the commands have been sent and the captures are
+//       done (e.g. when the output goes to a terminal the host is using).
+//
+// A line is printed to stderr for every capture: mode, channels, pins, compression,
+// capture engine, sampling rate, samples taken, capture time, bytes sent,
+// line utilisation, queue high-water mark, interrupts lost (raised again
+// before the last one was handled, so samples were missed), whether the
+// queue overflowed, and the gaps left in the timeline with the samples lost in
+// them. Each command sent while sampling that is answered with a reply frame
+// (see ProcessCommands()) gets a line too, with the time from the end of the
+// command to the end of the reply.
+//
+// With -b, the benchmark suite searches for the highest sampling rate that
+// each mode/channels/compression/engine combination (C/T/R, 1/2/4/8, N/Y/B,
+// I(nterrupt)/D(MA)) sustains without an overflow or a lost interrupt, running each trial in a
+// fresh process.
+//
+// With -p, the firmware routines are timed on their own (see profile.c).
+//
+// With -x, the self-checks in check.c are run. With -V, test vectors for the
+// host's decompressors are written to the directory given (see profile.c).
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "main.h"
+#include "capture.h"
+#include "trigger.h"
+#include "stats.h"
+#include "frame.h"
+#include "periph.h"
+
+extern int FirmwareMain(void);
+
+// Simulated time runs faster while the firmware isn't sampling, so that idle
+// time (e.g. a +<ms> hold before START) doesn't dominate a run.
+#define IDLE_SPEEDUP 100
+
+static uint32_t tickUs = 10;
+static SimTime timeLimit = 60000 * 1000000000ULL;
+static uint8_t keepRunning;
+
+static char *commandBuf;
+static size_t commandLen, commandPos;
+static SimTime commandHold;
+static int inFd = -1, outFd = -1;
+static uint8_t inputDone;
+static int resultFd = -1;
+
+static uint64_t lastExit;
+static timer_t timer;
+static uint8_t reported;
+
+// Commands sent while sampling, waiting for their replies.
+#define PENDING_MAX 8
+static struct {
+	SimTime sent;
+	char line[32];
+} pending[PENDING_MAX];
+static int pendingCount;
+static char inLine[32];
+static size_t inLineLen;
+
+// The frame being sent, as far as it is needed to pick out reply frames.
+static uint8_t outFrame[FRAME_OVERHEAD + 64];
+static size_t outFrameLen, outFrameSize;
+
+/**
+ * @brief  Get the host time.
+ * @param  none
+ * @retval the host time in nanoseconds
+ */
+static uint64_t hostNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief  Get the CPU time the simulator has used. Unlike the host time,
+ *         this doesn't include the time the host spent running something
+ *         else, which would otherwise show up as the firmware stalling.
+ * @param  none
+ * @retval the CPU time in nanoseconds
+ */
+static uint64_t cpuNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief  Write the USART output.
+ * @param  data: the bytes sent
+ * @param  len: the number of bytes
+ * @retval none
+ */
+void SimOutput(const uint8_t *data, size_t len) {
+	ssize_t n;
+
+	while (outFd >= 0 && len > 0) {
+		n = write(outFd, data, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		data += n;
+		len -= n;
+	}
+}
+
+// The firmware's command queue (usart.c). Commands that have arrived have
+// been taken once it is empty and no line is part-way in.
+extern volatile uint8_t CommandHead, CommandTail, CommandLineLength;
+
+#define COMMANDS_TAKEN() (CommandHead == CommandTail && CommandLineLength == 0)
+
+/**
+ * @brief  Set the commands to send, turning each ';' into a line end.
+ * @param  s: the commands
+ * @retval none
+ */
+static void setCommands(const char *s) {
+	commandLen = 0;
+	commandPos = 0;
+	commandBuf = realloc(commandBuf, strlen(s) * 2 + 4);
+
+	for (; *s; s++) {
+		if (*s == ';') {
+			commandBuf[commandLen++] = '\r';
+			commandBuf[commandLen++] = '\n';
+		} else
+			commandBuf[commandLen++] = *s;
+	}
+	commandBuf[commandLen++] = '\r';
+	commandBuf[commandLen++] = '\n';
+	commandBuf[commandLen] = 0;
+}
+
+/**
+ * @brief  Keep track of the command lines sent. Those sent while the firmware
+ *         is sampling wait for their reply frames (see replied()).
+ * @param  c: a byte of input
+ * @retval none
+ */
+static void noteInput(uint8_t c) {
+	if (c == '\n') {
+		inLine[inLineLen] = 0;
+		if (SamplingActive && pendingCount < PENDING_MAX && strncmp(inLine, "CRED=", 5) != 0) {
+			pending[pendingCount].sent = SimNow;
+			strcpy(pending[pendingCount].line, inLine);
+			pendingCount++;
+		}
+		inLineLen = 0;
+	} else if (c != '\r' && inLineLen < sizeof(inLine) - 1)
+		inLine[inLineLen++] = c;
+}
+
+/**
+ * @brief  A reply frame has been sent: print the time from the command to
+ *         the end of its reply.
+ * @param  payload: the reply frame payload
+ * @param  len: the payload length
+ * @param  end: when the last byte of the frame left
+ * @retval none
+ */
+static void replied(const uint8_t *payload, size_t len, SimTime end) {
+	char line[128];
+	int i, n;
+
+	if (len < 1)
+		return;
+	for (i = 0; i < pendingCount; i++) {
+		if (len - 1 == strlen(pending[i].line) && memcmp(payload + 1, pending[i].line, len - 1) == 0)
+			break;
+	}
+	if (i == pendingCount)
+		return;
+
+	if (resultFd < 0) {
+		n = snprintf(line, sizeof(line), "lasim: %s %s, %.3f ms after it was sent\n", pending[i].line,
+				payload[0] == REPLY_DONE ? "done" : "refused", (end - pending[i].sent) / 1e9);
+		write(2, line, n);
+	}
+
+	pendingCount--;
+	memmove(&pending[i], &pending[i + 1], (pendingCount - i) * sizeof(pending[0]));
+}
+
+/**
+ * @brief  A byte has been put on the line. The frames are followed, to pick
+ *         out the replies to commands.
+ * @param  b: the byte
+ * @param  end: when the byte has been sent
+ * @retval none
+ */
+void SimSent(uint8_t b, SimTime end) {
+	if (outFrameLen == 0 && b != FRAME_SYNC)
+		return;
+
+	if (outFrameLen < sizeof(outFrame))
+		outFrame[outFrameLen] = b;
+	outFrameLen++;
+	if (outFrameLen == FRAME_HEADER_SIZE)
+		outFrameSize = FRAME_OVERHEAD + (outFrame[3] | outFrame[4] << 8);
+	if (outFrameLen < FRAME_HEADER_SIZE || outFrameLen < outFrameSize)
+		return;
+
+	if (outFrame[1] == FRAME_REPLY && outFrameSize <= sizeof(outFrame))
+		replied(outFrame + FRAME_HEADER_SIZE, outFrameSize - FRAME_OVERHEAD, end);
+	outFrameLen = 0;
+}
+
+/**
+ * @brief  Get the next byte of input for the USART: first the -c commands,
+ *         then whatever can be read from the -i input without waiting.
+ * @param  c: the byte
+ * @retval 1 if there was a byte, otherwise 0
+ */
+int SimInput(uint8_t *c) {
+	ssize_t n;
+
+	// A "+<ms>" entry starts a hold instead of being sent, once the firmware
+	// has taken the commands before it.
+	if (commandPos < commandLen && commandBuf[commandPos] == '+'
+			&& (commandPos == 0 || commandBuf[commandPos - 1] == '\n')) {
+		if (!COMMANDS_TAKEN())
+			return 0;
+		commandHold = SimNow + strtoul(commandBuf + commandPos + 1, NULL, 10) * (SIM_PS_PER_SECOND / 1000);
+		commandPos += strcspn(commandBuf + commandPos, "\n") + 1;
+	}
+
+	if (commandPos < commandLen) {
+		if (SimNow < commandHold)
+			return 0;
+		*c = commandBuf[commandPos++];
+		noteInput(*c);
+		return 1;
+	}
+
+	if (inFd >= 0) {
+		n = read(inFd, c, 1);
+		if (n == 1) {
+			noteInput(*c);
+			return 1;
+		}
+		if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+			close(inFd);
+			inFd = -1;
+		}
+		return 0;
+	}
+
+	inputDone = 1;
+	return 0;
+}
+
+/**
+ * @brief  Print the statistics of the capture that just finished.
+ * @param  none
+ * @retval none
+ */
+static void reportCapture() {
+	char line[256];
+	SimTime span = SimStat.captureEnd - SimStat.captureStart;
+	int n;
+
+	n = snprintf(line, sizeof(line), "mode=%c chan=%u pins=0x%02x comp=%c engine=%s rate=%u samples=%u time=%.1fms "
+			"bytes=%llu line=%.1f%% queue=%u/%u missed=%u overflow=%u gaps=%u lost=%u\n",
+			SamplingMode < 3 ? "CTR"[SamplingMode] : '?', SamplingChannels, SamplingPins,
+			SamplingCompression < 3 ? "NYB"[SamplingCompression] : '?',
+			BurstDepth ? "burst" : SamplingDma ? "dma" : "irq", (unsigned) SamplingRate,
+			(unsigned) Irqs, span / 1e9, (unsigned long long) SimStat.bytesSent,
+			span ? 100.0 * SimStat.lineBusy / span : 0.0,
+			SimStat.queueFree - SimStat.queueMinFree, SimStat.queueFree, SimStat.missed, Overflow,
+			(unsigned) Stats.gaps, (unsigned) Stats.gapSamples);
+	write(2, line, n);
+}
+
+/**
+ * @brief  End the simulation, passing the result to the benchmark if this is
+ *         one of its trials.
+ * @param  done: non-zero if the run finished, zero if it timed out
+ * @retval none
+ */
+static void finish(uint8_t done) {
+	SimResult r;
+
+	if (resultFd >= 0) {
+		memset(&r, 0, sizeof(r));
+		r.done = done;
+		r.overflow = Overflow;
+		r.samples = Irqs;
+		r.stats = SimStat;
+		write(resultFd, &r, sizeof(r));
+	} else if (SimStat.starved) {
+		static const char msg[] = "lasim: interrupts are starving the main loop\n";
+		write(2, msg, sizeof(msg) - 1);
+	} else if (!done) {
+		static const char msg[] = "lasim: simulated time limit reached\n";
+		write(2, msg, sizeof(msg) - 1);
+	}
+
+	if (outFd >= 0)
+		close(outFd);
+	_exit(done ? 0 : 2);
+}
+
+/**
+ * @brief  Start the next tick. The timer is restarted once the tick has been
+ *         handled, so the firmware always gets a full tick to run in, however
+ *         long the simulator took.
+ * @param  none
+ * @retval none
+ */
+static void armTimer() {
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = tickUs / 1000000;
+	its.it_value.tv_nsec = (tickUs % 1000000) * 1000;
+	lastExit = cpuNs();
+	timer_settime(timer, 0, &its, NULL);
+}
+
+/**
+ * @brief  Host timer signal handler: move simulated time on by the host time
+ *         the firmware has used since the last tick, and run the peripherals.
+ * @param  sig: the signal
+ * @retval none
+ */
+static void onTick(int sig) {
+	uint64_t used = cpuNs() - lastExit;
+	double factor = SimSpeed * (SimSampling() ? 1 : IDLE_SPEEDUP);
+
+	SimAdvance(SimNow + (SimTime) (used * 1000 * factor));
+
+	if (SimStat.captures != reported) {
+		reported = SimStat.captures;
+		if (resultFd < 0)
+			reportCapture();
+	}
+
+	if (!keepRunning && inputDone && COMMANDS_TAKEN() && !SamplingActive && !SimSampling() && SimLineIdle())
+		finish(1);
+	if (SimNow > timeLimit || SimStat.starved)
+		finish(0);
+
+	// The time spent here is the simulator's, not the firmware's, so the
+	// next tick is a full tick of firmware time away.
+	armTimer();
+}
+
+/**
+ * @brief  Start the host timer and run the firmware. This does not return.
+ * @param  none
+ * @retval none
+ */
+static void run() {
+	struct sigaction sa;
+	struct sigevent sev;
+
+	SimReset();
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onTick;
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGALRM, &sa, NULL);
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = SIGALRM;
+	if (timer_create(CLOCK_MONOTONIC, &sev, &timer) < 0) {
+		perror("lasim: timer_create");
+		exit(1);
+	}
+	armTimer();
+
+	FirmwareMain();
+	exit(1);
+}
+
+/**
+ * @brief  Run one benchmark trial in a child process.
+ * @param  mode: sampling mode (C, T or R)
+ * @param  channels: number of channels
+ * @param  compression: compression (N, Y or B)
+ * @param  engine: capture engine (I or D)
+ * @param  rate: sampling rate
+ * @param  ms: sampling time
+ * @retval the result of the trial
+ */
+SimResult SimTrial(char mode, int channels, char compression, char engine, uint32_t rate, uint32_t ms) {
+	SimResult r;
+	char cmd[128];
+	int fds[2], status;
+	uint64_t deadline;
+	pid_t pid;
+
+	memset(&r, 0, sizeof(r));
+	// The trigger and burst settings are given too, so a trial doesn't depend
+	// on what was left in the globals before the fork. They go first, and
+	// are taken before the rest is sent, so the lines never outgrow the
+	// firmware's command queue (8 of them).
+	snprintf(cmd, sizeof(cmd), "TRIG=N;HOLD=0;DPTH=0;+0;CHAN=%d;RATE=%u;TIME=%u;COMP=%c;MODE=%c;DMAC=%c;START",
+			channels, (unsigned) rate, (unsigned) ms, compression, mode, engine == 'D' ? 'Y' : 'N');
+
+	if (pipe(fds) < 0)
+		return r;
+
+	pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		resultFd = fds[1];
+		setCommands(cmd);
+		timeLimit = (ms + 5000) * 1000000000ULL;
+		run();
+	}
+	close(fds[1]);
+
+	// A firmware that can't keep up at all may never get to the end.
+	deadline = hostNs() + 30000000000ULL;
+	while (pid > 0 && waitpid(pid, &status, WNOHANG) == 0) {
+		if (hostNs() > deadline) {
+			kill(pid, SIGKILL);
+			waitpid(pid, &status, 0);
+			break;
+		}
+		usleep(1000);
+	}
+
+	if (read(fds[0], &r, sizeof(r)) != sizeof(r))
+		r.done = 0;
+	close(fds[0]);
+	return r;
+}
+
+/**
+ * @brief  Check if a benchmark trial kept up.
+ * @param  r: the result of the trial
+ * @retval non-zero if it did
+ */
+static uint8_t passed(const SimResult *r) {
+	return r->done && !r->overflow && r->stats.missed == 0;
+}
+
+/**
+ * @brief  Run the benchmark suite.
+ * @param  modes: the sampling modes to try
+ * @param  channels: the channel counts to try
+ * @param  compressions: the compression settings to try
+ * @param  engines: the capture engines to try
+ * @param  ms: sampling time of each trial
+ * @retval none
+ */
+static void bench(const char *modes, const char *channels, const char *compressions, const char *engines, uint32_t ms) {
+	const char *m, *n, *z, *d;
+	uint32_t lo, hi, mid;
+	SimResult r, best;
+	SimTime span;
+
+	printf("mode chan comp engine   max rate   line  queue\n");
+	for (m = modes; *m; m++)
+		for (n = channels; *n; n++)
+			for (z = compressions; *z; z++)
+				for (d = engines; *d; d++) {
+					// Search (geometrically) for the highest rate without an
+					// overflow, to within 5%.
+					lo = 1000;
+					hi = 9999999;
+					best = SimTrial(*m, *n - '0', *z, *d, lo, ms);
+					if (!passed(&best)) {
+						printf("%c    %c    %c    %-6s   < %7u\n", *m, *n, *z, *d == 'D' ? "dma" : "irq", (unsigned) lo);
+						fflush(stdout);
+						continue;
+					}
+
+					r = SimTrial(*m, *n - '0', *z, *d, hi, ms);
+					if (passed(&r)) {
+						lo = hi;
+						best = r;
+					}
+
+					while (hi > lo + lo / 20) {
+						mid = (uint32_t) sqrt((double) lo * hi);
+						r = SimTrial(*m, *n - '0', *z, *d, mid, ms);
+						if (passed(&r)) {
+							lo = mid;
+							best = r;
+						} else
+							hi = mid;
+					}
+
+					span = best.stats.captureEnd - best.stats.captureStart;
+					printf("%c    %c    %c    %-6s %10u %5.1f%% %6u\n", *m, *n, *z, *d == 'D' ? "dma" : "irq",
+							(unsigned) lo, span ? 100.0 * best.stats.lineBusy / span : 0.0,
+							best.stats.queueFree - best.stats.queueMinFree);
+					fflush(stdout);
+				}
+}
+
+/**
+ * @brief  Simulator entry point.
+ * @param  argc: number of arguments
+ * @param  argv: arguments
+ * @retval exit status
+ */
+int main(int argc, char *argv[]) {
+	const char *modes = "CTR", *channels = "1248", *compressions = "NYB", *engines = "ID";
+	const char *waveform = "square", *units = "all", *vectors = NULL;
+	uint32_t benchMs = 100;
+	uint8_t benchmark = 0, profiling = 0, checking = 0;
+	int opt;
+
+	setCommands("");
+	commandLen = 0;
+
+	while ((opt = getopt(argc, argv, "c:i:o:w:B:s:e:q:t:kbpxu:V:m:n:z:d:T:")) != -1) {
+		switch (opt) {
+		case 'c':
+			setCommands(optarg);
+			break;
+		case 'i':
+			if ((inFd = open(optarg, O_RDONLY | O_NONBLOCK)) < 0) {
+				perror(optarg);
+				return 1;
+			}
+			break;
+		case 'o':
+			if ((outFd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+				perror(optarg);
+				return 1;
+			}
+			break;
+		case 'w':
+			waveform = optarg;
+			break;
+		case 'B':
+			SimBaudOverride = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			SimSpeed = atof(optarg);
+			break;
+		case 'e':
+			SimIsrCycles = strtoul(optarg, NULL, 0);
+			break;
+		case 'q':
+			tickUs = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			timeLimit = strtoull(optarg, NULL, 0) * 1000000000ULL;
+			break;
+		case 'k':
+			keepRunning = 1;
+			break;
+		case 'b':
+			benchmark = 1;
+			break;
+		case 'p':
+			profiling = 1;
+			break;
+		case 'x':
+			checking = 1;
+			break;
+		case 'u':
+			units = optarg;
+			break;
+		case 'V':
+			vectors = optarg;
+			break;
+		case 'm':
+			modes = optarg;
+			break;
+		case 'n':
+			channels = optarg;
+			break;
+		case 'z':
+			compressions = optarg;
+			break;
+		case 'd':
+			engines = optarg;
+			break;
+		case 'T':
+			benchMs = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: see the comment at the top of sim.c\n");
+			return 1;
+		}
+	}
+
+	if (SimSpeed <= 0 || tickUs == 0) {
+		fprintf(stderr, "lasim: bad -s or -q value\n");
+		return 1;
+	}
+	if (SimWaveformLoad(waveform) < 0) {
+		fprintf(stderr, "lasim: can't read waveform %s\n", waveform);
+		return 1;
+	}
+
+	if (checking)
+		return SimCheck() ? 1 : 0;
+	if (vectors)
+		return SimWriteVectors(vectors) ? 1 : 0;
+	if (benchmark)
+		bench(modes, channels, compressions, engines, benchMs);
+	else if (profiling)
+		SimProfile(units, modes, channels, engines);
+	else
+		run();
+	return 0;
+}
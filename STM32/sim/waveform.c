@@ -0,0 +1,207 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "periph.h"
+
+// The simulated input pins. A waveform is either built in:
+//
+//   square  the test pattern the host's test device uses (the default)
+//   noise   a new random value every time the inputs are read
+//   bus     serial bus traffic: bursts of UART bytes at 115200 baud on
+//           channel 1, and SPI transfers with a 250 kHz clock (chip select,
+//           clock, MOSI and MISO on channels 2 to 5), up to 20 ms apart. It
+//           is the same every time, and repeats every 2 seconds.
+//
+// or read from a file of "<microseconds> <value>" lines, each giving the
+// value of the 8 inputs and how long it lasts. A file waveform repeats.
+
+#define PS_PER_US 1000000ULL
+#define PS_PER_MS 1000000000ULL
+
+#define WAVE_SQUARE 0
+#define WAVE_NOISE  1
+#define WAVE_FILE   2
+
+static uint8_t wave = WAVE_SQUARE;
+static char *waveName;
+static uint32_t noise = 2463534242UL;
+
+// File (or bus) waveform: the end time of each step, and its value.
+static SimTime *stepEnd;
+static uint8_t *stepValue;
+static uint32_t steps, stepSize;
+
+/**
+ * @brief  Add a step to the waveform being built.
+ * @param  value: the value of the inputs
+ * @param  us: how long it lasts, in microseconds
+ * @retval none
+ */
+static void addStep(uint8_t value, double us) {
+	SimTime end = steps ? stepEnd[steps - 1] : 0;
+
+	if (steps == stepSize) {
+		stepSize = stepSize ? stepSize * 2 : 256;
+		stepEnd = realloc(stepEnd, stepSize * sizeof(*stepEnd));
+		stepValue = realloc(stepValue, stepSize * sizeof(*stepValue));
+	}
+	stepEnd[steps] = end + (SimTime) (us * PS_PER_US);
+	stepValue[steps++] = value;
+}
+
+/**
+ * @brief  Build the bus waveform.
+ * @param  none
+ * @retval none
+ */
+static void buildBus() {
+	uint32_t seed = 2463534242UL, n, bit;
+	uint8_t v = 0x03, byte;	// UART idle high, chip select high
+
+#define BUS_RANDOM() (seed ^= seed << 13, seed ^= seed >> 17, seed ^= seed << 5, seed)
+
+	steps = 0;
+	while (steps == 0 || stepEnd[steps - 1] < 2000 * PS_PER_MS) {
+		addStep(v, 1 + BUS_RANDOM() % 20000);
+
+		if (BUS_RANDOM() & 1) {
+			// UART: a start bit, 8 data bits (low bit first) and a stop bit.
+			for (n = 1 + BUS_RANDOM() % 32; n > 0; n--) {
+				byte = BUS_RANDOM();
+				addStep(v & ~0x01, 1e6 / 115200);
+				for (bit = 0; bit < 8; bit++)
+					addStep((v & ~0x01) | ((byte >> bit) & 1), 1e6 / 115200);
+				addStep(v, 1e6 / 115200 + BUS_RANDOM() % 20);
+			}
+		} else {
+			// SPI (mode 0): data changes while the clock is low.
+			v &= ~0x02;
+			addStep(v, 2);
+			for (n = 1 + BUS_RANDOM() % 16; n > 0; n--) {
+				byte = BUS_RANDOM();
+				for (bit = 0; bit < 8; bit++) {
+					v = (v & ~0x1c) | (((byte >> (7 - bit)) & 1) << 3) | ((BUS_RANDOM() & 1) << 4);
+					addStep(v, 2);
+					addStep(v | 0x04, 2);
+				}
+			}
+			v = (v & ~0x1c) | 0x02;
+		}
+	}
+}
+
+/**
+ * @brief  Select the input waveform.
+ * @param  name: "square", "noise", "bus" or the name of a waveform file
+ * @retval 0 if successful, -1 if the file could not be read
+ */
+int SimWaveformLoad(const char *name) {
+	FILE *f;
+	char line[128];
+	double us;
+	unsigned long value;
+
+	free(waveName);
+	waveName = strdup(name);
+
+	if (strcmp(name, "square") == 0) {
+		wave = WAVE_SQUARE;
+		return 0;
+	}
+	if (strcmp(name, "noise") == 0) {
+		wave = WAVE_NOISE;
+		return 0;
+	}
+	if (strcmp(name, "bus") == 0) {
+		buildBus();
+		wave = WAVE_FILE;
+		return 0;
+	}
+
+	if ((f = fopen(name, "r")) == NULL)
+		return -1;
+
+	steps = 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || sscanf(line, "%lf %li", &us, &value) != 2 || us <= 0)
+			continue;
+
+		addStep(value, us);
+	}
+	fclose(f);
+
+	if (steps == 0)
+		return -1;
+	wave = WAVE_FILE;
+	return 0;
+}
+
+/**
+ * @brief  Get the name of the input waveform.
+ * @param  none
+ * @retval the name it was selected with
+ */
+const char *SimWaveformName() {
+	return waveName ? waveName : "square";
+}
+
+/**
+ * @brief  Get the value of the inputs at a given time.
+ * @param  t: the time
+ * @retval the inputs (bit 0 is channel 1)
+ */
+uint8_t SimWaveform(SimTime t) {
+	uint32_t lo, hi, mid;
+	uint8_t v = 0;
+
+	switch (wave) {
+	case WAVE_NOISE:
+		noise ^= noise << 13;
+		noise ^= noise >> 17;
+		noise ^= noise << 5;
+		return noise;
+
+	case WAVE_FILE:
+		t %= stepEnd[steps - 1];
+		lo = 0;
+		hi = steps - 1;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (stepEnd[mid] > t)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		return stepValue[lo];
+	}
+
+	// 1 kHz, 500 Hz, a 1 ms pulse every 20 ms, a 2 ms pulse every 20 ms,
+	// 30 Hz, a 20 ms pulse every 80 ms, 100 Hz and 800 Hz.
+	v |= (t / (500 * PS_PER_US)) & 1;
+	v |= ((t / PS_PER_MS) & 1) << 1;
+	v |= (t % (20 * PS_PER_MS) >= 19 * PS_PER_MS) << 2;
+	v |= (t % (20 * PS_PER_MS) >= 18 * PS_PER_MS) << 3;
+	v |= ((t / (50 * PS_PER_MS / 3)) & 1) << 4;
+	v |= (t % (80 * PS_PER_MS) >= 60 * PS_PER_MS) << 5;
+	v |= ((t / (5 * PS_PER_MS)) & 1) << 6;
+	v |= ((t / (625 * PS_PER_US)) & 1) << 7;
+	return v;
+}
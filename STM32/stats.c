@@ -0,0 +1,64 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <string.h>
+#include "main.h"
+#include "stats.h"
+#include "frame.h"
+
+CaptureStats Stats;
+
+// The counters go out in one status frame.
+_Static_assert(sizeof(CaptureStats) <= FRAME_SMALL_PAYLOAD_MAX, "CaptureStats does not fit in a status frame");
+
+/**
+ * @brief  Reset the counters for a new capture, and start the cycle counter
+ *         if it isn't running yet.
+ * @param  none
+ * @retval none
+ */
+void StatsInit() {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	memset(&Stats, 0, sizeof(Stats));
+	Stats.queueSize = SampleQueueFree();
+}
+
+/**
+ * @brief  Record the queue level. The queue is fullest just before the drain
+ *         loop empties it, so this is called from there rather than from the
+ *         capture interrupt.
+ * @param  used: the number of bytes in the queue
+ * @retval none
+ */
+void StatsQueueLevel(uint16_t used) {
+	if (used > Stats.queueHighWater)
+		Stats.queueHighWater = used;
+}
+
+/**
+ * @brief  Send the counters to the host in a status frame.
+ * @param  none
+ * @retval none
+ */
+void StatsSend() {
+	Stats.samples = Irqs;
+	FrameSend(FRAME_STATUS, (const uint8_t *)&Stats, sizeof(Stats));
+}
@@ -0,0 +1,106 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+// Performance counters for the current (or last) capture. They are reset at
+// the start of each capture and sent to the host in a status frame at the end
+// of it, and whenever the host sends STAT. The status frame payload is this
+// structure as it is in memory (little-endian, no padding), so fields may be
+// added at the end but not moved, and only while it fits in a short frame
+// (FRAME_SMALL_PAYLOAD_MAX, which it fills as it is).
+//
+// Cycle counts come from the core's DWT cycle counter (CYCCNT). The capture
+// interrupt is the timer interrupt (one sample) or the DMA half-buffer
+// interrupt (a block of samples); the drain loop is one pass of the sample
+// loop that moved data from the queue towards the USART.
+
+typedef struct {
+	uint64_t isrCycles;		// Total cycles spent in the capture interrupt
+	uint64_t drainCycles;		// Total cycles spent in drain loop passes
+	uint32_t samples;		// Samples taken
+	uint32_t dropped;		// Bytes lost (queue full, or burst window overrun)
+	uint32_t bytesSent;		// Bytes handed to the USART, framing included
+	uint32_t compressIn;		// Bytes fed to the compressor
+	uint32_t compressOut;		// Bytes the compressor produced
+	uint32_t isrCount;		// Capture interrupts
+	uint32_t isrMaxCycles;		// Longest capture interrupt
+	uint32_t drainCount;		// Drain loop passes that moved data
+	uint32_t drainMaxCycles;	// Longest drain loop pass
+	uint16_t queueHighWater;	// Most bytes waiting in the queue at once
+	uint16_t queueSize;		// Size of the queue
+	uint32_t gaps;			// Gap records sent
+	uint32_t gapSamples;		// Samples lost in those gaps
+} CaptureStats;
+
+extern CaptureStats Stats;
+
+/**
+ * @brief  Read the cycle counter.
+ * @param  none
+ * @retval the cycle count
+ */
+static inline uint32_t StatsCycles() {
+	return DWT->CYCCNT;
+}
+
+/**
+ * @brief  Account for a capture interrupt.
+ * @param  start: the cycle count when the interrupt started
+ * @retval none
+ */
+static inline void StatsIsrDone(uint32_t start) {
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	Stats.isrCycles += cycles;
+	Stats.isrCount++;
+	if (cycles > Stats.isrMaxCycles)
+		Stats.isrMaxCycles = cycles;
+}
+
+/**
+ * @brief  Account for a drain loop pass that moved data.
+ * @param  start: the cycle count when the pass started
+ * @retval none
+ */
+static inline void StatsDrainDone(uint32_t start) {
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	Stats.drainCycles += cycles;
+	Stats.drainCount++;
+	if (cycles > Stats.drainMaxCycles)
+		Stats.drainMaxCycles = cycles;
+}
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+extern void StatsInit(void);
+extern void StatsQueueLevel(uint16_t used);
+extern void StatsSend(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* STATS_H_ */
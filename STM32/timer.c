@@ -20,11 +20,31 @@
 #include <math.h>
 #include "main.h"
 #include "stm32f4xx_tim.h"
+#include "stm32f4xx_dma.h"
 #include "evalboard.h"
+#include "capture.h"
+#include "stats.h"
 
 // Interrupt counter.
 volatile uint32_t Irqs;
 
+// DMA capture buffer. The DMA engine fills it continuously (circular mode);
+// each half is handed to CaptureBlock() as soon as it is full while the DMA
+// carries on filling the other half.
+#define CAPTURE_BUFFER_SIZE 1024
+#define CAPTURE_HALF_SIZE   (CAPTURE_BUFFER_SIZE / 2)
+
+static volatile uint8_t captureBuffer[CAPTURE_BUFFER_SIZE];
+static volatile uint16_t captureProcessed; // Offset of the next unprocessed sample.
+
+// Burst mode buffer. The DMA engine fills it in double-buffer mode, one half
+// per transfer, and the halves filled so far are counted in the interrupt.
+#define BURST_HALF_SIZE (BURST_BUFFER_SIZE / 2)
+
+volatile uint8_t BurstBuffer[BURST_BUFFER_SIZE];
+static volatile uint8_t burstActive;
+static volatile uint32_t burstHalves;
+
 /**
  * @brief  Configure the input pins that will be used for sampling.
  * @param  none
@@ -83,6 +103,8 @@ static void ConfigTimer(uint32_t TimerBaseClockRate, uint32_t DesiredFequency) {
  * @retval none
  */
 void TIM2_IRQHandler() {
+	uint32_t start = StatsCycles();
+
 	if (TIM_GetITStatus(TIM2, TIM_IT_Update ) != RESET) {
 		uint8_t sample;
 
@@ -101,6 +123,8 @@ void TIM2_IRQHandler() {
 		// Send the samples to the output queue.
 		EnqueueSample(sample);
 	}
+
+	StatsIsrDone(start);
 }
 
 /**
@@ -134,3 +158,248 @@ void TimerDenit() {
 	nvicStructure.NVIC_IRQChannelCmd = DISABLE;
 	NVIC_Init(&nvicStructure);
 }
+
+/**
+ * @brief  Configure the DMA stream that copies the input pins to memory on
+ *         every capture timer update event.
+ * @param  buffer: the buffer to fill
+ * @param  size: the size of the buffer (or of each half, in double-buffer
+ *         mode)
+ * @param  doubleBuffer: non-zero to fill the two halves of the buffer in
+ *         turn (interrupting after each), otherwise the buffer is filled in
+ *         circular mode (interrupting when each half is full)
+ * @retval none
+ */
+static void ConfigCaptureDma(volatile uint8_t *buffer, uint16_t size, uint8_t doubleBuffer) {
+	DMA_InitTypeDef dmaInitStructure;
+	NVIC_InitTypeDef nvicStructure;
+
+	RCC_AHB1PeriphClockCmd(CAPTURE_DMA_PERIPH, ENABLE);
+	DMA_DeInit(CAPTURE_DMA_STREAM);
+
+	// Byte transfers straight from the input data register. When the
+	// sample pins are the upper 8 pins of the port, read the upper byte.
+	dmaInitStructure.DMA_Channel = CAPTURE_DMA_CHANNEL;
+#if TIMER_HI_PINS
+	dmaInitStructure.DMA_PeripheralBaseAddr = (uint32_t) &TIMER_GPIO->IDR + 1;
+#else
+	dmaInitStructure.DMA_PeripheralBaseAddr = (uint32_t) &TIMER_GPIO->IDR;
+#endif
+	dmaInitStructure.DMA_Memory0BaseAddr = (uint32_t) buffer;
+	dmaInitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	dmaInitStructure.DMA_BufferSize = size;
+	dmaInitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	dmaInitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	dmaInitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	dmaInitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	dmaInitStructure.DMA_Mode = DMA_Mode_Circular;
+	dmaInitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+	dmaInitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	dmaInitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_Full;
+	dmaInitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	dmaInitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(CAPTURE_DMA_STREAM, &dmaInitStructure);
+
+	if (doubleBuffer) {
+		// Interrupt when the DMA switches from one half to the other.
+		DMA_DoubleBufferModeConfig(CAPTURE_DMA_STREAM, (uint32_t) (buffer + size), DMA_Memory_0);
+		DMA_DoubleBufferModeCmd(CAPTURE_DMA_STREAM, ENABLE);
+		DMA_ITConfig(CAPTURE_DMA_STREAM, DMA_IT_TC, ENABLE);
+	} else {
+		// Interrupt when each half of the buffer is full.
+		DMA_ITConfig(CAPTURE_DMA_STREAM, DMA_IT_HT | DMA_IT_TC, ENABLE);
+	}
+
+	nvicStructure.NVIC_IRQChannel = CAPTURE_DMA_IRQ;
+	nvicStructure.NVIC_IRQChannelPreemptionPriority = 0;
+	nvicStructure.NVIC_IRQChannelSubPriority = 1;
+	nvicStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&nvicStructure);
+
+	DMA_Cmd(CAPTURE_DMA_STREAM, ENABLE);
+}
+
+/**
+ * @brief  Configure the capture timer to issue a DMA request (instead of an
+ *         interrupt) at the desired frequency.
+ * @param  TimerBaseClockRate: the rate of the capture timer's APB clock.
+ * @param  DesiredFequency: the sampling frequency desired.
+ * @retval none
+ */
+static void ConfigCaptureTimer(uint32_t TimerBaseClockRate, uint32_t DesiredFequency) {
+	TIM_TimeBaseInitTypeDef timerInitStructure;
+	uint32_t timerTicks, prescaler;
+
+	RCC_APB2PeriphClockCmd(CAPTURE_TIM_PERIPH, ENABLE);
+
+	// The timer clock runs at twice the APB clock (see ConfigTimer() above).
+	// Unlike TIM2, the capture timer is only 16 bits wide, so low sampling
+	// rates need a prescaler.
+	timerTicks = (TimerBaseClockRate * 2) / DesiredFequency;
+	prescaler = (timerTicks >> 16) + 1;
+
+	timerInitStructure.TIM_Period = (timerTicks / prescaler) - 1;
+	timerInitStructure.TIM_Prescaler = prescaler - 1;
+	timerInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	timerInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	timerInitStructure.TIM_RepetitionCounter = 0;
+	TIM_TimeBaseInit(CAPTURE_TIM, &timerInitStructure);
+	TIM_DMACmd(CAPTURE_TIM, TIM_DMA_Update, ENABLE);
+	TIM_Cmd(CAPTURE_TIM, ENABLE);
+}
+
+/**
+ * @brief  ISR for the capture DMA stream. Called when either half of the
+ *         capture buffer has been filled; the half that was just filled is
+ *         processed while the DMA fills the other half.
+ * @param  none
+ * @retval none
+ */
+void CAPTURE_DMA_IRQHANDLER() {
+	uint32_t start = StatsCycles();
+
+	// In burst mode, the samples are left in the buffer; just count them.
+	if (burstActive) {
+		if (DMA_GetITStatus(CAPTURE_DMA_STREAM, CAPTURE_DMA_IT_TC ) != RESET) {
+			DMA_ClearITPendingBit(CAPTURE_DMA_STREAM, CAPTURE_DMA_IT_TC );
+			burstHalves++;
+		}
+	} else {
+		if (DMA_GetITStatus(CAPTURE_DMA_STREAM, CAPTURE_DMA_IT_HT ) != RESET) {
+			DMA_ClearITPendingBit(CAPTURE_DMA_STREAM, CAPTURE_DMA_IT_HT );
+			CaptureBlock(captureBuffer, CAPTURE_HALF_SIZE);
+			captureProcessed = CAPTURE_HALF_SIZE;
+		}
+
+		if (DMA_GetITStatus(CAPTURE_DMA_STREAM, CAPTURE_DMA_IT_TC ) != RESET) {
+			DMA_ClearITPendingBit(CAPTURE_DMA_STREAM, CAPTURE_DMA_IT_TC );
+			CaptureBlock(captureBuffer + CAPTURE_HALF_SIZE, CAPTURE_HALF_SIZE);
+			captureProcessed = 0;
+		}
+	}
+
+	StatsIsrDone(start);
+}
+
+/**
+ * @brief  Initialize timer-triggered DMA capture. Instead of an interrupt
+ *         per sample, the capture timer's update event copies the input pins
+ *         to memory and samples are processed a half-buffer at a time.
+ * @param  TimerBaseClockRate: the rate of the capture timer's APB clock.
+ * @param  DesiredFequency: the sampling frequency desired.
+ * @retval none
+ */
+void CaptureDmaInit(uint32_t TimerBaseClockRate, uint32_t DesiredFequency) {
+	Irqs = 0;
+	captureProcessed = 0;
+	burstActive = 0;
+	ConfigInputPins();
+	ConfigCaptureDma(captureBuffer, CAPTURE_BUFFER_SIZE, 0);
+	ConfigCaptureTimer(TimerBaseClockRate, DesiredFequency);
+}
+
+/**
+ * @brief  De-initialize DMA capture. Samples that were captured into a
+ *         partially filled half of the buffer are processed before returning.
+ * @param  none
+ * @retval none
+ */
+void CaptureDmaDenit() {
+	NVIC_InitTypeDef nvicStructure;
+	uint16_t written;
+
+	// Stop the DMA requests first so the buffer stops changing.
+	TIM_Cmd(CAPTURE_TIM, DISABLE);
+	TIM_DMACmd(CAPTURE_TIM, TIM_DMA_Update, DISABLE);
+
+	nvicStructure.NVIC_IRQChannel = CAPTURE_DMA_IRQ;
+	nvicStructure.NVIC_IRQChannelPreemptionPriority = 0;
+	nvicStructure.NVIC_IRQChannelSubPriority = 1;
+	nvicStructure.NVIC_IRQChannelCmd = DISABLE;
+	NVIC_Init(&nvicStructure);
+
+	// Process whatever the DMA wrote since the last half/full interrupt that
+	// was serviced (this may include a half whose interrupt is still pending).
+	written = CAPTURE_BUFFER_SIZE - DMA_GetCurrDataCounter(CAPTURE_DMA_STREAM);
+	if (written == CAPTURE_BUFFER_SIZE)
+		written = 0;
+
+	if (written < captureProcessed) {
+		CaptureBlock(captureBuffer + captureProcessed, CAPTURE_BUFFER_SIZE - captureProcessed);
+		captureProcessed = 0;
+	}
+	CaptureBlock(captureBuffer + captureProcessed, written - captureProcessed);
+
+	DMA_Cmd(CAPTURE_DMA_STREAM, DISABLE);
+	DMA_ITConfig(CAPTURE_DMA_STREAM, DMA_IT_HT | DMA_IT_TC, DISABLE);
+	RCC_APB2PeriphClockCmd(CAPTURE_TIM_PERIPH, DISABLE);
+}
+
+/**
+ * @brief  Initialize burst mode capture. The capture timer's DMA requests
+ *         fill BurstBuffer continuously (alternating between its two halves)
+ *         until BurstDmaDenit() is called.
+ * @param  TimerBaseClockRate: the rate of the capture timer's APB clock.
+ * @param  DesiredFequency: the sampling frequency desired.
+ * @retval none
+ */
+void BurstDmaInit(uint32_t TimerBaseClockRate, uint32_t DesiredFequency) {
+	burstHalves = 0;
+	burstActive = 1;
+	ConfigInputPins();
+	ConfigCaptureDma(BurstBuffer, BURST_HALF_SIZE, 1);
+	ConfigCaptureTimer(TimerBaseClockRate, DesiredFequency);
+}
+
+/**
+ * @brief  Get the number of samples written to the burst buffer so far.
+ * @param  none
+ * @retval the number of samples written
+ */
+uint32_t BurstDmaPosition() {
+	uint32_t halves, target, remaining;
+
+	// Read a consistent set of values: the DMA may switch halves (and the
+	// interrupt may count it) while we're reading.
+	do {
+		halves = burstHalves;
+		target = DMA_GetCurrentMemoryTarget(CAPTURE_DMA_STREAM);
+		remaining = DMA_GetCurrDataCounter(CAPTURE_DMA_STREAM);
+	} while (halves != burstHalves || target != DMA_GetCurrentMemoryTarget(CAPTURE_DMA_STREAM));
+
+	// The DMA has switched halves, but the interrupt hasn't been serviced yet.
+	if (target != (halves & 1))
+		halves++;
+
+	return halves * BURST_HALF_SIZE + (BURST_HALF_SIZE - remaining);
+}
+
+/**
+ * @brief  De-initialize burst mode capture.
+ * @param  none
+ * @retval the number of samples written to the burst buffer
+ */
+uint32_t BurstDmaDenit() {
+	NVIC_InitTypeDef nvicStructure;
+	uint32_t written;
+
+	// Stop the DMA requests first so the buffer stops changing.
+	TIM_Cmd(CAPTURE_TIM, DISABLE);
+	TIM_DMACmd(CAPTURE_TIM, TIM_DMA_Update, DISABLE);
+
+	written = BurstDmaPosition();
+
+	nvicStructure.NVIC_IRQChannel = CAPTURE_DMA_IRQ;
+	nvicStructure.NVIC_IRQChannelPreemptionPriority = 0;
+	nvicStructure.NVIC_IRQChannelSubPriority = 1;
+	nvicStructure.NVIC_IRQChannelCmd = DISABLE;
+	NVIC_Init(&nvicStructure);
+
+	DMA_Cmd(CAPTURE_DMA_STREAM, DISABLE);
+	DMA_DoubleBufferModeCmd(CAPTURE_DMA_STREAM, DISABLE);
+	DMA_ITConfig(CAPTURE_DMA_STREAM, DMA_IT_TC, DISABLE);
+	RCC_APB2PeriphClockCmd(CAPTURE_TIM_PERIPH, DISABLE);
+	burstActive = 0;
+
+	return written;
+}
@@ -0,0 +1,130 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "main.h"
+#include "trigger.h"
+
+// The trigger settings, reduced to one form for all modes: the trigger is
+// armed once (sample & mask) == value has been seen, and fires on the first
+// armed sample with one of the selected edges (or straight away, if
+// 'anyEdge' is set). This keeps the cost per sample the same for every mode.
+static uint8_t mask;
+static uint8_t value;
+static uint8_t rising;
+static uint8_t falling;
+static uint8_t anyEdge;
+
+static uint8_t armed;
+static uint8_t fired;
+static uint8_t prevSample;
+static uint8_t firstSample;
+static uint32_t holdoff; // samples still to be skipped after the trigger
+
+/**
+ * @brief  Initialize the trigger from the trigger settings for a new capture.
+ * @param  none
+ * @retval none
+ */
+void TriggerInit() {
+	mask = TriggerMask;
+	value = TriggerValue & TriggerMask;
+	rising = TriggerRising;
+	falling = TriggerFalling;
+	anyEdge = 0;
+
+	switch (TriggerMode) {
+	case TRIGGER_PATTERN:
+		anyEdge = 0xff;
+		break;
+	case TRIGGER_EDGE:
+		mask = 0;
+		value = 0;
+		break;
+	case TRIGGER_PATTERN_EDGE:
+		break;
+	default:
+		mask = 0;
+		value = 0;
+		anyEdge = 0xff;
+		break;
+	}
+
+	armed = 0;
+	fired = (TriggerMode == TRIGGER_NONE);
+	firstSample = 1;
+	holdoff = TriggerHoldoff;
+}
+
+/**
+ * @brief  Check if the trigger has fired (the hold-off may not be over yet).
+ * @param  none
+ * @retval 1 if the trigger has fired, otherwise 0
+ */
+uint8_t TriggerFired() {
+	return fired;
+}
+
+/**
+ * @brief  Look for the trigger in a block of samples, and skip the hold-off
+ *         samples after it.
+ * @param  samples: the raw samples (one byte per sample)
+ * @param  count: the number of samples
+ * @retval the number of samples to discard from the start of the block: the
+ *         samples before the trigger and during the hold-off. If it is less
+ *         than 'count', capture starts with the sample at that index.
+ */
+uint32_t TriggerScan(const volatile uint8_t *samples, uint32_t count) {
+	uint32_t i = 0, skip;
+	uint8_t sample, prev, isArmed;
+
+	if (!fired) {
+		if (count == 0)
+			return 0;
+
+		// There is no edge on the very first sample.
+		if (firstSample) {
+			prevSample = samples[0];
+			firstSample = 0;
+		}
+
+		prev = prevSample;
+		isArmed = armed;
+		for (; i < count; i++) {
+			sample = samples[i];
+			isArmed |= ((sample & mask) == value);
+			if (isArmed && (anyEdge | (~prev & sample & rising) | (prev & ~sample & falling)))
+				break;
+			prev = sample;
+		}
+		prevSample = prev;
+		armed = isArmed;
+
+		if (i == count)
+			return count;
+		fired = 1;
+	}
+
+	// Skip the hold-off.
+	skip = count - i;
+	if (skip > holdoff)
+		skip = holdoff;
+	holdoff -= skip;
+
+	return i + skip;
+}
@@ -0,0 +1,45 @@
+//
+//    8-Channel Logic Analyzer
+//    Copyright (C) 2014  Bob Foley
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef TRIGGER_H_
+#define TRIGGER_H_
+
+#include <stdint.h>
+
+// Trigger modes.
+#define TRIGGER_NONE         0 // Start straight away
+#define TRIGGER_PATTERN      1 // Start when (sample & mask) == value
+#define TRIGGER_EDGE         2 // Start on a rising or falling edge of the selected channels
+#define TRIGGER_PATTERN_EDGE 3 // Start on an edge, once the pattern has been seen
+
+// The trigger is evaluated on raw 8-bit samples, before they are packed. It
+// does not touch any peripherals, so it can be exercised on a host as well.
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+extern void TriggerInit(void);
+extern uint8_t TriggerFired(void);
+extern uint32_t TriggerScan(const volatile uint8_t *samples, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* TRIGGER_H_ */
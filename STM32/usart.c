@@ -18,7 +18,11 @@
 
 #include <stdio.h>
 #include "main.h"
+#include "stm32f4xx_dma.h"
 #include "evalboard.h"
+#include "stats.h"
+
+static void UsartTxInit(void);
 
 /**
  * @brief  Initialize the USART serial I/O
@@ -79,19 +83,94 @@ void UsartInit(void) {
 	USART_ITConfig(USART_NO, USART_IT_RXNE, ENABLE);
 
 	USART_Cmd(USART_NO, ENABLE); // enable USARTx
+
+	UsartTxInit();
+}
+
+/**
+ * @brief  Initialize the DMA stream used by the block transmit engine.
+ * @param  none
+ * @retval none
+ */
+static void UsartTxInit(void) {
+	RCC_AHB1PeriphClockCmd(USART_DMA_PERIPH, ENABLE);
+	DMA_DeInit(USART_DMA_STREAM);
+	USART_DMACmd(USART_NO, USART_DMAReq_Tx, ENABLE);
 }
 
 /**
- * @brief  Send a byte to the USART
+ * @brief  Check if a block transmission is still in progress.
+ * @param  none
+ * @retval non-zero if the transmit DMA is busy, otherwise 0
+ */
+int16_t UsartTxBusy() {
+	// The stream disables itself when the transfer is complete.
+	return DMA_GetCmdStatus(USART_DMA_STREAM) != DISABLE;
+}
+
+/**
+ * @brief  Wait for any block transmission in progress to finish.
+ * @param  none
+ * @retval none
+ */
+void UsartTxWait() {
+	while (UsartTxBusy())
+		;
+}
+
+/**
+ * @brief  Start sending a block of bytes to the USART and return immediately.
+ *         The bytes are moved to the USART by DMA, so the buffer must not be
+ *         changed or re-used until UsartTxBusy() returns 0.
+ * @param  buf: the bytes to send
+ * @param  len: the number of bytes to send
+ * @retval 0 if the transmission was started, -1 if the transmitter is busy
+ */
+int16_t UsartSendBlock(const uint8_t *buf, uint16_t len) {
+	DMA_InitTypeDef dmaInitStructure;
+
+	if (UsartTxBusy())
+		return -1;
+	if (len == 0)
+		return 0;
+
+	Stats.bytesSent += len;
+	DMA_ClearFlag(USART_DMA_STREAM, USART_DMA_FLAGS);
+
+	dmaInitStructure.DMA_Channel = USART_DMA_CHANNEL;
+	dmaInitStructure.DMA_PeripheralBaseAddr = (uint32_t) &USART_NO->DR;
+	dmaInitStructure.DMA_Memory0BaseAddr = (uint32_t) buf;
+	dmaInitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	dmaInitStructure.DMA_BufferSize = len;
+	dmaInitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	dmaInitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	dmaInitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	dmaInitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	dmaInitStructure.DMA_Mode = DMA_Mode_Normal;
+	dmaInitStructure.DMA_Priority = DMA_Priority_High;
+	dmaInitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	dmaInitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_Full;
+	dmaInitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	dmaInitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(USART_DMA_STREAM, &dmaInitStructure);
+	DMA_Cmd(USART_DMA_STREAM, ENABLE);
+	return 0;
+}
+
+/**
+ * @brief  Send a byte to the USART. Any block transmission in progress is
+ *         allowed to finish first.
  * @param  c: the byte to send
  * @retval none
  */
 void UsartSendChar(char c) {
-	USART_SendData(USART_NO, c);
+	UsartTxWait();
 
-	// Wait for the character to be sent.
+	// Wait for the transmit data register to be free.
 	while ((USART_NO ->SR & (1 << 7)) == 0)
 		;
+
+	USART_SendData(USART_NO, c);
 }
 
 /**
@@ -104,14 +183,19 @@ void UsartSendString(char *s) {
 		UsartSendChar(*(s++));
 }
 
-// Queue to hold characters as they come in. Note that no attention is
-// paid to thread-safety or queue overflows here. There should be very
-// little data and it is not considered critical.
-#define MAXQ 256
+// Commands are collected a line at a time by the receive interrupt and queued
+// once complete, so the main loop only has to look at the queue indices to
+// see if there is anything to do, even in the middle of a capture. A line
+// that doesn't fit is cut short; a line that starts arriving while the queue
+// is full is dropped. Carriage returns are left out.
+#define COMMAND_QUEUE_SIZE 8	// a power of 2
+#define COMMAND_LINE_MAX   32	// including the terminating zero
+#define LINE_DROPPED       0xff
 
-volatile char inbuf[MAXQ];
-volatile uint8_t inHead = 0;
-volatile uint8_t inTail = 0;
+static volatile char commandQueue[COMMAND_QUEUE_SIZE][COMMAND_LINE_MAX];
+volatile uint8_t CommandHead = 0;
+volatile uint8_t CommandTail = 0;
+volatile uint8_t CommandLineLength = 0;
 
 /**
  * @brief  ISR to handle incoming bytes from the USART
@@ -119,60 +203,52 @@ volatile uint8_t inTail = 0;
  * @retval none
  */
 void USART_IRQHANDLER() {
+	volatile char *line;
+	uint8_t full;
+	char c;
+
 	if (USART_GetITStatus(USART_NO, USART_IT_RXNE ) != RESET) {
-		// Add incoming bytes to the queue.
-		inbuf[inHead++] = USART_ReceiveData(USART_NO );
-		if (inHead == MAXQ)
-			inHead = 0;
+		c = USART_ReceiveData(USART_NO );
+		line = commandQueue[CommandHead % COMMAND_QUEUE_SIZE];
+		full = (uint8_t) (CommandHead - CommandTail) == COMMAND_QUEUE_SIZE;
+
+		if (c == '\n') {
+			if (CommandLineLength != LINE_DROPPED && !full) {
+				line[CommandLineLength] = '\0';
+				CommandHead++;
+			}
+			CommandLineLength = 0;
+		} else if (c != '\r' && CommandLineLength != LINE_DROPPED) {
+			if (full)
+				CommandLineLength = LINE_DROPPED;
+			else if (CommandLineLength < COMMAND_LINE_MAX - 1)
+				line[CommandLineLength++] = c;
+		}
+
 		USART_ClearITPendingBit(USART_NO, USART_IT_RXNE );
 	}
 }
 
-/**
- * @brief  Get a character from the input queue, if available.
- * @param  none
- * @retval the next character from the queue, or zero if none available.
- */
-char UsartGetchar() {
-	char c;
-
-	if (inHead == inTail)
-		return 0;
-	c = inbuf[inTail++];
-	if (inTail == MAXQ)
-		inTail = 0;
-	return c;
-}
-
-static char getsBuf[200];
+static char getsBuf[COMMAND_LINE_MAX];
 
 /**
- * @brief  Get a string of characters from the input queue, if available.
- * @note   A string is only returned if it is terminated by a linefeed (\n)
- *         character.
+ * @brief  Get the next command line from the input queue, if available.
  * @param  none
- * @retval a pointer to a string of received data, or NULL if none available.
+ * @retval a pointer to the line (without the line end), or NULL if none
+ *         available. The line is only valid until the next call.
  */
 char *UsartGets() {
-	int i;
-	char c, found = 0;
-
-	// Make sure that there is a line-feed in the input buffer before reading characters...
-	for (i = inTail; i != inHead; i++) {
-		if (inbuf[i] == '\n') {
-			found = 1;
-			break;
-		}
-	}
+	uint8_t i;
+	volatile char *line;
 
-	if (!found)
+	if (CommandHead == CommandTail)
 		return NULL ;
 
-	i = 0;
-	while ((c = UsartGetchar()) != '\n') {
-		if (c != '\r')
-			getsBuf[i++] = c;
-	}
+	// Copy the line out before its slot is given back to the interrupt.
+	line = commandQueue[CommandTail % COMMAND_QUEUE_SIZE];
+	for (i = 0; i < COMMAND_LINE_MAX - 1 && line[i] != '\0'; i++)
+		getsBuf[i] = line[i];
 	getsBuf[i] = '\0';
+	CommandTail++;
 	return getsBuf;
 }